@@ -0,0 +1,421 @@
+/******************************************************************************
+    Copyright (C) 2026 by OBS Studio contributors
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "SceneCollectionIndex.hpp"
+
+#include <obs.hpp>
+
+#include <fstream>
+#include <vector>
+
+static constexpr std::string_view indexFileName = "collections.index";
+static constexpr int64_t indexVersion = 2;
+
+namespace {
+
+/* Minimal pull parser over a file stream that only understands as much JSON
+ * as is needed to skip over values. */
+class JsonScanner {
+private:
+	std::ifstream file_;
+	std::vector<char> buffer_ = std::vector<char>(65536);
+	size_t pos_ = 0;
+	size_t size_ = 0;
+
+	bool fill()
+	{
+		if (!file_)
+			return false;
+
+		file_.read(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+		size_ = static_cast<size_t>(file_.gcount());
+		pos_ = 0;
+		return size_ > 0;
+	}
+
+public:
+	explicit JsonScanner(const std::filesystem::path &filePath) : file_(filePath, std::ios::binary) {}
+
+	bool isOpen() const { return file_.is_open(); }
+
+	bool next(char &ch)
+	{
+		if (pos_ == size_ && !fill())
+			return false;
+
+		ch = buffer_[pos_++];
+		return true;
+	}
+
+	bool nextToken(char &ch)
+	{
+		do {
+			if (!next(ch))
+				return false;
+		} while (ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r');
+
+		return true;
+	}
+
+	bool readHex(uint32_t &value)
+	{
+		value = 0;
+
+		for (int i = 0; i < 4; i++) {
+			char ch;
+			if (!next(ch))
+				return false;
+
+			value <<= 4;
+			if (ch >= '0' && ch <= '9')
+				value |= static_cast<uint32_t>(ch - '0');
+			else if (ch >= 'a' && ch <= 'f')
+				value |= static_cast<uint32_t>(ch - 'a' + 10);
+			else if (ch >= 'A' && ch <= 'F')
+				value |= static_cast<uint32_t>(ch - 'A' + 10);
+			else
+				return false;
+		}
+
+		return true;
+	}
+
+	static void appendUtf8(std::string &str, uint32_t codepoint)
+	{
+		if (codepoint < 0x80) {
+			str += static_cast<char>(codepoint);
+		} else if (codepoint < 0x800) {
+			str += static_cast<char>(0xC0 | (codepoint >> 6));
+			str += static_cast<char>(0x80 | (codepoint & 0x3F));
+		} else if (codepoint < 0x10000) {
+			str += static_cast<char>(0xE0 | (codepoint >> 12));
+			str += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+			str += static_cast<char>(0x80 | (codepoint & 0x3F));
+		} else {
+			str += static_cast<char>(0xF0 | (codepoint >> 18));
+			str += static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
+			str += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+			str += static_cast<char>(0x80 | (codepoint & 0x3F));
+		}
+	}
+
+	/* Reads the rest of a string after its opening quote.  If str is
+	 * null, the string is only skipped. */
+	bool readString(std::string *str)
+	{
+		char ch;
+
+		while (next(ch)) {
+			if (ch == '"')
+				return true;
+
+			if (ch != '\\') {
+				if (str)
+					*str += ch;
+				continue;
+			}
+
+			if (!next(ch))
+				return false;
+
+			if (ch == 'u') {
+				uint32_t codepoint;
+				if (!readHex(codepoint))
+					return false;
+
+				if (codepoint >= 0xD800 && codepoint < 0xDC00) {
+					uint32_t low;
+					char backslash, u;
+					if (!next(backslash) || !next(u) || backslash != '\\' || u != 'u' ||
+					    !readHex(low) || low < 0xDC00 || low >= 0xE000)
+						return false;
+
+					codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+				}
+
+				if (str)
+					appendUtf8(*str, codepoint);
+				continue;
+			}
+
+			if (!str)
+				continue;
+
+			switch (ch) {
+			case 'b':
+				*str += '\b';
+				break;
+			case 'f':
+				*str += '\f';
+				break;
+			case 'n':
+				*str += '\n';
+				break;
+			case 'r':
+				*str += '\r';
+				break;
+			case 't':
+				*str += '\t';
+				break;
+			default:
+				*str += ch;
+			}
+		}
+
+		return false;
+	}
+
+	/* Counts the elements of an array whose opening bracket has already
+	 * been read, and returns the first token after it. */
+	bool countArray(size_t &count, char &after)
+	{
+		char ch;
+
+		count = 0;
+		if (!nextToken(ch))
+			return false;
+		if (ch == ']')
+			return nextToken(after);
+
+		for (;;) {
+			/* skipValue would take an empty element as part of the
+			 * next one */
+			if (ch == ',' || ch == ']' || !skipValue(ch, ch))
+				return false;
+
+			count++;
+
+			if (ch == ']')
+				return nextToken(after);
+			if (ch != ',' || !nextToken(ch))
+				return false;
+		}
+	}
+
+	/* Skips a value whose first character has already been read, and
+	 * returns the first token after it. */
+	bool skipValue(char first, char &after)
+	{
+		int depth = 0;
+		char ch = first;
+
+		for (;;) {
+			if (ch == '"') {
+				if (!readString(nullptr))
+					return false;
+			} else if (ch == '{' || ch == '[') {
+				depth++;
+			} else if (ch == '}' || ch == ']') {
+				if (--depth < 0)
+					return false;
+			}
+
+			if (!nextToken(ch))
+				return false;
+
+			/* scalars end at the first structural character */
+			if (depth == 0 && (ch == ',' || ch == '}' || ch == ']')) {
+				after = ch;
+				return true;
+			}
+		}
+	}
+};
+
+} // namespace
+
+namespace OBS {
+SceneCollectionIndex::SceneCollectionIndex(const std::filesystem::path &directory) : directory_(directory) {}
+
+void SceneCollectionIndex::load()
+{
+	const std::string indexPath = (directory_ / indexFileName).u8string();
+
+	headers_.clear();
+	dirty_ = false;
+
+	OBSDataAutoRelease data = obs_data_create_from_json_file(indexPath.c_str());
+	if (!data)
+		return;
+
+	if (obs_data_get_int(data, "version") != indexVersion)
+		return;
+
+	OBSDataArrayAutoRelease collections = obs_data_get_array(data, "collections");
+	const size_t count = obs_data_array_count(collections);
+
+	for (size_t i = 0; i < count; i++) {
+		OBSDataAutoRelease item = obs_data_array_item(collections, i);
+		SceneCollectionHeader header;
+
+		header.name = obs_data_get_string(item, "name");
+		header.sourceCount = static_cast<size_t>(obs_data_get_int(item, "sources"));
+		header.modifiedTime = obs_data_get_int(item, "mtime");
+		header.fileSize = static_cast<uintmax_t>(obs_data_get_int(item, "size"));
+
+		headers_.try_emplace(obs_data_get_string(item, "file"), std::move(header));
+	}
+}
+
+void SceneCollectionIndex::save()
+{
+	if (!dirty_)
+		return;
+
+	const std::string indexPath = (directory_ / indexFileName).u8string();
+
+	OBSDataAutoRelease data = obs_data_create();
+	OBSDataArrayAutoRelease collections = obs_data_array_create();
+
+	for (const auto &[fileName, header] : headers_) {
+		OBSDataAutoRelease item = obs_data_create();
+
+		obs_data_set_string(item, "file", fileName.c_str());
+		obs_data_set_string(item, "name", header.name.c_str());
+		obs_data_set_int(item, "sources", static_cast<long long>(header.sourceCount));
+		obs_data_set_int(item, "mtime", header.modifiedTime);
+		obs_data_set_int(item, "size", static_cast<long long>(header.fileSize));
+
+		obs_data_array_push_back(collections, item);
+	}
+
+	obs_data_set_int(data, "version", indexVersion);
+	obs_data_set_array(data, "collections", collections);
+
+	if (obs_data_save_json_safe(data, indexPath.c_str(), "tmp", nullptr)) {
+		dirty_ = false;
+	} else {
+		blog(LOG_WARNING, "Failed to save scene collection index to '%s'", indexPath.c_str());
+	}
+}
+
+bool SceneCollectionIndex::updateFileInfo(const std::filesystem::path &filePath, SceneCollectionHeader &header) const
+{
+	std::error_code error;
+
+	auto modifiedTime = std::filesystem::last_write_time(filePath, error);
+	if (error)
+		return false;
+
+	auto fileSize = std::filesystem::file_size(filePath, error);
+	if (error)
+		return false;
+
+	header.modifiedTime = static_cast<int64_t>(modifiedTime.time_since_epoch().count());
+	header.fileSize = fileSize;
+	return true;
+}
+
+std::optional<SceneCollectionHeader> SceneCollectionIndex::getCollectionHeader(const std::filesystem::path &filePath)
+{
+	SceneCollectionHeader current;
+	if (!updateFileInfo(filePath, current))
+		return {};
+
+	const std::string fileName = filePath.filename().u8string();
+	auto found = headers_.find(fileName);
+
+	if (found != headers_.end()) {
+		SceneCollectionHeader &header = found->second;
+
+		if (header.modifiedTime == current.modifiedTime && header.fileSize == current.fileSize) {
+			header.used = true;
+			return header;
+		}
+	}
+
+	std::optional<SceneCollectionHeader> scanned = scanCollection(filePath);
+	if (!scanned)
+		return {};
+
+	current.name = std::move(scanned->name);
+	current.sourceCount = scanned->sourceCount;
+	current.used = true;
+	headers_.insert_or_assign(fileName, current);
+	dirty_ = true;
+
+	return current;
+}
+
+void SceneCollectionIndex::removeUnused()
+{
+	for (auto iter = headers_.begin(); iter != headers_.end();) {
+		if (!iter->second.used) {
+			iter = headers_.erase(iter);
+			dirty_ = true;
+		} else {
+			++iter;
+		}
+	}
+}
+
+std::optional<SceneCollectionHeader> SceneCollectionIndex::scanCollection(const std::filesystem::path &filePath)
+{
+	JsonScanner scanner(filePath);
+	SceneCollectionHeader header;
+	bool foundName = false;
+	char ch;
+
+	if (!scanner.isOpen())
+		return {};
+
+	if (!scanner.nextToken(ch) || ch != '{')
+		return {};
+
+	if (!scanner.nextToken(ch))
+		return {};
+
+	while (ch == '"') {
+		std::string key;
+		if (!scanner.readString(&key))
+			return {};
+
+		if (!scanner.nextToken(ch) || ch != ':')
+			return {};
+		if (!scanner.nextToken(ch))
+			return {};
+
+		if (key == "name" && ch == '"' && !foundName) {
+			if (!scanner.readString(&header.name) || !scanner.nextToken(ch))
+				return {};
+			foundName = true;
+		} else if (key == "sources" && ch == '[') {
+			if (!scanner.countArray(header.sourceCount, ch))
+				return {};
+		} else if (!scanner.skipValue(ch, ch)) {
+			return {};
+		}
+
+		if (ch == '}')
+			break;
+		if (ch != ',' || !scanner.nextToken(ch))
+			return {};
+	}
+
+	if (ch != '}')
+		return {};
+
+	/* anything but whitespace after the top-level object is an error */
+	if (scanner.nextToken(ch))
+		return {};
+
+	if (!foundName)
+		return {};
+
+	return header;
+}
+} // namespace OBS
@@ -0,0 +1,68 @@
+/******************************************************************************
+    Copyright (C) 2026 by OBS Studio contributors
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace OBS {
+
+struct SceneCollectionHeader {
+	std::string name;
+	size_t sourceCount = 0;
+	int64_t modifiedTime = 0;
+	uintmax_t fileSize = 0;
+	bool used = false;
+};
+
+/* Metadata of the scene collection files in a directory, stored next to
+ * them so that enumerating collections doesn't need to parse every file.
+ * Entries are keyed by file name and are valid for as long as the file's
+ * modification time and size match. */
+class SceneCollectionIndex {
+private:
+	std::filesystem::path directory_;
+	std::unordered_map<std::string, SceneCollectionHeader> headers_;
+	bool dirty_ = false;
+
+	bool updateFileInfo(const std::filesystem::path &filePath, SceneCollectionHeader &header) const;
+
+public:
+	explicit SceneCollectionIndex(const std::filesystem::path &directory);
+
+	void load();
+	void save();
+
+	/* Returns the metadata of the collection stored in filePath, scanning
+	 * the file if the index has no valid entry for it. */
+	std::optional<SceneCollectionHeader> getCollectionHeader(const std::filesystem::path &filePath);
+
+	/* Drops entries that weren't looked up since the index was loaded. */
+	void removeUnused();
+
+	/* Reads the top-level "name" value of a JSON file and counts the
+	 * elements of its top-level "sources" array.  The rest of the file is
+	 * still scanned, so that a truncated or malformed file fails and the
+	 * caller can fall back to the backup. */
+	static std::optional<SceneCollectionHeader> scanCollection(const std::filesystem::path &filePath);
+};
+} // namespace OBS
@@ -64,6 +64,7 @@ static bool unclean_shutdown = false;
 bool multi = false;
 static bool log_verbose = false;
 static bool unfiltered_log = false;
+static bool profiler_trace = false;
 bool opt_start_streaming = false;
 bool opt_start_recording = false;
 bool opt_studio_mode = false;
@@ -446,27 +447,59 @@ ProfilerSnapshot GetSnapshot()
 	return ProfilerSnapshot{profile_snapshot_create(), SnapshotRelease};
 }
 
-static void SaveProfilerData(const ProfilerSnapshot &snap)
+static BPtr<char> GetProfilerDataPath(const char *extension)
 {
 	if (currentLogFile.empty())
-		return;
+		return nullptr;
 
 	auto pos = currentLogFile.rfind('.');
 	if (pos == currentLogFile.npos)
-		return;
+		return nullptr;
 
 #define LITERAL_SIZE(x) x, (sizeof(x) - 1)
 	ostringstream dst;
 	dst.write(LITERAL_SIZE("obs-studio/profiler_data/"));
 	dst.write(currentLogFile.c_str(), pos);
-	dst.write(LITERAL_SIZE(".csv.gz"));
+	dst << extension;
 #undef LITERAL_SIZE
 
-	BPtr<char> path = GetAppConfigPathPtr(dst.str().c_str());
+	return GetAppConfigPathPtr(dst.str().c_str());
+}
+
+static void SaveProfilerData(const ProfilerSnapshot &snap)
+{
+	BPtr<char> path = GetProfilerDataPath(".csv.gz");
+	if (!path)
+		return;
+
 	if (!profiler_snapshot_dump_csv_gz(snap.get(), path))
 		blog(LOG_WARNING, "Could not save profiler data to '%s'", static_cast<const char *>(path));
 }
 
+/* several seconds of graphics thread history at 60 FPS */
+#define PROFILER_TRACE_EVENTS_PER_THREAD 32768
+
+static void StartProfilerTrace()
+{
+	if (!profiler_trace)
+		return;
+
+	/* traces written on missed frames are named <log>-missed-<n>.json */
+	BPtr<char> prefix = GetProfilerDataPath("");
+	profiler_trace_start(PROFILER_TRACE_EVENTS_PER_THREAD, prefix);
+	blog(LOG_INFO, "Profiler trace recording enabled");
+}
+
+static void SaveProfilerTrace()
+{
+	if (!profiler_trace_active())
+		return;
+
+	BPtr<char> path = GetProfilerDataPath(".trace.json");
+	if (path && !profiler_trace_dump_json(path))
+		blog(LOG_WARNING, "Could not save profiler trace to '%s'", static_cast<const char *>(path));
+}
+
 static auto ProfilerFree = [](void *) {
 	profiler_stop();
 
@@ -476,6 +509,7 @@ static auto ProfilerFree = [](void *) {
 	profiler_print_time_between_calls(snap.get());
 
 	SaveProfilerData(snap);
+	SaveProfilerTrace();
 
 	profiler_free();
 };
@@ -619,6 +653,8 @@ static int run_program(fstream &logFile, int argc, char *argv[])
 		if (!created_log)
 			create_log_file(logFile);
 
+		StartProfilerTrace();
+
 		program.checkForUncleanShutdown();
 
 		qInstallMessageHandler([](QtMsgType type, const QMessageLogContext &, const QString &message) {
@@ -948,6 +984,9 @@ int main(int argc, char *argv[])
 		} else if (arg_is(argv[i], "--unfiltered_log", nullptr)) {
 			unfiltered_log = true;
 
+		} else if (arg_is(argv[i], "--profiler-trace", nullptr)) {
+			profiler_trace = true;
+
 		} else if (arg_is(argv[i], "--startstreaming", nullptr)) {
 			opt_start_streaming = true;
 
@@ -1012,6 +1051,8 @@ int main(int argc, char *argv[])
 				"--verbose: Make log more verbose.\n"
 				"--always-on-top: Start in 'always on top' mode.\n\n"
 				"--unfiltered_log: Make log unfiltered.\n\n"
+				"--profiler-trace: Record a Chrome/Perfetto trace of the profiler, saved next to the\n"
+				"profiler data on exit and whenever a frame misses its deadline.\n\n"
 				"--disable-updater: Disable built-in updater (Windows/Mac only)\n\n"
 				"--disable-missing-files-check: Disable the missing files dialog which can appear on startup.\n\n";
 
@@ -526,6 +526,8 @@ OBSBasicSettings::OBSBasicSettings(QWidget *parent)
 	HookWidget(ui->hdrNominalPeakLevel,  SCROLL_CHANGED, ADV_CHANGED);
 	HookWidget(ui->disableOSXVSync,      CHECK_CHANGED,  ADV_CHANGED);
 	HookWidget(ui->resetOSXVSync,        CHECK_CHANGED,  ADV_CHANGED);
+	HookWidget(ui->zeroCopyRawVideo,     CHECK_CHANGED,  ADV_CHANGED);
+	HookWidget(ui->parallelRawInputs,    CHECK_CHANGED,  ADV_CHANGED);
 	if (obs_audio_monitoring_available())
 		HookWidget(ui->monitoringDevice,     COMBO_CHANGED,  ADV_CHANGED);
 #ifdef _WIN32
@@ -2518,6 +2520,8 @@ void OBSBasicSettings::LoadAdvancedSettings()
 	const char *videoColorRange = config_get_string(main->Config(), "Video", "ColorRange");
 	uint32_t sdrWhiteLevel = (uint32_t)config_get_uint(main->Config(), "Video", "SdrWhiteLevel");
 	uint32_t hdrNominalPeakLevel = (uint32_t)config_get_uint(main->Config(), "Video", "HdrNominalPeakLevel");
+	bool zeroCopyRawVideo = config_get_bool(main->Config(), "Video", "ZeroCopyRawVideo");
+	bool parallelRawInputs = config_get_bool(main->Config(), "Video", "ParallelRawInputs");
 
 	QString monDevName;
 	QString monDevId;
@@ -2578,6 +2582,10 @@ void OBSBasicSettings::LoadAdvancedSettings()
 	SetComboByValue(ui->colorRange, videoColorRange);
 	ui->sdrWhiteLevel->setValue(sdrWhiteLevel);
 	ui->hdrNominalPeakLevel->setValue(hdrNominalPeakLevel);
+	ui->zeroCopyRawVideo->setChecked(zeroCopyRawVideo);
+	ui->zeroCopyRawVideo->setToolTip(QTStr("Basic.Settings.Advanced.Video.ZeroCopyRawVideo.ToolTip"));
+	ui->parallelRawInputs->setChecked(parallelRawInputs);
+	ui->parallelRawInputs->setToolTip(QTStr("Basic.Settings.Advanced.Video.ParallelRawInputs.ToolTip"));
 
 	SetComboByValue(ui->ipFamily, ipFamily);
 	if (!SetComboByValue(ui->bindToIP, bindIP))
@@ -3186,6 +3194,8 @@ void OBSBasicSettings::SaveAdvancedSettings()
 	SaveComboData(ui->colorRange, "Video", "ColorRange");
 	SaveSpinBox(ui->sdrWhiteLevel, "Video", "SdrWhiteLevel");
 	SaveSpinBox(ui->hdrNominalPeakLevel, "Video", "HdrNominalPeakLevel");
+	SaveCheckBox(ui->zeroCopyRawVideo, "Video", "ZeroCopyRawVideo");
+	SaveCheckBox(ui->parallelRawInputs, "Video", "ParallelRawInputs");
 	if (obs_audio_monitoring_available()) {
 		SaveCombo(ui->monitoringDevice, "Audio", "MonitoringDeviceName");
 		SaveComboData(ui->monitoringDevice, "Audio", "MonitoringDeviceId");
@@ -847,6 +847,8 @@ bool OBSBasic::InitBasicConfigDefaults()
 	config_set_default_string(activeConfiguration, "Video", "ColorRange", "Partial");
 	config_set_default_uint(activeConfiguration, "Video", "SdrWhiteLevel", 300);
 	config_set_default_uint(activeConfiguration, "Video", "HdrNominalPeakLevel", 1000);
+	config_set_default_bool(activeConfiguration, "Video", "ZeroCopyRawVideo", false);
+	config_set_default_bool(activeConfiguration, "Video", "ParallelRawInputs", false);
 
 	config_set_default_string(activeConfiguration, "Audio", "MonitoringDeviceId", "default");
 	config_set_default_string(activeConfiguration, "Audio", "MonitoringDeviceName",
@@ -1607,6 +1609,10 @@ int OBSBasic::ResetVideo()
 		const float hdr_nominal_peak_level =
 			(float)config_get_uint(activeConfiguration, "Video", "HdrNominalPeakLevel");
 		obs_set_video_levels(sdr_white_level, hdr_nominal_peak_level);
+		const bool zero_copy = config_get_bool(activeConfiguration, "Video", "ZeroCopyRawVideo");
+		video_output_set_zero_copy(obs_get_video(), zero_copy);
+		const bool parallel_inputs = config_get_bool(activeConfiguration, "Video", "ParallelRawInputs");
+		video_output_set_parallel_inputs(obs_get_video(), parallel_inputs);
 		OBSBasicStats::InitializeValues();
 		OBSProjector::UpdateMultiviewProjectors();
 
@@ -20,6 +20,7 @@
 #include <dialogs/OBSMissingFiles.hpp>
 #include <importer/OBSImporter.hpp>
 #include <models/SceneCollection.hpp>
+#include <models/SceneCollectionIndex.hpp>
 #include <utility/item-widget-helpers.hpp>
 
 #include <qt-wrappers.hpp>
@@ -437,6 +438,9 @@ void OBSBasic::RefreshSceneCollectionCache()
 		return;
 	}
 
+	OBS::SceneCollectionIndex index{collectionsPath};
+	index.load();
+
 	for (const auto &entry : std::filesystem::directory_iterator(collectionsPath)) {
 		if (entry.is_directory()) {
 			continue;
@@ -446,11 +450,19 @@ void OBSBasic::RefreshSceneCollectionCache()
 			continue;
 		}
 
-		OBSDataAutoRelease collectionData =
-			obs_data_create_from_json_file_safe(entry.path().u8string().c_str(), "bak");
-
 		std::string candidateName;
-		std::string collectionName = obs_data_get_string(collectionData, "name");
+		std::string collectionName;
+
+		if (auto header = index.getCollectionHeader(entry.path())) {
+			collectionName = std::move(header->name);
+		} else {
+			/* The file couldn't be scanned, so let the full parser
+			 * fall back to the backup file if there is one. */
+			OBSDataAutoRelease collectionData =
+				obs_data_create_from_json_file_safe(entry.path().u8string().c_str(), "bak");
+
+			collectionName = obs_data_get_string(collectionData, "name");
+		}
 
 		if (collectionName.empty()) {
 			candidateName = entry.path().stem().u8string();
@@ -461,6 +473,9 @@ void OBSBasic::RefreshSceneCollectionCache()
 		foundCollections.try_emplace(candidateName, candidateName, entry.path());
 	}
 
+	index.removeUnused();
+	index.save();
+
 	collections.swap(foundCollections);
 }
 
@@ -61,11 +61,15 @@ static inline const char *cd_serialize_string(uint8_t **pos)
 
 static bool cd_getparam(const calldata_t *data, const char *name, uint8_t **pos)
 {
+	size_t find_size;
 	size_t name_size;
 
 	if (!data->size)
 		return false;
 
+	/* stored name sizes include the null terminator, so comparing sizes
+	 * first skips most parameters without touching their names */
+	find_size = strlen(name) + 1;
 	*pos = data->stack;
 
 	name_size = cd_serialize_size(pos);
@@ -74,7 +78,7 @@ static bool cd_getparam(const calldata_t *data, const char *name, uint8_t **pos)
 		size_t param_size;
 
 		*pos += name_size;
-		if (strcmp(param_name, name) == 0)
+		if (name_size == find_size && memcmp(param_name, name, name_size) == 0)
 			return true;
 
 		param_size = cd_serialize_size(pos);
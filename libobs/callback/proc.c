@@ -16,6 +16,7 @@
 
 #include "../util/darray.h"
 #include "../util/threading.h"
+#include "../util/uthash.h"
 
 #include "decl.h"
 #include "proc.h"
@@ -24,37 +25,34 @@ struct proc_info {
 	struct decl_info func;
 	void *data;
 	proc_handler_proc_t callback;
+
+	UT_hash_handle hh;
 };
 
 static inline void proc_info_free(struct proc_info *pi)
 {
 	decl_info_free(&pi->func);
+	bfree(pi);
 }
 
 struct proc_handler {
-	/* TODO: replace with hash table lookup? */
 	pthread_mutex_t mutex;
-	DARRAY(struct proc_info) procs;
+	struct proc_info *procs;
 };
 
-static struct proc_info *getproc(proc_handler_t *handler, const char *name)
+static inline struct proc_info *getproc(proc_handler_t *handler, const char *name)
 {
-	for (size_t i = 0; i < handler->procs.num; i++) {
-		struct proc_info *info = handler->procs.array + i;
-
-		if (strcmp(info->func.name, name) == 0) {
-			return info;
-		}
-	}
+	struct proc_info *info;
 
-	return NULL;
+	HASH_FIND_STR(handler->procs, name, info);
+	return info;
 }
 
 /* ------------------------------------------------------------------------- */
 
 proc_handler_t *proc_handler_create(void)
 {
-	struct proc_handler *handler = bmalloc(sizeof(struct proc_handler));
+	struct proc_handler *handler = bzalloc(sizeof(struct proc_handler));
 
 	if (pthread_mutex_init_recursive(&handler->mutex) != 0) {
 		blog(LOG_ERROR, "Couldn't create proc_handler mutex");
@@ -62,7 +60,6 @@ proc_handler_t *proc_handler_create(void)
 		return NULL;
 	}
 
-	da_init(handler->procs);
 	return handler;
 }
 
@@ -71,10 +68,13 @@ void proc_handler_destroy(proc_handler_t *handler)
 	if (!handler)
 		return;
 
-	for (size_t i = 0; i < handler->procs.num; i++)
-		proc_info_free(handler->procs.array + i);
+	struct proc_info *info, *temp;
+
+	HASH_ITER (hh, handler->procs, info, temp) {
+		HASH_DEL(handler->procs, info);
+		proc_info_free(info);
+	}
 
-	da_free(handler->procs);
 	pthread_mutex_destroy(&handler->mutex);
 	bfree(handler);
 }
@@ -84,25 +84,25 @@ void proc_handler_add(proc_handler_t *handler, const char *decl_string, proc_han
 	if (!handler)
 		return;
 
-	struct proc_info pi;
-	memset(&pi, 0, sizeof(struct proc_info));
+	struct proc_info *pi = bzalloc(sizeof(struct proc_info));
 
-	if (!parse_decl_string(&pi.func, decl_string)) {
+	if (!parse_decl_string(&pi->func, decl_string)) {
 		blog(LOG_ERROR, "Function declaration invalid: %s", decl_string);
+		proc_info_free(pi);
 		return;
 	}
 
-	pi.callback = proc;
-	pi.data = data;
+	pi->callback = proc;
+	pi->data = data;
 
 	pthread_mutex_lock(&handler->mutex);
 
-	struct proc_info *existing = getproc(handler, pi.func.name);
+	struct proc_info *existing = getproc(handler, pi->func.name);
 	if (existing) {
-		blog(LOG_WARNING, "Procedure '%s' already exists", pi.func.name);
-		proc_info_free(&pi);
+		blog(LOG_WARNING, "Procedure '%s' already exists", pi->func.name);
+		proc_info_free(pi);
 	} else {
-		da_push_back(handler->procs, &pi);
+		HASH_ADD_KEYPTR(hh, handler->procs, pi->func.name, strlen(pi->func.name), pi);
 	}
 
 	pthread_mutex_unlock(&handler->mutex);
@@ -19,6 +19,7 @@
 #include "../util/base.h"
 #include "../util/platform.h"
 #include "../util/dstr.h"
+#include "../util/threading.h"
 #include "vec4.h"
 
 #define blog(level, format, ...) blog(level, "%s: " format, __FUNCTION__, __VA_ARGS__)
@@ -69,10 +70,265 @@ static inline void *alloc_mem(gs_image_file_t *image, uint64_t *mem_usage, size_
 	return bzalloc(size);
 }
 
+static inline void premultiply_frame(void *data, size_t area, enum gs_image_alpha_mode alpha_mode)
+{
+	if (alpha_mode == GS_IMAGE_ALPHA_PREMULTIPLY_SRGB) {
+		gs_premultiply_xyza_srgb_loop(data, area);
+	} else if (alpha_mode == GS_IMAGE_ALPHA_PREMULTIPLY) {
+		gs_premultiply_xyza_loop(data, area);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* streamed gif decoding */
+
+#define GIF_STREAM_MIN_FRAMES 2
+#define GIF_STREAM_MAX_FRAMES 8
+
+struct gif_stream_slot {
+	uint8_t *data;
+	int frame;
+	uint64_t last_used;
+};
+
+struct gs_gif_stream {
+	gs_image_file_t *image;
+	enum gs_image_alpha_mode alpha_mode;
+	size_t frame_size;
+
+	pthread_t thread;
+	bool thread_active;
+	os_event_t *event;
+	volatile bool stop;
+
+	/* slots and requested_frame are protected by the mutex, the spare
+	 * buffer and last_decoded_frame belong to the decoding thread */
+	pthread_mutex_t mutex;
+	struct gif_stream_slot slots[GIF_STREAM_MAX_FRAMES];
+	size_t num_slots;
+	uint64_t use_count;
+	int requested_frame;
+
+	uint8_t *spare;
+	int last_decoded_frame;
+
+	int shown_frame;
+};
+
+static struct gif_stream_slot *gif_stream_find_slot(struct gs_gif_stream *stream, int frame)
+{
+	for (size_t i = 0; i < stream->num_slots; i++) {
+		if (stream->slots[i].frame == frame)
+			return &stream->slots[i];
+	}
+
+	return NULL;
+}
+
+static inline bool gif_stream_frame_wanted(struct gs_gif_stream *stream, int frame)
+{
+	int frame_count = (int)stream->image->gif.frame_count;
+	int ahead = (frame - stream->requested_frame + frame_count) % frame_count;
+	return ahead < (int)stream->num_slots;
+}
+
+/* returns the first frame from the requested one onward that isn't decoded
+ * yet, or -1 if the window is complete */
+static int gif_stream_next_frame(struct gs_gif_stream *stream)
+{
+	int frame_count = (int)stream->image->gif.frame_count;
+	int next = -1;
+
+	pthread_mutex_lock(&stream->mutex);
+	for (size_t i = 0; i < stream->num_slots; i++) {
+		int frame = (stream->requested_frame + (int)i) % frame_count;
+		if (!gif_stream_find_slot(stream, frame)) {
+			next = frame;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&stream->mutex);
+
+	return next;
+}
+
+/* swaps the spare buffer into the least recently used slot that isn't part
+ * of the window */
+static void gif_stream_store(struct gs_gif_stream *stream, int frame)
+{
+	struct gif_stream_slot *victim = NULL;
+
+	pthread_mutex_lock(&stream->mutex);
+
+	for (size_t i = 0; i < stream->num_slots; i++) {
+		struct gif_stream_slot *slot = &stream->slots[i];
+
+		if (slot->frame != -1 && gif_stream_frame_wanted(stream, slot->frame))
+			continue;
+		if (!victim || slot->last_used < victim->last_used)
+			victim = slot;
+	}
+
+	if (victim && gif_stream_frame_wanted(stream, frame)) {
+		uint8_t *data = victim->data;
+		victim->data = stream->spare;
+		victim->frame = frame;
+		victim->last_used = ++stream->use_count;
+		stream->spare = data;
+	}
+
+	pthread_mutex_unlock(&stream->mutex);
+}
+
+static void gif_stream_decode(struct gs_gif_stream *stream, int frame)
+{
+	gs_image_file_t *image = stream->image;
+
+	/* frames build on top of the previous ones, so going backwards means
+	 * starting over from the first frame.  a frame that fails to decode
+	 * just shows what was decoded before it. */
+	int first = frame > stream->last_decoded_frame ? stream->last_decoded_frame + 1 : 0;
+	for (int i = first; i <= frame; i++)
+		gif_decode_frame(&image->gif, i);
+
+	stream->last_decoded_frame = frame;
+
+	memcpy(stream->spare, image->gif.frame_image, stream->frame_size);
+	premultiply_frame(stream->spare, stream->frame_size / 4, stream->alpha_mode);
+
+	gif_stream_store(stream, frame);
+}
+
+static void *gif_stream_thread(void *data)
+{
+	struct gs_gif_stream *stream = data;
+
+	os_set_thread_name("gif stream decode");
+
+	while (os_event_wait(stream->event) == 0) {
+		if (os_atomic_load_bool(&stream->stop))
+			break;
+
+		int frame;
+		while (!os_atomic_load_bool(&stream->stop) && (frame = gif_stream_next_frame(stream)) != -1)
+			gif_stream_decode(stream, frame);
+	}
+
+	return NULL;
+}
+
+/* called with frame 0 decoded and premultiplied in the gif's frame image */
+static struct gs_gif_stream *gif_stream_create(gs_image_file_t *image, enum gs_image_alpha_mode alpha_mode,
+					       uint64_t limit, uint64_t *mem_usage)
+{
+	struct gs_gif_stream *stream = bzalloc(sizeof(*stream));
+	size_t frame_size = (size_t)image->gif.width * image->gif.height * 4;
+	uint64_t num_slots = limit / frame_size;
+
+	if (num_slots < GIF_STREAM_MIN_FRAMES)
+		num_slots = GIF_STREAM_MIN_FRAMES;
+	if (num_slots > GIF_STREAM_MAX_FRAMES)
+		num_slots = GIF_STREAM_MAX_FRAMES;
+	if (num_slots > image->gif.frame_count)
+		num_slots = image->gif.frame_count;
+
+	stream->image = image;
+	stream->alpha_mode = alpha_mode;
+	stream->frame_size = frame_size;
+	stream->num_slots = (size_t)num_slots;
+	stream->last_decoded_frame = -1;
+	stream->shown_frame = 0;
+
+	if (os_event_init(&stream->event, OS_EVENT_TYPE_AUTO) != 0) {
+		bfree(stream);
+		return NULL;
+	}
+	if (pthread_mutex_init(&stream->mutex, NULL) != 0) {
+		os_event_destroy(stream->event);
+		bfree(stream);
+		return NULL;
+	}
+
+	for (size_t i = 0; i < stream->num_slots; i++) {
+		stream->slots[i].data = alloc_mem(image, mem_usage, frame_size);
+		stream->slots[i].frame = -1;
+	}
+	stream->spare = alloc_mem(image, mem_usage, frame_size);
+
+	memcpy(stream->slots[0].data, image->gif.frame_image, frame_size);
+	stream->slots[0].frame = 0;
+	return stream;
+}
+
+static void gif_stream_destroy(struct gs_gif_stream *stream)
+{
+	if (!stream)
+		return;
+
+	if (stream->thread_active) {
+		os_atomic_set_bool(&stream->stop, true);
+		os_event_signal(stream->event);
+		pthread_join(stream->thread, NULL);
+	}
+
+	for (size_t i = 0; i < stream->num_slots; i++)
+		bfree(stream->slots[i].data);
+	bfree(stream->spare);
+
+	pthread_mutex_destroy(&stream->mutex);
+	os_event_destroy(stream->event);
+	bfree(stream);
+}
+
+/* the thread is only started once playback begins, since until then the
+ * gif's frame image is used to create the texture */
+static void gif_stream_request(struct gs_gif_stream *stream, int frame)
+{
+	pthread_mutex_lock(&stream->mutex);
+	stream->requested_frame = frame;
+	pthread_mutex_unlock(&stream->mutex);
+
+	if (!stream->thread_active) {
+		if (pthread_create(&stream->thread, NULL, gif_stream_thread, stream) != 0) {
+			blog(LOG_WARNING, "Failed to create decoding thread for gif of %u frames", stream->image->gif.frame_count);
+			return;
+		}
+		stream->thread_active = true;
+	}
+
+	os_event_signal(stream->event);
+}
+
+/* uploads the current frame if it's decoded, returns false otherwise */
+static bool gif_stream_update_texture(struct gs_gif_stream *stream)
+{
+	gs_image_file_t *image = stream->image;
+	struct gif_stream_slot *slot;
+
+	pthread_mutex_lock(&stream->mutex);
+
+	slot = gif_stream_find_slot(stream, image->cur_frame);
+	if (slot) {
+		slot->last_used = ++stream->use_count;
+		gs_texture_set_image(image->texture, slot->data, image->gif.width * 4, false);
+		stream->shown_frame = image->cur_frame;
+	}
+
+	pthread_mutex_unlock(&stream->mutex);
+
+	if (!slot)
+		gif_stream_request(stream, image->cur_frame);
+	return !!slot;
+}
+
+/* ------------------------------------------------------------------------- */
+
 static bool init_animated_gif(gs_image_file_t *image, const char *path, uint64_t *mem_usage,
-			      enum gs_image_alpha_mode alpha_mode)
+			      enum gs_image_alpha_mode alpha_mode, uint64_t gif_cache_limit,
+			      struct gs_gif_stream **stream)
 {
 	bool is_animated_gif = true;
+	bool streamed = false;
 	gif_result result;
 	uint64_t max_size;
 	size_t size, size_read;
@@ -121,8 +377,9 @@ static bool init_animated_gif(gs_image_file_t *image, const char *path, uint64_t
 	}
 
 	max_size = (uint64_t)image->gif.width * (uint64_t)image->gif.height * (uint64_t)image->gif.frame_count * 4LLU;
+	streamed = stream && gif_cache_limit && max_size > gif_cache_limit;
 
-	if ((uint64_t)get_full_decoded_gif_size(image) != max_size) {
+	if (!streamed && (uint64_t)get_full_decoded_gif_size(image) != max_size) {
 		blog(LOG_WARNING, "Gif '%s' overflowed maximum pointer size", path);
 		goto fail;
 	}
@@ -131,19 +388,22 @@ static bool init_animated_gif(gs_image_file_t *image, const char *path, uint64_t
 	if (image->is_animated_gif) {
 		gif_decode_frame(&image->gif, 0);
 
-		image->animation_frame_cache = alloc_mem(image, mem_usage, image->gif.frame_count * sizeof(uint8_t *));
-		image->animation_frame_data = alloc_mem(image, mem_usage, get_full_decoded_gif_size(image));
+		if (!streamed) {
+			image->animation_frame_cache =
+				alloc_mem(image, mem_usage, image->gif.frame_count * sizeof(uint8_t *));
+			image->animation_frame_data = alloc_mem(image, mem_usage, get_full_decoded_gif_size(image));
+
+			for (unsigned int i = 0; i < image->gif.frame_count; i++) {
+				if (gif_decode_frame(&image->gif, i) != GIF_OK)
+					blog(LOG_WARNING,
+					     "Couldn't decode frame %u "
+					     "of '%s'",
+					     i, path);
+			}
 
-		for (unsigned int i = 0; i < image->gif.frame_count; i++) {
-			if (gif_decode_frame(&image->gif, i) != GIF_OK)
-				blog(LOG_WARNING,
-				     "Couldn't decode frame %u "
-				     "of '%s'",
-				     i, path);
+			gif_decode_frame(&image->gif, 0);
 		}
 
-		gif_decode_frame(&image->gif, 0);
-
 		image->cx = (uint32_t)image->gif.width;
 		image->cy = (uint32_t)image->gif.height;
 		image->format = GS_RGBA;
@@ -153,10 +413,17 @@ static bool init_animated_gif(gs_image_file_t *image, const char *path, uint64_t
 			*mem_usage += size;
 		}
 
-		if (alpha_mode == GS_IMAGE_ALPHA_PREMULTIPLY_SRGB) {
-			gs_premultiply_xyza_srgb_loop(image->gif.frame_image, (size_t)image->cx * image->cy);
-		} else if (alpha_mode == GS_IMAGE_ALPHA_PREMULTIPLY) {
-			gs_premultiply_xyza_loop(image->gif.frame_image, (size_t)image->cx * image->cy);
+		premultiply_frame(image->gif.frame_image, (size_t)image->cx * image->cy, alpha_mode);
+
+		if (streamed) {
+			*stream = gif_stream_create(image, alpha_mode, gif_cache_limit, mem_usage);
+			if (!*stream) {
+				blog(LOG_WARNING, "Failed to create decoding state for gif '%s'", path);
+				goto fail;
+			}
+
+			blog(LOG_INFO, "Decoding %u frames of '%s' on demand, keeping %zu in memory",
+			     image->gif.frame_count, path, (*stream)->num_slots);
 		}
 	} else {
 		gif_finalise(&image->gif);
@@ -179,7 +446,8 @@ not_animated:
 }
 
 static void gs_image_file_init_internal(gs_image_file_t *image, const char *file, uint64_t *mem_usage,
-					enum gs_color_space *space, enum gs_image_alpha_mode alpha_mode)
+					enum gs_color_space *space, enum gs_image_alpha_mode alpha_mode,
+					uint64_t gif_cache_limit, struct gs_gif_stream **stream)
 {
 	size_t len;
 
@@ -194,7 +462,7 @@ static void gs_image_file_init_internal(gs_image_file_t *image, const char *file
 	len = strlen(file);
 
 	if (len > 4 && astrcmpi(file + len - 4, ".gif") == 0) {
-		if (init_animated_gif(image, file, mem_usage, alpha_mode)) {
+		if (init_animated_gif(image, file, mem_usage, alpha_mode, gif_cache_limit, stream)) {
 			return;
 		}
 	}
@@ -216,7 +484,7 @@ static void gs_image_file_init_internal(gs_image_file_t *image, const char *file
 void gs_image_file_init(gs_image_file_t *image, const char *file)
 {
 	enum gs_color_space unused;
-	gs_image_file_init_internal(image, file, NULL, &unused, GS_IMAGE_ALPHA_STRAIGHT);
+	gs_image_file_init_internal(image, file, NULL, &unused, GS_IMAGE_ALPHA_STRAIGHT, 0, NULL);
 }
 
 void gs_image_file_free(gs_image_file_t *image)
@@ -242,23 +510,44 @@ void gs_image_file_free(gs_image_file_t *image)
 void gs_image_file2_init(gs_image_file2_t *if2, const char *file)
 {
 	enum gs_color_space unused;
-	gs_image_file_init_internal(&if2->image, file, &if2->mem_usage, &unused, GS_IMAGE_ALPHA_STRAIGHT);
+	gs_image_file_init_internal(&if2->image, file, &if2->mem_usage, &unused, GS_IMAGE_ALPHA_STRAIGHT, 0, NULL);
 }
 
 void gs_image_file3_init(gs_image_file3_t *if3, const char *file, enum gs_image_alpha_mode alpha_mode)
 {
 	enum gs_color_space unused;
-	gs_image_file_init_internal(&if3->image2.image, file, &if3->image2.mem_usage, &unused, alpha_mode);
+	gs_image_file_init_internal(&if3->image2.image, file, &if3->image2.mem_usage, &unused, alpha_mode, 0, NULL);
 	if3->alpha_mode = alpha_mode;
 }
 
 void gs_image_file4_init(gs_image_file4_t *if4, const char *file, enum gs_image_alpha_mode alpha_mode)
 {
 	gs_image_file_init_internal(&if4->image3.image2.image, file, &if4->image3.image2.mem_usage, &if4->space,
-				    alpha_mode);
+				    alpha_mode, 0, NULL);
 	if4->image3.alpha_mode = alpha_mode;
 }
 
+void gs_image_file5_init(gs_image_file5_t *if5, const char *file, enum gs_image_alpha_mode alpha_mode,
+			 uint64_t gif_cache_limit)
+{
+	gs_image_file4_t *if4 = &if5->image4;
+
+	if5->gif_cache_limit = gif_cache_limit;
+	if5->gif_stream = NULL;
+
+	gs_image_file_init_internal(&if4->image3.image2.image, file, &if4->image3.image2.mem_usage, &if4->space,
+				    alpha_mode, gif_cache_limit, &if5->gif_stream);
+	if4->image3.alpha_mode = alpha_mode;
+}
+
+void gs_image_file5_free(gs_image_file5_t *if5)
+{
+	gif_stream_destroy(if5->gif_stream);
+	if5->gif_stream = NULL;
+
+	gs_image_file4_free(&if5->image4);
+}
+
 void gs_image_file_init_texture(gs_image_file_t *image)
 {
 	if (!image->loaded)
@@ -328,11 +617,7 @@ static void decode_new_frame(gs_image_file_t *image, int new_frame, enum gs_imag
 			size_t pos = new_frame * area * 4;
 			image->animation_frame_cache[new_frame] = image->animation_frame_data + pos;
 
-			if (alpha_mode == GS_IMAGE_ALPHA_PREMULTIPLY_SRGB) {
-				gs_premultiply_xyza_srgb_loop(image->gif.frame_image, area);
-			} else if (alpha_mode == GS_IMAGE_ALPHA_PREMULTIPLY) {
-				gs_premultiply_xyza_loop(image->gif.frame_image, area);
-			}
+			premultiply_frame(image->gif.frame_image, area, alpha_mode);
 
 			memcpy(image->animation_frame_cache[new_frame], image->gif.frame_image, area * 4);
 
@@ -344,7 +629,7 @@ static void decode_new_frame(gs_image_file_t *image, int new_frame, enum gs_imag
 }
 
 static bool gs_image_file_tick_internal(gs_image_file_t *image, uint64_t elapsed_time_ns,
-					enum gs_image_alpha_mode alpha_mode)
+					enum gs_image_alpha_mode alpha_mode, struct gs_gif_stream *stream)
 {
 	int loops;
 
@@ -359,39 +644,58 @@ static bool gs_image_file_tick_internal(gs_image_file_t *image, uint64_t elapsed
 		int new_frame = calculate_new_frame(image, elapsed_time_ns, loops);
 
 		if (new_frame != image->cur_frame) {
-			decode_new_frame(image, new_frame, alpha_mode);
+			if (stream) {
+				image->cur_frame = new_frame;
+				gif_stream_request(stream, new_frame);
+			} else {
+				decode_new_frame(image, new_frame, alpha_mode);
+			}
 			return true;
 		}
 	}
 
-	return false;
+	/* keep asking for an update until the decoding thread catches up */
+	return stream && stream->shown_frame != image->cur_frame;
 }
 
 bool gs_image_file_tick(gs_image_file_t *image, uint64_t elapsed_time_ns)
 {
-	return gs_image_file_tick_internal(image, elapsed_time_ns, false);
+	return gs_image_file_tick_internal(image, elapsed_time_ns, false, NULL);
 }
 
 bool gs_image_file2_tick(gs_image_file2_t *if2, uint64_t elapsed_time_ns)
 {
-	return gs_image_file_tick_internal(&if2->image, elapsed_time_ns, false);
+	return gs_image_file_tick_internal(&if2->image, elapsed_time_ns, false, NULL);
 }
 
 bool gs_image_file3_tick(gs_image_file3_t *if3, uint64_t elapsed_time_ns)
 {
-	return gs_image_file_tick_internal(&if3->image2.image, elapsed_time_ns, if3->alpha_mode);
+	return gs_image_file_tick_internal(&if3->image2.image, elapsed_time_ns, if3->alpha_mode, NULL);
 }
 
 bool gs_image_file4_tick(gs_image_file4_t *if4, uint64_t elapsed_time_ns)
 {
-	return gs_image_file_tick_internal(&if4->image3.image2.image, elapsed_time_ns, if4->image3.alpha_mode);
+	return gs_image_file_tick_internal(&if4->image3.image2.image, elapsed_time_ns, if4->image3.alpha_mode, NULL);
+}
+
+bool gs_image_file5_tick(gs_image_file5_t *if5, uint64_t elapsed_time_ns)
+{
+	gs_image_file4_t *if4 = &if5->image4;
+	return gs_image_file_tick_internal(&if4->image3.image2.image, elapsed_time_ns, if4->image3.alpha_mode,
+					   if5->gif_stream);
 }
 
-static void gs_image_file_update_texture_internal(gs_image_file_t *image, enum gs_image_alpha_mode alpha_mode)
+static void gs_image_file_update_texture_internal(gs_image_file_t *image, enum gs_image_alpha_mode alpha_mode,
+						  struct gs_gif_stream *stream)
 {
 	if (!image->is_animated_gif || !image->loaded)
 		return;
 
+	if (stream) {
+		gif_stream_update_texture(stream);
+		return;
+	}
+
 	if (!image->animation_frame_cache[image->cur_frame])
 		decode_new_frame(image, image->cur_frame, alpha_mode);
 
@@ -401,20 +705,26 @@ static void gs_image_file_update_texture_internal(gs_image_file_t *image, enum g
 
 void gs_image_file_update_texture(gs_image_file_t *image)
 {
-	gs_image_file_update_texture_internal(image, false);
+	gs_image_file_update_texture_internal(image, false, NULL);
 }
 
 void gs_image_file2_update_texture(gs_image_file2_t *if2)
 {
-	gs_image_file_update_texture_internal(&if2->image, false);
+	gs_image_file_update_texture_internal(&if2->image, false, NULL);
 }
 
 void gs_image_file3_update_texture(gs_image_file3_t *if3)
 {
-	gs_image_file_update_texture_internal(&if3->image2.image, if3->alpha_mode);
+	gs_image_file_update_texture_internal(&if3->image2.image, if3->alpha_mode, NULL);
 }
 
 void gs_image_file4_update_texture(gs_image_file4_t *if4)
 {
-	gs_image_file_update_texture_internal(&if4->image3.image2.image, if4->image3.alpha_mode);
+	gs_image_file_update_texture_internal(&if4->image3.image2.image, if4->image3.alpha_mode, NULL);
+}
+
+void gs_image_file5_update_texture(gs_image_file5_t *if5)
+{
+	gs_image_file4_t *if4 = &if5->image4;
+	gs_image_file_update_texture_internal(&if4->image3.image2.image, if4->image3.alpha_mode, if5->gif_stream);
 }
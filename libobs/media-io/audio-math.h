@@ -18,6 +18,7 @@
 #pragma once
 
 #include "../util/c99defs.h"
+#include "../util/sse-intrin.h"
 #include <math.h>
 
 #ifdef _MSC_VER
@@ -38,6 +39,29 @@ static inline float db_to_mul(const float db)
 	return isfinite((double)db) ? powf(10.0f, db / 20.0f) : 0.0f;
 }
 
+/* adds count samples of src to dst, neither needs to be aligned */
+static inline void audio_mix_floats(float *dst, const float *src, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 16 <= count; i += 16) {
+		__m128 a0 = _mm_add_ps(_mm_loadu_ps(dst + i), _mm_loadu_ps(src + i));
+		__m128 a1 = _mm_add_ps(_mm_loadu_ps(dst + i + 4), _mm_loadu_ps(src + i + 4));
+		__m128 a2 = _mm_add_ps(_mm_loadu_ps(dst + i + 8), _mm_loadu_ps(src + i + 8));
+		__m128 a3 = _mm_add_ps(_mm_loadu_ps(dst + i + 12), _mm_loadu_ps(src + i + 12));
+		_mm_storeu_ps(dst + i, a0);
+		_mm_storeu_ps(dst + i + 4, a1);
+		_mm_storeu_ps(dst + i + 8, a2);
+		_mm_storeu_ps(dst + i + 12, a3);
+	}
+
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_loadu_ps(src + i)));
+
+	for (; i < count; i++)
+		dst[i] += src[i];
+}
+
 #ifdef _MSC_VER
 #pragma warning(pop)
 #endif
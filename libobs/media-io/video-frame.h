@@ -31,6 +31,10 @@ struct video_frame {
 
 EXPORT void video_frame_init(struct video_frame *frame, enum video_format format, uint32_t width, uint32_t height);
 
+/* number of lines of each plane, the array must be zeroed beforehand */
+EXPORT void video_frame_get_plane_heights(uint32_t heights[MAX_AV_PLANES], enum video_format format,
+					  uint32_t height);
+
 static inline void video_frame_free(struct video_frame *frame)
 {
 	if (frame) {
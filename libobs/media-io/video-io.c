@@ -22,6 +22,7 @@
 #include "../util/profiler.h"
 #include "../util/threading.h"
 #include "../util/darray.h"
+#include "../util/deque.h"
 #include "../util/util_uint64.h"
 
 #include "format-conversion.h"
@@ -33,19 +34,66 @@ extern profiler_name_store_t *obs_get_profiler_name_store(void);
 
 #define MAX_CONVERT_BUFFERS 3
 #define MAX_CACHE_SIZE 16
+#define MAX_INPUT_QUEUE 2
+
+/* shared ownership of a cache frame's buffer while threaded inputs are still
+ * processing it.  if the cache entry is recycled before the inputs are done,
+ * the entry gets a spare buffer and the last input to release the reference
+ * returns the old buffer to the spare pool, or hands a referenced frame back
+ * to its producer. */
+struct frame_ref {
+	struct video_frame frame;
+	volatile long refs;
+	void (*release)(void *param);
+	void *release_param;
+};
 
 struct cached_frame_info {
 	struct video_data frame;
 	int skipped;
 	int count;
+	struct frame_ref *ref;
+
+	/* set while the entry references the producer's planes, the entry's
+	 * own planes are kept in buffer until they're released */
+	void (*release)(void *param);
+	void *release_param;
+	struct video_frame buffer;
 };
 
-struct video_input {
+struct queued_frame {
+	struct frame_ref *ref;
+	struct video_data frame;
+
+	/* frames this entry stands for, more than one if earlier frames were
+	 * dropped because the queue was full */
+	uint32_t count;
+};
+
+/* scaler and scaled frames of one conversion.  inputs on the video thread
+ * that use the same conversion and frame rate divisor share a single group,
+ * so each frame is only scaled once and every input in the group gets the
+ * same read-only scaled frame. */
+struct scale_group {
 	struct video_scale_info conversion;
+	uint32_t frame_rate_divisor;
+	bool shared;
+	long refs;
+
 	video_scaler_t *scaler;
 	struct video_frame frame[MAX_CONVERT_BUFFERS];
 	int cur_frame;
 
+	bool scaled;
+	uint64_t scaled_timestamp;
+	const uint8_t *scaled_source;
+};
+
+struct video_input {
+	struct video_output *video;
+	struct video_scale_info conversion;
+	struct scale_group *scale_group;
+
 	// allow outputting at fractions of main composition FPS,
 	// e.g. 60 FPS with frame_rate_divisor = 1 turns into 30 FPS
 	//
@@ -58,14 +106,22 @@ struct video_input {
 
 	void (*callback)(void *param, struct video_data *frame);
 	void *param;
-};
 
-static inline void video_input_free(struct video_input *input)
-{
-	for (size_t i = 0; i < MAX_CONVERT_BUFFERS; i++)
-		video_frame_free(&input->frame[i]);
-	video_scaler_destroy(input->scaler);
-}
+	/* threaded inputs are scaled and called back on their own thread,
+	 * fed through a bounded queue so a slow input cannot hold up others */
+	bool threaded;
+	volatile bool stop;
+	volatile bool finished;
+	pthread_t thread;
+	pthread_mutex_t queue_mutex;
+	os_sem_t *queue_sem;
+	struct deque queue;
+	uint32_t dropped;
+
+	volatile long total_frames;
+	volatile long lagged_frames;
+	volatile long skipped_frames;
+};
 
 struct video_output {
 	struct video_output_info info;
@@ -80,12 +136,17 @@ struct video_output {
 	volatile long total_frames;
 
 	pthread_mutex_t input_mutex;
-	DARRAY(struct video_input) inputs;
+	DARRAY(struct video_input *) inputs;
+	DARRAY(struct video_input *) detached_inputs;
+	DARRAY(struct scale_group *) scale_groups;
+	bool parallel_inputs;
+	volatile bool zero_copy;
 
 	size_t available_frames;
 	size_t first_added;
 	size_t last_added;
 	struct cached_frame_info cache[MAX_CACHE_SIZE];
+	DARRAY(struct video_frame) spare_frames;
 
 	struct video_output *parent;
 
@@ -95,32 +156,144 @@ struct video_output {
 
 /* ------------------------------------------------------------------------- */
 
+static void release_frame_ref(struct video_output *video, struct frame_ref *ref)
+{
+	if (os_atomic_dec_long(&ref->refs) != 0)
+		return;
+
+	if (ref->release) {
+		ref->release(ref->release_param);
+	} else {
+		pthread_mutex_lock(&video->data_mutex);
+		da_push_back(video->spare_frames, &ref->frame);
+		pthread_mutex_unlock(&video->data_mutex);
+	}
+
+	bfree(ref);
+}
+
+/* hands a referenced frame back to its producer and restores the entry's own
+ * planes, release is NULL if the inputs still hold the frame */
+static void release_referenced_frame(struct cached_frame_info *frame_info, void (*release)(void *param))
+{
+	if (release)
+		release(frame_info->release_param);
+
+	memcpy(frame_info->frame.data, frame_info->buffer.data, sizeof(frame_info->buffer.data));
+	memcpy(frame_info->frame.linesize, frame_info->buffer.linesize, sizeof(frame_info->buffer.linesize));
+	frame_info->release = NULL;
+	frame_info->release_param = NULL;
+}
+
+/* called with data_mutex locked when a cache entry is about to be reused */
+static void detach_frame_ref(struct video_output *video, struct cached_frame_info *frame_info)
+{
+	struct frame_ref *ref = frame_info->ref;
+	struct video_frame frame;
+
+	frame_info->ref = NULL;
+
+	if (os_atomic_dec_long(&ref->refs) == 0) {
+		bfree(ref);
+		if (frame_info->release)
+			release_referenced_frame(frame_info, frame_info->release);
+		return;
+	}
+
+	/* the last input to finish releases the producer's frame */
+	if (frame_info->release) {
+		release_referenced_frame(frame_info, NULL);
+		return;
+	}
+
+	/* the old buffer now belongs to the inputs still using it */
+	if (video->spare_frames.num) {
+		frame = video->spare_frames.array[video->spare_frames.num - 1];
+		da_pop_back(video->spare_frames);
+	} else {
+		video_frame_init(&frame, video->info.format, video->info.width, video->info.height);
+	}
+
+	memcpy(frame_info->frame.data, frame.data, sizeof(frame.data));
+	memcpy(frame_info->frame.linesize, frame.linesize, sizeof(frame.linesize));
+}
+
 static inline bool scale_video_output(struct video_input *input, struct video_data *data)
 {
-	bool success = true;
+	struct scale_group *group = input->scale_group;
+	struct video_frame *frame;
 
-	if (input->scaler) {
-		struct video_frame *frame;
+	if (!group)
+		return true;
 
-		if (++input->cur_frame == MAX_CONVERT_BUFFERS)
-			input->cur_frame = 0;
+	/* another input of the group already scaled this frame */
+	if (group->scaled && group->scaled_timestamp == data->timestamp && group->scaled_source == data->data[0]) {
+		frame = &group->frame[group->cur_frame];
 
-		frame = &input->frame[input->cur_frame];
+	} else {
+		if (++group->cur_frame == MAX_CONVERT_BUFFERS)
+			group->cur_frame = 0;
 
-		success = video_scaler_scale(input->scaler, frame->data, frame->linesize,
-					     (const uint8_t *const *)data->data, data->linesize);
+		frame = &group->frame[group->cur_frame];
 
-		if (success) {
-			for (size_t i = 0; i < MAX_AV_PLANES; i++) {
-				data->data[i] = frame->data[i];
-				data->linesize[i] = frame->linesize[i];
-			}
-		} else {
+		group->scaled = video_scaler_scale(group->scaler, frame->data, frame->linesize,
+						   (const uint8_t *const *)data->data, data->linesize);
+		if (!group->scaled) {
 			blog(LOG_WARNING, "video-io: Could not scale frame!");
+			return false;
 		}
+
+		group->scaled_timestamp = data->timestamp;
+		group->scaled_source = data->data[0];
 	}
 
-	return success;
+	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+		data->data[i] = frame->data[i];
+		data->linesize[i] = frame->linesize[i];
+	}
+
+	return true;
+}
+
+static void video_input_queue_frame(struct video_input *input, struct cached_frame_info *frame_info,
+				    const struct video_data *frame)
+{
+	struct queued_frame queued;
+	size_t num_queued;
+
+	pthread_mutex_lock(&input->queue_mutex);
+
+	num_queued = input->queue.size / sizeof(struct queued_frame);
+	if (num_queued >= MAX_INPUT_QUEUE) {
+		input->dropped++;
+		pthread_mutex_unlock(&input->queue_mutex);
+		os_atomic_inc_long(&input->skipped_frames);
+		return;
+	}
+	if (num_queued)
+		os_atomic_inc_long(&input->lagged_frames);
+
+	if (!frame_info->ref) {
+		frame_info->ref = bzalloc(sizeof(struct frame_ref));
+		frame_info->ref->refs = 1;
+		frame_info->ref->release = frame_info->release;
+		frame_info->ref->release_param = frame_info->release_param;
+		memcpy(frame_info->ref->frame.data, frame_info->frame.data, sizeof(frame_info->frame.data));
+		memcpy(frame_info->ref->frame.linesize, frame_info->frame.linesize,
+		       sizeof(frame_info->frame.linesize));
+	}
+
+	os_atomic_inc_long(&frame_info->ref->refs);
+
+	queued.ref = frame_info->ref;
+	queued.frame = *frame;
+	queued.count = input->dropped + 1;
+	input->dropped = 0;
+	deque_push_back(&input->queue, &queued, sizeof(queued));
+
+	pthread_mutex_unlock(&input->queue_mutex);
+
+	os_sem_post(input->queue_sem);
 }
 
 static inline bool video_output_cur_frame(struct video_output *video)
@@ -142,7 +315,7 @@ static inline bool video_output_cur_frame(struct video_output *video)
 	pthread_mutex_lock(&video->input_mutex);
 
 	for (size_t i = 0; i < video->inputs.num; i++) {
-		struct video_input *input = video->inputs.array + i;
+		struct video_input *input = video->inputs.array[i];
 		struct video_data frame = frame_info->frame;
 
 		// an explicit counter is used instead of remainder calculation
@@ -155,6 +328,13 @@ static inline bool video_output_cur_frame(struct video_output *video)
 		if (skip)
 			continue;
 
+		os_atomic_inc_long(&input->total_frames);
+
+		if (input->threaded) {
+			video_input_queue_frame(input, frame_info, &frame);
+			continue;
+		}
+
 		if (scale_video_output(input, &frame))
 			input->callback(input->param, &frame);
 	}
@@ -170,6 +350,11 @@ static inline bool video_output_cur_frame(struct video_output *video)
 	skipped = frame_info->skipped > 0;
 
 	if (complete) {
+		if (frame_info->ref)
+			detach_frame_ref(video, frame_info);
+		else if (frame_info->release)
+			release_referenced_frame(frame_info, frame_info->release);
+
 		if (++video->first_added == video->info.cache_size)
 			video->first_added = 0;
 
@@ -216,6 +401,182 @@ static void *video_thread(void *param)
 
 /* ------------------------------------------------------------------------- */
 
+static void scale_group_destroy(struct scale_group *group)
+{
+	for (size_t i = 0; i < MAX_CONVERT_BUFFERS; i++)
+		video_frame_free(&group->frame[i]);
+	video_scaler_destroy(group->scaler);
+	bfree(group);
+}
+
+static void scale_group_release(struct video_output *video, struct scale_group *group)
+{
+	if (!group)
+		return;
+
+	/* groups of threaded inputs are private to the input */
+	if (!group->shared) {
+		scale_group_destroy(group);
+		return;
+	}
+
+	pthread_mutex_lock(&video->input_mutex);
+	if (--group->refs == 0) {
+		da_erase_item(video->scale_groups, &group);
+		scale_group_destroy(group);
+	}
+	pthread_mutex_unlock(&video->input_mutex);
+}
+
+static void video_input_destroy(struct video_input *input)
+{
+	scale_group_release(input->video, input->scale_group);
+
+	if (input->threaded) {
+		deque_free(&input->queue);
+		os_sem_destroy(input->queue_sem);
+		pthread_mutex_destroy(&input->queue_mutex);
+	}
+
+	bfree(input);
+}
+
+static void video_input_drain(struct video_input *input)
+{
+	struct queued_frame queued;
+
+	pthread_mutex_lock(&input->queue_mutex);
+	while (input->queue.size) {
+		deque_pop_front(&input->queue, &queued, sizeof(queued));
+		release_frame_ref(input->video, queued.ref);
+	}
+	pthread_mutex_unlock(&input->queue_mutex);
+}
+
+/* dropped frames are made up for by repeating the next frame that gets
+ * through, the same way the cache repeats frames when rendering lags, so the
+ * input sees one frame per interval and stays in sync with audio */
+static void video_input_output_frame(struct video_input *input, struct queued_frame *queued)
+{
+	uint64_t interval = input->video->frame_time * input->frame_rate_divisor;
+	uint64_t timestamp = queued->frame.timestamp;
+
+	for (uint32_t i = queued->count; i > 0; i--) {
+		struct video_data frame = queued->frame;
+
+		frame.timestamp = timestamp - interval * (i - 1);
+		input->callback(input->param, &frame);
+
+		if (os_atomic_load_bool(&input->stop))
+			break;
+	}
+}
+
+static void *video_input_thread(void *param)
+{
+	struct video_input *input = param;
+	struct queued_frame queued;
+
+	os_set_thread_name("video-io: input thread");
+
+	const char *input_thread_name =
+		profile_store_name(obs_get_profiler_name_store(), "video_input_thread(%s)", input->video->info.name);
+
+	while (os_sem_wait(input->queue_sem) == 0) {
+		if (os_atomic_load_bool(&input->stop))
+			break;
+
+		pthread_mutex_lock(&input->queue_mutex);
+		deque_pop_front(&input->queue, &queued, sizeof(queued));
+		pthread_mutex_unlock(&input->queue_mutex);
+
+		profile_start(input_thread_name);
+		if (scale_video_output(input, &queued.frame))
+			video_input_output_frame(input, &queued);
+		profile_end(input_thread_name);
+
+		release_frame_ref(input->video, queued.ref);
+
+		profile_reenable_thread();
+
+		/* the callback may have disconnected this input */
+		if (os_atomic_load_bool(&input->stop))
+			break;
+	}
+
+	video_input_drain(input);
+	os_atomic_set_bool(&input->finished, true);
+	return NULL;
+}
+
+static bool video_input_start_thread(struct video_input *input)
+{
+	if (pthread_mutex_init(&input->queue_mutex, NULL) != 0)
+		return false;
+	if (os_sem_init(&input->queue_sem, 0) != 0)
+		goto fail1;
+	if (pthread_create(&input->thread, NULL, video_input_thread, input) != 0)
+		goto fail2;
+
+	input->threaded = true;
+	return true;
+
+fail2:
+	os_sem_destroy(input->queue_sem);
+fail1:
+	pthread_mutex_destroy(&input->queue_mutex);
+	return false;
+}
+
+static void video_input_free(struct video_input *input)
+{
+	if (input->threaded) {
+		os_atomic_set_bool(&input->stop, true);
+		os_sem_post(input->queue_sem);
+
+		/* disconnected from within its own callback, so the thread
+		 * is joined later, once the callback has returned */
+		if (pthread_equal(pthread_self(), input->thread)) {
+			pthread_mutex_lock(&input->video->input_mutex);
+			da_push_back(input->video->detached_inputs, &input);
+			pthread_mutex_unlock(&input->video->input_mutex);
+			return;
+		}
+
+		pthread_join(input->thread, NULL);
+	}
+
+	video_input_destroy(input);
+}
+
+/* joins the threads of inputs that disconnected themselves, only the ones
+ * that have already finished unless wait is set */
+static void video_input_reap_detached(struct video_output *video, bool wait)
+{
+	DARRAY(struct video_input *) finished;
+
+	da_init(finished);
+
+	pthread_mutex_lock(&video->input_mutex);
+	for (size_t i = 0; i < video->detached_inputs.num; i++) {
+		struct video_input *input = video->detached_inputs.array[i];
+
+		if (wait || os_atomic_load_bool(&input->finished)) {
+			da_push_back(finished, &input);
+			da_erase(video->detached_inputs, i--);
+		}
+	}
+	pthread_mutex_unlock(&video->input_mutex);
+
+	for (size_t i = 0; i < finished.num; i++) {
+		pthread_join(finished.array[i]->thread, NULL);
+		video_input_destroy(finished.array[i]);
+	}
+	da_free(finished);
+}
+
+/* ------------------------------------------------------------------------- */
+
 static inline bool valid_video_params(const struct video_output_info *info)
 {
 	return info->height != 0 && info->width != 0 && info->fps_den != 0 && info->fps_num != 0;
@@ -277,19 +638,41 @@ fail0:
 
 void video_output_close(video_t *video)
 {
+	DARRAY(struct video_input *) inputs;
+
 	if (!video)
 		return;
 
 	video_output_stop(video);
 
+	/* input threads are joined outside of input_mutex, their callbacks
+	 * may try to disconnect themselves */
+	da_init(inputs);
 	pthread_mutex_lock(&video->input_mutex);
+	da_move(inputs, video->inputs);
+	pthread_mutex_unlock(&video->input_mutex);
+
+	for (size_t i = 0; i < inputs.num; i++)
+		video_input_free(inputs.array[i]);
+	da_free(inputs);
+
+	/* their threads still release frames into the spare pool */
+	video_input_reap_detached(video, true);
 
-	for (size_t i = 0; i < video->inputs.num; i++)
-		video_input_free(&video->inputs.array[i]);
-	da_free(video->inputs);
+	pthread_mutex_lock(&video->input_mutex);
+	da_free(video->detached_inputs);
+	da_free(video->scale_groups);
 
-	for (size_t i = 0; i < video->info.cache_size; i++)
+	for (size_t i = 0; i < video->info.cache_size; i++) {
+		if (video->cache[i].release)
+			release_referenced_frame(&video->cache[i], video->cache[i].release);
+		bfree(video->cache[i].ref);
 		video_frame_free((struct video_frame *)&video->cache[i]);
+	}
+
+	for (size_t i = 0; i < video->spare_frames.num; i++)
+		video_frame_free(&video->spare_frames.array[i]);
+	da_free(video->spare_frames);
 
 	pthread_mutex_unlock(&video->input_mutex);
 	os_sem_destroy(video->update_semaphore);
@@ -303,7 +686,7 @@ static size_t video_get_input_idx(const video_t *video, void (*callback)(void *p
 				  void *param)
 {
 	for (size_t i = 0; i < video->inputs.num; i++) {
-		struct video_input *input = video->inputs.array + i;
+		struct video_input *input = video->inputs.array[i];
 		if (input->callback == callback && input->param == param)
 			return i;
 	}
@@ -337,7 +720,39 @@ static bool match_space(enum video_colorspace a, enum video_colorspace b)
 	return (a == VIDEO_CS_DEFAULT) || (b == VIDEO_CS_DEFAULT) || (collapse_space(a) == collapse_space(b));
 }
 
-static inline bool video_input_init(struct video_input *input, struct video_output *video)
+static inline bool match_conversion(const struct video_scale_info *a, const struct video_scale_info *b)
+{
+	return a->format == b->format && a->width == b->width && a->height == b->height && a->range == b->range &&
+	       a->colorspace == b->colorspace;
+}
+
+/* only join groups whose inputs output on the same frames as a newly
+ * connected input, otherwise the group would scale every frame anyway */
+static bool scale_group_in_phase(const struct video_output *video, const struct scale_group *group)
+{
+	for (size_t i = 0; i < video->inputs.num; i++) {
+		const struct video_input *input = video->inputs.array[i];
+		if (input->scale_group == group)
+			return input->frame_rate_divisor_counter == 0;
+	}
+
+	return false;
+}
+
+static struct scale_group *find_scale_group(struct video_output *video, const struct video_input *input)
+{
+	for (size_t i = 0; i < video->scale_groups.num; i++) {
+		struct scale_group *group = video->scale_groups.array[i];
+
+		if (group->frame_rate_divisor == input->frame_rate_divisor &&
+		    match_conversion(&group->conversion, &input->conversion) && scale_group_in_phase(video, group))
+			return group;
+	}
+
+	return NULL;
+}
+
+static inline bool video_input_init(struct video_input *input, struct video_output *video, bool shareable)
 {
 	if (input->conversion.width != video->info.width || input->conversion.height != video->info.height ||
 	    input->conversion.format != video->info.format ||
@@ -348,8 +763,19 @@ static inline bool video_input_init(struct video_input *input, struct video_outp
 						.height = video->info.height,
 						.range = video->info.range,
 						.colorspace = video->info.colorspace};
+		struct scale_group *group = shareable ? find_scale_group(video, input) : NULL;
 
-		int ret = video_scaler_create(&input->scaler, &input->conversion, &from, VIDEO_SCALE_FAST_BILINEAR);
+		if (group) {
+			group->refs++;
+			input->scale_group = group;
+			return true;
+		}
+
+		group = bzalloc(sizeof(struct scale_group));
+		group->conversion = input->conversion;
+		group->frame_rate_divisor = input->frame_rate_divisor;
+
+		int ret = video_scaler_create(&group->scaler, &input->conversion, &from, VIDEO_SCALE_FAST_BILINEAR);
 		if (ret != VIDEO_SCALER_SUCCESS) {
 			if (ret == VIDEO_SCALER_BAD_CONVERSION)
 				blog(LOG_ERROR, "video_input_init: Bad "
@@ -358,12 +784,21 @@ static inline bool video_input_init(struct video_input *input, struct video_outp
 				blog(LOG_ERROR, "video_input_init: Failed to "
 						"create scaler");
 
+			bfree(group);
 			return false;
 		}
 
 		for (size_t i = 0; i < MAX_CONVERT_BUFFERS; i++)
-			video_frame_init(&input->frame[i], input->conversion.format, input->conversion.width,
+			video_frame_init(&group->frame[i], input->conversion.format, input->conversion.width,
 					 input->conversion.height);
+
+		if (shareable) {
+			group->shared = true;
+			group->refs = 1;
+			da_push_back(video->scale_groups, &group);
+		}
+
+		input->scale_group = group;
 	}
 
 	return true;
@@ -405,34 +840,43 @@ bool video_output_connect2(video_t *video, const struct video_scale_info *conver
 	if (!video || !callback || frame_rate_divisor == 0)
 		return false;
 
+	video_input_reap_detached(video, false);
+
 	pthread_mutex_lock(&video->input_mutex);
 
 	if (video_get_input_idx(video, callback, param) == DARRAY_INVALID) {
-		struct video_input input;
-		memset(&input, 0, sizeof(input));
+		struct video_input *input = bzalloc(sizeof(struct video_input));
 
-		input.callback = callback;
-		input.param = param;
+		input->video = video;
+		input->callback = callback;
+		input->param = param;
 
-		input.frame_rate_divisor = frame_rate_divisor;
+		input->frame_rate_divisor = frame_rate_divisor;
 
 		if (conversion) {
-			input.conversion = *conversion;
+			input->conversion = *conversion;
 		} else {
-			input.conversion.format = video->info.format;
-			input.conversion.width = video->info.width;
-			input.conversion.height = video->info.height;
-			input.conversion.range = video->info.range;
-			input.conversion.colorspace = video->info.colorspace;
+			input->conversion.format = video->info.format;
+			input->conversion.width = video->info.width;
+			input->conversion.height = video->info.height;
+			input->conversion.range = video->info.range;
+			input->conversion.colorspace = video->info.colorspace;
 		}
 
-		if (input.conversion.width == 0)
-			input.conversion.width = video->info.width;
-		if (input.conversion.height == 0)
-			input.conversion.height = video->info.height;
+		if (input->conversion.width == 0)
+			input->conversion.width = video->info.width;
+		if (input->conversion.height == 0)
+			input->conversion.height = video->info.height;
+
+		success = video_input_init(input, video, !video->parallel_inputs);
+		if (success && video->parallel_inputs && !video_input_start_thread(input)) {
+			blog(LOG_WARNING, "video_output_connect2: Failed to create input "
+					  "thread, falling back to the video thread");
+		}
 
-		success = video_input_init(&input, video);
-		if (success) {
+		if (!success) {
+			video_input_destroy(input);
+		} else {
 			if (video->inputs.num == 0) {
 				if (!os_atomic_load_long(&video->gpu_refs)) {
 					reset_frames(video);
@@ -462,6 +906,18 @@ static void log_skipped(video_t *video)
 		     video->skipped_frames, video->total_frames, percentage_skipped);
 }
 
+static void log_input_skipped(struct video_input *input)
+{
+	long skipped = os_atomic_load_long(&input->skipped_frames);
+	long total = os_atomic_load_long(&input->total_frames);
+
+	if (skipped)
+		blog(LOG_INFO,
+		     "Video input stopped, number of frames skipped "
+		     "due to input lag: %ld/%ld (%0.1f%%)",
+		     skipped, total, (double)skipped / (double)total * 100.0);
+}
+
 void video_output_disconnect(video_t *video, void (*callback)(void *param, struct video_data *frame), void *param)
 {
 	video_output_disconnect2(video, callback, param);
@@ -474,11 +930,13 @@ bool video_output_disconnect2(video_t *video, void (*callback)(void *param, stru
 
 	video = get_root(video);
 
+	struct video_input *input = NULL;
+
 	pthread_mutex_lock(&video->input_mutex);
 
 	size_t idx = video_get_input_idx(video, callback, param);
 	if (idx != DARRAY_INVALID) {
-		video_input_free(video->inputs.array + idx);
+		input = video->inputs.array[idx];
 		da_erase(video->inputs, idx);
 
 		if (video->inputs.num == 0) {
@@ -491,6 +949,14 @@ bool video_output_disconnect2(video_t *video, void (*callback)(void *param, stru
 
 	pthread_mutex_unlock(&video->input_mutex);
 
+	/* input threads are joined outside of input_mutex, their callbacks
+	 * may need to disconnect other inputs */
+	if (input) {
+		if (input->threaded)
+			log_input_skipped(input);
+		video_input_free(input);
+	}
+
 	return idx != DARRAY_INVALID;
 }
 
@@ -506,10 +972,32 @@ const struct video_output_info *video_output_get_info(const video_t *video)
 	return video ? &video->info : NULL;
 }
 
+/* called with data_mutex locked, returns NULL if the cache is full */
+static struct cached_frame_info *lock_cache_entry(struct video_output *video, int count, uint64_t timestamp)
+{
+	struct cached_frame_info *cfi;
+
+	if (video->available_frames == 0) {
+		video->cache[video->last_added].count += count;
+		video->cache[video->last_added].skipped += count;
+		return NULL;
+	}
+
+	if (video->available_frames != video->info.cache_size) {
+		if (++video->last_added == video->info.cache_size)
+			video->last_added = 0;
+	}
+
+	cfi = &video->cache[video->last_added];
+	cfi->frame.timestamp = timestamp;
+	cfi->count = count;
+	cfi->skipped = 0;
+	return cfi;
+}
+
 bool video_output_lock_frame(video_t *video, struct video_frame *frame, int count, uint64_t timestamp)
 {
 	struct cached_frame_info *cfi;
-	bool locked;
 
 	if (!video)
 		return false;
@@ -518,30 +1006,43 @@ bool video_output_lock_frame(video_t *video, struct video_frame *frame, int coun
 
 	pthread_mutex_lock(&video->data_mutex);
 
-	if (video->available_frames == 0) {
-		video->cache[video->last_added].count += count;
-		video->cache[video->last_added].skipped += count;
-		locked = false;
+	cfi = lock_cache_entry(video, count, timestamp);
+	if (cfi)
+		memcpy(frame, &cfi->frame, sizeof(*frame));
 
-	} else {
-		if (video->available_frames != video->info.cache_size) {
-			if (++video->last_added == video->info.cache_size)
-				video->last_added = 0;
-		}
+	pthread_mutex_unlock(&video->data_mutex);
 
-		cfi = &video->cache[video->last_added];
-		cfi->frame.timestamp = timestamp;
-		cfi->count = count;
-		cfi->skipped = 0;
+	return cfi != NULL;
+}
 
-		memcpy(frame, &cfi->frame, sizeof(*frame));
+bool video_output_reference_frame(video_t *video, const struct video_frame *frame, int count, uint64_t timestamp,
+				  void (*release)(void *param), void *param)
+{
+	struct cached_frame_info *cfi;
+
+	if (!video || !release)
+		return false;
+
+	video = get_root(video);
+
+	pthread_mutex_lock(&video->data_mutex);
+
+	cfi = lock_cache_entry(video, count, timestamp);
+	if (cfi) {
+		memcpy(cfi->buffer.data, cfi->frame.data, sizeof(cfi->buffer.data));
+		memcpy(cfi->buffer.linesize, cfi->frame.linesize, sizeof(cfi->buffer.linesize));
+		memcpy(cfi->frame.data, frame->data, sizeof(frame->data));
+		memcpy(cfi->frame.linesize, frame->linesize, sizeof(frame->linesize));
+		cfi->release = release;
+		cfi->release_param = param;
 
-		locked = true;
+		video->available_frames--;
+		os_sem_post(video->update_semaphore);
 	}
 
 	pthread_mutex_unlock(&video->data_mutex);
 
-	return locked;
+	return cfi != NULL;
 }
 
 void video_output_unlock_frame(video_t *video)
@@ -623,6 +1124,53 @@ uint32_t video_output_get_total_frames(const video_t *video)
 	return (uint32_t)os_atomic_load_long(&get_const_root(video)->total_frames);
 }
 
+void video_output_set_parallel_inputs(video_t *video, bool parallel)
+{
+	if (!video)
+		return;
+
+	video = get_root(video);
+
+	pthread_mutex_lock(&video->input_mutex);
+	video->parallel_inputs = parallel;
+	pthread_mutex_unlock(&video->input_mutex);
+}
+
+void video_output_set_zero_copy(video_t *video, bool zero_copy)
+{
+	if (video)
+		os_atomic_set_bool(&get_root(video)->zero_copy, zero_copy);
+}
+
+bool video_output_get_zero_copy(const video_t *video)
+{
+	return video ? os_atomic_load_bool(&get_const_root(video)->zero_copy) : false;
+}
+
+bool video_output_get_input_stats(video_t *video, void (*callback)(void *param, struct video_data *frame), void *param,
+				  struct video_input_stats *stats)
+{
+	if (!video || !callback || !stats)
+		return false;
+
+	video = get_root(video);
+
+	pthread_mutex_lock(&video->input_mutex);
+
+	size_t idx = video_get_input_idx(video, callback, param);
+	if (idx != DARRAY_INVALID) {
+		struct video_input *input = video->inputs.array[idx];
+		stats->total_frames = (uint32_t)os_atomic_load_long(&input->total_frames);
+		stats->lagged_frames = (uint32_t)os_atomic_load_long(&input->lagged_frames);
+		stats->skipped_frames = (uint32_t)os_atomic_load_long(&input->skipped_frames);
+		stats->threaded = input->threaded;
+	}
+
+	pthread_mutex_unlock(&video->input_mutex);
+
+	return idx != DARRAY_INVALID;
+}
+
 /* Note: These four functions below are a very slight bit of a hack.  If the
  * texture encoder thread is active while the raw encoder thread is active, the
  * total frame count will just be doubled while they're both active.  Which is
@@ -291,6 +291,13 @@ EXPORT bool video_format_get_parameters_for_format(enum video_colorspace color_s
 						   enum video_format format, float matrix[16], float min_range[3],
 						   float max_range[3]);
 
+struct video_input_stats {
+	uint32_t total_frames;
+	uint32_t lagged_frames;
+	uint32_t skipped_frames;
+	bool threaded;
+};
+
 #define VIDEO_OUTPUT_SUCCESS 0
 #define VIDEO_OUTPUT_INVALIDPARAM -1
 #define VIDEO_OUTPUT_FAIL -2
@@ -313,6 +320,16 @@ EXPORT bool video_output_active(const video_t *video);
 EXPORT const struct video_output_info *video_output_get_info(const video_t *video);
 EXPORT bool video_output_lock_frame(video_t *video, struct video_frame *frame, int count, uint64_t timestamp);
 EXPORT void video_output_unlock_frame(video_t *video);
+
+/**
+ * Outputs a frame that references the caller's planes instead of copying
+ * them into the frame cache.  Returns false if the cache is full, in which
+ * case the frame is skipped like with video_output_lock_frame.  Otherwise
+ * release(param) is called, from any thread, once no input uses the planes
+ * anymore.
+ */
+EXPORT bool video_output_reference_frame(video_t *video, const struct video_frame *frame, int count,
+					 uint64_t timestamp, void (*release)(void *param), void *param);
 EXPORT uint64_t video_output_get_frame_time(const video_t *video);
 EXPORT void video_output_stop(video_t *video);
 EXPORT bool video_output_stopped(video_t *video);
@@ -325,6 +342,28 @@ EXPORT double video_output_get_frame_rate(const video_t *video);
 EXPORT uint32_t video_output_get_skipped_frames(const video_t *video);
 EXPORT uint32_t video_output_get_total_frames(const video_t *video);
 
+/**
+ * Gives each raw video input connected after this call its own thread and a
+ * small bounded frame queue, so that scaling and callbacks of one input do
+ * not delay the others.  Frames that arrive while an input's queue is full
+ * are skipped for that input only, and the next frame is repeated in their
+ * place so the input still gets one frame per interval.
+ */
+EXPORT void video_output_set_parallel_inputs(video_t *video, bool parallel);
+
+/**
+ * Lets the producer of the video output hand frames to it by reference with
+ * video_output_reference_frame instead of copying them.  For the main video
+ * output, libobs then passes its mapped staging surfaces to the inputs, which
+ * keeps those surfaces mapped until every input is done with the frame.
+ */
+EXPORT void video_output_set_zero_copy(video_t *video, bool zero_copy);
+EXPORT bool video_output_get_zero_copy(const video_t *video);
+
+/** Gets the frame counters of a single raw video input */
+EXPORT bool video_output_get_input_stats(video_t *video, void (*callback)(void *param, struct video_data *frame),
+					 void *param, struct video_input_stats *stats);
+
 extern void video_output_inc_texture_encoders(video_t *video);
 extern void video_output_dec_texture_encoders(video_t *video);
 extern void video_output_inc_texture_frames(video_t *video);
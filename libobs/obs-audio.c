@@ -17,6 +17,7 @@
 
 #include <inttypes.h>
 #include "obs-internal.h"
+#include "media-io/audio-math.h"
 #include "util/util_uint64.h"
 
 struct ts_info {
@@ -27,6 +28,10 @@ struct ts_info {
 #define DEBUG_AUDIO 0
 #define DEBUG_LAGGED_AUDIO 0
 
+/* rendering a leaf source is little more than a copy and a volume multiply
+ * per mix, so below this, waking the pool costs more than it saves */
+#define MIN_PARALLEL_AUDIO_SOURCES 8
+
 static void push_audio_tree(obs_source_t *parent, obs_source_t *source, void *p)
 {
 	struct obs_core_audio *audio = p;
@@ -87,8 +92,8 @@ static inline size_t convert_time_to_frames(size_t sample_rate, uint64_t t)
 	return (size_t)util_mul_div64(t, sample_rate, 1000000000ULL);
 }
 
-static inline void mix_audio(struct audio_output_data *mixes, obs_source_t *source, size_t channels, size_t sample_rate,
-			     struct ts_info *ts)
+static inline void mix_audio(struct audio_output_data *mixes, obs_source_t *source, uint32_t mixers, size_t channels,
+			     size_t sample_rate, struct ts_info *ts)
 {
 	size_t total_floats = AUDIO_OUTPUT_FRAMES;
 	size_t start_point = 0;
@@ -104,17 +109,19 @@ static inline void mix_audio(struct audio_output_data *mixes, obs_source_t *sour
 		total_floats -= start_point;
 	}
 
+	/* the output buffers of mixes the source isn't assigned to (or that
+	 * aren't active) are left silent by obs_source_audio_render */
+	mixers &= source->audio_mixers;
+
 	for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
-		for (size_t ch = 0; ch < channels; ch++) {
-			register float *mix = mixes[mix_idx].data[ch];
-			register float *aud = source->audio_output_buf[mix_idx][ch];
-			register float *end;
+		if ((mixers & (1 << mix_idx)) == 0)
+			continue;
 
-			mix += start_point;
-			end = aud + total_floats;
+		for (size_t ch = 0; ch < channels; ch++) {
+			float *mix = mixes[mix_idx].data[ch] + start_point;
+			const float *aud = source->audio_output_buf[mix_idx][ch];
 
-			while (aud < end)
-				*(mix++) += *(aud++);
+			audio_mix_floats(mix, aud, total_floats);
 		}
 	}
 }
@@ -549,6 +556,92 @@ static inline void clear_audio_output_buf(obs_source_t *source, struct obs_core_
 	}
 }
 
+struct audio_render_data {
+	struct obs_core_audio *audio;
+	const struct ts_info *ts;
+	uint32_t mixers;
+	size_t channels;
+	size_t sample_rate;
+	size_t audio_size;
+};
+
+static void render_audio_source(const struct audio_render_data *rd, obs_source_t *source)
+{
+	struct obs_core_audio *audio = rd->audio;
+
+	obs_source_audio_render(source, rd->mixers, rd->channels, rd->sample_rate, rd->audio_size);
+	if (should_silence_monitored_source(source, audio))
+		clear_audio_output_buf(source, audio);
+
+	/* if a source has gone backward in time and we can no
+	 * longer buffer, drop some or all of its audio */
+	if (audio_buffering_maxed(audio) && source->audio_ts != 0 && source->audio_ts < rd->ts->start) {
+		if (source->info.audio_render) {
+			blog(LOG_DEBUG,
+			     "render audio source %s timestamp has "
+			     "gone backwards",
+			     obs_source_get_name(source));
+
+			/* just avoid further damage */
+			source->audio_pending = true;
+#if DEBUG_AUDIO == 1
+			/* this should really be fixed */
+			assert(false);
+#endif
+		} else {
+			pthread_mutex_lock(&source->audio_buf_mutex);
+			bool rerender = ignore_audio(source, rd->channels, rd->sample_rate, rd->ts->start);
+			pthread_mutex_unlock(&source->audio_buf_mutex);
+
+			/* if we (potentially) recovered, re-render */
+			if (rerender)
+				obs_source_audio_render(source, rd->mixers, rd->channels, rd->sample_rate,
+							rd->audio_size);
+		}
+	}
+}
+
+/* Sources without an audio_render or audio_mix callback only read their own
+ * input buffer and write their own output buffers, so they don't depend on
+ * any other source in the tree and can be rendered concurrently.  Only the
+ * copy to the mixes and the volume are done here, audio filters still run on
+ * the thread that outputs the source's audio.
+ *
+ * Sources with pending audio actions are rendered on the audio thread, so
+ * mute, push-to-talk and volume changes are still applied there. */
+static bool can_render_in_parallel(obs_source_t *source)
+{
+	bool actions_pending;
+
+	if (source->info.audio_render || source->info.audio_mix)
+		return false;
+
+	pthread_mutex_lock(&source->audio_actions_mutex);
+	actions_pending = source->audio_actions.num > 0;
+	pthread_mutex_unlock(&source->audio_actions_mutex);
+
+	return !actions_pending;
+}
+
+static void parallel_render_task(void *param, size_t idx)
+{
+	const struct audio_render_data *rd = param;
+	render_audio_source(rd, rd->audio->parallel_render_order.array[idx]);
+}
+
+static const char *parallel_audio_render_name = "parallel_audio_render";
+static const char *audio_deadline_slack_name = "audio_deadline_slack";
+
+/* records how much time was left before the next audio tick is due, which
+ * is one tick after the end of the data that was just requested */
+static void record_deadline_slack(const struct ts_info *ts_in)
+{
+	uint64_t deadline = ts_in->end + (ts_in->end - ts_in->start);
+	uint64_t now = os_gettime_ns();
+
+	profile_record(audio_deadline_slack_name, deadline > now ? deadline - now : 0);
+}
+
 bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in, uint64_t *out_ts, uint32_t mixers,
 		    struct audio_output_data *mixes)
 {
@@ -558,6 +651,7 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in, uint6
 	size_t sample_rate = audio_output_get_sample_rate(audio->audio);
 	size_t channels = audio_output_get_channels(audio->audio);
 	struct ts_info ts = {start_ts_in, end_ts_in};
+	const struct ts_info ts_in = ts;
 	size_t audio_size;
 	uint64_t min_ts;
 
@@ -623,37 +717,41 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in, uint6
 
 	/* ------------------------------------------------ */
 	/* render audio data */
+	struct audio_render_data render_data = {audio, &ts, mixers, channels, sample_rate, audio_size};
+	bool parallel = false;
+
+	da_resize(audio->parallel_render_order, 0);
+	da_resize(audio->serial_render_order, 0);
+
 	for (size_t i = 0; i < audio->render_order.num; i++) {
 		obs_source_t *source = audio->render_order.array[i];
-		obs_source_audio_render(source, mixers, channels, sample_rate, audio_size);
-		if (should_silence_monitored_source(source, audio))
-			clear_audio_output_buf(source, audio);
-
-		/* if a source has gone backward in time and we can no
-		 * longer buffer, drop some or all of its audio */
-		if (audio_buffering_maxed(audio) && source->audio_ts != 0 && source->audio_ts < ts.start) {
-			if (source->info.audio_render) {
-				blog(LOG_DEBUG,
-				     "render audio source %s timestamp has "
-				     "gone backwards",
-				     obs_source_get_name(source));
-
-				/* just avoid further damage */
-				source->audio_pending = true;
-#if DEBUG_AUDIO == 1
-				/* this should really be fixed */
-				assert(false);
-#endif
-			} else {
-				pthread_mutex_lock(&source->audio_buf_mutex);
-				bool rerender = ignore_audio(source, channels, sample_rate, ts.start);
-				pthread_mutex_unlock(&source->audio_buf_mutex);
-
-				/* if we (potentially) recovered, re-render */
-				if (rerender)
-					obs_source_audio_render(source, mixers, channels, sample_rate, audio_size);
-			}
-		}
+		if (can_render_in_parallel(source))
+			da_push_back(audio->parallel_render_order, &source);
+		else
+			da_push_back(audio->serial_render_order, &source);
+	}
+
+	/* the pool's threads are only worth having once there are enough
+	 * sources to spread over them */
+	if (audio->parallel_render_order.num >= MIN_PARALLEL_AUDIO_SOURCES) {
+		if (!audio->render_pool)
+			audio->render_pool = os_task_pool_create("audio render", 0);
+		parallel = !!audio->render_pool;
+	}
+
+	if (parallel) {
+		profile_start(parallel_audio_render_name);
+		os_task_pool_run(audio->render_pool, audio->parallel_render_order.num, parallel_render_task,
+				 &render_data);
+		profile_end(parallel_audio_render_name);
+
+		/* composite sources mix the output of their children, so they
+		 * are rendered serially in tree order once the leaves are done */
+		for (size_t i = 0; i < audio->serial_render_order.num; i++)
+			render_audio_source(&render_data, audio->serial_render_order.array[i]);
+	} else {
+		for (size_t i = 0; i < audio->render_order.num; i++)
+			render_audio_source(&render_data, audio->render_order.array[i]);
 	}
 
 	/* ------------------------------------------------ */
@@ -684,7 +782,7 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in, uint6
 			pthread_mutex_lock(&source->audio_buf_mutex);
 
 			if (source->audio_output_buf[0][0] && source->audio_ts)
-				mix_audio(mixes, source, channels, sample_rate, &ts);
+				mix_audio(mixes, source, mixers, channels, sample_rate, &ts);
 
 			pthread_mutex_unlock(&source->audio_buf_mutex);
 		}
@@ -713,6 +811,8 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in, uint6
 
 	*out_ts = ts.start;
 
+	record_deadline_slack(&ts_in);
+
 	if (audio->buffering_wait_ticks) {
 		audio->buffering_wait_ticks--;
 		return false;
@@ -1265,7 +1265,6 @@ static void send_first_video_packet(struct obs_encoder *encoder, struct encoder_
 				    struct encoder_packet *packet, struct encoder_packet_time *packet_time)
 {
 	struct encoder_packet first_packet;
-	DARRAY(uint8_t) data;
 	uint8_t *sei;
 	size_t size;
 
@@ -1273,25 +1272,21 @@ static void send_first_video_packet(struct obs_encoder *encoder, struct encoder_
 	if (!packet->keyframe)
 		return;
 
-	da_init(data);
-
 	if (!get_sei(encoder, &sei, &size) || !sei || !size) {
 		cb->new_packet(cb->param, packet, packet_time);
 		cb->sent_first_packet = true;
 		return;
 	}
 
-	da_push_back_array(data, sei, size);
-	da_push_back_array(data, packet->data, packet->size);
-
 	first_packet = *packet;
-	first_packet.data = data.array;
-	first_packet.size = data.num;
+	obs_encoder_packet_alloc(&first_packet, size + packet->size);
+	memcpy(first_packet.data, sei, size);
+	memcpy(first_packet.data + size, packet->data, packet->size);
 
 	cb->new_packet(cb->param, &first_packet, packet_time);
 	cb->sent_first_packet = true;
 
-	da_free(data);
+	obs_encoder_packet_release(&first_packet);
 }
 
 static const char *send_packet_name = "send_packet";
@@ -1331,7 +1326,12 @@ void full_stop(struct obs_encoder *encoder)
 
 void send_off_encoder_packet(obs_encoder_t *encoder, bool success, bool received, struct encoder_packet *pkt)
 {
+	bool refcounted = (encoder->info.caps & OBS_ENCODER_CAP_REFCOUNTED_PACKETS) != 0;
+
 	if (!success) {
+		if (refcounted && received)
+			obs_encoder_packet_release(pkt);
+
 		blog(LOG_ERROR, "Error encoding with encoder '%s'", encoder->context.name);
 		full_stop(encoder);
 		return;
@@ -1376,6 +1376,14 @@ void send_off_encoder_packet(obs_encoder_t *encoder, bool success, bool received
 
 		pthread_mutex_lock(&encoder->callbacks_mutex);
 
+		/* all callbacks share one refcounted copy of the packet, which
+		 * refcounted encoders have already written for us */
+		if (encoder->callbacks.num && !refcounted) {
+			struct encoder_packet src = *pkt;
+			obs_encoder_packet_create_instance(pkt, &src);
+			refcounted = true;
+		}
+
 		for (size_t i = encoder->callbacks.num; i > 0; i--) {
 			struct encoder_callback *cb;
 			cb = encoder->callbacks.array + (i - 1);
@@ -1387,6 +1395,9 @@ void send_off_encoder_packet(obs_encoder_t *encoder, bool success, bool received
 		// Count number of video frames successfully encoded
 		if (pkt->type == OBS_ENCODER_VIDEO)
 			encoder->encoded_frames++;
+
+		if (refcounted)
+			obs_encoder_packet_release(pkt);
 	}
 }
 
@@ -1775,14 +1786,160 @@ void obs_encoder_remove_output(struct obs_encoder *encoder, struct obs_output *o
 	pthread_mutex_unlock(&encoder->outputs_mutex);
 }
 
-void obs_encoder_packet_create_instance(struct encoder_packet *dst, const struct encoder_packet *src)
+/* ------------------------------------------------------------------------- */
+/* encoder packet buffers */
+
+/*
+ * Packet data is always preceded by a long reference count, so that packets
+ * created with a plain bmalloc'd (or darray) buffer can still be referenced
+ * and released.  Pooled buffers additionally carry a header in front of the
+ * reference count, and mark themselves by biasing the count with
+ * PACKET_POOLED_REFS, which a plain buffer's count never reaches.
+ */
+
+#define PACKET_POOL_MIN_SHIFT 12 /* 4 KiB */
+#define PACKET_POOL_MAX_SHIFT 24 /* 16 MiB */
+#define PACKET_POOL_CLASSES (PACKET_POOL_MAX_SHIFT - PACKET_POOL_MIN_SHIFT + 1)
+#define PACKET_POOL_MAX_CACHED (64 * 1024 * 1024)
+#define PACKET_POOLED_REFS (1L << (sizeof(long) * 8 - 2))
+
+struct packet_block {
+	struct packet_block *next;
+	size_t size_class;
+	long refs;
+	/* packet data follows the reference count */
+};
+
+static struct {
+	pthread_mutex_t mutex;
+	struct packet_block *free[PACKET_POOL_CLASSES];
+	size_t cached_bytes;
+	struct obs_encoder_packet_stats stats;
+} packet_pool = {.mutex = PTHREAD_MUTEX_INITIALIZER};
+
+static inline uint8_t *packet_block_data(struct packet_block *block)
+{
+	return (uint8_t *)(&block->refs + 1);
+}
+
+static inline struct packet_block *packet_block_from_refs(long *p_refs)
 {
-	long *p_refs;
+	return (struct packet_block *)((uint8_t *)p_refs - offsetof(struct packet_block, refs));
+}
+
+static inline size_t packet_block_header_size(void)
+{
+	return offsetof(struct packet_block, refs) + sizeof(long);
+}
+
+static inline size_t get_size_class(size_t size)
+{
+	size_t size_class = 0;
+
+	while (((size_t)1 << (size_class + PACKET_POOL_MIN_SHIFT)) < size)
+		size_class++;
+
+	return size_class;
+}
+
+/* copied is the number of bytes the caller is about to copy in, for stats */
+static uint8_t *alloc_packet_data(size_t size, size_t copied)
+{
+	struct packet_block *block = NULL;
+	bool pooled = size <= ((size_t)1 << PACKET_POOL_MAX_SHIFT);
+	size_t size_class = pooled ? get_size_class(size) : 0;
+
+	pthread_mutex_lock(&packet_pool.mutex);
+	if (pooled) {
+		block = packet_pool.free[size_class];
+		if (block) {
+			packet_pool.free[size_class] = block->next;
+			packet_pool.cached_bytes -= (size_t)1 << (size_class + PACKET_POOL_MIN_SHIFT);
+		}
+	}
+	if (block)
+		packet_pool.stats.reuses++;
+	else
+		packet_pool.stats.allocs++;
+	packet_pool.stats.bytes_copied += copied;
+	pthread_mutex_unlock(&packet_pool.mutex);
+
+	if (!pooled) {
+		long *p_refs = bmalloc(size + sizeof(long));
+		*p_refs = 1;
+		return (uint8_t *)(p_refs + 1);
+	}
 
+	if (!block) {
+		block = bmalloc(packet_block_header_size() + ((size_t)1 << (size_class + PACKET_POOL_MIN_SHIFT)));
+		block->size_class = size_class;
+	}
+
+	block->next = NULL;
+	block->refs = PACKET_POOLED_REFS + 1;
+	return packet_block_data(block);
+}
+
+static void free_packet_block(struct packet_block *block)
+{
+	size_t size = (size_t)1 << (block->size_class + PACKET_POOL_MIN_SHIFT);
+
+	pthread_mutex_lock(&packet_pool.mutex);
+	if (packet_pool.cached_bytes + size <= PACKET_POOL_MAX_CACHED) {
+		block->next = packet_pool.free[block->size_class];
+		packet_pool.free[block->size_class] = block;
+		packet_pool.cached_bytes += size;
+		block = NULL;
+	}
+	pthread_mutex_unlock(&packet_pool.mutex);
+
+	bfree(block);
+}
+
+void obs_encoder_packet_pool_free(void)
+{
+	pthread_mutex_lock(&packet_pool.mutex);
+
+	for (size_t i = 0; i < PACKET_POOL_CLASSES; i++) {
+		struct packet_block *block = packet_pool.free[i];
+
+		while (block) {
+			struct packet_block *next = block->next;
+			bfree(block);
+			block = next;
+		}
+
+		packet_pool.free[i] = NULL;
+	}
+
+	packet_pool.cached_bytes = 0;
+
+	pthread_mutex_unlock(&packet_pool.mutex);
+}
+
+void obs_encoder_packet_alloc(struct encoder_packet *packet, size_t size)
+{
+	if (!obs_ptr_valid(packet, "obs_encoder_packet_alloc"))
+		return;
+
+	packet->data = alloc_packet_data(size ? size : 1, 0);
+	packet->size = size;
+}
+
+void obs_encoder_packet_get_stats(struct obs_encoder_packet_stats *stats)
+{
+	if (!obs_ptr_valid(stats, "obs_encoder_packet_get_stats"))
+		return;
+
+	pthread_mutex_lock(&packet_pool.mutex);
+	*stats = packet_pool.stats;
+	pthread_mutex_unlock(&packet_pool.mutex);
+}
+
+void obs_encoder_packet_create_instance(struct encoder_packet *dst, const struct encoder_packet *src)
+{
 	*dst = *src;
-	p_refs = bmalloc(src->size + sizeof(long));
-	dst->data = (void *)(p_refs + 1);
-	*p_refs = 1;
+	dst->data = alloc_packet_data(src->size ? src->size : 1, src->size);
 	memcpy(dst->data, src->data, src->size);
 }
 
@@ -1806,8 +1963,12 @@ void obs_encoder_packet_release(struct encoder_packet *pkt)
 
 	if (pkt->data) {
 		long *p_refs = ((long *)pkt->data) - 1;
-		if (os_atomic_dec_long(p_refs) == 0)
+		long refs = os_atomic_dec_long(p_refs);
+
+		if (refs == 0)
 			bfree(p_refs);
+		else if (refs == PACKET_POOLED_REFS)
+			free_packet_block(packet_block_from_refs(p_refs));
 	}
 
 	memset(pkt, 0, sizeof(struct encoder_packet));
@@ -38,6 +38,7 @@ typedef struct obs_encoder obs_encoder_t;
 #define OBS_ENCODER_CAP_INTERNAL (1 << 3)
 #define OBS_ENCODER_CAP_ROI (1 << 4)
 #define OBS_ENCODER_CAP_SCALING (1 << 5)
+#define OBS_ENCODER_CAP_REFCOUNTED_PACKETS (1 << 6)
 
 /** Specifies the encoder type */
 enum obs_encoder_type {
@@ -142,6 +143,18 @@ struct encoder_packet {
 	obs_encoder_t *encoder;
 };
 
+/** Encoder packet buffer statistics */
+struct obs_encoder_packet_stats {
+	/** Packet buffers allocated from the heap */
+	uint64_t allocs;
+
+	/** Packet buffers reused from the pool */
+	uint64_t reuses;
+
+	/** Bytes of packet data copied into packet buffers */
+	uint64_t bytes_copied;
+};
+
 /** Encoder input frame */
 struct encoder_frame {
 	/** Data for the frame/audio */
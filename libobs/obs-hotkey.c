@@ -136,13 +136,13 @@ void obs_hotkey_pair_set_descriptions(obs_hotkey_pair_id id, const char *desc0,
 
 static void hotkey_signal(const char *signal, obs_hotkey_t *hotkey)
 {
+	uint8_t stack[128];
 	calldata_t data;
-	calldata_init(&data);
+
+	calldata_init_fixed(&data, stack, sizeof(stack));
 	calldata_set_ptr(&data, "key", hotkey);
 
 	signal_handler_signal(obs->hotkeys.signals, signal, &data);
-
-	calldata_free(&data);
 }
 
 static inline void load_bindings(obs_hotkey_t *hotkey, obs_data_array_t *data);
@@ -0,0 +1,150 @@
+/******************************************************************************
+    Copyright (C) 2023 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "util/c99defs.h"
+#include "util/bmem.h"
+#include "obs.h"
+
+#include <assert.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Sorted ring buffer of encoder packets used by the output interleaver.
+ *
+ * Packets mostly arrive in (or close to) DTS order, so inserting is a binary
+ * search followed by moving the few packets on the shorter side of the
+ * insertion point, and removing packets from the front never moves memory.
+ */
+
+struct interleaver {
+	struct encoder_packet *packets;
+	size_t start;
+	size_t num;
+	size_t capacity; /* always a power of two */
+};
+
+static inline void interleaver_init(struct interleaver *il)
+{
+	memset(il, 0, sizeof(struct interleaver));
+}
+
+static inline void interleaver_free(struct interleaver *il)
+{
+	bfree(il->packets);
+	memset(il, 0, sizeof(struct interleaver));
+}
+
+static inline struct encoder_packet *interleaver_get(const struct interleaver *il, size_t idx)
+{
+	return &il->packets[(il->start + idx) & (il->capacity - 1)];
+}
+
+static inline void interleaver_grow(struct interleaver *il)
+{
+	size_t new_capacity = il->capacity ? il->capacity * 2 : 64;
+	struct encoder_packet *packets = bmalloc(new_capacity * sizeof(struct encoder_packet));
+
+	for (size_t i = 0; i < il->num; i++)
+		packets[i] = *interleaver_get(il, i);
+
+	bfree(il->packets);
+	il->packets = packets;
+	il->start = 0;
+	il->capacity = new_capacity;
+}
+
+/* returns true if pkt should be placed in front of cur */
+static inline bool interleaver_packet_before(const struct encoder_packet *pkt, const struct encoder_packet *cur)
+{
+	if (pkt->dts_usec != cur->dts_usec)
+		return pkt->dts_usec < cur->dts_usec;
+
+	/* video goes in front of audio with the same DTS, and video packets
+	 * with the same DTS are sorted by track index to prevent the pruning
+	 * logic from removing additional video tracks */
+	if (pkt->type != OBS_ENCODER_VIDEO)
+		return false;
+
+	return cur->type != OBS_ENCODER_VIDEO || pkt->track_idx <= cur->track_idx;
+}
+
+static inline size_t interleaver_find_insert_idx(const struct interleaver *il, const struct encoder_packet *pkt)
+{
+	size_t lo = 0;
+	size_t hi = il->num;
+
+	/* common case: the packet goes at the end */
+	if (!il->num || !interleaver_packet_before(pkt, interleaver_get(il, il->num - 1)))
+		return il->num;
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+
+		if (interleaver_packet_before(pkt, interleaver_get(il, mid)))
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+
+	return lo;
+}
+
+static inline void interleaver_insert(struct interleaver *il, const struct encoder_packet *pkt)
+{
+	size_t idx;
+
+	if (il->num == il->capacity)
+		interleaver_grow(il);
+
+	idx = interleaver_find_insert_idx(il, pkt);
+
+	if (idx >= il->num / 2) {
+		for (size_t i = il->num; i > idx; i--)
+			*interleaver_get(il, i) = *interleaver_get(il, i - 1);
+	} else {
+		il->start = (il->start - 1) & (il->capacity - 1);
+		for (size_t i = 0; i < idx; i++)
+			*interleaver_get(il, i) = *interleaver_get(il, i + 1);
+	}
+
+	*interleaver_get(il, idx) = *pkt;
+	il->num++;
+}
+
+/* removes the first count packets without releasing them */
+static inline void interleaver_erase_front(struct interleaver *il, size_t count)
+{
+	assert(count <= il->num);
+
+	il->start = (il->start + count) & (il->capacity - 1);
+	il->num -= count;
+}
+
+static inline void interleaver_pop_front(struct interleaver *il, struct encoder_packet *pkt)
+{
+	*pkt = *interleaver_get(il, 0);
+	interleaver_erase_front(il, 1);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -38,6 +38,8 @@
 #include "media-io/audio-io.h"
 
 #include "obs.h"
+#include "obs-interleave.h"
+#include "obs-packet-queue.h"
 
 #include <obsversion.h>
 #include <caption/caption.h>
@@ -329,6 +331,12 @@ struct obs_task_info {
 	void *param;
 };
 
+/* mapped stage surfaces referenced by a raw video frame */
+struct obs_stage_ref {
+	gs_stagesurf_t *surfaces[NUM_CHANNELS];
+	volatile bool released;
+};
+
 struct obs_core_video_mix {
 	struct obs_view *view;
 
@@ -350,6 +358,8 @@ struct obs_core_video_mix {
 	struct deque vframe_info_buffer;
 	struct deque vframe_info_buffer_gpu;
 	gs_stagesurf_t *mapped_surfaces[NUM_CHANNELS];
+	DARRAY(struct obs_stage_ref *) stage_refs;
+	DARRAY(gs_stagesurf_t *) spare_stage_surfaces;
 	int cur_texture;
 	volatile long raw_active;
 	volatile long gpu_encoder_active;
@@ -385,6 +395,7 @@ struct obs_core_video_mix {
 
 extern struct obs_core_video_mix *obs_create_video_mix(struct obs_video_info *ovi);
 extern void obs_free_video_mix(struct obs_core_video_mix *video);
+extern void obs_free_stage_refs(struct obs_core_video_mix *video);
 
 struct obs_core_video {
 	graphics_t *graphics;
@@ -433,6 +444,10 @@ struct obs_core_video {
 
 	pthread_mutex_t mixes_mutex;
 	DARRAY(struct obs_core_video_mix *) mixes;
+
+	/* runs video_tick of OBS_SOURCE_PARALLEL_TICK sources, created by the
+	 * graphics thread once more than one of them needs to be ticked */
+	os_task_pool_t *tick_pool;
 };
 
 extern void add_ready_encoder_group(obs_encoder_t *encoder);
@@ -445,6 +460,10 @@ struct obs_core_audio {
 	DARRAY(struct obs_source *) render_order;
 	DARRAY(struct obs_source *) root_nodes;
 
+	os_task_pool_t *render_pool;
+	DARRAY(struct obs_source *) parallel_render_order;
+	DARRAY(struct obs_source *) serial_render_order;
+
 	uint64_t buffered_ts;
 	struct deque buffered_timestamps;
 	uint64_t buffering_wait_ticks;
@@ -463,6 +482,11 @@ struct obs_core_audio {
 	struct obs_source *monitoring_duplicating_source;
 };
 
+struct parallel_tick {
+	obs_source_t *source;
+	uint64_t tick_ns;
+};
+
 /* user sources, output channels, and displays */
 struct obs_core_data {
 	/* Hash tables (uthash) */
@@ -505,7 +529,14 @@ struct obs_core_data {
 	volatile bool valid;
 
 	DARRAY(char *) protocols;
-	DARRAY(obs_source_t *) sources_to_tick;
+
+	/* sources that need a video tick, only rebuilt by the graphics thread
+	 * when sources_to_tick_epoch no longer matches the epoch it was built
+	 * at (sources added/removed, (de)activated or updated) */
+	DARRAY(obs_weak_source_t *) sources_to_tick;
+	volatile long sources_to_tick_epoch;
+	long sources_to_tick_built_epoch;
+	DARRAY(struct parallel_tick) parallel_ticks;
 };
 
 /* user hotkeys */
@@ -584,6 +615,11 @@ struct obs_core {
 
 extern struct obs_core *obs;
 
+static inline void obs_invalidate_sources_to_tick(void)
+{
+	os_atomic_inc_long(&obs->data.sources_to_tick_epoch);
+}
+
 struct obs_graphics_context {
 	uint64_t last_time;
 	uint64_t interval;
@@ -784,6 +820,14 @@ struct async_frame {
 	bool used;
 };
 
+/* frame output with obs_source_output_video_owned, it references the
+ * producer's planes until release is called */
+struct owned_async_frame {
+	struct obs_source_frame frame;
+	void (*release)(void *param);
+	void *param;
+};
+
 enum audio_action_type {
 	AUDIO_ACTION_VOL,
 	AUDIO_ACTION_MUTE,
@@ -940,7 +984,10 @@ struct obs_source {
 	struct obs_source_frame *async_preload_frame;
 	DARRAY(struct async_frame) async_cache;
 	DARRAY(struct obs_source_frame *) async_frames;
+	DARRAY(struct owned_async_frame *) owned_frames;
+	DARRAY(struct owned_async_frame *) released_owned_frames;
 	pthread_mutex_t async_mutex;
+	long async_lock_depth;
 	uint32_t async_width;
 	uint32_t async_height;
 	uint32_t async_cache_width;
@@ -1053,6 +1100,11 @@ extern obs_source_t *obs_source_create_canvas(obs_canvas_t *canvas, const char *
 extern obs_source_t *obs_source_create_set_last_ver(obs_canvas_t *canvas, const char *id, const char *name,
 						    const char *uuid, obs_data_t *settings, obs_data_t *hotkey_data,
 						    uint32_t last_obs_ver, bool is_private);
+extern struct obs_source *obs_source_create_begin(const char *id, const char *name, const char *uuid,
+						  obs_data_t *settings, obs_data_t *hotkey_data, bool private,
+						  uint32_t last_obs_ver);
+extern void obs_source_create_data(struct obs_source *source);
+extern void obs_source_create_finish(struct obs_source *source, obs_canvas_t *canvas);
 
 extern void obs_source_destroy(struct obs_source *source);
 extern void obs_source_addref(obs_source_t *source);
@@ -1150,6 +1202,9 @@ extern void obs_source_set_texcoords_centered(obs_source_t *source, bool centere
 extern void obs_source_activate(obs_source_t *source, enum view_type type);
 extern void obs_source_deactivate(obs_source_t *source, enum view_type type);
 extern void obs_source_video_tick(obs_source_t *source, float seconds);
+/* video tick without the video_tick callback, for ticking it elsewhere */
+extern void obs_source_video_tick_begin(obs_source_t *source, float seconds);
+extern void obs_source_video_tick_end(obs_source_t *source);
 extern float obs_source_get_target_volume(obs_source_t *source, obs_source_t *target);
 extern uint64_t obs_source_get_last_async_ts(const obs_source_t *source);
 
@@ -1165,6 +1220,8 @@ extern bool update_async_textures(struct obs_source *source, const struct obs_so
 				  gs_texture_t *tex[MAX_AV_PLANES], gs_texrender_t *texrender);
 extern bool set_async_texture_size(struct obs_source *source, const struct obs_source_frame *frame);
 extern void remove_async_frame(obs_source_t *source, struct obs_source_frame *frame);
+extern void lock_async_mutex(obs_source_t *source);
+extern void unlock_async_mutex(obs_source_t *source);
 
 extern void set_deinterlace_texture_size(obs_source_t *source);
 extern void deinterlace_process_last_frame(obs_source_t *source, uint64_t sys_time);
@@ -1256,7 +1313,7 @@ struct obs_output {
 	pthread_t end_data_capture_thread;
 	os_event_t *stopping_event;
 	pthread_mutex_t interleaved_mutex;
-	DARRAY(struct encoder_packet) interleaved_packets;
+	struct interleaver interleaved_packets;
 	size_t interleaver_max_batch_size;
 	int stop_code;
 
@@ -1312,6 +1369,12 @@ struct obs_output {
 	pthread_mutex_t pkt_callbacks_mutex;
 	DARRAY(struct packet_callback) pkt_callbacks;
 
+	/* Encoded packets are queued here by the encoders and handed to the
+	 * output on its own thread, so a slow output can't stall encoders it
+	 * shares with other outputs. */
+	struct packet_queue pkt_queue;
+	bool pkt_queue_active;
+
 	struct reconnect_callback reconnect_callback;
 
 	bool valid;
@@ -1352,6 +1415,7 @@ extern const struct obs_output_info *find_output(const char *id);
 extern void obs_output_remove_encoder(struct obs_output *output, struct obs_encoder *encoder);
 
 extern void obs_encoder_packet_create_instance(struct encoder_packet *dst, const struct encoder_packet *src);
+extern void obs_encoder_packet_pool_free(void);
 void obs_output_destroy(obs_output_t *output);
 
 /* ------------------------------------------------------------------------- */
@@ -1544,6 +1608,8 @@ extern void source_profiler_async_frame_received(obs_source_t *source);
 extern uint64_t source_profiler_source_tick_start(void);
 /* Submit start timestamp for source */
 extern void source_profiler_source_tick_end(obs_source_t *source, uint64_t start);
+/* Submit tick duration for source, for ticks measured on other threads */
+extern void source_profiler_source_tick_time(obs_source_t *source, uint64_t delta);
 
 /* Obtain GPU timer and start timestamp for render start of a source. */
 extern uint64_t source_profiler_source_render_begin(gs_timer_t **timer);
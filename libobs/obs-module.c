@@ -17,11 +17,14 @@
 
 #include "util/platform.h"
 #include "util/dstr.h"
+#include "util/task.h"
 
 #include "obs-defs.h"
 #include "obs-internal.h"
 #include "obs-module.h"
 
+#include <sys/stat.h>
+
 extern const char *get_module_extension(void);
 
 obs_module_t *loadingModule = NULL;
@@ -137,14 +140,12 @@ int obs_module_load_metadata(struct obs_module *mod)
 	return MODULE_SUCCESS;
 }
 
-int obs_open_module(obs_module_t **module, const char *path, const char *data_path)
+/* Opens the module binary and reads its exports and metadata without touching
+ * any global state, so modules can be opened on multiple threads at once. */
+static int open_module_binary(struct obs_module *mod, const char *path, const char *data_path)
 {
-	struct obs_module mod = {0};
 	int errorcode;
 
-	if (!module || !path || !obs)
-		return MODULE_ERROR;
-
 #ifdef __APPLE__
 	/* HACK: Do not load obsolete obs-browser build on macOS; the
 	 * obs-browser plugin used to live in the Application Support
@@ -157,50 +158,73 @@ int obs_open_module(obs_module_t **module, const char *path, const char *data_pa
 
 	blog(LOG_DEBUG, "---------------------------------");
 
-	mod.module = os_dlopen(path);
-	if (!mod.module) {
+	mod->module = os_dlopen(path);
+	if (!mod->module) {
 		blog(LOG_WARNING, "Module '%s' not loaded", path);
 		return MODULE_FAILED_TO_OPEN;
 	}
 
-	errorcode = load_module_exports(&mod, path);
+	errorcode = load_module_exports(mod, path);
 	if (errorcode != MODULE_SUCCESS)
 		return errorcode;
 
 	/* Reject plugins compiled with a newer libobs. Patch version (lower 16-bit) is ignored. */
-	uint32_t ver = mod.ver ? mod.ver() & 0xFFFF0000 : 0;
+	uint32_t ver = mod->ver ? mod->ver() & 0xFFFF0000 : 0;
 	if (ver > LIBOBS_API_VER) {
 		blog(LOG_WARNING, "Module '%s' compiled with newer libobs %d.%d", path, (ver >> 24) & 0xFF,
 		     (ver >> 16) & 0xFF);
 		return MODULE_INCOMPATIBLE_VER;
 	}
 
-	mod.bin_path = bstrdup(path);
-	mod.file = strrchr(mod.bin_path, '/');
-	mod.file = (!mod.file) ? mod.bin_path : (mod.file + 1);
-	mod.mod_name = get_module_name(mod.file);
-	mod.data_path = bstrdup(data_path);
-	mod.next = obs->first_module;
-	mod.load_state = OBS_MODULE_ENABLED;
+	mod->bin_path = bstrdup(path);
+	mod->file = strrchr(mod->bin_path, '/');
+	mod->file = (!mod->file) ? mod->bin_path : (mod->file + 1);
+	mod->mod_name = get_module_name(mod->file);
+	mod->data_path = bstrdup(data_path);
+	mod->load_state = OBS_MODULE_ENABLED;
 
-	da_init(mod.sources);
-	da_init(mod.outputs);
-	da_init(mod.encoders);
-	da_init(mod.services);
+	da_init(mod->sources);
+	da_init(mod->outputs);
+	da_init(mod->encoders);
+	da_init(mod->services);
 
-	if (mod.file) {
-		blog(LOG_DEBUG, "Loading module: %s", mod.file);
+	if (mod->file) {
+		blog(LOG_DEBUG, "Loading module: %s", mod->file);
 	}
 
-	obs_module_load_metadata(&mod);
+	obs_module_load_metadata(mod);
+	return MODULE_SUCCESS;
+}
 
-	*module = bmemdup(&mod, sizeof(mod));
-	obs->first_module = (*module);
-	mod.set_pointer(*module);
+static obs_module_t *add_opened_module(struct obs_module *mod)
+{
+	obs_module_t *module;
+
+	mod->next = obs->first_module;
+
+	module = bmemdup(mod, sizeof(*mod));
+	obs->first_module = module;
+	mod->set_pointer(module);
+
+	if (mod->set_locale)
+		mod->set_locale(obs->locale);
+
+	return module;
+}
+
+int obs_open_module(obs_module_t **module, const char *path, const char *data_path)
+{
+	struct obs_module mod = {0};
+	int errorcode;
 
-	if (mod.set_locale)
-		mod.set_locale(obs->locale);
+	if (!module || !path || !obs)
+		return MODULE_ERROR;
+
+	errorcode = open_module_binary(&mod, path, data_path);
+	if (errorcode != MODULE_SUCCESS)
+		return errorcode;
 
+	*module = add_opened_module(&mod);
 	return MODULE_SUCCESS;
 }
 
@@ -490,70 +514,365 @@ bool obs_get_module_allow_disable(const char *name)
 	return !is_core_module(name);
 }
 
-static void load_all_callback(void *param, const struct obs_module_info2 *info)
+/* ------------------------------------------------------------------------- */
+/* Module cache
+ *
+ * Remembers, per module binary and keyed on its modification time and size,
+ * whether it is an OBS plugin at all and which types it registered the last
+ * time it was loaded.  Binaries that aren't plugins are skipped without being
+ * opened, and modules that are disabled or fail to load still report the
+ * types they provide, so that their sources show up as disabled rather than
+ * missing. */
+
+#define MODULE_CACHE_VERSION 1
+
+static char *module_cache_path(void)
 {
-	struct fail_info *fail_info = param;
-	obs_module_t *module;
-	obs_module_t *disabled_module;
+	struct dstr path = {0};
 
-	bool is_obs_plugin;
+	if (!obs->module_config_path)
+		return NULL;
+
+	dstr_copy(&path, obs->module_config_path);
+	if (!dstr_is_empty(&path) && dstr_end(&path) != '/')
+		dstr_cat_ch(&path, '/');
+	dstr_cat(&path, "module-cache.json");
+	return path.array;
+}
+
+static obs_data_t *module_cache_load(void)
+{
+	char *path = module_cache_path();
+	obs_data_t *data = path ? obs_data_create_from_json_file(path) : NULL;
+	obs_data_t *modules = NULL;
 
-	get_plugin_info(info->bin_path, &is_obs_plugin);
+	if (data && obs_data_get_int(data, "version") == MODULE_CACHE_VERSION)
+		modules = obs_data_get_obj(data, "modules");
+
+	obs_data_release(data);
+	bfree(path);
+	return modules;
+}
 
-	if (!is_obs_plugin) {
-		blog(LOG_WARNING, "Skipping module '%s', not an OBS plugin", info->bin_path);
+static void module_cache_save(obs_data_t *modules)
+{
+	char *path = module_cache_path();
+	if (!path)
 		return;
+
+	obs_data_t *data = obs_data_create();
+	obs_data_set_int(data, "version", MODULE_CACHE_VERSION);
+	obs_data_set_obj(data, "modules", modules);
+
+	os_mkdirs(obs->module_config_path);
+	if (!obs_data_save_json_safe(data, path, "tmp", NULL))
+		blog(LOG_WARNING, "Failed to save module cache to '%s'", path);
+
+	obs_data_release(data);
+	bfree(path);
+}
+
+static void module_cache_set_types(obs_data_t *entry, const char *name, const char **ids, size_t num)
+{
+	obs_data_array_t *array = obs_data_array_create();
+
+	for (size_t i = 0; i < num; i++) {
+		obs_data_t *item = obs_data_create();
+		obs_data_set_string(item, "id", ids[i]);
+		obs_data_array_push_back(array, item);
+		obs_data_release(item);
 	}
 
-	if (!is_safe_module(info->name)) {
-		obs_create_disabled_module(&disabled_module, info->bin_path, info->data_path, OBS_MODULE_DISABLED_SAFE);
-		blog(LOG_WARNING, "Skipping module '%s', not on safe list", info->name);
+	obs_data_set_array(entry, name, array);
+	obs_data_array_release(array);
+}
+
+static void module_cache_add_types(obs_module_t *module, obs_data_t *entry, const char *name,
+				   void (*add)(obs_module_t *module, const char *id))
+{
+	obs_data_array_t *array = obs_data_get_array(entry, name);
+	size_t count = obs_data_array_count(array);
+
+	for (size_t i = 0; i < count; i++) {
+		obs_data_t *item = obs_data_array_item(array, i);
+		add(module, obs_data_get_string(item, "id"));
+		obs_data_release(item);
+	}
+
+	obs_data_array_release(array);
+}
+
+/* gives a disabled module the types it registered when it was last loaded */
+static void module_cache_apply_types(obs_module_t *module, obs_data_t *entry)
+{
+	if (!module || !entry)
 		return;
+
+	module_cache_add_types(module, entry, "sources", obs_module_add_source);
+	module_cache_add_types(module, entry, "outputs", obs_module_add_output);
+	module_cache_add_types(module, entry, "encoders", obs_module_add_encoder);
+	module_cache_add_types(module, entry, "services", obs_module_add_service);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Loading all modules
+ *
+ * Modules are found first, then their binaries are checked and opened on a
+ * task pool, and finally they are initialized one at a time in the order they
+ * were found, since obs_module_load registers types into global state. */
+
+struct module_candidate {
+	char *name;
+	char *bin_path;
+	char *data_path;
+
+	int64_t mtime;
+	int64_t size;
+	obs_data_t *cached;
+
+	bool safe;
+	bool disabled;
+	bool is_obs_plugin;
+	int code;
+	struct obs_module mod;
+
+	uint64_t open_time;
+	uint64_t load_time;
+};
+
+typedef DARRAY(struct module_candidate) module_candidates_t;
+
+static void find_candidate_callback(void *param, const struct obs_module_info2 *info)
+{
+	module_candidates_t *candidates = param;
+	struct module_candidate *candidate = da_push_back_new(*candidates);
+	struct stat st;
+
+	candidate->name = bstrdup(info->name);
+	candidate->bin_path = bstrdup(info->bin_path);
+	candidate->data_path = bstrdup(info->data_path);
+	candidate->safe = is_safe_module(info->name);
+	candidate->disabled = is_disabled_module(info->name);
+	candidate->code = MODULE_ERROR;
+
+	if (os_stat(info->bin_path, &st) == 0) {
+		candidate->mtime = (int64_t)st.st_mtime;
+		candidate->size = (int64_t)st.st_size;
 	}
+}
+
+static void open_candidate_task(void *param, size_t idx)
+{
+	struct module_candidate *candidate = (struct module_candidate *)param + idx;
+	uint64_t start = os_gettime_ns();
 
-	if (is_disabled_module(info->name)) {
-		obs_create_disabled_module(&disabled_module, info->bin_path, info->data_path, OBS_MODULE_DISABLED);
-		blog(LOG_WARNING, "Skipping module '%s', is disabled", info->name);
+	if (candidate->cached && !obs_data_get_bool(candidate->cached, "obs_plugin")) {
+		candidate->is_obs_plugin = false;
 		return;
 	}
 
-	int code = obs_open_module(&module, info->bin_path, info->data_path);
-	switch (code) {
+	get_plugin_info(candidate->bin_path, &candidate->is_obs_plugin);
+
+	if (candidate->is_obs_plugin && candidate->safe && !candidate->disabled)
+		candidate->code = open_module_binary(&candidate->mod, candidate->bin_path, candidate->data_path);
+
+	candidate->open_time = os_gettime_ns() - start;
+}
+
+static void add_load_failure(struct fail_info *fail_info, struct module_candidate *candidate)
+{
+	if (fail_info) {
+		dstr_cat(&fail_info->fail_modules, candidate->name);
+		dstr_cat(&fail_info->fail_modules, ";");
+		fail_info->fail_count++;
+	}
+}
+
+static void create_disabled_candidate(struct module_candidate *candidate, enum obs_module_load_state state)
+{
+	obs_module_t *disabled_module;
+
+	obs_create_disabled_module(&disabled_module, candidate->bin_path, candidate->data_path, state);
+	module_cache_apply_types(disabled_module, candidate->cached);
+}
+
+/* returns the module if it was loaded */
+static obs_module_t *load_candidate(struct module_candidate *candidate, struct fail_info *fail_info)
+{
+	obs_module_t *module;
+
+	if (!candidate->is_obs_plugin) {
+		if (candidate->cached)
+			blog(LOG_DEBUG, "Skipping module '%s', not an OBS plugin (cached)", candidate->bin_path);
+		else
+			blog(LOG_WARNING, "Skipping module '%s', not an OBS plugin", candidate->bin_path);
+		return NULL;
+	}
+
+	if (!candidate->safe) {
+		create_disabled_candidate(candidate, OBS_MODULE_DISABLED_SAFE);
+		blog(LOG_WARNING, "Skipping module '%s', not on safe list", candidate->name);
+		return NULL;
+	}
+
+	if (candidate->disabled) {
+		create_disabled_candidate(candidate, OBS_MODULE_DISABLED);
+		blog(LOG_WARNING, "Skipping module '%s', is disabled", candidate->name);
+		return NULL;
+	}
+
+	switch (candidate->code) {
 	case MODULE_MISSING_EXPORTS:
-		blog(LOG_DEBUG, "Failed to load module file '%s', not an OBS plugin", info->bin_path);
-		return;
+		blog(LOG_DEBUG, "Failed to load module file '%s', not an OBS plugin", candidate->bin_path);
+		candidate->is_obs_plugin = false;
+		return NULL;
 	case MODULE_FAILED_TO_OPEN:
-		blog(LOG_DEBUG, "Failed to load module file '%s', module failed to open", info->bin_path);
-		obs_create_disabled_module(&disabled_module, info->bin_path, info->data_path,
-					   OBS_MODULE_FAILED_TO_OPEN);
-		goto load_failure;
+		blog(LOG_DEBUG, "Failed to load module file '%s', module failed to open", candidate->bin_path);
+		create_disabled_candidate(candidate, OBS_MODULE_FAILED_TO_OPEN);
+		add_load_failure(fail_info, candidate);
+		return NULL;
 	case MODULE_ERROR:
-		blog(LOG_DEBUG, "Failed to load module file '%s' (unknown error)", info->bin_path);
-		goto load_failure;
+		blog(LOG_DEBUG, "Failed to load module file '%s' (unknown error)", candidate->bin_path);
+		add_load_failure(fail_info, candidate);
+		return NULL;
 	case MODULE_INCOMPATIBLE_VER:
-		blog(LOG_DEBUG, "Failed to load module file '%s', incompatible version", info->bin_path);
-		obs_create_disabled_module(&disabled_module, info->bin_path, info->data_path,
-					   OBS_MODULE_FAILED_TO_OPEN);
-		goto load_failure;
+		blog(LOG_DEBUG, "Failed to load module file '%s', incompatible version", candidate->bin_path);
+		create_disabled_candidate(candidate, OBS_MODULE_FAILED_TO_OPEN);
+		add_load_failure(fail_info, candidate);
+		return NULL;
 	case MODULE_HARDCODED_SKIP:
-		return;
+		return NULL;
 	}
 
-	if (!obs_init_module(module)) {
+	module = add_opened_module(&candidate->mod);
+
+	uint64_t start = os_gettime_ns();
+	bool loaded = obs_init_module(module);
+	candidate->load_time = os_gettime_ns() - start;
+
+	if (!loaded) {
 		free_module(module);
-		obs_create_disabled_module(&disabled_module, info->bin_path, info->data_path,
-					   OBS_MODULE_FAILED_TO_INITIALIZE);
+		create_disabled_candidate(candidate, OBS_MODULE_FAILED_TO_INITIALIZE);
+		return NULL;
 	}
 
-	UNUSED_PARAMETER(param);
-	return;
+	return module;
+}
 
-load_failure:
-	if (fail_info) {
-		dstr_cat(&fail_info->fail_modules, info->name);
-		dstr_cat(&fail_info->fail_modules, ";");
-		fail_info->fail_count++;
+static obs_data_t *make_cache_entry(struct module_candidate *candidate, obs_module_t *module)
+{
+	/* keep what's known about modules that weren't loaded this time */
+	if (!module && candidate->cached && candidate->is_obs_plugin) {
+		obs_data_addref(candidate->cached);
+		return candidate->cached;
+	}
+
+	obs_data_t *entry = obs_data_create();
+	obs_data_set_int(entry, "mtime", candidate->mtime);
+	obs_data_set_int(entry, "size", candidate->size);
+	obs_data_set_bool(entry, "obs_plugin", candidate->is_obs_plugin);
+
+	if (module) {
+		module_cache_set_types(entry, "sources", (const char **)module->sources.array, module->sources.num);
+		module_cache_set_types(entry, "outputs", (const char **)module->outputs.array, module->outputs.num);
+		module_cache_set_types(entry, "encoders", (const char **)module->encoders.array,
+				       module->encoders.num);
+		module_cache_set_types(entry, "services", (const char **)module->services.array,
+				       module->services.num);
 	}
+
+	return entry;
+}
+
+static int candidate_time_cmp(const void *a, const void *b)
+{
+	const struct module_candidate *candidate_a = *(const struct module_candidate *const *)a;
+	const struct module_candidate *candidate_b = *(const struct module_candidate *const *)b;
+	uint64_t time_a = candidate_a->open_time + candidate_a->load_time;
+	uint64_t time_b = candidate_b->open_time + candidate_b->load_time;
+
+	if (time_a == time_b)
+		return 0;
+	return time_a < time_b ? 1 : -1;
+}
+
+static void log_module_load_times(module_candidates_t *candidates, uint64_t total_time, size_t num_threads)
+{
+	DARRAY(struct module_candidate *) loaded;
+
+	da_init(loaded);
+
+	for (size_t i = 0; i < candidates->num; i++) {
+		struct module_candidate *candidate = &candidates->array[i];
+		if (candidate->open_time || candidate->load_time)
+			da_push_back(loaded, &candidate);
+	}
+
+	qsort(loaded.array, loaded.num, sizeof(*loaded.array), candidate_time_cmp);
+
+	blog(LOG_INFO, "Module load times (%.1f ms total, opened on %zu threads):", (double)total_time / 1000000.0,
+	     num_threads + 1);
+
+	for (size_t i = 0; i < loaded.num; i++) {
+		struct module_candidate *candidate = loaded.array[i];
+		blog(LOG_INFO, "    %s: open %.1f ms, load %.1f ms", candidate->name,
+		     (double)candidate->open_time / 1000000.0, (double)candidate->load_time / 1000000.0);
+	}
+
+	da_free(loaded);
+}
+
+static void load_all_modules(struct fail_info *fail_info)
+{
+	module_candidates_t candidates;
+	obs_data_t *cache = module_cache_load();
+	obs_data_t *new_cache = obs_data_create();
+	uint64_t start = os_gettime_ns();
+	os_task_pool_t *pool;
+
+	da_init(candidates);
+	obs_find_modules2(find_candidate_callback, &candidates);
+
+	for (size_t i = 0; i < candidates.num; i++) {
+		struct module_candidate *candidate = &candidates.array[i];
+		obs_data_t *entry = obs_data_get_obj(cache, candidate->bin_path);
+
+		if (entry && candidate->mtime && obs_data_get_int(entry, "mtime") == candidate->mtime &&
+		    obs_data_get_int(entry, "size") == candidate->size)
+			candidate->cached = entry;
+		else
+			obs_data_release(entry);
+	}
+
+	pool = os_task_pool_create("module load", 0);
+	os_task_pool_run(pool, candidates.num, open_candidate_task, candidates.array);
+
+	for (size_t i = 0; i < candidates.num; i++) {
+		struct module_candidate *candidate = &candidates.array[i];
+		obs_module_t *module = load_candidate(candidate, fail_info);
+
+		obs_data_t *entry = make_cache_entry(candidate, module);
+		obs_data_set_obj(new_cache, candidate->bin_path, entry);
+		obs_data_release(entry);
+	}
+
+	log_module_load_times(&candidates, os_gettime_ns() - start, os_task_pool_num_threads(pool));
+	os_task_pool_destroy(pool);
+
+	if (!cache || strcmp(obs_data_get_json(cache), obs_data_get_json(new_cache)) != 0)
+		module_cache_save(new_cache);
+
+	for (size_t i = 0; i < candidates.num; i++) {
+		struct module_candidate *candidate = &candidates.array[i];
+		obs_data_release(candidate->cached);
+		bfree(candidate->name);
+		bfree(candidate->bin_path);
+		bfree(candidate->data_path);
+	}
+
+	da_free(candidates);
+	obs_data_release(new_cache);
+	obs_data_release(cache);
 }
 
 static const char *obs_load_all_modules_name = "obs_load_all_modules";
@@ -564,7 +883,7 @@ static const char *reset_win32_symbol_paths_name = "reset_win32_symbol_paths";
 void obs_load_all_modules(void)
 {
 	profile_start(obs_load_all_modules_name);
-	obs_find_modules2(load_all_callback, NULL);
+	load_all_modules(NULL);
 #ifdef _WIN32
 	profile_start(reset_win32_symbol_paths_name);
 	reset_win32_symbol_paths();
@@ -581,7 +900,7 @@ void obs_load_all_modules2(struct obs_module_failure_info *mfi)
 	memset(mfi, 0, sizeof(*mfi));
 
 	profile_start(obs_load_all_modules2_name);
-	obs_find_modules2(load_all_callback, &fail_info);
+	load_all_modules(&fail_info);
 #ifdef _WIN32
 	profile_start(reset_win32_symbol_paths_name);
 	reset_win32_symbol_paths();
@@ -862,9 +1181,11 @@ lookup_t *obs_module_load_locale(obs_module_t *module, const char *default_local
 	dstr_cat(&str, default_locale);
 	dstr_cat(&str, ".ini");
 
+	/* locale files are only parsed once the module looks up its first
+	 * string, which many modules never do during startup */
 	char *file = obs_find_module_file(module, str.array);
 	if (file)
-		lookup = text_lookup_create(file);
+		lookup = text_lookup_create_deferred(file);
 
 	bfree(file);
 
@@ -882,7 +1203,7 @@ lookup_t *obs_module_load_locale(obs_module_t *module, const char *default_local
 
 	file = obs_find_module_file(module, str.array);
 
-	if (!text_lookup_add(lookup, file))
+	if (!file || !text_lookup_add_deferred(lookup, file))
 		blog(LOG_WARNING, "Failed to load '%s' text for module: '%s'", locale, module->file);
 
 	bfree(file);
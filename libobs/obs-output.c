@@ -204,6 +204,7 @@ obs_output_t *obs_output_create(const char *id, const char *name, obs_data_t *se
 	pthread_mutex_init_value(&output->delay_mutex);
 	pthread_mutex_init_value(&output->pause.mutex);
 	pthread_mutex_init_value(&output->pkt_callbacks_mutex);
+	pthread_mutex_init_value(&output->pkt_queue.mutex);
 
 	if (pthread_mutex_init(&output->interleaved_mutex, NULL) != 0)
 		goto fail;
@@ -213,6 +214,8 @@ obs_output_t *obs_output_create(const char *id, const char *name, obs_data_t *se
 		goto fail;
 	if (pthread_mutex_init(&output->pkt_callbacks_mutex, NULL) != 0)
 		goto fail;
+	if (!packet_queue_init(&output->pkt_queue))
+		goto fail;
 	if (os_event_init(&output->stopping_event, OS_EVENT_TYPE_MANUAL) != 0)
 		goto fail;
 	if (!init_output_handlers(output, name, settings, hotkey_data))
@@ -242,6 +245,7 @@ obs_output_t *obs_output_create(const char *id, const char *name, obs_data_t *se
 	output->reconnect_retry_sec = 2;
 	output->reconnect_retry_max = 20;
 	output->reconnect_retry_exp = RECONNECT_RETRY_BASE_EXP + (rand_float(0) * 0.05f);
+	output->pkt_queue.policy = flag_service(output) ? OBS_OUTPUT_QUEUE_DROP : OBS_OUTPUT_QUEUE_GROW;
 	output->valid = true;
 
 	obs_context_init_control(&output->context, output, (obs_destroy_cb)obs_output_destroy);
@@ -263,8 +267,8 @@ fail:
 static inline void free_packets(struct obs_output *output)
 {
 	for (size_t i = 0; i < output->interleaved_packets.num; i++)
-		obs_encoder_packet_release(output->interleaved_packets.array + i);
-	da_free(output->interleaved_packets);
+		obs_encoder_packet_release(interleaver_get(&output->interleaved_packets, i));
+	interleaver_free(&output->interleaved_packets);
 }
 
 static inline void clear_raw_audio_buffers(obs_output_t *output)
@@ -340,6 +344,7 @@ void obs_output_destroy(obs_output_t *output)
 		pthread_mutex_destroy(&output->interleaved_mutex);
 		pthread_mutex_destroy(&output->delay_mutex);
 		pthread_mutex_destroy(&output->pkt_callbacks_mutex);
+		packet_queue_free(&output->pkt_queue);
 		os_event_destroy(output->reconnect_stop_event);
 		obs_context_data_free(&output->context);
 		deque_free(&output->delay_data);
@@ -429,7 +434,7 @@ static void log_frame_info(struct obs_output *output)
 	uint32_t lagged = video->lagged_frames - output->starting_lagged_count;
 
 	int dropped = obs_output_get_frames_dropped(output);
-	int total = output->total_frames;
+	int total = obs_output_get_total_frames(output);
 
 	double percentage_lagged = 0.0f;
 	double percentage_dropped = 0.0f;
@@ -1190,15 +1195,37 @@ int obs_output_get_frames_dropped(const obs_output_t *output)
 {
 	if (!obs_output_valid(output, "obs_output_get_frames_dropped"))
 		return 0;
-	if (!output->info.get_dropped_frames)
-		return 0;
 
-	return output->info.get_dropped_frames(output->context.data);
+	/* frames dropped by the packet queue never reach the output */
+	int dropped = (int)packet_queue_dropped_frames(&output->pkt_queue);
+
+	if (output->info.get_dropped_frames)
+		dropped += output->info.get_dropped_frames(output->context.data);
+	return dropped;
 }
 
 int obs_output_get_total_frames(const obs_output_t *output)
 {
-	return obs_output_valid(output, "obs_output_get_total_frames") ? output->total_frames : 0;
+	if (!obs_output_valid(output, "obs_output_get_total_frames"))
+		return 0;
+
+	return output->total_frames + (int)packet_queue_dropped_frames(&output->pkt_queue);
+}
+
+void obs_output_set_packet_queue_policy(obs_output_t *output, enum obs_output_queue_policy policy, size_t max_packets)
+{
+	if (!obs_output_valid(output, "obs_output_set_packet_queue_policy"))
+		return;
+
+	packet_queue_set_policy(&output->pkt_queue, policy, max_packets);
+}
+
+size_t obs_output_get_packet_queue_depth(const obs_output_t *output)
+{
+	if (!obs_output_valid(output, "obs_output_get_packet_queue_depth"))
+		return 0;
+
+	return packet_queue_depth(&output->pkt_queue);
 }
 
 void obs_output_set_preferred_size2(obs_output_t *output, uint32_t width, uint32_t height, size_t idx)
@@ -1680,11 +1707,11 @@ static bool add_caption(struct obs_output *output, struct encoder_packet *out)
 
 static inline void send_interleaved(struct obs_output *output)
 {
-	struct encoder_packet out = output->interleaved_packets.array[0];
+	struct encoder_packet out;
 	struct encoder_packet_time ept_local = {0};
 	bool found_ept = false;
 
-	da_erase(output->interleaved_packets, 0);
+	interleaver_pop_front(&output->interleaved_packets, &out);
 
 	if (out.type == OBS_ENCODER_VIDEO) {
 		output->total_frames++;
@@ -1781,7 +1808,7 @@ static size_t get_interleaved_start_idx(struct obs_output *output)
 	size_t idx = 0;
 
 	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
-		struct encoder_packet *packet = &output->interleaved_packets.array[i];
+		struct encoder_packet *packet = interleaver_get(&output->interleaved_packets, i);
 		int64_t diff;
 
 		if (packet->type != OBS_ENCODER_AUDIO) {
@@ -1802,10 +1829,10 @@ static size_t get_interleaved_start_idx(struct obs_output *output)
 	/* Early AAC/Opus audio packets will be for "priming" the encoder and contain silence, but they should not be
 	 * discarded. Set the idx to the first audio packet if closest PTS was <= 0. */
 	size_t first_audio_idx = idx;
-	while (output->interleaved_packets.array[first_audio_idx].type != OBS_ENCODER_AUDIO)
+	while (interleaver_get(&output->interleaved_packets, first_audio_idx)->type != OBS_ENCODER_AUDIO)
 		first_audio_idx++;
 
-	if (output->interleaved_packets.array[first_audio_idx].pts <= 0) {
+	if (interleaver_get(&output->interleaved_packets, first_audio_idx)->pts <= 0) {
 		for (size_t i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++) {
 			int audio_idx = find_first_packet_type_idx(output, OBS_ENCODER_AUDIO, i);
 			if (audio_idx >= 0 && (size_t)audio_idx < idx)
@@ -1836,7 +1863,7 @@ static int prune_premature_packets(struct obs_output *output)
 		return -1;
 
 	max_idx = video_idx;
-	video = &output->interleaved_packets.array[video_idx];
+	video = interleaver_get(&output->interleaved_packets, video_idx);
 	duration_usec = video->timebase_num * 1000000LL / video->timebase_den;
 
 	for (size_t i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++) {
@@ -1854,7 +1881,7 @@ static int prune_premature_packets(struct obs_output *output)
 			return -1;
 		}
 
-		audio = &output->interleaved_packets.array[audio_idx];
+		audio = interleaver_get(&output->interleaved_packets, audio_idx);
 		if (audio_idx > max_idx)
 			max_idx = audio_idx;
 
@@ -1885,7 +1912,7 @@ static int prune_premature_packets(struct obs_output *output)
 static void discard_to_idx(struct obs_output *output, size_t idx)
 {
 	for (size_t i = 0; i < idx; i++) {
-		struct encoder_packet *packet = &output->interleaved_packets.array[i];
+		struct encoder_packet *packet = interleaver_get(&output->interleaved_packets, i);
 #if DEBUG_STARTING_PACKETS == 1
 		blog(LOG_DEBUG, "discarding %s packet, dts: %lld, pts: %lld",
 		     packet->type == OBS_ENCODER_VIDEO ? "video" : "audio", packet->dts, packet->pts);
@@ -1896,7 +1923,7 @@ static void discard_to_idx(struct obs_output *output, size_t idx)
 		obs_encoder_packet_release(packet);
 	}
 
-	da_erase_range(output->interleaved_packets, 0, idx);
+	interleaver_erase_front(&output->interleaved_packets, idx);
 }
 
 static bool prune_interleaved_packets(struct obs_output *output)
@@ -1907,7 +1934,7 @@ static bool prune_interleaved_packets(struct obs_output *output)
 #if DEBUG_STARTING_PACKETS == 1
 	blog(LOG_DEBUG, "--------- Pruning! %d ---------", prune_start);
 	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
-		struct encoder_packet *packet = &output->interleaved_packets.array[i];
+		struct encoder_packet *packet = interleaver_get(&output->interleaved_packets, i);
 		blog(LOG_DEBUG, "packet: %s %d, ts: %lld, pruned = %s",
 		     packet->type == OBS_ENCODER_AUDIO ? "audio" : "video", (int)packet->track_idx, packet->dts_usec,
 		     (int)i < prune_start ? "true" : "false");
@@ -1931,7 +1958,7 @@ static bool prune_interleaved_packets(struct obs_output *output)
 static int find_first_packet_type_idx(struct obs_output *output, enum obs_encoder_type type, size_t idx)
 {
 	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
-		struct encoder_packet *packet = &output->interleaved_packets.array[i];
+		struct encoder_packet *packet = interleaver_get(&output->interleaved_packets, i);
 
 		if (packet->type == type && packet->track_idx == idx)
 			return (int)i;
@@ -1943,7 +1970,7 @@ static int find_first_packet_type_idx(struct obs_output *output, enum obs_encode
 static int find_last_packet_type_idx(struct obs_output *output, enum obs_encoder_type type, size_t idx)
 {
 	for (size_t i = output->interleaved_packets.num; i > 0; i--) {
-		struct encoder_packet *packet = &output->interleaved_packets.array[i - 1];
+		struct encoder_packet *packet = interleaver_get(&output->interleaved_packets, i - 1);
 
 		if (packet->type == type && packet->track_idx == idx)
 			return (int)(i - 1);
@@ -1956,14 +1983,14 @@ static inline struct encoder_packet *find_first_packet_type(struct obs_output *o
 							    size_t audio_idx)
 {
 	int idx = find_first_packet_type_idx(output, type, audio_idx);
-	return (idx != -1) ? &output->interleaved_packets.array[idx] : NULL;
+	return (idx != -1) ? interleaver_get(&output->interleaved_packets, idx) : NULL;
 }
 
 static inline struct encoder_packet *find_last_packet_type(struct obs_output *output, enum obs_encoder_type type,
 							   size_t audio_idx)
 {
 	int idx = find_last_packet_type_idx(output, type, audio_idx);
-	return (idx != -1) ? &output->interleaved_packets.array[idx] : NULL;
+	return (idx != -1) ? interleaver_get(&output->interleaved_packets, idx) : NULL;
 }
 
 static bool get_audio_and_video_packets(struct obs_output *output, struct encoder_packet **video,
@@ -2063,51 +2090,27 @@ static bool initialize_interleaved_packets(struct obs_output *output)
 
 	/* apply new offsets to all existing packet DTS/PTS values */
 	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
-		struct encoder_packet *packet = &output->interleaved_packets.array[i];
+		struct encoder_packet *packet = interleaver_get(&output->interleaved_packets, i);
 		apply_interleaved_packet_offset(output, packet, NULL);
 	}
 
 	return true;
 }
 
-static inline void insert_interleaved_packet(struct obs_output *output, struct encoder_packet *out)
-{
-	size_t idx;
-	for (idx = 0; idx < output->interleaved_packets.num; idx++) {
-		struct encoder_packet *cur_packet;
-		cur_packet = output->interleaved_packets.array + idx;
-
-		// sort video packets with same DTS by track index,
-		// to prevent the pruning logic from removing additional
-		// video tracks
-		if (out->dts_usec == cur_packet->dts_usec && out->type == OBS_ENCODER_VIDEO &&
-		    cur_packet->type == OBS_ENCODER_VIDEO && out->track_idx > cur_packet->track_idx)
-			continue;
-
-		if (out->dts_usec == cur_packet->dts_usec && out->type == OBS_ENCODER_VIDEO) {
-			break;
-		} else if (out->dts_usec < cur_packet->dts_usec) {
-			break;
-		}
-	}
-
-	da_insert(output->interleaved_packets, idx, out);
-}
-
 static void resort_interleaved_packets(struct obs_output *output)
 {
-	DARRAY(struct encoder_packet) old_array;
+	struct interleaver old = output->interleaved_packets;
 
-	old_array.da = output->interleaved_packets.da;
-	memset(&output->interleaved_packets, 0, sizeof(output->interleaved_packets));
+	interleaver_init(&output->interleaved_packets);
 
-	for (size_t i = 0; i < old_array.num; i++) {
-		set_higher_ts(output, &old_array.array[i]);
+	for (size_t i = 0; i < old.num; i++) {
+		struct encoder_packet *packet = interleaver_get(&old, i);
 
-		insert_interleaved_packet(output, &old_array.array[i]);
+		set_higher_ts(output, packet);
+		interleaver_insert(&output->interleaved_packets, packet);
 	}
 
-	da_free(old_array);
+	interleaver_free(&old);
 }
 
 static void discard_unused_audio_packets(struct obs_output *output, int64_t dts_usec)
@@ -2115,7 +2118,7 @@ static void discard_unused_audio_packets(struct obs_output *output, int64_t dts_
 	size_t idx = 0;
 
 	for (; idx < output->interleaved_packets.num; idx++) {
-		struct encoder_packet *p = &output->interleaved_packets.array[idx];
+		struct encoder_packet *p = interleaver_get(&output->interleaved_packets, idx);
 
 		if (p->dts_usec >= dts_usec)
 			break;
@@ -2206,7 +2209,7 @@ static inline size_t count_streamable_frames(struct obs_output *output)
 	size_t eligible = 0;
 
 	for (size_t idx = 0; idx < output->interleaved_packets.num; idx++) {
-		struct encoder_packet *pkt = &output->interleaved_packets.array[idx];
+		struct encoder_packet *pkt = interleaver_get(&output->interleaved_packets, idx);
 
 		/* Only count an interleaved packet as streamable if there are packets of the opposing type and of a
 		 * higher timestamp in the interleave buffer. This ensures that the timestamps are monotonic. */
@@ -2257,7 +2260,7 @@ static void interleave_packets(void *data, struct encoder_packet *packet, struct
 	if (output->active_delay_ns)
 		out = *packet;
 	else
-		obs_encoder_packet_create_instance(&out, packet);
+		obs_encoder_packet_ref(&out, packet);
 
 	if (packet_time) {
 		output_packet_time = da_push_back_new(output->encoder_packet_times[packet->track_idx]);
@@ -2269,7 +2272,7 @@ static void interleave_packets(void *data, struct encoder_packet *packet, struct
 	else
 		check_received(output, packet);
 
-	insert_interleaved_packet(output, &out);
+	interleaver_insert(&output->interleaved_packets, &out);
 
 	received_video = true;
 	for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
@@ -2325,6 +2328,43 @@ static void default_encoded_callback(void *param, struct encoder_packet *packet,
 		obs_encoder_packet_release(packet);
 }
 
+/* Called from the encoder threads.  Only takes a reference to the packet,
+ * the output receives it on its packet queue thread. */
+static void queue_encoded_packet(void *data, struct encoder_packet *packet, struct encoder_packet_time *packet_time)
+{
+	struct obs_output *output = data;
+	size_t track = packet->type == OBS_ENCODER_VIDEO ? get_encoder_index(output, packet) : 0;
+	size_t flushed = packet_queue_push(&output->pkt_queue, packet, packet_time, track);
+
+	if (flushed)
+		blog(LOG_WARNING, "Output '%s': packet queue full, dropped %zu packets", output->context.name,
+		     flushed);
+}
+
+static bool start_packet_queue(struct obs_output *output, encoded_callback_t callback)
+{
+	output->pkt_queue_active = packet_queue_start(&output->pkt_queue, callback, output);
+	if (!output->pkt_queue_active)
+		blog(LOG_WARNING,
+		     "Output '%s': failed to create packet queue thread, "
+		     "passing packets on the encoder threads",
+		     output->context.name);
+
+	return output->pkt_queue_active;
+}
+
+static void stop_packet_queue(struct obs_output *output)
+{
+	if (!output->pkt_queue_active)
+		return;
+
+	packet_queue_stop(&output->pkt_queue);
+	output->pkt_queue_active = false;
+
+	blog(LOG_INFO, "Output '%s': packet queue peaked at %zu packets, %ld dropped", output->context.name,
+	     output->pkt_queue.peak, os_atomic_load_long(&output->pkt_queue.dropped));
+}
+
 static void default_raw_video_callback(void *param, struct video_data *frame)
 {
 	struct obs_output *output = param;
@@ -2511,6 +2551,9 @@ static void hook_data_capture(struct obs_output *output)
 			     output->context.name, output->delay_sec, preserve_active(output) ? "on" : "off");
 		}
 
+		if (start_packet_queue(output, encoded_callback))
+			encoded_callback = queue_encoded_packet;
+
 		if (has_audio)
 			start_audio_encoders(output, encoded_callback);
 		if (has_video)
@@ -2842,7 +2885,9 @@ static void *end_data_capture_thread(void *data)
 	bool has_audio = flag_audio(output);
 
 	if (flag_encoded(output)) {
-		if (output->active_delay_ns)
+		if (output->pkt_queue_active)
+			encoded_callback = queue_encoded_packet;
+		else if (output->active_delay_ns)
 			encoded_callback = process_delay;
 		else
 			encoded_callback = (has_video && has_audio) ? interleave_packets : default_encoded_callback;
@@ -2851,6 +2896,8 @@ static void *end_data_capture_thread(void *data)
 			stop_video_encoders(output, encoded_callback);
 		if (has_audio)
 			stop_audio_encoders(output, encoded_callback);
+
+		stop_packet_queue(output);
 	} else {
 		if (has_video)
 			stop_raw_video(output->video, default_raw_video_callback, output);
@@ -0,0 +1,266 @@
+/******************************************************************************
+    Copyright (C) 2026 by OBS Studio contributors
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "util/c99defs.h"
+#include "util/deque.h"
+#include "util/threading.h"
+#include "obs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Queue of encoded packets between the encoders and an output.
+ *
+ * Encoders only take a reference to each packet and push it, a thread per
+ * output pops the packets and passes them on, so a slow output can't stall
+ * encoders it shares with other outputs.
+ *
+ * With OBS_OUTPUT_QUEUE_DROP the queue is flushed once it holds max_packets
+ * packets.  Either policy flushes it once it holds more than max_bytes of
+ * packet data, so an output that stops consuming can't use up all memory.
+ * After a flush, video packets are dropped until the next keyframe of their
+ * track, as they couldn't be decoded anyway.
+ */
+
+#define PACKET_QUEUE_DEFAULT_MAX 1024
+#define PACKET_QUEUE_DEFAULT_MAX_BYTES (512 * 1024 * 1024)
+
+typedef void (*packet_queue_cb)(void *param, struct encoder_packet *packet, struct encoder_packet_time *packet_time);
+
+struct queued_packet {
+	struct encoder_packet packet;
+	struct encoder_packet_time packet_time;
+	bool has_packet_time;
+};
+
+struct packet_queue {
+	struct deque packets; /* struct queued_packet */
+	pthread_mutex_t mutex;
+	os_sem_t *sem;
+	pthread_t thread;
+	bool thread_active;
+	volatile bool stopping;
+
+	packet_queue_cb callback;
+	void *param;
+
+	enum obs_output_queue_policy policy;
+	size_t max_packets;
+	size_t max_bytes;
+	size_t bytes;
+	size_t peak;
+	bool wait_keyframe[MAX_OUTPUT_VIDEO_ENCODERS];
+
+	volatile long depth;
+	volatile long dropped;
+	volatile long dropped_frames;
+};
+
+static inline bool packet_queue_init(struct packet_queue *pq)
+{
+	memset(pq, 0, sizeof(*pq));
+	pthread_mutex_init_value(&pq->mutex);
+
+	pq->policy = OBS_OUTPUT_QUEUE_GROW;
+	pq->max_packets = PACKET_QUEUE_DEFAULT_MAX;
+	pq->max_bytes = PACKET_QUEUE_DEFAULT_MAX_BYTES;
+
+	if (pthread_mutex_init(&pq->mutex, NULL) != 0)
+		return false;
+	if (os_sem_init(&pq->sem, 0) != 0) {
+		pthread_mutex_destroy(&pq->mutex);
+		return false;
+	}
+
+	return true;
+}
+
+/* releases the packets still queued, call with the mutex held */
+static inline size_t packet_queue_clear(struct packet_queue *pq)
+{
+	struct queued_packet qp;
+	size_t frames = 0;
+
+	while (pq->packets.size) {
+		deque_pop_front(&pq->packets, &qp, sizeof(qp));
+		if (qp.packet.type == OBS_ENCODER_VIDEO)
+			frames++;
+		obs_encoder_packet_release(&qp.packet);
+	}
+
+	pq->bytes = 0;
+	os_atomic_set_long(&pq->depth, 0);
+	return frames;
+}
+
+static inline void packet_queue_free(struct packet_queue *pq)
+{
+	packet_queue_clear(pq);
+	deque_free(&pq->packets);
+	pthread_mutex_destroy(&pq->mutex);
+	os_sem_destroy(pq->sem);
+}
+
+static inline void packet_queue_set_policy(struct packet_queue *pq, enum obs_output_queue_policy policy,
+					   size_t max_packets)
+{
+	pthread_mutex_lock(&pq->mutex);
+	pq->policy = policy;
+	pq->max_packets = max_packets ? max_packets : PACKET_QUEUE_DEFAULT_MAX;
+	pthread_mutex_unlock(&pq->mutex);
+}
+
+static inline size_t packet_queue_depth(const struct packet_queue *pq)
+{
+	return (size_t)os_atomic_load_long(&pq->depth);
+}
+
+/* video packets dropped since the queue was started */
+static inline long packet_queue_dropped_frames(const struct packet_queue *pq)
+{
+	return os_atomic_load_long(&pq->dropped_frames);
+}
+
+static inline void packet_queue_drop(struct packet_queue *pq, long packets, long frames)
+{
+	os_atomic_set_long(&pq->dropped, os_atomic_load_long(&pq->dropped) + packets);
+	os_atomic_set_long(&pq->dropped_frames, os_atomic_load_long(&pq->dropped_frames) + frames);
+}
+
+/* Called from the encoder threads.  track is the index of the packet's
+ * video encoder in the output.  Returns the number of packets flushed to
+ * make room, if any. */
+static inline size_t packet_queue_push(struct packet_queue *pq, struct encoder_packet *packet,
+				       struct encoder_packet_time *packet_time, size_t track)
+{
+	struct queued_packet qp = {0};
+	const bool video = packet->type == OBS_ENCODER_VIDEO;
+	size_t flushed = 0;
+	size_t depth;
+
+	pthread_mutex_lock(&pq->mutex);
+
+	depth = pq->packets.size / sizeof(qp);
+	if ((pq->policy == OBS_OUTPUT_QUEUE_DROP && depth >= pq->max_packets) ||
+	    (depth && pq->bytes + packet->size > pq->max_bytes)) {
+		size_t frames = packet_queue_clear(pq);
+		packet_queue_drop(pq, (long)depth, (long)frames);
+		flushed = depth;
+
+		for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++)
+			pq->wait_keyframe[i] = true;
+	}
+
+	if (video && track < MAX_OUTPUT_VIDEO_ENCODERS && pq->wait_keyframe[track]) {
+		if (!packet->keyframe) {
+			packet_queue_drop(pq, 1, 1);
+			pthread_mutex_unlock(&pq->mutex);
+			return flushed;
+		}
+
+		pq->wait_keyframe[track] = false;
+	}
+
+	obs_encoder_packet_ref(&qp.packet, packet);
+	if (packet_time) {
+		qp.packet_time = *packet_time;
+		qp.has_packet_time = true;
+	}
+
+	deque_push_back(&pq->packets, &qp, sizeof(qp));
+	pq->bytes += packet->size;
+
+	depth = pq->packets.size / sizeof(qp);
+	if (depth > pq->peak)
+		pq->peak = depth;
+	os_atomic_set_long(&pq->depth, (long)depth);
+
+	pthread_mutex_unlock(&pq->mutex);
+
+	os_sem_post(pq->sem);
+	return flushed;
+}
+
+static inline void *packet_queue_thread(void *data)
+{
+	struct packet_queue *pq = data;
+	struct queued_packet qp;
+
+	os_set_thread_name("obs-output: packet queue");
+
+	for (;;) {
+		bool have_packet = false;
+
+		os_sem_wait(pq->sem);
+
+		pthread_mutex_lock(&pq->mutex);
+		if (pq->packets.size) {
+			deque_pop_front(&pq->packets, &qp, sizeof(qp));
+			pq->bytes -= qp.packet.size;
+			os_atomic_set_long(&pq->depth, (long)(pq->packets.size / sizeof(qp)));
+			have_packet = true;
+		}
+		pthread_mutex_unlock(&pq->mutex);
+
+		/* the stop signal is posted after the encoders have been
+		 * stopped, so the queue is empty by the time it's received */
+		if (!have_packet) {
+			if (os_atomic_load_bool(&pq->stopping))
+				break;
+			continue;
+		}
+
+		pq->callback(pq->param, &qp.packet, qp.has_packet_time ? &qp.packet_time : NULL);
+		obs_encoder_packet_release(&qp.packet);
+	}
+
+	return NULL;
+}
+
+static inline bool packet_queue_start(struct packet_queue *pq, packet_queue_cb callback, void *param)
+{
+	pq->callback = callback;
+	pq->param = param;
+	pq->peak = 0;
+	memset(pq->wait_keyframe, 0, sizeof(pq->wait_keyframe));
+	os_atomic_set_long(&pq->dropped, 0);
+	os_atomic_set_long(&pq->dropped_frames, 0);
+	os_atomic_set_bool(&pq->stopping, false);
+
+	pq->thread_active = pthread_create(&pq->thread, NULL, packet_queue_thread, pq) == 0;
+	return pq->thread_active;
+}
+
+/* call once nothing pushes to the queue anymore, passes on what is left */
+static inline void packet_queue_stop(struct packet_queue *pq)
+{
+	if (!pq->thread_active)
+		return;
+
+	os_atomic_set_bool(&pq->stopping, true);
+	os_sem_post(pq->sem);
+	pthread_join(pq->thread, NULL);
+	pq->thread_active = false;
+}
+
+#ifdef __cplusplus
+}
+#endif
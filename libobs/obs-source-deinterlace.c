@@ -235,13 +235,13 @@ void deinterlace_update_async_video(obs_source_t *source)
 
 	source->deinterlace_rendered = true;
 
-	pthread_mutex_lock(&source->async_mutex);
+	lock_async_mutex(source);
 
 	const bool updated = source->cur_async_frame != NULL;
 	struct obs_source_frame *frame = source->prev_async_frame;
 	source->prev_async_frame = NULL;
 
-	pthread_mutex_unlock(&source->async_mutex);
+	unlock_async_mutex(source);
 
 	if (frame) {
 		os_atomic_inc_long(&frame->refs);
@@ -413,12 +413,12 @@ static void enable_deinterlacing(obs_source_t *source, enum obs_deinterlace_mode
 	source->deinterlace_mode = mode;
 	source->deinterlace_effect = get_effect(mode);
 
-	pthread_mutex_lock(&source->async_mutex);
+	lock_async_mutex(source);
 	if (source->prev_async_frame) {
 		remove_async_frame(source, source->prev_async_frame);
 		source->prev_async_frame = NULL;
 	}
-	pthread_mutex_unlock(&source->async_mutex);
+	unlock_async_mutex(source);
 
 	obs_leave_graphics();
 }
@@ -286,6 +286,7 @@ static void obs_source_init_finalize(struct obs_source *source, obs_canvas_t *ca
 		}
 	}
 	obs_context_data_insert_uuid(&source->context, &obs->data.sources_mutex, &obs->data.sources);
+	obs_invalidate_sources_to_tick();
 }
 
 static bool obs_source_hotkey_mute(void *data, obs_hotkey_pair_id id, obs_hotkey_t *key, bool pressed)
@@ -433,9 +434,16 @@ void obs_source_audio_output_capture_device_changed(obs_source_t *src, const cha
 	}
 }
 
-static obs_source_t *obs_source_create_internal(const char *id, const char *name, const char *uuid,
-						obs_data_t *settings, obs_data_t *hotkey_data, bool private,
-						uint32_t last_obs_ver, obs_canvas_t *canvas)
+/* Creation is split into three steps so that source loading can run the
+ * create callbacks of thread-safe source types on worker threads, while
+ * everything that touches global state stays on the loading thread:
+ *
+ * - begin:  allocates the source and initializes its context, defaults and
+ *           hotkeys
+ * - data:   calls the create callback of the source type
+ * - finish: registers the source name and UUID and sends creation signals */
+struct obs_source *obs_source_create_begin(const char *id, const char *name, const char *uuid, obs_data_t *settings,
+					   obs_data_t *hotkey_data, bool private, uint32_t last_obs_ver)
 {
 	struct obs_source *source = bzalloc(sizeof(struct obs_source));
 
@@ -477,23 +485,42 @@ static obs_source_t *obs_source_create_internal(const char *id, const char *name
 	if (!obs_source_init(source))
 		goto fail;
 
-	/* Scenes need canvases, fall back to using default canvas if none provided here. */
-	if (requires_canvas(source) && !canvas) {
-		blog(LOG_WARNING, "Attempted to add Scene without specifying a canvas! Using default canvas instead.");
-		canvas = obs->data.main_canvas;
-	}
-
 	if (!private)
 		obs_source_init_audio_hotkeys(source);
 
+	return source;
+
+fail:
+	blog(LOG_ERROR, "obs_source_create failed");
+	obs_source_destroy(source);
+	return NULL;
+}
+
+void obs_source_create_data(struct obs_source *source)
+{
+	const char *name = source->context.name;
+	bool has_info = !source->owns_info_id;
+
 	/* allow the source to be created even if creation fails so that the
 	 * user's data doesn't become lost */
-	if (info && info->create)
-		source->context.data = info->create(source->context.settings, source);
-	if ((!info || info->create) && !source->context.data)
+	if (has_info && source->info.create)
+		source->context.data = source->info.create(source->context.settings, source);
+	if ((!has_info || source->info.create) && !source->context.data)
 		blog(LOG_ERROR, "Failed to create source '%s'!", name);
 
-	blog(LOG_DEBUG, "%ssource '%s' (%s) created", private ? "private " : "", name, id);
+	blog(LOG_DEBUG, "%ssource '%s' (%s) created", source->context.private ? "private " : "", name,
+	     source->info.id);
+}
+
+void obs_source_create_finish(struct obs_source *source, obs_canvas_t *canvas)
+{
+	bool private = source->context.private;
+
+	/* Scenes need canvases, fall back to using default canvas if none provided here. */
+	if (requires_canvas(source) && !canvas) {
+		blog(LOG_WARNING, "Attempted to add Scene without specifying a canvas! Using default canvas instead.");
+		canvas = obs->data.main_canvas;
+	}
 
 	source->flags = source->default_flags;
 	source->enabled = true;
@@ -508,13 +535,20 @@ static obs_source_t *obs_source_create_internal(const char *id, const char *name
 		if (!canvas || canvas == obs->data.main_canvas)
 			obs_source_dosignal(source, "source_create", NULL);
 	}
+}
 
-	return source;
+static obs_source_t *obs_source_create_internal(const char *id, const char *name, const char *uuid,
+						obs_data_t *settings, obs_data_t *hotkey_data, bool private,
+						uint32_t last_obs_ver, obs_canvas_t *canvas)
+{
+	struct obs_source *source =
+		obs_source_create_begin(id, name, uuid, settings, hotkey_data, private, last_obs_ver);
+	if (!source)
+		return NULL;
 
-fail:
-	blog(LOG_ERROR, "obs_source_create failed");
-	obs_source_destroy(source);
-	return NULL;
+	obs_source_create_data(source);
+	obs_source_create_finish(source, canvas);
+	return source;
 }
 
 obs_source_t *obs_source_create(const char *id, const char *name, obs_data_t *settings, obs_data_t *hotkey_data)
@@ -703,6 +737,78 @@ static inline void obs_source_frame_decref(struct obs_source_frame *frame)
 		obs_source_frame_destroy(frame);
 }
 
+/* async_mutex is recursive, the depth is tracked so that the release
+ * callbacks of owned frames are only called once it's actually unlocked */
+void lock_async_mutex(obs_source_t *source)
+{
+	pthread_mutex_lock(&source->async_mutex);
+	source->async_lock_depth++;
+}
+
+void unlock_async_mutex(obs_source_t *source)
+{
+	DARRAY(struct owned_async_frame *) released;
+
+	da_init(released);
+	if (--source->async_lock_depth == 0)
+		da_move(released, source->released_owned_frames);
+
+	pthread_mutex_unlock(&source->async_mutex);
+
+	for (size_t i = 0; i < released.num; i++) {
+		struct owned_async_frame *owned = released.array[i];
+		owned->release(owned->param);
+		bfree(owned);
+	}
+
+	da_free(released);
+}
+
+static struct owned_async_frame *find_owned_frame(const obs_source_t *source, const struct obs_source_frame *frame)
+{
+	for (size_t i = 0; i < source->owned_frames.num; i++) {
+		struct owned_async_frame *owned = source->owned_frames.array[i];
+		if (&owned->frame == frame)
+			return owned;
+	}
+
+	return NULL;
+}
+
+/* called with async_mutex locked once a frame is no longer referenced, owned
+ * frames are handed back to their producer by unlock_async_mutex */
+static void free_async_frame(obs_source_t *source, struct obs_source_frame *frame)
+{
+	struct owned_async_frame *owned = find_owned_frame(source, frame);
+
+	if (owned) {
+		da_erase_item(source->owned_frames, &owned);
+		da_push_back(source->released_owned_frames, &owned);
+	} else {
+		obs_source_frame_destroy(frame);
+	}
+}
+
+static void owned_frame_decref(obs_source_t *source, struct obs_source_frame *frame)
+{
+	if (frame && find_owned_frame(source, frame) && os_atomic_dec_long(&frame->refs) == 0)
+		free_async_frame(source, frame);
+}
+
+/* drops the queue's references to owned frames, cached frames are freed
+ * with the cache */
+static void release_owned_async_frames(struct obs_source *source)
+{
+	if (!source->owned_frames.num)
+		return;
+
+	for (size_t i = 0; i < source->async_frames.num; i++)
+		owned_frame_decref(source, source->async_frames.array[i]);
+
+	owned_frame_decref(source, source->cur_async_frame);
+	owned_frame_decref(source, source->prev_async_frame);
+}
+
 static bool obs_source_filter_remove_refless(obs_source_t *source, obs_source_t *filter);
 static void obs_source_destroy_defer(struct obs_source *source);
 
@@ -747,6 +853,7 @@ void obs_source_destroy(struct obs_source *source)
 		obs_source_filter_remove(source, source->filters.array[0]);
 
 	obs_context_data_remove_uuid(&source->context, &obs->data.sources_mutex, &obs->data.sources);
+	obs_invalidate_sources_to_tick();
 	if (!source->context.private) {
 		if (requires_canvas(source)) {
 			obs_canvas_remove_source(source);
@@ -785,6 +892,12 @@ static void obs_source_destroy_defer(struct obs_source *source)
 	obs_hotkey_unregister(source->push_to_mute_key);
 	obs_hotkey_pair_unregister(source->mute_unmute_key);
 
+	/* nothing can use the source's frames anymore */
+	lock_async_mutex(source);
+	da_push_back_da(source->released_owned_frames, source->owned_frames);
+	da_resize(source->owned_frames, 0);
+	unlock_async_mutex(source);
+
 	for (i = 0; i < source->async_cache.num; i++)
 		obs_source_frame_decref(source->async_cache.array[i].frame);
 
@@ -821,6 +934,8 @@ static void obs_source_destroy_defer(struct obs_source *source)
 	da_free(source->caption_cb_list);
 	da_free(source->async_cache);
 	da_free(source->async_frames);
+	da_free(source->owned_frames);
+	da_free(source->released_owned_frames);
 	da_free(source->filters);
 	da_free(source->media_actions);
 	pthread_mutex_destroy(&source->filter_mutex);
@@ -933,6 +1048,7 @@ void obs_source_remove(obs_source_t *source)
 		obs_source_t *s = obs_source_get_ref(source);
 		if (s) {
 			s->removed = true;
+			obs_invalidate_sources_to_tick();
 			obs_source_dosignal(s, "source_remove", "remove");
 			/* Remove from canvas if there is one. */
 			if (source->canvas)
@@ -1073,7 +1189,8 @@ void obs_source_update(obs_source_t *source, obs_data_t *settings)
 	}
 
 	if (source->info.output_flags & OBS_SOURCE_VIDEO) {
-		os_atomic_inc_long(&source->defer_update_count);
+		if (os_atomic_inc_long(&source->defer_update_count) == 1)
+			obs_invalidate_sources_to_tick();
 	} else if (source->context.data && source->info.update) {
 		source->info.update(source->context.data, source->context.settings);
 		obs_source_dosignal(source, "source_update", "update");
@@ -1240,6 +1357,8 @@ void obs_source_activate(obs_source_t *source, enum view_type type)
 		os_atomic_inc_long(&source->activate_refs);
 		obs_source_enum_active_tree(source, activate_tree, NULL);
 	}
+
+	obs_invalidate_sources_to_tick();
 }
 
 void obs_source_deactivate(obs_source_t *source, enum view_type type)
@@ -1258,6 +1377,8 @@ void obs_source_deactivate(obs_source_t *source, enum view_type type)
 			obs_source_enum_active_tree(source, deactivate_tree, NULL);
 		}
 	}
+
+	obs_invalidate_sources_to_tick();
 }
 
 static inline struct obs_source_frame *get_closest_frame(obs_source_t *source, uint64_t sys_time);
@@ -1329,7 +1450,7 @@ static void async_tick(obs_source_t *source)
 {
 	uint64_t sys_time = obs->video.video_time;
 
-	pthread_mutex_lock(&source->async_mutex);
+	lock_async_mutex(source);
 
 	if (deinterlacing_enabled(source)) {
 		deinterlace_process_last_frame(source, sys_time);
@@ -1351,16 +1472,13 @@ static void async_tick(obs_source_t *source)
 	if (source->cur_async_frame)
 		source->async_update_texture = set_async_texture_size(source, source->cur_async_frame);
 
-	pthread_mutex_unlock(&source->async_mutex);
+	unlock_async_mutex(source);
 }
 
-void obs_source_video_tick(obs_source_t *source, float seconds)
+void obs_source_video_tick_begin(obs_source_t *source, float seconds)
 {
 	bool now_showing, now_active;
 
-	if (!obs_source_valid(source, "obs_source_video_tick"))
-		return;
-
 	if (source->info.type == OBS_SOURCE_TYPE_TRANSITION)
 		obs_transition_tick(source, seconds);
 
@@ -1422,12 +1540,25 @@ void obs_source_video_tick(obs_source_t *source, float seconds)
 
 		source->active = now_active;
 	}
+}
+
+void obs_source_video_tick_end(obs_source_t *source)
+{
+	source->async_rendered = false;
+	source->deinterlace_rendered = false;
+}
+
+void obs_source_video_tick(obs_source_t *source, float seconds)
+{
+	if (!obs_source_valid(source, "obs_source_video_tick"))
+		return;
+
+	obs_source_video_tick_begin(source, seconds);
 
 	if (source->context.data && source->info.video_tick)
 		source->info.video_tick(source->context.data, seconds);
 
-	source->async_rendered = false;
-	source->deinterlace_rendered = false;
+	obs_source_video_tick_end(source);
 }
 
 /* unless the value is 3+ hours worth of frames, this won't overflow */
@@ -3474,6 +3605,7 @@ static inline bool async_texture_changed(struct obs_source *source, const struct
 
 static inline void free_async_cache(struct obs_source *source)
 {
+	release_owned_async_frames(source);
 	for (size_t i = 0; i < source->async_cache.num; i++)
 		obs_source_frame_decref(source->async_cache.array[i].frame);
 
@@ -3501,18 +3633,15 @@ static void clean_cache(obs_source_t *source)
 }
 
 #define MAX_ASYNC_FRAMES 30
-//if return value is not null then do (os_atomic_dec_long(&output->refs) == 0) && obs_source_frame_destroy(output)
-static inline struct obs_source_frame *cache_video(struct obs_source *source, const struct obs_source_frame *frame)
-{
-	struct obs_source_frame *new_frame = NULL;
-
-	pthread_mutex_lock(&source->async_mutex);
 
+/* called with async_mutex locked before queueing a frame, returns false if
+ * too many frames are queued and the frame has to be dropped */
+static bool prepare_async_frame_queue(struct obs_source *source, const struct obs_source_frame *frame)
+{
 	if (source->async_frames.num >= MAX_ASYNC_FRAMES) {
 		free_async_cache(source);
 		source->last_frame_ts = 0;
-		pthread_mutex_unlock(&source->async_mutex);
-		return NULL;
+		return false;
 	}
 
 	if (async_texture_changed(source, frame)) {
@@ -3521,10 +3650,25 @@ static inline struct obs_source_frame *cache_video(struct obs_source *source, co
 		source->async_cache_height = frame->height;
 	}
 
-	const enum video_format format = frame->format;
-	source->async_cache_format = format;
+	source->async_cache_format = frame->format;
 	source->async_cache_full_range = frame->full_range;
 	source->async_cache_trc = frame->trc;
+	return true;
+}
+
+//if return value is not null then do (os_atomic_dec_long(&output->refs) == 0) && obs_source_frame_destroy(output)
+static inline struct obs_source_frame *cache_video(struct obs_source *source, const struct obs_source_frame *frame)
+{
+	struct obs_source_frame *new_frame = NULL;
+
+	lock_async_mutex(source);
+
+	if (!prepare_async_frame_queue(source, frame)) {
+		unlock_async_mutex(source);
+		return NULL;
+	}
+
+	const enum video_format format = frame->format;
 
 	for (size_t i = 0; i < source->async_cache.num; i++) {
 		struct async_frame *af = &source->async_cache.array[i];
@@ -3553,7 +3697,7 @@ static inline struct obs_source_frame *cache_video(struct obs_source *source, co
 
 	os_atomic_inc_long(&new_frame->refs);
 
-	pthread_mutex_unlock(&source->async_mutex);
+	unlock_async_mutex(source);
 
 	copy_frame_data(new_frame, frame);
 
@@ -3566,11 +3710,11 @@ static void obs_source_output_video_internal(obs_source_t *source, const struct
 		return;
 
 	if (!frame) {
-		pthread_mutex_lock(&source->async_mutex);
+		lock_async_mutex(source);
 		source->async_active = false;
 		source->last_frame_ts = 0;
 		free_async_cache(source);
-		pthread_mutex_unlock(&source->async_mutex);
+		unlock_async_mutex(source);
 		return;
 	}
 
@@ -3579,7 +3723,7 @@ static void obs_source_output_video_internal(obs_source_t *source, const struct
 	struct obs_source_frame *output = cache_video(source, frame);
 
 	/* ------------------------------------------- */
-	pthread_mutex_lock(&source->async_mutex);
+	lock_async_mutex(source);
 	if (output) {
 		if (os_atomic_dec_long(&output->refs) == 0) {
 			obs_source_frame_destroy(output);
@@ -3589,7 +3733,7 @@ static void obs_source_output_video_internal(obs_source_t *source, const struct
 			source->async_active = true;
 		}
 	}
-	pthread_mutex_unlock(&source->async_mutex);
+	unlock_async_mutex(source);
 }
 
 void obs_source_output_video(obs_source_t *source, const struct obs_source_frame *frame)
@@ -3607,6 +3751,48 @@ void obs_source_output_video(obs_source_t *source, const struct obs_source_frame
 	obs_source_output_video_internal(source, &new_frame);
 }
 
+void obs_source_output_video_owned(obs_source_t *source, const struct obs_source_frame *frame,
+				   void (*release)(void *param), void *param)
+{
+	struct owned_async_frame *owned;
+	struct obs_source_frame *new_frame;
+
+	if (!frame) {
+		obs_source_output_video(source, NULL);
+		return;
+	}
+	if (!obs_source_valid(source, "obs_source_output_video_owned") || destroying(source)) {
+		release(param);
+		return;
+	}
+
+	source_profiler_async_frame_received(source);
+
+	owned = bzalloc(sizeof(*owned));
+	owned->frame = *frame;
+	owned->release = release;
+	owned->param = param;
+
+	new_frame = &owned->frame;
+	new_frame->full_range = format_is_yuv(frame->format) ? frame->full_range : true;
+	new_frame->refs = 1;
+	new_frame->prev_frame = false;
+
+	lock_async_mutex(source);
+
+	/* the queue's reference is dropped by remove_async_frame once the
+	 * frame has been displayed or skipped */
+	if (prepare_async_frame_queue(source, new_frame)) {
+		da_push_back(source->owned_frames, &owned);
+		da_push_back(source->async_frames, &new_frame);
+		source->async_active = true;
+	} else {
+		da_push_back(source->released_owned_frames, &owned);
+	}
+
+	unlock_async_mutex(source);
+}
+
 void obs_source_output_video2(obs_source_t *source, const struct obs_source_frame2 *frame)
 {
 	if (destroying(source))
@@ -4072,6 +4258,11 @@ void remove_async_frame(obs_source_t *source, struct obs_source_frame *frame)
 	if (frame)
 		frame->prev_frame = false;
 
+	if (frame && find_owned_frame(source, frame)) {
+		owned_frame_decref(source, frame);
+		return;
+	}
+
 	for (size_t i = 0; i < source->async_cache.num; i++) {
 		struct async_frame *f = &source->async_cache.array[i];
 
@@ -4203,7 +4394,7 @@ struct obs_source_frame *obs_source_get_frame(obs_source_t *source)
 	if (!obs_source_valid(source, "obs_source_get_frame"))
 		return NULL;
 
-	pthread_mutex_lock(&source->async_mutex);
+	lock_async_mutex(source);
 
 	frame = source->cur_async_frame;
 	source->cur_async_frame = NULL;
@@ -4212,7 +4403,7 @@ struct obs_source_frame *obs_source_get_frame(obs_source_t *source)
 		os_atomic_inc_long(&frame->refs);
 	}
 
-	pthread_mutex_unlock(&source->async_mutex);
+	unlock_async_mutex(source);
 
 	return frame;
 }
@@ -4225,14 +4416,14 @@ void obs_source_release_frame(obs_source_t *source, struct obs_source_frame *fra
 	if (!source) {
 		obs_source_frame_destroy(frame);
 	} else {
-		pthread_mutex_lock(&source->async_mutex);
+		lock_async_mutex(source);
 
 		if (os_atomic_dec_long(&frame->refs) == 0)
-			obs_source_frame_destroy(frame);
+			free_async_frame(source, frame);
 		else
 			remove_async_frame(source, frame);
 
-		pthread_mutex_unlock(&source->async_mutex);
+		unlock_async_mutex(source);
 	}
 }
 
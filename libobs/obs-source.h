@@ -208,6 +208,20 @@ enum obs_media_state {
  */
 #define OBS_SOURCE_REQUIRES_CANVAS (1 << 17)
 
+/**
+ * Source type's video_tick is thread-safe and does not use the graphics
+ * subsystem, so it can be called on a worker thread concurrently with the
+ * video_tick of other sources.
+ */
+#define OBS_SOURCE_PARALLEL_TICK (1 << 18)
+
+/**
+ * Source type's create callback is thread-safe, so when loading sources it
+ * can be called on a worker thread concurrently with the create callbacks of
+ * other sources.
+ */
+#define OBS_SOURCE_PARALLEL_CREATE (1 << 19)
+
 /** @} */
 
 typedef void (*obs_source_enum_proc_t)(obs_source_t *parent, obs_source_t *child, void *param);
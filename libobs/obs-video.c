@@ -29,10 +29,90 @@
 #include <windows.h>
 #endif
 
+/* sources that have nothing to do in obs_source_video_tick until their
+ * show/active state changes or an update is deferred to the tick.  hidden
+ * sources are not ticked either, except for scenes, which release removed
+ * items in their tick */
+static bool source_needs_tick(const struct obs_source *source)
+{
+	if (source->info.type == OBS_SOURCE_TYPE_TRANSITION || source->info.type == OBS_SOURCE_TYPE_FILTER)
+		return true;
+	if ((source->info.output_flags & (OBS_SOURCE_ASYNC | OBS_SOURCE_CONTROLLABLE_MEDIA)) != 0)
+		return true;
+	if (os_atomic_load_long(&source->defer_update_count) > 0)
+		return true;
+
+	bool showing = !!os_atomic_load_long(&source->show_refs);
+	bool active = !!os_atomic_load_long(&source->activate_refs);
+	if (showing != source->showing || active != source->active)
+		return true;
+
+	if (!source->info.video_tick)
+		return false;
+
+	return showing || obs_source_is_scene(source) || obs_source_is_group(source);
+}
+
+static inline bool source_ticks_in_parallel(const struct obs_source *source)
+{
+	return (source->info.output_flags & OBS_SOURCE_PARALLEL_TICK) != 0 && source->info.video_tick;
+}
+
+static void rebuild_sources_to_tick(struct obs_core_data *data, long epoch)
+{
+	struct obs_source *source;
+	size_t parallel_ticks = 0;
+
+	for (size_t i = 0; i < data->sources_to_tick.num; i++)
+		obs_weak_source_release(data->sources_to_tick.array[i]);
+	da_clear(data->sources_to_tick);
+
+	pthread_mutex_lock(&data->sources_mutex);
+
+	source = data->sources;
+	while (source) {
+		if (!obs_source_removed(source) && source_needs_tick(source)) {
+			obs_weak_source_t *weak = obs_source_get_weak_source(source);
+			da_push_back(data->sources_to_tick, &weak);
+
+			if (source_ticks_in_parallel(source))
+				parallel_ticks++;
+		}
+		source = (struct obs_source *)source->context.hh_uuid.next;
+	}
+
+	pthread_mutex_unlock(&data->sources_mutex);
+
+	/* the pool's threads are only worth having once there is more than
+	 * one tick to spread over them */
+	if (parallel_ticks > 1 && !obs->video.tick_pool)
+		obs->video.tick_pool = os_task_pool_create("video tick", 0);
+
+	data->sources_to_tick_built_epoch = epoch;
+}
+
+struct parallel_tick_data {
+	struct obs_core_data *data;
+	float seconds;
+};
+
+static void parallel_tick_task(void *param, size_t idx)
+{
+	struct parallel_tick_data *tick_data = param;
+	struct parallel_tick *tick = tick_data->data->parallel_ticks.array + idx;
+	obs_source_t *source = tick->source;
+
+	const uint64_t start = source_profiler_source_tick_start();
+	source->info.video_tick(source->context.data, tick_data->seconds);
+	if (start)
+		tick->tick_ns += os_gettime_ns() - start;
+}
+
+static const char *parallel_tick_name = "parallel_tick";
+
 static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
 {
 	struct obs_core_data *data = &obs->data;
-	struct obs_source *source;
 	uint64_t delta_time;
 	float seconds;
 
@@ -56,35 +136,60 @@ static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
 	pthread_mutex_unlock(&data->draw_callbacks_mutex);
 
 	/* ------------------------------------- */
-	/* get an array of all sources to tick   */
-
-	da_clear(data->sources_to_tick);
-
-	pthread_mutex_lock(&data->sources_mutex);
-
-	source = data->sources;
-	while (source) {
-		obs_source_t *s = obs_source_removed(source) ? NULL : obs_source_get_ref(source);
-		if (s)
-			da_push_back(data->sources_to_tick, &s);
-		source = (struct obs_source *)source->context.hh_uuid.next;
-	}
+	/* rebuild the sources to tick if needed */
 
-	pthread_mutex_unlock(&data->sources_mutex);
+	long epoch = os_atomic_load_long(&data->sources_to_tick_epoch);
+	if (epoch != data->sources_to_tick_built_epoch)
+		rebuild_sources_to_tick(data, epoch);
 
 	/* ------------------------------------- */
 	/* call the tick function of each source */
 
+	da_clear(data->parallel_ticks);
+
 	for (size_t i = 0; i < data->sources_to_tick.num; i++) {
-		obs_source_t *s = data->sources_to_tick.array[i];
+		obs_source_t *s = obs_weak_source_get_source(data->sources_to_tick.array[i]);
+		if (!s)
+			continue;
+
 		if (!obs_source_removed(s)) {
 			const uint64_t start = source_profiler_source_tick_start();
+
+			/* video_tick of these is deferred to the tick pool, the
+			 * rest of the tick stays on the graphics thread */
+			if (obs->video.tick_pool && source_ticks_in_parallel(s) && s->context.data) {
+				struct parallel_tick *tick = da_push_back_new(data->parallel_ticks);
+				obs_source_video_tick_begin(s, seconds);
+				tick->source = s;
+				tick->tick_ns = start ? os_gettime_ns() - start : 0;
+				continue;
+			}
+
 			obs_source_video_tick(s, seconds);
 			source_profiler_source_tick_end(s, start);
 		}
 		obs_source_release(s);
 	}
 
+	/* ------------------------------------- */
+	/* tick parallel sources on the pool     */
+
+	if (data->parallel_ticks.num) {
+		struct parallel_tick_data tick_data = {data, seconds};
+
+		profile_start(parallel_tick_name);
+		os_task_pool_run(obs->video.tick_pool, data->parallel_ticks.num, parallel_tick_task, &tick_data);
+		profile_end(parallel_tick_name);
+
+		for (size_t i = 0; i < data->parallel_ticks.num; i++) {
+			struct parallel_tick *tick = data->parallel_ticks.array + i;
+
+			obs_source_video_tick_end(tick->source);
+			source_profiler_source_tick_time(tick->source, tick->tick_ns);
+			obs_source_release(tick->source);
+		}
+	}
+
 	return cur_time;
 }
 
@@ -133,6 +238,145 @@ static inline void unmap_last_surface(struct obs_core_video_mix *video)
 	}
 }
 
+/* ------------------------------------------------------------------------- */
+/* stage surfaces referenced by video-io frames (zero copy raw output).  they
+ * stay mapped until video-io releases the frame, and a surface that is still
+ * referenced when it's time to stage into it again is swapped for a spare,
+ * so the graphics thread never waits on raw video inputs. */
+
+static bool stage_surface_in_slot(const struct obs_core_video_mix *video, const gs_stagesurf_t *surface)
+{
+	for (size_t i = 0; i < NUM_TEXTURES; i++) {
+		for (size_t c = 0; c < NUM_CHANNELS; c++) {
+			if (video->copy_surfaces[i][c] == surface)
+				return true;
+		}
+#ifdef _WIN32
+		if (video->copy_surfaces_encode[i] == surface)
+			return true;
+#endif
+	}
+
+	return false;
+}
+
+static bool stage_surface_referenced(const struct obs_core_video_mix *video, const gs_stagesurf_t *surface)
+{
+	for (size_t i = 0; i < video->stage_refs.num; i++) {
+		const struct obs_stage_ref *ref = video->stage_refs.array[i];
+
+		for (size_t c = 0; c < NUM_CHANNELS; c++) {
+			if (ref->surfaces[c] == surface)
+				return true;
+		}
+	}
+
+	return false;
+}
+
+static void free_stage_ref(struct obs_core_video_mix *video, struct obs_stage_ref *ref)
+{
+	for (size_t c = 0; c < NUM_CHANNELS; c++) {
+		gs_stagesurf_t *surface = ref->surfaces[c];
+		if (!surface)
+			continue;
+
+		gs_stagesurface_unmap(surface);
+
+		/* swapped out while it was referenced */
+		if (!stage_surface_in_slot(video, surface))
+			da_push_back(video->spare_stage_surfaces, &surface);
+	}
+
+	bfree(ref);
+}
+
+static void reclaim_stage_refs(struct obs_core_video_mix *video)
+{
+	for (size_t i = 0; i < video->stage_refs.num; i++) {
+		struct obs_stage_ref *ref = video->stage_refs.array[i];
+		if (!os_atomic_load_bool(&ref->released))
+			continue;
+
+		da_erase(video->stage_refs, i--);
+		free_stage_ref(video, ref);
+	}
+}
+
+/* called after the video output has been closed, so every frame has been
+ * released */
+void obs_free_stage_refs(struct obs_core_video_mix *video)
+{
+	for (size_t i = 0; i < video->stage_refs.num; i++)
+		free_stage_ref(video, video->stage_refs.array[i]);
+	da_free(video->stage_refs);
+
+	for (size_t i = 0; i < video->spare_stage_surfaces.num; i++)
+		gs_stagesurface_destroy(video->spare_stage_surfaces.array[i]);
+	da_free(video->spare_stage_surfaces);
+}
+
+static gs_stagesurf_t *create_spare_stage_surface(const struct obs_core_video_mix *video, const gs_stagesurf_t *like)
+{
+	const uint32_t width = gs_stagesurface_get_width(like);
+	const uint32_t height = gs_stagesurface_get_height(like);
+	const enum gs_color_format format = gs_stagesurface_get_color_format(like);
+
+#ifdef _WIN32
+	if (format == GS_UNKNOWN) {
+		if (video->using_nv12_tex)
+			return gs_stagesurface_create_nv12(width, height);
+		if (video->using_p010_tex)
+			return gs_stagesurface_create_p010(width, height);
+		return NULL;
+	}
+#else
+	UNUSED_PARAMETER(video);
+#endif
+
+	return gs_stagesurface_create(width, height, format);
+}
+
+/* returns the surface to stage into for a slot of copy_surfaces */
+static gs_stagesurf_t *get_stage_surface(struct obs_core_video_mix *video, gs_stagesurf_t **slot)
+{
+	gs_stagesurf_t *surface = *slot;
+	gs_stagesurf_t *spare = NULL;
+
+	if (!surface || !stage_surface_referenced(video, surface))
+		return surface;
+
+	for (size_t i = 0; i < video->spare_stage_surfaces.num; i++) {
+		gs_stagesurf_t *cur = video->spare_stage_surfaces.array[i];
+
+		if (gs_stagesurface_get_width(cur) == gs_stagesurface_get_width(surface) &&
+		    gs_stagesurface_get_height(cur) == gs_stagesurface_get_height(surface) &&
+		    gs_stagesurface_get_color_format(cur) == gs_stagesurface_get_color_format(surface)) {
+			spare = cur;
+			da_erase(video->spare_stage_surfaces, i);
+			break;
+		}
+	}
+
+	if (!spare) {
+		spare = create_spare_stage_surface(video, surface);
+		if (!spare)
+			return NULL;
+
+		blog(LOG_DEBUG, "Added a stage surface, raw video inputs still reference %zu frames",
+		     video->stage_refs.num);
+	}
+
+	*slot = spare;
+	return spare;
+}
+
+static void release_stage_ref(void *param)
+{
+	struct obs_stage_ref *ref = param;
+	os_atomic_set_bool(&ref->released, true);
+}
+
 static inline bool can_reuse_mix_texture(const struct obs_core_video_mix *mix, size_t *idx)
 {
 	for (size_t i = 0, num = obs->video.mixes.num; i < num; i++) {
@@ -406,14 +650,17 @@ static void render_convert_texture(struct obs_core_video_mix *video, gs_texture_
 static const char *stage_output_texture_name = "stage_output_texture";
 static inline void stage_output_texture(struct obs_core_video_mix *video, int cur_texture,
 					gs_texture_t *const *const convert_textures, gs_texture_t *output_texture,
-					gs_stagesurf_t *const *const copy_surfaces, size_t channel_count)
+					gs_stagesurf_t **copy_surfaces, size_t channel_count)
 {
 	profile_start(stage_output_texture_name);
 
 	unmap_last_surface(video);
 
+	if (video->stage_refs.num)
+		reclaim_stage_refs(video);
+
 	if (!video->gpu_conversion) {
-		gs_stagesurf_t *copy = copy_surfaces[0];
+		gs_stagesurf_t *copy = get_stage_surface(video, &copy_surfaces[0]);
 		if (copy)
 			gs_stage_texture(copy, output_texture);
 		video->active_copy_surfaces[cur_texture][0] = copy;
@@ -424,7 +671,7 @@ static inline void stage_output_texture(struct obs_core_video_mix *video, int cu
 		video->textures_copied[cur_texture] = true;
 	} else if (video->texture_converted) {
 		for (size_t i = 0; i < channel_count; i++) {
-			gs_stagesurf_t *copy = copy_surfaces[i];
+			gs_stagesurf_t *copy = get_stage_surface(video, &copy_surfaces[i]);
 			if (copy)
 				gs_stage_texture(copy, convert_textures[i]);
 			video->active_copy_surfaces[cur_texture][i] = copy;
@@ -548,7 +795,7 @@ static inline void render_video(struct obs_core_video_mix *video, bool raw_activ
 
 	if (raw_active || gpu_active) {
 		gs_texture_t *const *convert_textures = video->convert_textures;
-		gs_stagesurf_t *const *copy_surfaces = video->copy_surfaces[cur_texture];
+		gs_stagesurf_t **copy_surfaces = video->copy_surfaces[cur_texture];
 		size_t channel_count = NUM_CHANNELS;
 		gs_texture_t *output_texture = render_output_texture(video);
 
@@ -776,12 +1023,81 @@ static inline void copy_rgbx_frame(struct video_frame *output, const struct vide
 	}
 }
 
+/* gets the planes of a downloaded frame in the layout of the output format,
+ * or returns false if they have to be copied */
+static bool get_referenced_planes(const struct obs_core_video_mix *video, const struct video_data *input,
+				  const struct video_output_info *info, struct video_frame *planes)
+{
+	memset(planes, 0, sizeof(*planes));
+
+	if (!video->gpu_conversion) {
+		planes->data[0] = input->data[0];
+		planes->linesize[0] = input->linesize[0];
+		return true;
+	}
+
+	switch (info->format) {
+	case VIDEO_FORMAT_NV12:
+	case VIDEO_FORMAT_P010:
+		/* single surface, the UV plane follows the Y plane */
+		if (!input->linesize[1]) {
+			planes->data[0] = input->data[0];
+			planes->data[1] = input->data[0] + (size_t)input->linesize[0] * info->height;
+			planes->linesize[0] = input->linesize[0];
+			planes->linesize[1] = input->linesize[0];
+			return true;
+		}
+		/* fall through */
+	case VIDEO_FORMAT_I420:
+	case VIDEO_FORMAT_I444:
+	case VIDEO_FORMAT_I010:
+	case VIDEO_FORMAT_P216:
+	case VIDEO_FORMAT_P416:
+		for (size_t i = 0; i < NUM_CHANNELS; i++) {
+			planes->data[i] = input->data[i];
+			planes->linesize[i] = input->linesize[i];
+		}
+		return true;
+	default:
+		return false;
+	}
+}
+
+static inline bool output_referenced_video_data(struct obs_core_video_mix *video, struct video_data *input_frame,
+						int count)
+{
+	const struct video_output_info *info = video_output_get_info(video->video);
+	struct video_frame planes;
+
+	if (!get_referenced_planes(video, input_frame, info, &planes))
+		return false;
+
+	struct obs_stage_ref *ref = bzalloc(sizeof(*ref));
+	memcpy(ref->surfaces, video->mapped_surfaces, sizeof(ref->surfaces));
+
+	if (!video_output_reference_frame(video->video, &planes, count, input_frame->timestamp, release_stage_ref,
+					  ref)) {
+		/* skipped, unmapped as usual */
+		bfree(ref);
+		return true;
+	}
+
+	/* unmapped once video-io releases the frame instead of at the next
+	 * stage */
+	memset(video->mapped_surfaces, 0, sizeof(video->mapped_surfaces));
+	da_push_back(video->stage_refs, &ref);
+	return true;
+}
+
 static inline void output_video_data(struct obs_core_video_mix *video, struct video_data *input_frame, int count)
 {
 	const struct video_output_info *info;
 	struct video_frame output_frame;
 	bool locked;
 
+	if (video_output_get_zero_copy(video->video) && output_referenced_video_data(video, input_frame, count))
+		return;
+
 	info = video_output_get_info(video->video);
 
 	locked = video_output_lock_frame(video->video, &output_frame, count, input_frame->timestamp);
@@ -1139,6 +1455,10 @@ bool obs_graphics_thread_loop(struct obs_graphics_context *context)
 	source_profiler_frame_collect();
 	profile_end(context->video_thread_name);
 
+	/* keep the frames leading up to the overrun if a trace is recording */
+	if (frame_time_ns > context->interval)
+		profiler_trace_deadline_missed();
+
 	profile_reenable_thread();
 
 	video_sleep(&obs->video, &obs->video.video_time, context->interval);
@@ -756,6 +756,8 @@ static void obs_free_render_textures(struct obs_core_video_mix *video)
 		}
 	}
 
+	obs_free_stage_refs(video);
+
 	for (size_t i = 0; i < NUM_TEXTURES; i++) {
 		for (size_t c = 0; c < NUM_CHANNELS; c++) {
 			if (video->copy_surfaces[i][c]) {
@@ -848,6 +850,9 @@ static void obs_free_video(void)
 	pthread_mutex_destroy(&obs->video.task_mutex);
 	pthread_mutex_init_value(&obs->video.task_mutex);
 	deque_free(&obs->video.tasks);
+
+	os_task_pool_destroy(obs->video.tick_pool);
+	obs->video.tick_pool = NULL;
 }
 
 static void obs_free_graphics(void)
@@ -947,9 +952,13 @@ static void obs_free_audio(void)
 	if (audio->audio)
 		audio_output_close(audio->audio);
 
+	os_task_pool_destroy(audio->render_pool);
+
 	deque_free(&audio->buffered_timestamps);
 	da_free(audio->render_order);
 	da_free(audio->root_nodes);
+	da_free(audio->parallel_render_order);
+	da_free(audio->serial_render_order);
 
 	da_free(audio->monitors);
 	bfree(audio->monitoring_device_name);
@@ -1079,7 +1088,11 @@ static void obs_free_data(void)
 	for (size_t i = 0; i < data->protocols.num; i++)
 		bfree(data->protocols.array[i]);
 	da_free(data->protocols);
+
+	for (size_t i = 0; i < data->sources_to_tick.num; i++)
+		obs_weak_source_release(data->sources_to_tick.array[i]);
 	da_free(data->sources_to_tick);
+	da_free(data->parallel_ticks);
 }
 
 static const char *obs_signals[] = {
@@ -1381,6 +1394,20 @@ struct obs_cmdline_args obs_get_cmdline_args(void)
 	return cmdline_args;
 }
 
+static void obs_log_packet_stats(void)
+{
+	struct obs_encoder_packet_stats stats;
+
+	obs_encoder_packet_get_stats(&stats);
+	if (!stats.allocs && !stats.reuses)
+		return;
+
+	blog(LOG_INFO,
+	     "Encoder packet buffers: %" PRIu64 " allocated, %" PRIu64 " reused, "
+	     "%" PRIu64 " bytes copied",
+	     stats.allocs, stats.reuses, stats.bytes_copied);
+}
+
 void obs_shutdown(void)
 {
 	struct obs_module *module;
@@ -1440,6 +1467,8 @@ void obs_shutdown(void)
 	obs_free_audio();
 	obs_free_video();
 	os_task_queue_destroy(obs->destruction_task_thread);
+	obs_log_packet_stats();
+	obs_encoder_packet_pool_free();
 	obs_free_hotkeys();
 	obs_free_graphics();
 	proc_handler_destroy(obs->procs);
@@ -2258,9 +2287,8 @@ gs_texture_t *obs_get_main_texture(void)
 	return video->render_texture;
 }
 
-static obs_source_t *obs_load_source_type(obs_data_t *source_data, bool is_private)
+static obs_source_t *obs_load_source_begin(obs_data_t *source_data, bool is_private)
 {
-	obs_data_array_t *filters = obs_data_get_array(source_data, "filters");
 	obs_source_t *source;
 	const char *name = obs_data_get_string(source_data, "name");
 	const char *uuid = obs_data_get_string(source_data, "uuid");
@@ -2268,23 +2296,25 @@ static obs_source_t *obs_load_source_type(obs_data_t *source_data, bool is_priva
 	const char *v_id = obs_data_get_string(source_data, "versioned_id");
 	obs_data_t *settings = obs_data_get_obj(source_data, "settings");
 	obs_data_t *hotkeys = obs_data_get_obj(source_data, "hotkeys");
-	obs_canvas_t *canvas = NULL;
-	double volume;
-	double balance;
-	int64_t sync;
 	uint32_t prev_ver;
-	uint32_t caps;
-	uint32_t flags;
-	uint32_t mixers;
-	int di_order;
-	int di_mode;
-	int monitoring_type;
 
 	prev_ver = (uint32_t)obs_data_get_int(source_data, "prev_ver");
 
 	if (!*v_id)
 		v_id = id;
 
+	source = obs_source_create_begin(v_id, name, uuid, settings, hotkeys, is_private, prev_ver);
+
+	obs_data_release(hotkeys);
+	obs_data_release(settings);
+	return source;
+}
+
+static obs_canvas_t *obs_load_source_canvas(obs_data_t *source_data)
+{
+	const char *id = obs_data_get_string(source_data, "id");
+	obs_canvas_t *canvas = NULL;
+
 	if (obs_source_type_is_scene(id) || obs_source_type_is_group(id)) {
 		const char *canvas_uuid = obs_data_get_string(source_data, "canvas_uuid");
 		canvas = obs_get_canvas_by_uuid(canvas_uuid);
@@ -2294,16 +2324,35 @@ static obs_source_t *obs_load_source_type(obs_data_t *source_data, bool is_priva
 		}
 	}
 
-	source = obs_source_create_set_last_ver(canvas, v_id, name, uuid, settings, hotkeys, prev_ver, is_private);
+	return canvas;
+}
+
+static obs_source_t *obs_load_source_type(obs_data_t *source_data, bool is_private);
+
+/* applies the saved state that isn't part of the source's settings, and
+ * loads its filters */
+static void obs_load_source_end(obs_source_t *source, obs_data_t *source_data)
+{
+	obs_data_array_t *filters = obs_data_get_array(source_data, "filters");
+	const char *id = obs_data_get_string(source_data, "id");
+	double volume;
+	double balance;
+	int64_t sync;
+	uint32_t prev_ver;
+	uint32_t caps;
+	uint32_t flags;
+	uint32_t mixers;
+	int di_order;
+	int di_mode;
+	int monitoring_type;
+
+	prev_ver = (uint32_t)obs_data_get_int(source_data, "prev_ver");
 
 	if (source->owns_info_id) {
 		bfree((void *)source->info.unversioned_id);
 		source->info.unversioned_id = bstrdup(id);
 	}
 
-	obs_canvas_release(canvas);
-	obs_data_release(hotkeys);
-
 	caps = obs_source_get_output_flags(source);
 
 	obs_data_set_default_double(source_data, "volume", 1.0);
@@ -2383,9 +2432,21 @@ static obs_source_t *obs_load_source_type(obs_data_t *source_data, bool is_priva
 
 		obs_data_array_release(filters);
 	}
+}
 
-	obs_data_release(settings);
+static obs_source_t *obs_load_source_type(obs_data_t *source_data, bool is_private)
+{
+	obs_source_t *source = obs_load_source_begin(source_data, is_private);
+	if (!source)
+		return NULL;
+
+	obs_canvas_t *canvas = obs_load_source_canvas(source_data);
+
+	obs_source_create_data(source);
+	obs_source_create_finish(source, canvas);
+	obs_canvas_release(canvas);
 
+	obs_load_source_end(source, source_data);
 	return source;
 }
 
@@ -2399,44 +2460,173 @@ obs_source_t *obs_load_private_source(obs_data_t *source_data)
 	return obs_load_source_type(source_data, true);
 }
 
+struct source_load_entry {
+	obs_source_t *source;
+	obs_data_t *source_data;
+	uint64_t load_time;
+	bool parallel;
+};
+
+struct source_load_type_time {
+	const char *id;
+	size_t count;
+	uint64_t load_time;
+};
+
+static inline bool source_can_create_in_parallel(const obs_source_t *source)
+{
+	return !source->owns_info_id && (source->info.output_flags & OBS_SOURCE_PARALLEL_CREATE) != 0;
+}
+
+static void source_load_create_task(void *param, size_t idx)
+{
+	struct source_load_entry **entries = param;
+	struct source_load_entry *entry = entries[idx];
+	uint64_t start = os_gettime_ns();
+
+	obs_source_create_data(entry->source);
+
+	entry->load_time += os_gettime_ns() - start;
+}
+
+static int source_load_type_time_cmp(const void *a, const void *b)
+{
+	const struct source_load_type_time *type_a = a;
+	const struct source_load_type_time *type_b = b;
+
+	if (type_a->load_time == type_b->load_time)
+		return 0;
+	return type_a->load_time < type_b->load_time ? 1 : -1;
+}
+
+static void log_source_load_times(struct source_load_entry *entries, size_t count, size_t num_parallel,
+				  uint64_t total_time)
+{
+	DARRAY(struct source_load_type_time) types;
+
+	da_init(types);
+
+	for (size_t i = 0; i < count; i++) {
+		struct source_load_entry *entry = &entries[i];
+		struct source_load_type_time *type = NULL;
+
+		if (!entry->source)
+			continue;
+
+		for (size_t j = 0; j < types.num; j++) {
+			if (strcmp(types.array[j].id, entry->source->info.id) == 0) {
+				type = &types.array[j];
+				break;
+			}
+		}
+
+		if (!type) {
+			type = da_push_back_new(types);
+			type->id = entry->source->info.id;
+		}
+
+		type->count++;
+		type->load_time += entry->load_time;
+	}
+
+	qsort(types.array, types.num, sizeof(*types.array), source_load_type_time_cmp);
+
+	blog(LOG_INFO, "Loaded %zu sources in %.1f ms (%zu created in parallel)", count,
+	     (double)total_time / 1000000.0, num_parallel);
+	for (size_t i = 0; i < types.num; i++)
+		blog(LOG_INFO, "\t%s: %zu, %.1f ms", types.array[i].id, types.array[i].count,
+		     (double)types.array[i].load_time / 1000000.0);
+
+	da_free(types);
+}
+
+/* Sources are loaded in phases.  Every source is allocated up front in array
+ * order, then the create callbacks of source types flagged with
+ * OBS_SOURCE_PARALLEL_CREATE run on a worker pool, and finally each source is
+ * created (if it wasn't already), registered and signaled in array order.
+ * Name and UUID registration and signal order are therefore the same as when
+ * everything is loaded serially. */
 void obs_load_sources(obs_data_array_t *array, obs_load_source_cb cb, void *private_data)
 {
-	DARRAY(obs_source_t *) sources;
+	DARRAY(struct source_load_entry) entries;
+	DARRAY(struct source_load_entry *) parallel;
+	uint64_t load_start = os_gettime_ns();
 	size_t count;
 	size_t i;
 
-	da_init(sources);
+	da_init(entries);
+	da_init(parallel);
 
 	count = obs_data_array_count(array);
-	da_reserve(sources, count);
+	da_resize(entries, count);
 
 	for (i = 0; i < count; i++) {
-		obs_data_t *source_data = obs_data_array_item(array, i);
-		obs_source_t *source = obs_load_source(source_data);
+		struct source_load_entry *entry = &entries.array[i];
+		uint64_t start = os_gettime_ns();
+
+		entry->source_data = obs_data_array_item(array, i);
+		entry->source = obs_load_source_begin(entry->source_data, false);
+		entry->parallel = entry->source && source_can_create_in_parallel(entry->source);
+		entry->load_time = os_gettime_ns() - start;
+
+		if (entry->parallel)
+			da_push_back(parallel, &entry);
+	}
+
+	if (parallel.num) {
+		os_task_pool_t *pool = NULL;
 
-		da_push_back(sources, &source);
+		if (parallel.num > 1)
+			pool = os_task_pool_create("source load", 0);
 
-		obs_data_release(source_data);
+		os_task_pool_run(pool, parallel.num, source_load_create_task, parallel.array);
+		os_task_pool_destroy(pool);
+	}
+
+	for (i = 0; i < count; i++) {
+		struct source_load_entry *entry = &entries.array[i];
+		uint64_t start = os_gettime_ns();
+
+		if (entry->source) {
+			obs_canvas_t *canvas = obs_load_source_canvas(entry->source_data);
+
+			if (!entry->parallel)
+				obs_source_create_data(entry->source);
+			obs_source_create_finish(entry->source, canvas);
+			obs_canvas_release(canvas);
+
+			obs_load_source_end(entry->source, entry->source_data);
+		}
+
+		entry->load_time += os_gettime_ns() - start;
 	}
 
 	/* tell sources that we want to load */
-	for (i = 0; i < sources.num; i++) {
-		obs_source_t *source = sources.array[i];
-		obs_data_t *source_data = obs_data_array_item(array, i);
+	for (i = 0; i < count; i++) {
+		struct source_load_entry *entry = &entries.array[i];
+		obs_source_t *source = entry->source;
+		uint64_t start = os_gettime_ns();
+
 		if (source) {
 			if (source->info.type == OBS_SOURCE_TYPE_TRANSITION)
-				obs_transition_load(source, source_data);
+				obs_transition_load(source, entry->source_data);
 			obs_source_load2(source);
 			if (cb)
 				cb(private_data, source);
 		}
-		obs_data_release(source_data);
+
+		entry->load_time += os_gettime_ns() - start;
 	}
 
-	for (i = 0; i < sources.num; i++)
-		obs_source_release(sources.array[i]);
+	log_source_load_times(entries.array, count, parallel.num, os_gettime_ns() - load_start);
+
+	for (i = 0; i < count; i++) {
+		obs_source_release(entries.array[i].source);
+		obs_data_release(entries.array[i].source_data);
+	}
 
-	da_free(sources);
+	da_free(parallel);
+	da_free(entries);
 }
 
 obs_data_t *obs_save_source(obs_source_t *source)
@@ -2881,7 +3071,7 @@ void obs_context_data_setname_ht(struct obs_context_data *context, const char *n
 
 profiler_name_store_t *obs_get_profiler_name_store(void)
 {
-	return obs->name_store;
+	return obs ? obs->name_store : NULL;
 }
 
 uint64_t obs_get_video_frame_time(void)
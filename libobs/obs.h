@@ -1419,6 +1419,18 @@ EXPORT void obs_source_draw(gs_texture_t *image, int x, int y, uint32_t cx, uint
 EXPORT void obs_source_output_video(obs_source_t *source, const struct obs_source_frame *frame);
 EXPORT void obs_source_output_video2(obs_source_t *source, const struct obs_source_frame2 *frame);
 
+/**
+ * Outputs asynchronous video data without copying it.  libobs references the
+ * planes of the frame directly, and calls release(param) once it no longer
+ * needs them, which is usually right after the frame has been uploaded.
+ *
+ * release can be called from any thread, and may be called before this
+ * function returns if the frame is dropped.  It is never called with the
+ * source's frame queue locked, so it may output another frame.
+ */
+EXPORT void obs_source_output_video_owned(obs_source_t *source, const struct obs_source_frame *frame,
+					  void (*release)(void *param), void *param);
+
 EXPORT void obs_source_set_async_rotation(obs_source_t *source, long rotation);
 
 EXPORT void obs_source_output_cea708(obs_source_t *source, const struct obs_source_cea_708 *captions);
@@ -2075,6 +2087,30 @@ EXPORT uint64_t obs_output_get_total_bytes(const obs_output_t *output);
 EXPORT int obs_output_get_frames_dropped(const obs_output_t *output);
 EXPORT int obs_output_get_total_frames(const obs_output_t *output);
 
+enum obs_output_queue_policy {
+	/** Let the packet queue grow up to 512 MiB of packet data */
+	OBS_OUTPUT_QUEUE_GROW,
+	/** Drop queued packets and wait for the next keyframe when full */
+	OBS_OUTPUT_QUEUE_DROP,
+};
+
+/**
+ * Sets what happens when the output falls behind its encoders.  Encoded
+ * packets are queued and passed to the output on its own thread, so a slow
+ * output never holds up the encoders.  With OBS_OUTPUT_QUEUE_DROP the queue
+ * is flushed once it holds more than max_packets packets, with either policy
+ * once it holds more than 512 MiB of packet data.  Flushed video packets are
+ * counted in obs_output_get_frames_dropped.
+ *
+ * Service outputs default to OBS_OUTPUT_QUEUE_DROP, all others to
+ * OBS_OUTPUT_QUEUE_GROW.
+ */
+EXPORT void obs_output_set_packet_queue_policy(obs_output_t *output, enum obs_output_queue_policy policy,
+					       size_t max_packets);
+
+/** Gets the number of encoded packets waiting to be passed to the output */
+EXPORT size_t obs_output_get_packet_queue_depth(const obs_output_t *output);
+
 /**
  * Sets the preferred scaled resolution for this output.  Set width and height
  * to 0 to disable scaling.
@@ -2453,6 +2489,10 @@ EXPORT uint32_t obs_encoder_get_caps(const obs_encoder_t *encoder);
 EXPORT void obs_encoder_packet_ref(struct encoder_packet *dst, struct encoder_packet *src);
 EXPORT void obs_encoder_packet_release(struct encoder_packet *packet);
 
+/** Allocates a refcounted packet buffer of the given size */
+EXPORT void obs_encoder_packet_alloc(struct encoder_packet *packet, size_t size);
+EXPORT void obs_encoder_packet_get_stats(struct obs_encoder_packet_stats *stats);
+
 EXPORT void *obs_encoder_create_rerouted(obs_encoder_t *encoder, const char *reroute_id);
 
 /** Returns whether encoder is paused */
@@ -33,7 +33,8 @@ struct os_process_pipe {
 	FILE *err_file;
 };
 
-os_process_pipe_t *os_process_pipe_create_internal(const char *bin, char **argv, const char *type)
+os_process_pipe_t *os_process_pipe_create_internal(const char *bin, char **argv, const char *type,
+						   const int *inherit_fds, size_t num_inherit_fds)
 {
 	struct os_process_pipe process_pipe = {0};
 	struct os_process_pipe *out;
@@ -89,6 +90,11 @@ os_process_pipe_t *os_process_pipe_create_internal(const char *bin, char **argv,
 	posix_spawn_file_actions_addclose(&file_actions, errfds[0]);
 	posix_spawn_file_actions_adddup2(&file_actions, errfds[1], STDERR_FILENO);
 
+	/* duplicating an fd onto itself only clears its close-on-exec flag,
+	 * and only in the child */
+	for (size_t i = 0; i < num_inherit_fds; i++)
+		posix_spawn_file_actions_adddup2(&file_actions, inherit_fds[i], inherit_fds[i]);
+
 	int pid;
 	int ret = posix_spawn(&pid, bin, &file_actions, NULL, (char *const *)argv, environ);
 
@@ -127,13 +133,16 @@ os_process_pipe_t *os_process_pipe_create(const char *cmd_line, const char *type
 		return NULL;
 
 	char *argv[4] = {"sh", "-c", (char *)cmd_line, NULL};
-	return os_process_pipe_create_internal("/bin/sh", argv, type);
+	return os_process_pipe_create_internal("/bin/sh", argv, type, NULL, 0);
 }
 
 os_process_pipe_t *os_process_pipe_create2(const os_process_args_t *args, const char *type)
 {
 	char **argv = os_process_args_get_argv(args);
-	return os_process_pipe_create_internal(argv[0], argv, type);
+	size_t num_fds;
+	const int *fds = os_process_args_get_inherit_fds(args, &num_fds);
+
+	return os_process_pipe_create_internal(argv[0], argv, type, fds, num_fds);
 }
 
 int os_process_pipe_destroy(os_process_pipe_t *pp)
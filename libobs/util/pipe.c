@@ -20,6 +20,7 @@
 
 struct os_process_args {
 	DARRAY(char *) arguments;
+	DARRAY(int) inherit_fds;
 };
 
 struct os_process_args *os_process_args_create(const char *executable)
@@ -62,6 +63,17 @@ char **os_process_args_get_argv(const struct os_process_args *args)
 	return args->arguments.array;
 }
 
+void os_process_args_inherit_fd(struct os_process_args *args, int fd)
+{
+	da_push_back(args->inherit_fds, &fd);
+}
+
+const int *os_process_args_get_inherit_fds(const struct os_process_args *args, size_t *num)
+{
+	*num = args->inherit_fds.num;
+	return args->inherit_fds.array;
+}
+
 void os_process_args_destroy(struct os_process_args *args)
 {
 	if (!args)
@@ -71,5 +83,6 @@ void os_process_args_destroy(struct os_process_args *args)
 		bfree(args->arguments.array[idx]);
 
 	da_free(args->arguments);
+	da_free(args->inherit_fds);
 	bfree(args);
 }
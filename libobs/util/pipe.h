@@ -47,6 +47,12 @@ EXPORT char **os_process_args_get_argv(const struct os_process_args *args);
 EXPORT size_t os_process_args_get_argc(struct os_process_args *args);
 EXPORT void os_process_args_destroy(struct os_process_args *args);
 
+/* Passes fd on to the process under the same number, even though it is
+ * close-on-exec in this process, so that it isn't inherited by any other
+ * process started in the meantime.  Only supported on POSIX systems. */
+EXPORT void os_process_args_inherit_fd(struct os_process_args *args, int fd);
+EXPORT const int *os_process_args_get_inherit_fds(const struct os_process_args *args, size_t *num);
+
 #ifdef __cplusplus
 }
 #endif
@@ -43,10 +43,11 @@ uint64_t os_gettime_ns(void)
     return clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
 }
 
-/* gets the location [domain mask]/Library/Application Support/[name] */
-static int os_get_path_internal(char *dst, size_t size, const char *name, NSSearchPathDomainMask domainMask)
+/* gets the location [domain mask]/Library/[directory]/[name] */
+static int os_get_path_internal(char *dst, size_t size, const char *name, NSSearchPathDirectory directory,
+                                NSSearchPathDomainMask domainMask)
 {
-    NSArray *paths = NSSearchPathForDirectoriesInDomains(NSApplicationSupportDirectory, domainMask, YES);
+    NSArray *paths = NSSearchPathForDirectoriesInDomains(directory, domainMask, YES);
 
     if ([paths count] == 0)
         bcrash("Could not get home directory (platform-cocoa)");
@@ -60,9 +61,10 @@ static int os_get_path_internal(char *dst, size_t size, const char *name, NSSear
         return snprintf(dst, size, "%s/%s", base_path, name);
 }
 
-static char *os_get_path_ptr_internal(const char *name, NSSearchPathDomainMask domainMask)
+static char *os_get_path_ptr_internal(const char *name, NSSearchPathDirectory directory,
+                                      NSSearchPathDomainMask domainMask)
 {
-    NSArray *paths = NSSearchPathForDirectoriesInDomains(NSApplicationSupportDirectory, domainMask, YES);
+    NSArray *paths = NSSearchPathForDirectoriesInDomains(directory, domainMask, YES);
 
     if ([paths count] == 0)
         bcrash("Could not get home directory (platform-cocoa)");
@@ -86,22 +88,32 @@ static char *os_get_path_ptr_internal(const char *name, NSSearchPathDomainMask d
 
 int os_get_config_path(char *dst, size_t size, const char *name)
 {
-    return os_get_path_internal(dst, size, name, NSUserDomainMask);
+    return os_get_path_internal(dst, size, name, NSApplicationSupportDirectory, NSUserDomainMask);
 }
 
 char *os_get_config_path_ptr(const char *name)
 {
-    return os_get_path_ptr_internal(name, NSUserDomainMask);
+    return os_get_path_ptr_internal(name, NSApplicationSupportDirectory, NSUserDomainMask);
 }
 
 int os_get_program_data_path(char *dst, size_t size, const char *name)
 {
-    return os_get_path_internal(dst, size, name, NSLocalDomainMask);
+    return os_get_path_internal(dst, size, name, NSApplicationSupportDirectory, NSLocalDomainMask);
 }
 
 char *os_get_program_data_path_ptr(const char *name)
 {
-    return os_get_path_ptr_internal(name, NSLocalDomainMask);
+    return os_get_path_ptr_internal(name, NSApplicationSupportDirectory, NSLocalDomainMask);
+}
+
+int os_get_cache_path(char *dst, size_t size, const char *name)
+{
+    return os_get_path_internal(dst, size, name, NSCachesDirectory, NSUserDomainMask);
+}
+
+char *os_get_cache_path_ptr(const char *name)
+{
+    return os_get_path_ptr_internal(name, NSCachesDirectory, NSUserDomainMask);
 }
 
 char *os_get_executable_path_ptr(const char *name)
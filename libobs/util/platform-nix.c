@@ -273,6 +273,54 @@ char *os_get_config_path_ptr(const char *name)
 	return path.array;
 }
 
+int os_get_cache_path(char *dst, size_t size, const char *name)
+{
+	char *xdg_ptr = getenv("XDG_CACHE_HOME");
+
+	// If XDG_CACHE_HOME is unset,
+	// we use the default $HOME/.cache/[name] instead
+	if (xdg_ptr == NULL) {
+		char *home_ptr = getenv("HOME");
+		if (home_ptr == NULL)
+			bcrash("Could not get $HOME\n");
+
+		if (!name || !*name) {
+			return snprintf(dst, size, "%s/.cache", home_ptr);
+		} else {
+			return snprintf(dst, size, "%s/.cache/%s", home_ptr, name);
+		}
+	} else {
+		if (!name || !*name)
+			return snprintf(dst, size, "%s", xdg_ptr);
+		else
+			return snprintf(dst, size, "%s/%s", xdg_ptr, name);
+	}
+}
+
+/* should return $HOME/.cache/[name] as default */
+char *os_get_cache_path_ptr(const char *name)
+{
+	struct dstr path;
+	char *xdg_ptr = getenv("XDG_CACHE_HOME");
+
+	/* If XDG_CACHE_HOME is unset,
+	 * we use the default $HOME/.cache/[name] instead */
+	if (xdg_ptr == NULL) {
+		char *home_ptr = getenv("HOME");
+		if (home_ptr == NULL)
+			bcrash("Could not get $HOME\n");
+
+		dstr_init_copy(&path, home_ptr);
+		dstr_cat(&path, "/.cache/");
+		dstr_cat(&path, name);
+	} else {
+		dstr_init_copy(&path, xdg_ptr);
+		dstr_cat(&path, "/");
+		dstr_cat(&path, name);
+	}
+	return path.array;
+}
+
 int os_get_program_data_path(char *dst, size_t size, const char *name)
 {
 	return snprintf(dst, size, "/usr/local/share/%s", !!name ? name : "");
@@ -450,6 +450,17 @@ char *os_get_program_data_path_ptr(const char *name)
 	return os_get_path_ptr_internal(name, CSIDL_COMMON_APPDATA);
 }
 
+/* local, so that large caches don't roam with the user's profile */
+int os_get_cache_path(char *dst, size_t size, const char *name)
+{
+	return os_get_path_internal(dst, size, name, CSIDL_LOCAL_APPDATA);
+}
+
+char *os_get_cache_path_ptr(const char *name)
+{
+	return os_get_path_ptr_internal(name, CSIDL_LOCAL_APPDATA);
+}
+
 char *os_get_executable_path_ptr(const char *name)
 {
 	char *ptr;
@@ -106,6 +106,9 @@ EXPORT char *os_get_config_path_ptr(const char *name);
 EXPORT int os_get_program_data_path(char *dst, size_t size, const char *name);
 EXPORT char *os_get_program_data_path_ptr(const char *name);
 
+EXPORT int os_get_cache_path(char *dst, size_t size, const char *name);
+EXPORT char *os_get_cache_path_ptr(const char *name);
+
 EXPORT char *os_get_executable_path_ptr(const char *name);
 
 EXPORT bool os_file_exists(const char *path);
@@ -80,12 +80,30 @@ struct profile_entry {
 
 typedef struct profile_root_entry profile_root_entry;
 struct profile_root_entry {
-	pthread_mutex_t *mutex;
 	const char *name;
 	profile_entry *entry;
 	profile_call *prev_call;
 };
 
+/* completed root calls are handed from the profiled thread to the aggregator
+ * through a single producer, single consumer ring, so profiled threads never
+ * wait on each other or on snapshots */
+#define THREAD_RING_SIZE 1024
+#define THREAD_RING_MASK (THREAD_RING_SIZE - 1)
+
+typedef struct profile_thread profile_thread;
+struct profile_thread {
+	profile_call *calls[THREAD_RING_SIZE];
+	volatile long head; /* written by the profiled thread */
+	volatile long tail; /* written by the aggregator */
+	volatile long dropped;
+	volatile bool exited;
+#ifdef TRACK_OVERHEAD
+	uint64_t handoff_time;
+	uint64_t handoffs;
+#endif
+};
+
 static inline uint64_t diff_ns_to_usec(uint64_t prev, uint64_t next)
 {
 	return (next - prev + 500) / 1000;
@@ -248,25 +266,74 @@ static void merge_call(profile_entry *entry, profile_call *call, profile_call *p
 #endif
 }
 
-static bool enabled = false;
+static volatile bool enabled = false;
+
+/* root_mutex guards the aggregated state, which only the aggregator thread,
+ * snapshots and root registration touch */
 static pthread_mutex_t root_mutex = PTHREAD_MUTEX_INITIALIZER;
 static DARRAY(profile_root_entry) root_entries;
 
+static pthread_mutex_t threads_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DARRAY(profile_thread *) threads;
+static pthread_key_t thread_key;
+static bool thread_key_valid = false;
+
+/* bumped by profiler_free, which frees every thread's buffer, so threads that
+ * outlive it know their buffer is gone */
+static volatile long threads_generation = 0;
+
+/* threads currently touching their buffer.  a thread registers before it
+ * checks whether the profiler is enabled, and profiler_free disables the
+ * profiler before waiting for this to drop to zero, so either the thread
+ * sees the profiler disabled or profiler_free waits for it */
+static volatile long active_producers = 0;
+
+static pthread_t aggregator_thread;
+static os_event_t *aggregator_stop = NULL;
+static bool aggregator_active = false;
+
 static THREAD_LOCAL profile_call *thread_context = NULL;
 static THREAD_LOCAL bool thread_enabled = true;
+static THREAD_LOCAL profile_thread *thread_buffer = NULL;
+static THREAD_LOCAL long thread_buffer_generation = 0;
+
+#define AGGREGATE_INTERVAL_MS 10
+
+static void aggregate_calls(void);
+static void check_trace_auto_dump(void);
+
+static void *aggregator_thread_func(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+
+	os_set_thread_name("profiler: aggregator");
+
+	while (os_event_timedwait(aggregator_stop, AGGREGATE_INTERVAL_MS) == ETIMEDOUT) {
+		aggregate_calls();
+		check_trace_auto_dump();
+	}
+
+	return NULL;
+}
 
 void profiler_start(void)
 {
 	pthread_mutex_lock(&root_mutex);
-	enabled = true;
+	os_atomic_set_bool(&enabled, true);
+
+	if (!aggregator_active && os_event_init(&aggregator_stop, OS_EVENT_TYPE_MANUAL) == 0) {
+		aggregator_active = pthread_create(&aggregator_thread, NULL, aggregator_thread_func, NULL) == 0;
+		if (!aggregator_active) {
+			os_event_destroy(aggregator_stop);
+			aggregator_stop = NULL;
+		}
+	}
 	pthread_mutex_unlock(&root_mutex);
 }
 
 void profiler_stop(void)
 {
-	pthread_mutex_lock(&root_mutex);
-	enabled = false;
-	pthread_mutex_unlock(&root_mutex);
+	os_atomic_set_bool(&enabled, false);
 }
 
 void profile_reenable_thread(void)
@@ -274,16 +341,12 @@ void profile_reenable_thread(void)
 	if (thread_enabled)
 		return;
 
-	pthread_mutex_lock(&root_mutex);
-	thread_enabled = enabled;
-	pthread_mutex_unlock(&root_mutex);
+	thread_enabled = os_atomic_load_bool(&enabled);
 }
 
-static bool lock_root(void)
+static bool check_enabled(void)
 {
-	pthread_mutex_lock(&root_mutex);
-	if (!enabled) {
-		pthread_mutex_unlock(&root_mutex);
+	if (!os_atomic_load_bool(&enabled)) {
 		thread_enabled = false;
 		return false;
 	}
@@ -304,9 +367,6 @@ static profile_root_entry *get_root_entry(const char *name)
 
 	if (!r_entry) {
 		r_entry = da_push_back_new(root_entries);
-		r_entry->mutex = bmalloc(sizeof(pthread_mutex_t));
-		pthread_mutex_init(r_entry->mutex, NULL);
-
 		r_entry->name = name;
 		r_entry->entry = bzalloc(sizeof(profile_entry));
 		init_entry(r_entry->entry, name);
@@ -317,42 +377,238 @@ static profile_root_entry *get_root_entry(const char *name)
 
 void profile_register_root(const char *name, uint64_t expected_time_between_calls)
 {
-	if (!lock_root())
+	if (!check_enabled())
 		return;
 
+	pthread_mutex_lock(&root_mutex);
 	get_root_entry(name)->entry->expected_time_between_calls = (expected_time_between_calls + 500) / 1000;
 	pthread_mutex_unlock(&root_mutex);
 }
 
 static void free_call_context(profile_call *context);
 
+/* called with root_mutex held */
+static void merge_root_call(profile_call *context)
+{
+	profile_root_entry *r_entry = get_root_entry(context->name);
+	profile_call *prev_call = r_entry->prev_call;
+
+	r_entry->prev_call = context;
+	merge_call(r_entry->entry, context, prev_call);
+	free_call_context(prev_call);
+}
+
+/* called with root_mutex and threads_mutex held, the aggregator is the only
+ * consumer of each ring */
+static void drain_thread(profile_thread *thread)
+{
+	long tail = thread->tail;
+	long head = os_atomic_load_long(&thread->head);
+
+	while (tail != head) {
+		merge_root_call(thread->calls[tail]);
+		tail = (tail + 1) & THREAD_RING_MASK;
+		os_atomic_set_long(&thread->tail, tail);
+	}
+}
+
+static void free_thread(profile_thread *thread)
+{
+	long dropped = os_atomic_load_long(&thread->dropped);
+	if (dropped)
+		blog(LOG_WARNING, "Profiler dropped %ld calls from a thread that fell behind", dropped);
+
+#ifdef TRACK_OVERHEAD
+	if (thread->handoffs)
+		blog(LOG_DEBUG, "Profiler handed off %" PRIu64 " root calls, %" PRIu64 " ns on average",
+		     thread->handoffs, thread->handoff_time / thread->handoffs);
+#endif
+
+	bfree(thread);
+}
+
+static void aggregate_calls(void)
+{
+	pthread_mutex_lock(&root_mutex);
+	pthread_mutex_lock(&threads_mutex);
+
+	for (size_t i = threads.num; i > 0; i--) {
+		profile_thread *thread = threads.array[i - 1];
+
+		/* the exit flag is set after the thread's last push, so
+		 * checking it first means nothing is left behind */
+		bool exited = os_atomic_load_bool(&thread->exited);
+		drain_thread(thread);
+
+		if (exited) {
+			da_erase(threads, i - 1);
+			free_thread(thread);
+		}
+	}
+
+	pthread_mutex_unlock(&threads_mutex);
+	pthread_mutex_unlock(&root_mutex);
+}
+
+static void thread_exited(void *data)
+{
+	profile_thread *thread = data;
+
+	/* profiler_free may have taken the buffer already */
+	pthread_mutex_lock(&threads_mutex);
+	if (thread_buffer_generation == threads_generation)
+		os_atomic_set_bool(&thread->exited, true);
+	pthread_mutex_unlock(&threads_mutex);
+}
+
+static profile_thread *get_thread_buffer(void)
+{
+	long generation = os_atomic_load_long(&threads_generation);
+	if (thread_buffer && thread_buffer_generation == generation)
+		return thread_buffer;
+
+	pthread_mutex_lock(&threads_mutex);
+	if (!thread_key_valid)
+		thread_key_valid = pthread_key_create(&thread_key, thread_exited) == 0;
+
+	thread_buffer = NULL;
+	if (thread_key_valid) {
+		thread_buffer = bzalloc(sizeof(profile_thread));
+		thread_buffer_generation = threads_generation;
+		pthread_setspecific(thread_key, thread_buffer);
+		da_push_back(threads, &thread_buffer);
+	}
+	pthread_mutex_unlock(&threads_mutex);
+
+	return thread_buffer;
+}
+
 static void merge_context(profile_call *context)
 {
-	pthread_mutex_t *mutex = NULL;
-	profile_entry *entry = NULL;
-	profile_call *prev_call = NULL;
+	profile_thread *thread;
+
+	os_atomic_inc_long(&active_producers);
 
-	if (!lock_root()) {
+	if (!check_enabled() || !(thread = get_thread_buffer())) {
+		os_atomic_dec_long(&active_producers);
 		free_call_context(context);
 		return;
 	}
 
-	profile_root_entry *r_entry = get_root_entry(context->name);
+#ifdef TRACK_OVERHEAD
+	uint64_t handoff_start = os_gettime_ns();
+#endif
 
-	mutex = r_entry->mutex;
-	entry = r_entry->entry;
-	prev_call = r_entry->prev_call;
+	long head = thread->head;
+	long next = (head + 1) & THREAD_RING_MASK;
 
-	r_entry->prev_call = context;
+	if (next == os_atomic_load_long(&thread->tail)) {
+		os_atomic_inc_long(&thread->dropped);
+		os_atomic_dec_long(&active_producers);
+		free_call_context(context);
+		return;
+	}
 
-	pthread_mutex_lock(mutex);
-	pthread_mutex_unlock(&root_mutex);
+	thread->calls[head] = context;
+	os_atomic_set_long(&thread->head, next);
 
-	merge_call(entry, context, prev_call);
+#ifdef TRACK_OVERHEAD
+	thread->handoff_time += os_gettime_ns() - handoff_start;
+	thread->handoffs++;
+#endif
 
-	pthread_mutex_unlock(mutex);
+	os_atomic_dec_long(&active_producers);
+}
 
-	free_call_context(prev_call);
+/* ------------------------------------------------------------------------- */
+/* Trace recording */
+
+typedef struct trace_event trace_event;
+struct trace_event {
+	const char *name;
+	uint64_t start_time;
+	uint64_t end_time;
+};
+
+/* each thread records into its own ring, the mutex is only contended while
+ * the ring is being dumped */
+typedef struct trace_thread trace_thread;
+struct trace_thread {
+	pthread_mutex_t mutex;
+	long tid;
+	const char *name;
+	trace_event *events;
+	size_t capacity;
+	size_t head;
+	size_t num;
+};
+
+#define TRACE_AUTO_DUMP_INTERVAL_NS 10000000000ULL
+
+static volatile bool trace_enabled = false;
+static volatile long trace_generation = 0;
+static volatile bool trace_dump_requested = false;
+static pthread_mutex_t trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DARRAY(trace_thread *) trace_threads;
+/* threads may still hold on to buffers from a previous trace, so they are
+ * only freed along with the profiler */
+static DARRAY(trace_thread *) retired_trace_threads;
+static size_t trace_capacity = 0;
+static char *trace_auto_dump_prefix = NULL;
+static uint64_t trace_last_auto_dump = 0;
+static long trace_auto_dumps = 0;
+
+static THREAD_LOCAL trace_thread *thread_trace = NULL;
+static THREAD_LOCAL long thread_trace_generation = 0;
+
+static trace_thread *get_trace_thread(const profile_call *call)
+{
+	long generation = os_atomic_load_long(&trace_generation);
+	if (thread_trace && thread_trace_generation == generation)
+		return thread_trace;
+
+	thread_trace = NULL;
+
+	pthread_mutex_lock(&trace_mutex);
+	if (trace_enabled) {
+		thread_trace = bzalloc(sizeof(trace_thread));
+		pthread_mutex_init(&thread_trace->mutex, NULL);
+		thread_trace->tid = (long)trace_threads.num + 1;
+		thread_trace->capacity = trace_capacity;
+		thread_trace->events = bmalloc(sizeof(trace_event) * trace_capacity);
+
+		/* threads are named after the root they were first seen in */
+		while (call->parent)
+			call = call->parent;
+		thread_trace->name = call->name;
+
+		da_push_back(trace_threads, &thread_trace);
+		thread_trace_generation = trace_generation;
+	}
+	pthread_mutex_unlock(&trace_mutex);
+
+	return thread_trace;
+}
+
+static void trace_record(const profile_call *call)
+{
+	if (!os_atomic_load_bool(&trace_enabled))
+		return;
+
+	trace_thread *trace = get_trace_thread(call);
+	if (!trace)
+		return;
+
+	pthread_mutex_lock(&trace->mutex);
+	trace_event *event = &trace->events[trace->head];
+	event->name = call->name;
+	event->start_time = call->start_time;
+	event->end_time = call->end_time;
+
+	trace->head = (trace->head + 1) % trace->capacity;
+	if (trace->num < trace->capacity)
+		trace->num++;
+	pthread_mutex_unlock(&trace->mutex);
 }
 
 void profile_start(const char *name)
@@ -419,6 +675,7 @@ void profile_end(const char *name)
 	thread_context = call->parent;
 
 	call->end_time = end;
+	trace_record(call);
 #ifdef TRACK_OVERHEAD
 	call->overhead_end = os_gettime_ns();
 #endif
@@ -429,6 +686,31 @@ void profile_end(const char *name)
 	merge_context(call);
 }
 
+void profile_record(const char *name, uint64_t duration)
+{
+	uint64_t end = os_gettime_ns();
+	if (!thread_enabled)
+		return;
+
+	profile_start(name);
+
+	profile_call *call = thread_context;
+	thread_context = call->parent;
+
+	call->start_time = end - duration;
+	call->end_time = end;
+	trace_record(call);
+#ifdef TRACK_OVERHEAD
+	call->overhead_start = call->start_time;
+	call->overhead_end = end;
+#endif
+
+	if (call->parent)
+		return;
+
+	merge_context(call);
+}
+
 static int profiler_time_entry_compare(const void *first, const void *second)
 {
 	int64_t diff = ((profiler_time_entry *)second)->time_delta - ((profiler_time_entry *)first)->time_delta;
@@ -767,31 +1049,64 @@ static void free_profile_entry(profile_entry *entry)
 void profiler_free(void)
 {
 	DARRAY(profile_root_entry) old_root_entries = {0};
+	DARRAY(profile_thread *) old_threads = {0};
+
+	os_atomic_set_bool(&enabled, false);
+
+	/* threads that saw the profiler enabled may still be pushing into
+	 * their buffers */
+	while (os_atomic_load_long(&active_producers))
+		os_sleep_ms(1);
+
+	if (aggregator_active) {
+		os_event_signal(aggregator_stop);
+		pthread_join(aggregator_thread, NULL);
+		os_event_destroy(aggregator_stop);
+		aggregator_stop = NULL;
+		aggregator_active = false;
+	}
 
 	pthread_mutex_lock(&root_mutex);
-	enabled = false;
+	pthread_mutex_lock(&threads_mutex);
+
+	for (size_t i = 0; i < threads.num; i++)
+		drain_thread(threads.array[i]);
+
+	da_move(old_threads, threads);
 	da_move(old_root_entries, root_entries);
+	os_atomic_inc_long(&threads_generation);
+
+	if (thread_key_valid) {
+		pthread_key_delete(thread_key);
+		thread_key_valid = false;
+	}
+
+	pthread_mutex_unlock(&threads_mutex);
 	pthread_mutex_unlock(&root_mutex);
 
+	for (size_t i = 0; i < old_threads.num; i++)
+		free_thread(old_threads.array[i]);
+
 	for (size_t i = 0; i < old_root_entries.num; i++) {
 		profile_root_entry *entry = &old_root_entries.array[i];
 
-		pthread_mutex_lock(entry->mutex);
-		pthread_mutex_unlock(entry->mutex);
-
-		pthread_mutex_destroy(entry->mutex);
-		bfree(entry->mutex);
-		entry->mutex = NULL;
-
 		free_call_context(entry->prev_call);
 
 		free_profile_entry(entry->entry);
 		bfree(entry->entry);
 	}
 
+	da_free(old_threads);
 	da_free(old_root_entries);
 
-	pthread_mutex_destroy(&root_mutex);
+	profiler_trace_stop();
+	for (size_t i = 0; i < retired_trace_threads.num; i++) {
+		trace_thread *trace = retired_trace_threads.array[i];
+		pthread_mutex_destroy(&trace->mutex);
+		bfree(trace->events);
+		bfree(trace);
+	}
+	da_free(retired_trace_threads);
 }
 
 /* ------------------------------------------------------------------------- */
@@ -833,6 +1148,11 @@ void profiler_name_store_free(profiler_name_store_t *store)
 
 const char *profile_store_name(profiler_name_store_t *store, const char *format, ...)
 {
+	/* media-io can be used without libobs being initialized, in which
+	 * case its threads just aren't profiled by name */
+	if (!store)
+		return NULL;
+
 	va_list args;
 	va_start(args, format);
 
@@ -887,13 +1207,13 @@ profiler_snapshot_t *profile_snapshot_create(void)
 {
 	profiler_snapshot_t *snap = bzalloc(sizeof(profiler_snapshot_t));
 
+	/* pick up everything that was handed off before this call */
+	aggregate_calls();
+
 	pthread_mutex_lock(&root_mutex);
 	da_reserve(snap->roots, root_entries.num);
-	for (size_t i = 0; i < root_entries.num; i++) {
-		pthread_mutex_lock(root_entries.array[i].mutex);
+	for (size_t i = 0; i < root_entries.num; i++)
 		add_entry_to_snapshot(root_entries.array[i].entry, da_push_back_new(snap->roots));
-		pthread_mutex_unlock(root_entries.array[i].mutex);
-	}
 	pthread_mutex_unlock(&root_mutex);
 
 	for (size_t i = 0; i < snap->roots.num; i++)
@@ -1115,3 +1435,167 @@ uint64_t profiler_snapshot_entry_overall_between_calls_count(profiler_snapshot_e
 {
 	return entry ? entry->overall_between_calls_count : 0;
 }
+
+/* ------------------------------------------------------------------------- */
+/* Profiler trace */
+
+void profiler_trace_start(size_t events_per_thread, const char *auto_dump_prefix)
+{
+	if (!events_per_thread)
+		return;
+
+	pthread_mutex_lock(&trace_mutex);
+	if (!trace_enabled) {
+		trace_capacity = events_per_thread;
+		trace_auto_dump_prefix = auto_dump_prefix ? bstrdup(auto_dump_prefix) : NULL;
+		trace_last_auto_dump = 0;
+		os_atomic_inc_long(&trace_generation);
+		os_atomic_set_bool(&trace_enabled, true);
+	}
+	pthread_mutex_unlock(&trace_mutex);
+}
+
+void profiler_trace_stop(void)
+{
+	pthread_mutex_lock(&trace_mutex);
+	os_atomic_set_bool(&trace_enabled, false);
+	os_atomic_inc_long(&trace_generation);
+
+	da_push_back_da(retired_trace_threads, trace_threads);
+	da_free(trace_threads);
+
+	bfree(trace_auto_dump_prefix);
+	trace_auto_dump_prefix = NULL;
+	pthread_mutex_unlock(&trace_mutex);
+}
+
+bool profiler_trace_active(void)
+{
+	return os_atomic_load_bool(&trace_enabled);
+}
+
+void profiler_trace_deadline_missed(void)
+{
+	if (!os_atomic_load_bool(&trace_enabled))
+		return;
+
+	/* written out by the aggregator thread, so the thread that missed
+	 * its deadline doesn't also have to wait on the disk */
+	os_atomic_set_bool(&trace_dump_requested, true);
+}
+
+typedef struct trace_dump_event trace_dump_event;
+struct trace_dump_event {
+	long tid;
+	trace_event event;
+};
+
+static void trace_cat_json_string(struct dstr *buffer, const char *str)
+{
+	dstr_cat_ch(buffer, '"');
+	for (; str && *str; str++) {
+		unsigned char ch = (unsigned char)*str;
+		if (ch == '"' || ch == '\\') {
+			dstr_cat_ch(buffer, '\\');
+			dstr_cat_ch(buffer, (char)ch);
+		} else if (ch < 0x20) {
+			dstr_catf(buffer, "\\u%04x", ch);
+		} else {
+			dstr_cat_ch(buffer, (char)ch);
+		}
+	}
+	dstr_cat_ch(buffer, '"');
+}
+
+bool profiler_trace_dump_json(const char *filename)
+{
+	DARRAY(trace_dump_event) events = {0};
+	struct dstr buffer = {0};
+	bool first = true;
+	FILE *f;
+
+	f = os_fopen(filename, "wb");
+	if (!f)
+		return false;
+
+	dstr_cat(&buffer, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+	pthread_mutex_lock(&trace_mutex);
+	for (size_t i = 0; i < trace_threads.num; i++) {
+		trace_thread *trace = trace_threads.array[i];
+
+		dstr_catf(&buffer,
+			  "%s\n{\"ph\":\"M\",\"pid\":1,\"tid\":%ld,"
+			  "\"name\":\"thread_name\",\"args\":{\"name\":",
+			  first ? "" : ",", trace->tid);
+		trace_cat_json_string(&buffer, trace->name);
+		dstr_cat(&buffer, "}}");
+		first = false;
+
+		pthread_mutex_lock(&trace->mutex);
+		size_t start = (trace->head + trace->capacity - trace->num) % trace->capacity;
+		for (size_t j = 0; j < trace->num; j++) {
+			trace_dump_event *event = da_push_back_new(events);
+			event->tid = trace->tid;
+			event->event = trace->events[(start + j) % trace->capacity];
+		}
+		pthread_mutex_unlock(&trace->mutex);
+	}
+	pthread_mutex_unlock(&trace_mutex);
+
+	for (size_t i = 0; i < events.num; i++) {
+		trace_dump_event *event = &events.array[i];
+
+		dstr_catf(&buffer,
+			  "%s\n{\"ph\":\"X\",\"pid\":1,\"tid\":%ld,"
+			  "\"ts\":%.3f,\"dur\":%.3f,\"name\":",
+			  first ? "" : ",", event->tid, event->event.start_time / 1000.,
+			  (event->event.end_time - event->event.start_time) / 1000.);
+		trace_cat_json_string(&buffer, event->event.name);
+		dstr_cat_ch(&buffer, '}');
+		first = false;
+
+		if (buffer.len >= 65536) {
+			fwrite(buffer.array, 1, buffer.len, f);
+			buffer.len = 0;
+		}
+	}
+
+	dstr_cat(&buffer, "\n]}\n");
+	fwrite(buffer.array, 1, buffer.len, f);
+
+	bool success = ferror(f) == 0;
+	fclose(f);
+
+	dstr_free(&buffer);
+	da_free(events);
+	return success;
+}
+
+static void check_trace_auto_dump(void)
+{
+	struct dstr path = {0};
+	uint64_t now;
+
+	if (!os_atomic_exchange_bool(&trace_dump_requested, false))
+		return;
+
+	now = os_gettime_ns();
+
+	pthread_mutex_lock(&trace_mutex);
+	if (trace_auto_dump_prefix &&
+	    (!trace_last_auto_dump || now - trace_last_auto_dump >= TRACE_AUTO_DUMP_INTERVAL_NS)) {
+		trace_last_auto_dump = now;
+		dstr_printf(&path, "%s-missed-%ld.json", trace_auto_dump_prefix, ++trace_auto_dumps);
+	}
+	pthread_mutex_unlock(&trace_mutex);
+
+	if (path.len) {
+		if (profiler_trace_dump_json(path.array))
+			blog(LOG_INFO, "Frame deadline missed, saved profiler trace to '%s'", path.array);
+		else
+			blog(LOG_WARNING, "Could not save profiler trace to '%s'", path.array);
+	}
+
+	dstr_free(&path);
+}
@@ -18,6 +18,7 @@ EXPORT void profile_register_root(const char *name, uint64_t expected_time_betwe
 
 EXPORT void profile_start(const char *name);
 EXPORT void profile_end(const char *name);
+EXPORT void profile_record(const char *name, uint64_t duration);
 
 EXPORT void profile_reenable_thread(void);
 
@@ -32,6 +33,15 @@ EXPORT void profiler_print_time_between_calls(profiler_snapshot_t *snap);
 
 EXPORT void profiler_free(void);
 
+/* ------------------------------------------------------------------------- */
+/* Profiler trace */
+
+EXPORT void profiler_trace_start(size_t events_per_thread, const char *auto_dump_prefix);
+EXPORT void profiler_trace_stop(void);
+EXPORT bool profiler_trace_active(void);
+EXPORT bool profiler_trace_dump_json(const char *filename);
+EXPORT void profiler_trace_deadline_missed(void);
+
 /* ------------------------------------------------------------------------- */
 /* Profiler name storage */
 
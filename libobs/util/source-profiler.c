@@ -425,7 +425,13 @@ void source_profiler_source_tick_end(obs_source_t *source, uint64_t start)
 	if (!enabled)
 		return;
 
-	const uint64_t delta = os_gettime_ns() - start;
+	source_profiler_source_tick_time(source, os_gettime_ns() - start);
+}
+
+void source_profiler_source_tick_time(obs_source_t *source, uint64_t delta)
+{
+	if (!enabled)
+		return;
 
 	struct source_samples *smp = NULL;
 	HASH_FIND_PTR(hm_samples, &source, smp);
@@ -1,5 +1,7 @@
 #include "task.h"
 #include "bmem.h"
+#include "dstr.h"
+#include "platform.h"
 #include "threading.h"
 #include "deque.h"
 
@@ -162,3 +164,148 @@ static void *tiny_tubular_task_thread(void *param)
 
 	return NULL;
 }
+
+/* ------------------------------------------------------------------------- */
+
+struct os_task_pool {
+	pthread_t *threads;
+	size_t num_threads;
+	char *name;
+	volatile bool stop;
+
+	pthread_mutex_t run_mutex;
+	os_sem_t *start_sem;
+	os_event_t *done_event;
+
+	os_task_range_t task;
+	void *param;
+	size_t count;
+	volatile long next;
+	volatile long running;
+};
+
+static void task_pool_work(struct os_task_pool *pool)
+{
+	for (;;) {
+		size_t idx = (size_t)os_atomic_inc_long(&pool->next) - 1;
+		if (idx >= pool->count)
+			break;
+
+		pool->task(pool->param, idx);
+	}
+}
+
+static void *task_pool_thread(void *param)
+{
+	struct os_task_pool *pool = param;
+
+	os_set_thread_name(pool->name);
+
+	while (os_sem_wait(pool->start_sem) == 0) {
+		if (os_atomic_load_bool(&pool->stop))
+			break;
+
+		task_pool_work(pool);
+
+		if (os_atomic_dec_long(&pool->running) == 0)
+			os_event_signal(pool->done_event);
+	}
+
+	return NULL;
+}
+
+os_task_pool_t *os_task_pool_create(const char *name, size_t num_threads)
+{
+	struct os_task_pool *pool = bzalloc(sizeof(*pool));
+	struct dstr thread_name = {0};
+
+	if (!num_threads) {
+		int cores = os_get_logical_cores();
+		num_threads = cores > 1 ? (size_t)cores - 1 : 0;
+	}
+
+	dstr_printf(&thread_name, "%s: task pool", name ? name : "libobs");
+	pool->name = thread_name.array;
+
+	if (pthread_mutex_init(&pool->run_mutex, NULL) != 0)
+		goto fail1;
+	if (os_sem_init(&pool->start_sem, 0) != 0)
+		goto fail2;
+	if (os_event_init(&pool->done_event, OS_EVENT_TYPE_AUTO) != 0)
+		goto fail3;
+
+	pool->threads = bzalloc(sizeof(pthread_t) * (num_threads ? num_threads : 1));
+
+	for (size_t i = 0; i < num_threads; i++) {
+		if (pthread_create(&pool->threads[i], NULL, task_pool_thread, pool) != 0)
+			break;
+		pool->num_threads++;
+	}
+
+	return pool;
+
+fail3:
+	os_sem_destroy(pool->start_sem);
+fail2:
+	pthread_mutex_destroy(&pool->run_mutex);
+fail1:
+	bfree(pool->name);
+	bfree(pool);
+	return NULL;
+}
+
+void os_task_pool_destroy(os_task_pool_t *pool)
+{
+	if (!pool)
+		return;
+
+	os_atomic_set_bool(&pool->stop, true);
+	for (size_t i = 0; i < pool->num_threads; i++)
+		os_sem_post(pool->start_sem);
+	for (size_t i = 0; i < pool->num_threads; i++)
+		pthread_join(pool->threads[i], NULL);
+
+	os_event_destroy(pool->done_event);
+	os_sem_destroy(pool->start_sem);
+	pthread_mutex_destroy(&pool->run_mutex);
+	bfree(pool->threads);
+	bfree(pool->name);
+	bfree(pool);
+}
+
+size_t os_task_pool_num_threads(const os_task_pool_t *pool)
+{
+	return pool ? pool->num_threads : 0;
+}
+
+void os_task_pool_run(os_task_pool_t *pool, size_t count, os_task_range_t task, void *param)
+{
+	size_t wake;
+
+	if (!count || !task)
+		return;
+
+	if (!pool || !pool->num_threads || count == 1) {
+		for (size_t i = 0; i < count; i++)
+			task(param, i);
+		return;
+	}
+
+	pthread_mutex_lock(&pool->run_mutex);
+
+	wake = count - 1 < pool->num_threads ? count - 1 : pool->num_threads;
+
+	pool->task = task;
+	pool->param = param;
+	pool->count = count;
+	os_atomic_set_long(&pool->next, 0);
+	os_atomic_set_long(&pool->running, (long)wake);
+
+	for (size_t i = 0; i < wake; i++)
+		os_sem_post(pool->start_sem);
+
+	task_pool_work(pool);
+	os_event_wait(pool->done_event);
+
+	pthread_mutex_unlock(&pool->run_mutex);
+}
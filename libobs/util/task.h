@@ -17,6 +17,23 @@ EXPORT void os_task_queue_destroy(os_task_queue_t *tt);
 EXPORT bool os_task_queue_wait(os_task_queue_t *tt);
 EXPORT bool os_task_queue_inside(os_task_queue_t *tt);
 
+/* Fixed pool of worker threads for running batches of independent tasks.
+ * os_task_pool_run calls task(param, idx) once for each idx in [0, count)
+ * and returns once all of them have finished.  The calling thread takes part
+ * in the work, and idle threads keep taking the next unclaimed index, so
+ * uneven task lengths balance out.  Batches on the same pool are serialized. */
+
+struct os_task_pool;
+typedef struct os_task_pool os_task_pool_t;
+
+typedef void (*os_task_range_t)(void *param, size_t idx);
+
+/* num_threads of 0 uses one thread less than the number of logical cores */
+EXPORT os_task_pool_t *os_task_pool_create(const char *name, size_t num_threads);
+EXPORT void os_task_pool_destroy(os_task_pool_t *pool);
+EXPORT size_t os_task_pool_num_threads(const os_task_pool_t *pool);
+EXPORT void os_task_pool_run(os_task_pool_t *pool, size_t count, os_task_range_t task, void *param);
+
 #ifdef __cplusplus
 }
 #endif
@@ -16,10 +16,12 @@
 
 #include <ctype.h>
 
+#include "darray.h"
 #include "dstr.h"
 #include "text-lookup.h"
 #include "lexer.h"
 #include "platform.h"
+#include "threading.h"
 #include "uthash.h"
 
 /* ------------------------------------------------------------------------- */
@@ -40,6 +42,12 @@ static inline void text_item_destroy(struct text_item *item)
 
 struct text_lookup {
 	struct text_item *items;
+
+	/* files added with text_lookup_add_deferred that haven't been parsed
+	 * yet, in the order they were added */
+	pthread_mutex_t deferred_mutex;
+	DARRAY(char *) deferred_files;
+	volatile bool has_deferred;
 };
 
 static void lookup_getstringtoken(struct lexer *lex, struct strref *token)
@@ -197,10 +205,57 @@ static void lookup_addfiledata(struct text_lookup *lookup, const char *file_data
 	lexer_free(&lex);
 }
 
+static bool lookup_addfile(struct text_lookup *lookup, const char *path)
+{
+	struct dstr file_str;
+	char *temp = NULL;
+	FILE *file;
+
+	file = os_fopen(path, "rb");
+	if (!file)
+		return false;
+
+	os_fread_utf8(file, &temp);
+	dstr_init_move_array(&file_str, temp);
+	fclose(file);
+
+	if (!file_str.array)
+		return false;
+
+	dstr_replace(&file_str, "\r", " ");
+	lookup_addfiledata(lookup, file_str.array);
+	dstr_free(&file_str);
+
+	return true;
+}
+
+static void lookup_load_deferred(struct text_lookup *lookup)
+{
+	pthread_mutex_lock(&lookup->deferred_mutex);
+
+	if (lookup->has_deferred) {
+		for (size_t i = 0; i < lookup->deferred_files.num; i++) {
+			char *path = lookup->deferred_files.array[i];
+
+			if (!lookup_addfile(lookup, path))
+				blog(LOG_WARNING, "Failed to load text lookup file '%s'", path);
+			bfree(path);
+		}
+
+		da_free(lookup->deferred_files);
+		os_atomic_set_bool(&lookup->has_deferred, false);
+	}
+
+	pthread_mutex_unlock(&lookup->deferred_mutex);
+}
+
 static inline bool lookup_getstring(const char *lookup_val, const char **out, struct text_lookup *lookup)
 {
 	struct text_item *item;
 
+	if (os_atomic_load_bool(&lookup->has_deferred))
+		lookup_load_deferred(lookup);
+
 	if (!lookup->items)
 		return false;
 
@@ -215,38 +270,57 @@ static inline bool lookup_getstring(const char *lookup_val, const char **out, st
 
 /* ------------------------------------------------------------------------- */
 
-lookup_t *text_lookup_create(const char *path)
+static struct text_lookup *lookup_create(void)
 {
 	struct text_lookup *lookup = bzalloc(sizeof(struct text_lookup));
+	pthread_mutex_init(&lookup->deferred_mutex, NULL);
+	return lookup;
+}
+
+lookup_t *text_lookup_create(const char *path)
+{
+	struct text_lookup *lookup = lookup_create();
 
 	if (!text_lookup_add(lookup, path)) {
-		bfree(lookup);
+		text_lookup_destroy(lookup);
 		lookup = NULL;
 	}
 
 	return lookup;
 }
 
-bool text_lookup_add(lookup_t *lookup, const char *path)
+lookup_t *text_lookup_create_deferred(const char *path)
 {
-	struct dstr file_str;
-	char *temp = NULL;
-	FILE *file;
+	struct text_lookup *lookup = lookup_create();
 
-	file = os_fopen(path, "rb");
-	if (!file)
-		return false;
+	if (!text_lookup_add_deferred(lookup, path)) {
+		text_lookup_destroy(lookup);
+		lookup = NULL;
+	}
 
-	os_fread_utf8(file, &temp);
-	dstr_init_move_array(&file_str, temp);
-	fclose(file);
+	return lookup;
+}
 
-	if (!file_str.array)
+bool text_lookup_add(lookup_t *lookup, const char *path)
+{
+	/* keep files overriding each other in the order they were added */
+	if (os_atomic_load_bool(&lookup->has_deferred))
+		lookup_load_deferred(lookup);
+
+	return lookup_addfile(lookup, path);
+}
+
+bool text_lookup_add_deferred(lookup_t *lookup, const char *path)
+{
+	if (!path || !os_file_exists(path))
 		return false;
 
-	dstr_replace(&file_str, "\r", " ");
-	lookup_addfiledata(lookup, file_str.array);
-	dstr_free(&file_str);
+	char *path_copy = bstrdup(path);
+
+	pthread_mutex_lock(&lookup->deferred_mutex);
+	da_push_back(lookup->deferred_files, &path_copy);
+	os_atomic_set_bool(&lookup->has_deferred, true);
+	pthread_mutex_unlock(&lookup->deferred_mutex);
 
 	return true;
 }
@@ -259,6 +333,12 @@ void text_lookup_destroy(lookup_t *lookup)
 			HASH_DELETE(hh, lookup->items, item);
 			text_item_destroy(item);
 		}
+
+		for (size_t i = 0; i < lookup->deferred_files.num; i++)
+			bfree(lookup->deferred_files.array[i]);
+		da_free(lookup->deferred_files);
+
+		pthread_mutex_destroy(&lookup->deferred_mutex);
 		bfree(lookup);
 	}
 }
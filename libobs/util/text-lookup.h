@@ -37,6 +37,12 @@ typedef struct text_lookup lookup_t;
 /* functions */
 EXPORT lookup_t *text_lookup_create(const char *path);
 EXPORT bool text_lookup_add(lookup_t *lookup, const char *path);
+
+/* Like text_lookup_create/text_lookup_add, but the files are only parsed on
+ * the first lookup.  Only checks that the file exists. */
+EXPORT lookup_t *text_lookup_create_deferred(const char *path);
+EXPORT bool text_lookup_add_deferred(lookup_t *lookup, const char *path);
+
 EXPORT void text_lookup_destroy(lookup_t *lookup);
 EXPORT bool text_lookup_getstr(lookup_t *lookup, const char *lookup_val, const char **out);
 
@@ -91,6 +91,10 @@ enum behavior {
 
 #define SLIDE_BUFFER_COUNT 5
 
+/* animated gifs that would take more than this per slide are decoded on
+ * demand instead of being kept fully decoded for every buffered slide */
+#define SLIDE_GIF_CACHE_LIMIT_MB 64
+
 struct active_slides {
 	struct deque prev;
 	struct deque next;
@@ -302,6 +306,7 @@ static inline obs_source_t *create_source_from_file(struct slideshow *ss, const
 	obs_data_set_string(settings, "file", file);
 	obs_data_set_bool(settings, "unload", false);
 	obs_data_set_bool(settings, "is_slide", !now);
+	obs_data_set_int(settings, "gif_cache_limit_mb", SLIDE_GIF_CACHE_LIMIT_MB);
 	source = obs_source_create_private("image_source", NULL, settings);
 
 	obs_data_release(settings);
@@ -157,13 +157,16 @@ static obs_source_t *get_source(image_file_array_t *files, const char *path)
 	return source;
 }
 
-static obs_source_t *create_source_from_file(const char *file)
+static obs_source_t *create_source_from_file(const char *file, uint64_t mem_available)
 {
 	obs_data_t *settings = obs_data_create();
 	obs_source_t *source;
 
+	/* animated gifs that don't fit in what's left of the memory budget
+	 * are decoded on demand */
 	obs_data_set_string(settings, "file", file);
 	obs_data_set_bool(settings, "unload", false);
+	obs_data_set_int(settings, "gif_cache_limit_mb", (long long)(mem_available / BYTES_TO_MBYTES) + 1);
 	source = obs_source_create_private("image_source", NULL, settings);
 
 	obs_data_release(settings);
@@ -212,7 +215,7 @@ static void add_file(struct slideshow *ss, image_file_array_t *new_files, const
 	if (!new_source)
 		new_source = get_source(new_files, path);
 	if (!new_source)
-		new_source = create_source_from_file(path);
+		new_source = create_source_from_file(path, MAX_MEM_USAGE - ss->mem_usage);
 
 	if (new_source) {
 		uint32_t new_cx = obs_source_get_width(new_source);
@@ -75,6 +75,13 @@ void xcb_xcursor_update(xcb_connection_t *xcb, xcb_xcursor_t *data)
 	if (!data || !xc)
 		return;
 
+	xcb_xcursor_update_from_reply(data, xc);
+
+	free(xc);
+}
+
+void xcb_xcursor_update_from_reply(xcb_xcursor_t *data, xcb_xfixes_get_cursor_image_reply_t *xc)
+{
 	if (!data->tex || data->last_serial != xc->cursor_serial)
 		xcb_xcursor_create(data, xc);
 
@@ -82,8 +89,6 @@ void xcb_xcursor_update(xcb_connection_t *xcb, xcb_xcursor_t *data)
 	data->y = xc->y - data->y_org;
 	data->x_render = data->x - xc->xhot;
 	data->y_render = data->y - xc->yhot;
-
-	free(xc);
 }
 
 void xcb_xcursor_render(xcb_xcursor_t *data)
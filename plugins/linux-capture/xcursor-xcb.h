@@ -61,6 +61,15 @@ void xcb_xcursor_destroy(xcb_xcursor_t *data);
  */
 void xcb_xcursor_update(xcb_connection_t *xcb, xcb_xcursor_t *data);
 
+/**
+ * Update the cursor data from a cursor image that was already fetched
+ * @param data xcursor object
+ * @param xc reply of a get cursor image request
+ *
+ * @note This needs to be executed within a valid render context
+ */
+void xcb_xcursor_update_from_reply(xcb_xcursor_t *data, xcb_xfixes_get_cursor_image_reply_t *xc);
+
 /**
  * Draw the cursor
  *
@@ -18,6 +18,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <stdio.h>
 #include <stdlib.h>
 #include <inttypes.h>
+#include <pthread.h>
+#include <xcb/damage.h>
 #include <xcb/randr.h>
 #include <xcb/shm.h>
 #include <xcb/xfixes.h>
@@ -25,6 +27,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <obs-module.h>
 #include <util/dstr.h>
+#include <util/platform.h>
+#include <util/threading.h>
 #include "xcursor-xcb.h"
 #include "xhelpers.h"
 
@@ -34,6 +38,27 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #define INVALID_DISPLAY (-1)
 
+#ifndef MIN
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b) (((a) > (b)) ? (a) : (b))
+#endif
+
+/* damaged areas kept per frame before they're merged into one */
+#define MAX_DIRTY_RECTS 16
+
+/* dirty areas are uploaded through textures of 64 to 2048 pixels per side */
+#define PATCH_SIZE_MIN 64
+#define PATCH_SIZE_COUNT 6
+
+struct xshm_rect {
+	int32_t x;
+	int32_t y;
+	int32_t w;
+	int32_t h;
+};
+
 struct xshm_data {
 	obs_source_t *source;
 
@@ -65,6 +90,36 @@ struct xshm_data {
 	bool use_xinerama;
 	bool use_randr;
 	bool advanced;
+	bool use_damage;
+
+	/* damage on the root window, only fetched and uploaded where the
+	 * screen changed */
+	xcb_damage_damage_t damage;
+	xcb_xfixes_region_t damage_region;
+	uint8_t damage_event;
+	bool damage_full;
+
+	/* images are fetched by the capture thread whenever the video tick
+	 * asks for one */
+	pthread_t capture_thread;
+	bool capture_thread_active;
+	os_event_t *capture_event;
+	volatile bool capture_stop;
+
+	/* protects dirty and cursor_image, and the frame while the capture
+	 * thread writes to it */
+	pthread_mutex_t frame_mutex;
+	uint8_t *frame;
+	struct xshm_rect dirty[MAX_DIRTY_RECTS];
+	size_t dirty_count;
+	xcb_xfixes_get_cursor_image_reply_t *cursor_image;
+
+	/* last cursor state seen by the capture thread */
+	uint32_t cursor_serial;
+	int16_t cursor_x;
+	int16_t cursor_y;
+
+	gs_texture_t *patches[PATCH_SIZE_COUNT][PATCH_SIZE_COUNT];
 };
 
 /**
@@ -81,6 +136,21 @@ static inline void xshm_resize_texture(struct xshm_data *data)
 	data->texture = gs_texture_create(data->adj_width, data->adj_height, GS_BGRA, 1, NULL, GS_DYNAMIC);
 }
 
+/**
+ * Destroy the textures used to upload dirty areas
+ *
+ * @note requires to be called within the obs graphics context
+ */
+static void xshm_destroy_patches(struct xshm_data *data)
+{
+	for (size_t i = 0; i < PATCH_SIZE_COUNT; i++) {
+		for (size_t j = 0; j < PATCH_SIZE_COUNT; j++) {
+			gs_texture_destroy(data->patches[i][j]);
+			data->patches[i][j] = NULL;
+		}
+	}
+}
+
 /**
  * Check if the xserver supports all the extensions we need
  */
@@ -170,6 +240,274 @@ static int_fast32_t xshm_update_geometry(struct xshm_data *data)
 	return 1;
 }
 
+/**
+ * Start tracking damage on the root window
+ *
+ * Without the damage extension every frame is fetched in full.
+ *
+ * @note the xfixes version must have been queried already
+ */
+static void xshm_damage_init(struct xshm_data *data)
+{
+	const xcb_query_extension_reply_t *damage_ext = xcb_get_extension_data(data->xcb, &xcb_damage_id);
+	const xcb_query_extension_reply_t *xfixes_ext = xcb_get_extension_data(data->xcb, &xcb_xfixes_id);
+
+	if (!data->use_damage)
+		return;
+
+	if (!damage_ext || !damage_ext->present || !xfixes_ext || !xfixes_ext->present) {
+		blog(LOG_INFO, "Missing Damage extension, capturing full frames");
+		return;
+	}
+
+	xcb_damage_query_version_cookie_t ver_c =
+		xcb_damage_query_version_unchecked(data->xcb, XCB_DAMAGE_MAJOR_VERSION, XCB_DAMAGE_MINOR_VERSION);
+	free(xcb_damage_query_version_reply(data->xcb, ver_c, NULL));
+
+	data->damage_event = damage_ext->first_event + XCB_DAMAGE_NOTIFY;
+	data->damage = xcb_generate_id(data->xcb);
+	data->damage_region = xcb_generate_id(data->xcb);
+
+	xcb_damage_create(data->xcb, data->damage, data->xcb_screen->root, XCB_DAMAGE_REPORT_LEVEL_NON_EMPTY);
+	xcb_xfixes_create_region(data->xcb, data->damage_region, 0, NULL);
+	xcb_flush(data->xcb);
+
+	data->damage_full = true;
+}
+
+static void xshm_damage_free(struct xshm_data *data)
+{
+	if (data->damage) {
+		xcb_damage_destroy(data->xcb, data->damage);
+		xcb_xfixes_destroy_region(data->xcb, data->damage_region);
+		data->damage = 0;
+		data->damage_region = 0;
+	}
+}
+
+static inline void rect_union(struct xshm_rect *dst, const struct xshm_rect *src)
+{
+	int32_t x2 = MAX(dst->x + dst->w, src->x + src->w);
+	int32_t y2 = MAX(dst->y + dst->h, src->y + src->h);
+
+	dst->x = MIN(dst->x, src->x);
+	dst->y = MIN(dst->y, src->y);
+	dst->w = x2 - dst->x;
+	dst->h = y2 - dst->y;
+}
+
+/**
+ * Add a rectangle to a list, merging all of them once the list is full
+ */
+static void add_rect(struct xshm_rect *rects, size_t *count, const struct xshm_rect *rect)
+{
+	if (*count < MAX_DIRTY_RECTS) {
+		rects[(*count)++] = *rect;
+		return;
+	}
+
+	for (size_t i = 1; i < *count; i++)
+		rect_union(&rects[0], &rects[i]);
+	rect_union(&rects[0], rect);
+	*count = 1;
+}
+
+/**
+ * Get the areas of the capture that changed since the last call
+ *
+ * @return number of rectangles, relative to the capture
+ */
+static size_t xshm_get_damage(struct xshm_data *data, struct xshm_rect *rects)
+{
+	const struct xshm_rect full = {0, 0, data->adj_width, data->adj_height};
+	bool damaged = data->damage_full;
+	xcb_generic_event_t *event;
+	size_t count = 0;
+
+	while ((event = xcb_poll_for_event(data->xcb))) {
+		if ((event->response_type & ~0x80) == data->damage_event)
+			damaged = true;
+		free(event);
+	}
+
+	if (!damaged)
+		return 0;
+
+	/* move the accumulated damage into our region and reset it */
+	xcb_damage_subtract(data->xcb, data->damage, XCB_NONE, data->damage_region);
+
+	xcb_xfixes_fetch_region_cookie_t region_c = xcb_xfixes_fetch_region_unchecked(data->xcb, data->damage_region);
+	xcb_xfixes_fetch_region_reply_t *region_r = xcb_xfixes_fetch_region_reply(data->xcb, region_c, NULL);
+
+	if (!region_r || data->damage_full) {
+		data->damage_full = false;
+		free(region_r);
+		rects[0] = full;
+		return 1;
+	}
+
+	xcb_rectangle_t *damage = xcb_xfixes_fetch_region_rectangles(region_r);
+	int length = xcb_xfixes_fetch_region_rectangles_length(region_r);
+
+	for (int i = 0; i < length; i++) {
+		int32_t x1 = MAX(damage[i].x - (int32_t)data->adj_x_org, 0);
+		int32_t y1 = MAX(damage[i].y - (int32_t)data->adj_y_org, 0);
+		int32_t x2 = MIN(damage[i].x + damage[i].width - (int32_t)data->adj_x_org, (int32_t)data->adj_width);
+		int32_t y2 = MIN(damage[i].y + damage[i].height - (int32_t)data->adj_y_org, (int32_t)data->adj_height);
+
+		if (x2 <= x1 || y2 <= y1)
+			continue;
+
+		/* the rectangles must stay disjoint to fit in the shm segment,
+		 * so if there are too many only their bounds are fetched */
+		struct xshm_rect rect = {x1, y1, x2 - x1, y2 - y1};
+		if (length <= MAX_DIRTY_RECTS || !count)
+			rects[count++] = rect;
+		else
+			rect_union(&rects[0], &rect);
+	}
+
+	free(region_r);
+	return count;
+}
+
+/**
+ * Fetch the changed areas of the screen into the frame
+ *
+ * @note runs on the capture thread
+ */
+static void xshm_capture_frame(struct xshm_data *data)
+{
+	struct xshm_rect rects[MAX_DIRTY_RECTS];
+	xcb_shm_get_image_cookie_t cookies[MAX_DIRTY_RECTS];
+	xcb_xfixes_get_cursor_image_cookie_t cursor_c = {0};
+	xcb_xfixes_get_cursor_image_reply_t *cursor_r = NULL;
+	size_t count = 1;
+	uint32_t offset = 0;
+
+	if (data->show_cursor)
+		cursor_c = xcb_xfixes_get_cursor_image_unchecked(data->xcb);
+
+	if (data->damage) {
+		count = xshm_get_damage(data, rects);
+	} else {
+		rects[0] = (struct xshm_rect){0, 0, data->adj_width, data->adj_height};
+	}
+
+	/* the rectangles don't overlap, so they all fit in the segment */
+	for (size_t i = 0; i < count; i++) {
+		const struct xshm_rect *rect = &rects[i];
+
+		cookies[i] = xcb_shm_get_image_unchecked(data->xcb, data->xcb_screen->root, data->adj_x_org + rect->x,
+							 data->adj_y_org + rect->y, rect->w, rect->h, ~0,
+							 XCB_IMAGE_FORMAT_Z_PIXMAP, data->xshm->seg, offset);
+		offset += (uint32_t)rect->w * rect->h * 4;
+	}
+
+	if (data->show_cursor)
+		cursor_r = xcb_xfixes_get_cursor_image_reply(data->xcb, cursor_c, NULL);
+
+	offset = 0;
+
+	for (size_t i = 0; i < count; i++) {
+		const struct xshm_rect *rect = &rects[i];
+		const size_t linesize = (size_t)data->adj_width * 4;
+		const size_t rect_linesize = (size_t)rect->w * 4;
+		xcb_shm_get_image_reply_t *img_r = xcb_shm_get_image_reply(data->xcb, cookies[i], NULL);
+
+		if (img_r) {
+			const uint8_t *src = data->xshm->data + offset;
+			uint8_t *dst = data->frame + rect->y * linesize + rect->x * 4;
+
+			pthread_mutex_lock(&data->frame_mutex);
+			for (int32_t y = 0; y < rect->h; y++)
+				memcpy(dst + y * linesize, src + y * rect_linesize, rect_linesize);
+			add_rect(data->dirty, &data->dirty_count, rect);
+			pthread_mutex_unlock(&data->frame_mutex);
+		}
+
+		offset += (uint32_t)rect_linesize * rect->h;
+		free(img_r);
+	}
+
+	/* only pass on cursor changes, so unchanged frames need no upload */
+	if (cursor_r && cursor_r->cursor_serial == data->cursor_serial && cursor_r->x == data->cursor_x &&
+	    cursor_r->y == data->cursor_y) {
+		free(cursor_r);
+		cursor_r = NULL;
+	}
+
+	if (cursor_r) {
+		data->cursor_serial = cursor_r->cursor_serial;
+		data->cursor_x = cursor_r->x;
+		data->cursor_y = cursor_r->y;
+
+		pthread_mutex_lock(&data->frame_mutex);
+		free(data->cursor_image);
+		data->cursor_image = cursor_r;
+		pthread_mutex_unlock(&data->frame_mutex);
+	}
+}
+
+static void *xshm_capture_thread(void *vptr)
+{
+	XSHM_DATA(vptr);
+
+	os_set_thread_name("xshm-input: capture");
+
+	while (os_event_wait(data->capture_event) == 0) {
+		if (os_atomic_load_bool(&data->capture_stop))
+			break;
+
+		xshm_capture_frame(data);
+	}
+
+	return NULL;
+}
+
+/**
+ * Upload a dirty area of the frame to the texture
+ *
+ * Small areas are uploaded to the smallest patch texture they fit in, which
+ * is then copied into the texture on the GPU.
+ *
+ * @return true if the whole frame was uploaded instead
+ * @note requires to be called within the obs graphics context
+ */
+static bool xshm_upload_rect(struct xshm_data *data, const struct xshm_rect *rect)
+{
+	const uint32_t linesize = data->adj_width * 4;
+	size_t i = 0;
+	size_t j = 0;
+
+	while (i < PATCH_SIZE_COUNT && (PATCH_SIZE_MIN << i) < rect->w)
+		i++;
+	while (j < PATCH_SIZE_COUNT && (PATCH_SIZE_MIN << j) < rect->h)
+		j++;
+
+	uint32_t patch_w = PATCH_SIZE_MIN << i;
+	uint32_t patch_h = PATCH_SIZE_MIN << j;
+
+	if (i == PATCH_SIZE_COUNT || j == PATCH_SIZE_COUNT || patch_w > (uint32_t)data->adj_width ||
+	    patch_h > (uint32_t)data->adj_height ||
+	    (uint64_t)patch_w * patch_h * 2 > (uint64_t)data->adj_width * data->adj_height) {
+		gs_texture_set_image(data->texture, data->frame, linesize, false);
+		return true;
+	}
+
+	if (!data->patches[i][j])
+		data->patches[i][j] = gs_texture_create(patch_w, patch_h, GS_BGRA, 1, NULL, GS_DYNAMIC);
+
+	/* keep the patch inside of the frame, the extra pixels it covers
+	 * are just as current */
+	uint32_t x = MIN((uint32_t)rect->x, data->adj_width - patch_w);
+	uint32_t y = MIN((uint32_t)rect->y, data->adj_height - patch_h);
+
+	gs_texture_set_image(data->patches[i][j], data->frame + y * linesize + x * 4, linesize, false);
+	gs_copy_texture_region(data->texture, x, y, data->patches[i][j], 0, 0, patch_w, patch_h);
+	return false;
+}
+
 /**
  * Returns the name of the plugin
  */
@@ -184,8 +522,16 @@ static const char *xshm_getname(void *unused)
  */
 static void xshm_capture_stop(struct xshm_data *data)
 {
+	if (data->capture_thread_active) {
+		os_atomic_set_bool(&data->capture_stop, true);
+		os_event_signal(data->capture_event);
+		pthread_join(data->capture_thread, NULL);
+		data->capture_thread_active = false;
+	}
+
 	obs_enter_graphics();
 
+	xshm_destroy_patches(data);
 	if (data->texture) {
 		gs_texture_destroy(data->texture);
 		data->texture = NULL;
@@ -203,10 +549,18 @@ static void xshm_capture_stop(struct xshm_data *data)
 	}
 
 	if (data->xcb) {
+		xshm_damage_free(data);
 		xcb_disconnect(data->xcb);
 		data->xcb = NULL;
 	}
 
+	bfree(data->frame);
+	data->frame = NULL;
+	data->dirty_count = 0;
+
+	free(data->cursor_image);
+	data->cursor_image = NULL;
+
 	if (data->server) {
 		bfree(data->server);
 		data->server = NULL;
@@ -256,12 +610,25 @@ static void xshm_capture_start(struct xshm_data *data)
 	data->cursor = xcb_xcursor_init(data->xcb);
 	xcb_xcursor_offset(data->cursor, data->adj_x_org, data->adj_y_org);
 
+	xshm_damage_init(data);
+
+	data->frame = bzalloc((size_t)data->adj_width * data->adj_height * 4);
+
 	obs_enter_graphics();
 
 	xshm_resize_texture(data);
 
 	obs_leave_graphics();
 
+	data->cursor_serial = 0;
+	data->cursor_x = INT16_MIN;
+	os_atomic_set_bool(&data->capture_stop, false);
+	if (pthread_create(&data->capture_thread, NULL, xshm_capture_thread, data) != 0) {
+		blog(LOG_ERROR, "failed to create capture thread !");
+		goto fail;
+	}
+	data->capture_thread_active = true;
+
 	return;
 fail:
 	xshm_capture_stop(data);
@@ -285,6 +652,7 @@ static void xshm_update(void *vptr, obs_data_t *settings)
 	data->cut_left = obs_data_get_int(settings, "cut_left");
 	data->cut_right = obs_data_get_int(settings, "cut_right");
 	data->cut_bot = obs_data_get_int(settings, "cut_bot");
+	data->use_damage = obs_data_get_bool(settings, "use_damage");
 
 	xshm_capture_start(data);
 }
@@ -301,6 +669,7 @@ static void xshm_defaults(obs_data_t *defaults, int ver)
 	obs_data_set_default_int(defaults, "cut_left", 0);
 	obs_data_set_default_int(defaults, "cut_right", 0);
 	obs_data_set_default_int(defaults, "cut_bot", 0);
+	obs_data_set_default_bool(defaults, "use_damage", true);
 }
 
 static void xshm_defaults_v1(obs_data_t *defaults)
@@ -465,6 +834,8 @@ static void xshm_destroy(void *vptr)
 
 	xshm_capture_stop(data);
 
+	pthread_mutex_destroy(&data->frame_mutex);
+	os_event_destroy(data->capture_event);
 	bfree(data);
 }
 
@@ -476,6 +847,14 @@ static void *xshm_create(obs_data_t *settings, obs_source_t *source)
 	struct xshm_data *data = bzalloc(sizeof(struct xshm_data));
 	data->source = source;
 
+	if (os_event_init(&data->capture_event, OS_EVENT_TYPE_AUTO) != 0 ||
+	    pthread_mutex_init(&data->frame_mutex, NULL) != 0) {
+		blog(LOG_ERROR, "failed to create capture event !");
+		os_event_destroy(data->capture_event);
+		bfree(data);
+		return NULL;
+	}
+
 	xshm_update(data, settings);
 
 	return data;
@@ -494,27 +873,40 @@ static void xshm_video_tick(void *vptr, float seconds)
 	if (!obs_source_showing(data->source))
 		return;
 
-	xcb_shm_get_image_cookie_t img_c;
-	xcb_shm_get_image_reply_t *img_r;
-
-	img_c = xcb_shm_get_image_unchecked(data->xcb, data->xcb_screen->root, data->adj_x_org, data->adj_y_org,
-					    data->adj_width, data->adj_height, ~0, XCB_IMAGE_FORMAT_Z_PIXMAP,
-					    data->xshm->seg, 0);
-
-	img_r = xcb_shm_get_image_reply(data->xcb, img_c, NULL);
-
-	if (!img_r)
-		goto exit;
-
-	obs_enter_graphics();
+	struct xshm_rect dirty[MAX_DIRTY_RECTS];
+	xcb_xfixes_get_cursor_image_reply_t *cursor_image;
+	size_t dirty_count;
+
+	/* take the changes over, so that the capture thread isn't blocked
+	 * while they're uploaded */
+	pthread_mutex_lock(&data->frame_mutex);
+	dirty_count = data->dirty_count;
+	memcpy(dirty, data->dirty, dirty_count * sizeof(dirty[0]));
+	cursor_image = data->cursor_image;
+	data->dirty_count = 0;
+	data->cursor_image = NULL;
+	pthread_mutex_unlock(&data->frame_mutex);
+
+	if (dirty_count || cursor_image) {
+		obs_enter_graphics();
+
+		for (size_t i = 0; i < dirty_count; i++) {
+			if (xshm_upload_rect(data, &dirty[i]))
+				break;
+		}
+		if (cursor_image)
+			xcb_xcursor_update_from_reply(data->cursor, cursor_image);
 
-	gs_texture_set_image(data->texture, (void *)data->xshm->data, data->adj_width * 4, false);
-	xcb_xcursor_update(data->xcb, data->cursor);
+		obs_leave_graphics();
 
-	obs_leave_graphics();
+		free(cursor_image);
+	}
 
-exit:
-	free(img_r);
+	/* signaled only now, so that the capture thread normally doesn't
+	 * write to the frame during the upload above.  If a slow capture
+	 * does, the area it writes is dirty again and uploaded on the next
+	 * tick, along with what it fetches now. */
+	os_event_signal(data->capture_event);
 }
 
 /**
@@ -0,0 +1,355 @@
+/*
+ * Copyright (c) 2023 Lain Bailey <lain@obsproject.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+/*
+ * Shared memory transport between obs-ffmpeg and the ffmpeg-mux helper.
+ *
+ * The output creates a memfd before starting the helper, which inherits it,
+ * and offers it with an FFM_PACKET_SHM_OFFER packet once the headers have
+ * been sent.  The helper maps it and accepts (or declines) through the
+ * state field, while still reading the pipe.  When the output notices the
+ * ring was accepted it sends FFM_PACKET_SHM_SWITCH, and everything after
+ * that, in the same format as on the pipe, goes through the ring.  If the
+ * ring is never accepted the pipe keeps being used.
+ *
+ * The ring is a single producer, single consumer byte stream.  Each side
+ * only waits on a futex when the ring is full or empty, so there are no
+ * system calls in the steady state.
+ */
+
+#ifdef __linux__
+#define FFM_SHM_SUPPORTED 1
+
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <linux/memfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#define FFM_SHM_MAGIC 0x4d484646 /* "FFHM" */
+#define FFM_SHM_VERSION 1
+#define FFM_SHM_DEFAULT_SIZE (32 * 1024 * 1024)
+#define FFM_SHM_HEADER_SIZE 4096
+#define FFM_SHM_WAIT_MS 100
+
+enum ffm_shm_state {
+	FFM_SHM_OFFERED,
+	FFM_SHM_ACCEPTED,
+	FFM_SHM_DECLINED,
+	FFM_SHM_CLOSED,
+};
+
+/* payload of FFM_PACKET_SHM_OFFER */
+struct ffm_shm_offer {
+	int32_t fd;
+	uint32_t version;
+	uint64_t size;
+};
+
+/* head and tail are kept on their own cache lines so the two processes
+ * don't bounce a line between them on every packet */
+struct ffm_shm_header {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t capacity;
+	uint32_t state;
+	int32_t consumer_pid;
+	uint8_t pad0[40];
+
+	/* written by the producer */
+	uint64_t head;
+	uint32_t head_seq;
+	uint32_t consumer_waiting;
+	uint8_t pad1[48];
+
+	/* written by the consumer */
+	uint64_t tail;
+	uint32_t tail_seq;
+	uint32_t producer_waiting;
+	uint8_t pad2[48];
+};
+
+struct ffm_shm {
+	struct ffm_shm_header *header;
+	uint8_t *data;
+	uint64_t capacity;
+	size_t map_size;
+	int fd;
+	bool producer;
+
+	/* producer: pidfd of the consumer, consumer: pid of the producer */
+	int peer;
+};
+
+static inline void ffm_shm_futex_wait(uint32_t *addr, uint32_t val)
+{
+	struct timespec ts = {.tv_sec = 0, .tv_nsec = FFM_SHM_WAIT_MS * 1000000L};
+	syscall(SYS_futex, addr, FUTEX_WAIT, val, &ts, NULL, 0);
+}
+
+static inline void ffm_shm_futex_wake(uint32_t *addr)
+{
+	syscall(SYS_futex, addr, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+static inline void ffm_shm_set_state(struct ffm_shm *shm, enum ffm_shm_state state)
+{
+	__atomic_store_n(&shm->header->state, (uint32_t)state, __ATOMIC_SEQ_CST);
+
+	/* wake both sides, either may be waiting for the other */
+	__atomic_add_fetch(&shm->header->head_seq, 1, __ATOMIC_SEQ_CST);
+	__atomic_add_fetch(&shm->header->tail_seq, 1, __ATOMIC_SEQ_CST);
+	ffm_shm_futex_wake(&shm->header->head_seq);
+	ffm_shm_futex_wake(&shm->header->tail_seq);
+}
+
+static inline enum ffm_shm_state ffm_shm_get_state(const struct ffm_shm *shm)
+{
+	return (enum ffm_shm_state)__atomic_load_n(&shm->header->state, __ATOMIC_ACQUIRE);
+}
+
+static inline bool ffm_shm_map(struct ffm_shm *shm, int fd, uint64_t size)
+{
+	void *map = mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED)
+		return false;
+
+	shm->header = map;
+	shm->data = (uint8_t *)map + FFM_SHM_HEADER_SIZE;
+	shm->capacity = size - FFM_SHM_HEADER_SIZE;
+	shm->map_size = (size_t)size;
+	shm->fd = fd;
+	return true;
+}
+
+/* Producer side.  size is the capacity of the ring, and has to be a power
+ * of two.  The fd is close-on-exec, the helper has to be started with
+ * os_process_args_inherit_fd to inherit it. */
+static inline bool ffm_shm_create(struct ffm_shm *shm, uint64_t size)
+{
+	memset(shm, 0, sizeof(*shm));
+	shm->fd = -1;
+	shm->peer = -1;
+	shm->producer = true;
+
+	int fd = (int)syscall(SYS_memfd_create, "obs-ffmpeg-mux", MFD_CLOEXEC);
+	if (fd == -1)
+		return false;
+
+	uint64_t map_size = size + FFM_SHM_HEADER_SIZE;
+	if (ftruncate(fd, (off_t)map_size) != 0 || !ffm_shm_map(shm, fd, map_size)) {
+		close(fd);
+		shm->fd = -1;
+		return false;
+	}
+
+	shm->header->magic = FFM_SHM_MAGIC;
+	shm->header->version = FFM_SHM_VERSION;
+	shm->header->capacity = size;
+	shm->header->state = FFM_SHM_OFFERED;
+	return true;
+}
+
+static inline void ffm_shm_get_offer(const struct ffm_shm *shm, struct ffm_shm_offer *offer)
+{
+	offer->fd = shm->fd;
+	offer->version = FFM_SHM_VERSION;
+	offer->size = shm->map_size;
+}
+
+/* Producer side, called once the consumer has accepted the ring.  Returns
+ * false if the consumer can't be watched, in which case the ring shouldn't
+ * be used. */
+static inline bool ffm_shm_watch_consumer(struct ffm_shm *shm)
+{
+#ifdef SYS_pidfd_open
+	pid_t pid = (pid_t)__atomic_load_n(&shm->header->consumer_pid, __ATOMIC_ACQUIRE);
+	if (pid > 0)
+		shm->peer = (int)syscall(SYS_pidfd_open, pid, 0);
+#endif
+	return shm->peer != -1;
+}
+
+/* Consumer side, maps the ring and accepts it if it's valid.  The ring has
+ * to be freed even if this fails. */
+static inline bool ffm_shm_accept(struct ffm_shm *shm, const struct ffm_shm_offer *offer)
+{
+	struct stat st;
+
+	memset(shm, 0, sizeof(*shm));
+	shm->fd = offer->fd;
+	shm->peer = (int)getppid();
+
+	if (offer->version != FFM_SHM_VERSION || offer->size <= FFM_SHM_HEADER_SIZE)
+		return false;
+	if (fstat(offer->fd, &st) != 0 || (uint64_t)st.st_size != offer->size)
+		return false;
+	if (!ffm_shm_map(shm, offer->fd, offer->size))
+		return false;
+
+	struct ffm_shm_header *header = shm->header;
+	uint64_t capacity = shm->capacity;
+
+	if (header->magic != FFM_SHM_MAGIC || header->capacity != capacity || (capacity & (capacity - 1)) != 0) {
+		ffm_shm_set_state(shm, FFM_SHM_DECLINED);
+		return false;
+	}
+
+	__atomic_store_n(&header->consumer_pid, (int32_t)getpid(), __ATOMIC_RELEASE);
+	ffm_shm_set_state(shm, FFM_SHM_ACCEPTED);
+	return true;
+}
+
+static inline bool ffm_shm_peer_alive(const struct ffm_shm *shm)
+{
+	if (shm->producer) {
+		struct pollfd pfd = {.fd = shm->peer, .events = POLLIN};
+		return poll(&pfd, 1, 0) == 0;
+	}
+
+	/* reparented if the producer exited */
+	return getppid() == (pid_t)shm->peer;
+}
+
+/* Producer side, blocks until all of the data is in the ring.  Returns
+ * false if the consumer has gone away. */
+static inline bool ffm_shm_write(struct ffm_shm *shm, const void *vdata, size_t size)
+{
+	struct ffm_shm_header *header = shm->header;
+	const uint8_t *data = vdata;
+	const uint64_t mask = shm->capacity - 1;
+	uint64_t head = header->head;
+
+	while (size > 0) {
+		uint64_t tail = __atomic_load_n(&header->tail, __ATOMIC_ACQUIRE);
+		uint64_t space = shm->capacity - (head - tail);
+
+		if (!space) {
+			uint32_t seq = __atomic_load_n(&header->tail_seq, __ATOMIC_SEQ_CST);
+
+			__atomic_store_n(&header->producer_waiting, 1, __ATOMIC_SEQ_CST);
+			if (__atomic_load_n(&header->tail, __ATOMIC_SEQ_CST) == tail)
+				ffm_shm_futex_wait(&header->tail_seq, seq);
+			__atomic_store_n(&header->producer_waiting, 0, __ATOMIC_RELAXED);
+
+			if (ffm_shm_get_state(shm) != FFM_SHM_ACCEPTED || !ffm_shm_peer_alive(shm))
+				return false;
+			continue;
+		}
+
+		size_t count = space < size ? (size_t)space : size;
+		size_t offset = (size_t)(head & mask);
+		size_t first = count < shm->capacity - offset ? count : (size_t)(shm->capacity - offset);
+
+		memcpy(shm->data + offset, data, first);
+		memcpy(shm->data, data + first, count - first);
+
+		head += count;
+		data += count;
+		size -= count;
+
+		__atomic_store_n(&header->head, head, __ATOMIC_SEQ_CST);
+		if (__atomic_load_n(&header->consumer_waiting, __ATOMIC_SEQ_CST)) {
+			__atomic_add_fetch(&header->head_seq, 1, __ATOMIC_SEQ_CST);
+			ffm_shm_futex_wake(&header->head_seq);
+		}
+	}
+
+	return true;
+}
+
+/* Consumer side, blocks until size bytes have been read.  Returns 0 once
+ * the producer has closed the ring and everything in it has been read, or
+ * if the producer has gone away. */
+static inline size_t ffm_shm_read(struct ffm_shm *shm, void *vdata, size_t size)
+{
+	struct ffm_shm_header *header = shm->header;
+	uint8_t *data = vdata;
+	const uint64_t mask = shm->capacity - 1;
+	uint64_t tail = header->tail;
+	size_t total = size;
+
+	while (size > 0) {
+		uint64_t head = __atomic_load_n(&header->head, __ATOMIC_ACQUIRE);
+		uint64_t avail = head - tail;
+
+		if (!avail) {
+			if (ffm_shm_get_state(shm) == FFM_SHM_CLOSED)
+				return 0;
+
+			uint32_t seq = __atomic_load_n(&header->head_seq, __ATOMIC_SEQ_CST);
+
+			__atomic_store_n(&header->consumer_waiting, 1, __ATOMIC_SEQ_CST);
+			if (__atomic_load_n(&header->head, __ATOMIC_SEQ_CST) == head)
+				ffm_shm_futex_wait(&header->head_seq, seq);
+			__atomic_store_n(&header->consumer_waiting, 0, __ATOMIC_RELAXED);
+
+			if (!ffm_shm_peer_alive(shm))
+				return 0;
+			continue;
+		}
+
+		size_t count = avail < size ? (size_t)avail : size;
+		size_t offset = (size_t)(tail & mask);
+		size_t first = count < shm->capacity - offset ? count : (size_t)(shm->capacity - offset);
+
+		memcpy(data, shm->data + offset, first);
+		memcpy(data + first, shm->data, count - first);
+
+		tail += count;
+		data += count;
+		size -= count;
+
+		__atomic_store_n(&header->tail, tail, __ATOMIC_SEQ_CST);
+		if (__atomic_load_n(&header->producer_waiting, __ATOMIC_SEQ_CST)) {
+			__atomic_add_fetch(&header->tail_seq, 1, __ATOMIC_SEQ_CST);
+			ffm_shm_futex_wake(&header->tail_seq);
+		}
+	}
+
+	return total;
+}
+
+/* Producer side, tells the consumer there's nothing more to read */
+static inline void ffm_shm_close(struct ffm_shm *shm)
+{
+	if (shm->header)
+		ffm_shm_set_state(shm, FFM_SHM_CLOSED);
+}
+
+static inline void ffm_shm_free(struct ffm_shm *shm)
+{
+	if (shm->header)
+		munmap(shm->header, shm->map_size);
+	if (shm->fd != -1)
+		close(shm->fd);
+	if (shm->producer && shm->peer != -1)
+		close(shm->peer);
+
+	memset(shm, 0, sizeof(*shm));
+	shm->fd = -1;
+	shm->peer = -1;
+}
+
+#endif
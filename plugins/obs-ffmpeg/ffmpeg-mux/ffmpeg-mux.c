@@ -22,9 +22,11 @@
 
 #endif
 
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include "ffmpeg-mux.h"
+#include "ffmpeg-mux-shm.h"
 
 #include <util/threading.h>
 #include <util/platform.h>
@@ -45,6 +47,11 @@
 
 static char *global_stream_key = "";
 
+#ifdef FFM_SHM_SUPPORTED
+static struct ffm_shm global_shm = {.fd = -1, .peer = -1};
+static bool global_shm_active = false;
+#endif
+
 struct resize_buf {
 	uint8_t *buf;
 	size_t size;
@@ -606,6 +613,11 @@ static size_t safe_read(void *vdata, size_t size)
 	uint8_t *data = vdata;
 	size_t total = size;
 
+#ifdef FFM_SHM_SUPPORTED
+	if (global_shm_active)
+		return ffm_shm_read(&global_shm, vdata, size);
+#endif
+
 	while (size > 0) {
 		size_t in_size = fread(data, 1, size, stdin);
 		if (in_size == 0)
@@ -1133,6 +1145,191 @@ static inline bool read_change_file(struct ffmpeg_mux *ffm, uint32_t size, struc
 	return true;
 }
 
+static inline bool read_shm_offer(uint32_t size, struct resize_buf *rb)
+{
+	resize_buf_resize(rb, size);
+	if (safe_read(rb->buf, size) != size)
+		return false;
+
+#ifdef FFM_SHM_SUPPORTED
+	struct ffm_shm_offer offer;
+
+	if (size != sizeof(offer))
+		return true;
+
+	memcpy(&offer, rb->buf, sizeof(offer));
+
+	/* on failure the output keeps using the pipe */
+	if (!ffm_shm_accept(&global_shm, &offer)) {
+		fprintf(stderr, "warning: Could not map shared memory ring, using pipe\n");
+		ffm_shm_free(&global_shm);
+	}
+#endif
+	return true;
+}
+
+static inline bool switch_to_shm(void)
+{
+#ifdef FFM_SHM_SUPPORTED
+	if (global_shm.header) {
+#ifdef ENABLE_FFMPEG_MUX_DEBUG
+		fprintf(stderr, "info: Reading packets from shared memory\n");
+#endif
+		global_shm_active = true;
+		return true;
+	}
+#endif
+	/* never sent unless the ring was accepted */
+	return false;
+}
+
+/* ------------------------------------------------------------------------- */
+
+#ifdef FFM_SHM_SUPPORTED
+#define BENCHMARK_DEFAULT_MB 4096
+#define BENCHMARK_DEFAULT_PACKET_KB 256
+
+struct benchmark {
+	struct ffm_shm shm;
+	int pipe_fd;
+	uint8_t *packet;
+	size_t packet_size;
+	uint64_t packets;
+};
+
+static bool benchmark_write(struct benchmark *bm, const void *vdata, size_t size)
+{
+	const uint8_t *data = vdata;
+
+	if (bm->pipe_fd == -1)
+		return ffm_shm_write(&bm->shm, data, size);
+
+	while (size > 0) {
+		ssize_t ret = write(bm->pipe_fd, data, size);
+		if (ret <= 0)
+			return false;
+
+		size -= (size_t)ret;
+		data += ret;
+	}
+
+	return true;
+}
+
+static void *benchmark_writer_thread(void *data)
+{
+	struct benchmark *bm = data;
+	struct ffm_packet_info info = {.size = (uint32_t)bm->packet_size, .type = FFM_PACKET_VIDEO};
+
+	for (uint64_t i = 0; i < bm->packets; i++) {
+		info.pts = info.dts = (int64_t)i;
+		info.keyframe = (i % 120) == 0;
+
+		if (!benchmark_write(bm, &info, sizeof(info)) || !benchmark_write(bm, bm->packet, bm->packet_size))
+			break;
+	}
+
+	if (bm->pipe_fd == -1) {
+		ffm_shm_close(&bm->shm);
+	} else {
+		close(bm->pipe_fd);
+	}
+	return NULL;
+}
+
+/* reads packets the same way the main loop does, through safe_read */
+static bool benchmark_run(struct benchmark *bm, const char *name)
+{
+	struct ffm_packet_info info = {0};
+	struct resize_buf rb = {0};
+	uint64_t packets = 0;
+	pthread_t thread;
+
+	uint64_t start = os_gettime_ns();
+
+	if (pthread_create(&thread, NULL, benchmark_writer_thread, bm) != 0)
+		return false;
+
+	while (safe_read(&info, sizeof(info)) == sizeof(info)) {
+		resize_buf_resize(&rb, info.size);
+		if (safe_read(rb.buf, info.size) != info.size)
+			break;
+		packets++;
+	}
+
+	pthread_join(thread, NULL);
+
+	double sec = (double)(os_gettime_ns() - start) / 1000000000.0;
+	double mib = (double)(packets * (bm->packet_size + sizeof(info))) / (1024.0 * 1024.0);
+
+	printf("%-6s %8" PRIu64 " packets of %zu KiB: %8.1f MiB/s, %6.2f us per packet\n", name, packets,
+	       bm->packet_size / 1024, mib / sec, sec * 1000000.0 / (double)packets);
+
+	resize_buf_free(&rb);
+	return packets == bm->packets;
+}
+
+/* obs-ffmpeg-mux --benchmark [total MiB] [packet KiB]
+ *
+ * Measures the throughput of the shared memory ring against the pipe, with
+ * the writer on another thread standing in for obs-ffmpeg. */
+static int ffmpeg_mux_benchmark(int argc, char *argv[])
+{
+	struct benchmark bm = {.pipe_fd = -1};
+	uint64_t total_mb = argc > 0 ? strtoull(argv[0], NULL, 10) : BENCHMARK_DEFAULT_MB;
+	size_t packet_kb = argc > 1 ? (size_t)strtoul(argv[1], NULL, 10) : BENCHMARK_DEFAULT_PACKET_KB;
+	bool success = true;
+
+	if (!total_mb || !packet_kb) {
+		fprintf(stderr, "usage: obs-ffmpeg-mux --benchmark [total MiB] [packet KiB]\n");
+		return 1;
+	}
+
+	bm.packet_size = packet_kb * 1024;
+	bm.packets = total_mb * 1024 / packet_kb;
+	bm.packet = malloc(bm.packet_size);
+	for (size_t i = 0; i < bm.packet_size; i++)
+		bm.packet[i] = (uint8_t)i;
+
+	/* shared memory, both ends in this process */
+	struct ffm_shm_offer offer;
+
+	if (!ffm_shm_create(&bm.shm, FFM_SHM_DEFAULT_SIZE)) {
+		fprintf(stderr, "Could not create shared memory ring\n");
+		free(bm.packet);
+		return 1;
+	}
+
+	ffm_shm_get_offer(&bm.shm, &offer);
+	offer.fd = dup(offer.fd);
+
+	if (ffm_shm_accept(&global_shm, &offer) && ffm_shm_watch_consumer(&bm.shm)) {
+		global_shm_active = true;
+		success = benchmark_run(&bm, "shm");
+		global_shm_active = false;
+	} else {
+		fprintf(stderr, "Could not map shared memory ring\n");
+		success = false;
+	}
+
+	ffm_shm_free(&global_shm);
+	ffm_shm_free(&bm.shm);
+
+	/* pipe, read through stdin like the main loop */
+	int fds[2];
+
+	if (success && pipe(fds) == 0) {
+		dup2(fds[0], STDIN_FILENO);
+		close(fds[0]);
+		bm.pipe_fd = fds[1];
+		success = benchmark_run(&bm, "pipe");
+	}
+
+	free(bm.packet);
+	return success ? 0 : 1;
+}
+#endif
+
 /* ------------------------------------------------------------------------- */
 
 #ifdef _WIN32
@@ -1168,6 +1365,15 @@ int main(int argc, char *argv[])
 #endif
 	setvbuf(stderr, NULL, _IONBF, 0);
 
+	if (argc > 1 && strcmp(argv[1], "--benchmark") == 0) {
+#ifdef FFM_SHM_SUPPORTED
+		return ffmpeg_mux_benchmark(argc - 2, argv + 2);
+#else
+		fprintf(stderr, "Shared memory transport is not supported on this platform\n");
+		return 1;
+#endif
+	}
+
 	ret = ffmpeg_mux_init(&ffm, argc, argv);
 	if (ret != FFM_SUCCESS) {
 		fprintf(stderr, "Couldn't initialize muxer\n");
@@ -1178,6 +1384,12 @@ int main(int argc, char *argv[])
 		if (info.type == FFM_PACKET_CHANGE_FILE) {
 			fail = !read_change_file(&ffm, info.size, &rb_filename, argc, argv);
 			continue;
+		} else if (info.type == FFM_PACKET_SHM_OFFER) {
+			fail = !read_shm_offer(info.size, &rb);
+			continue;
+		} else if (info.type == FFM_PACKET_SHM_SWITCH) {
+			fail = !switch_to_shm();
+			continue;
 		}
 
 		resize_buf_resize(&rb, info.size);
@@ -1192,6 +1404,9 @@ int main(int argc, char *argv[])
 	ffmpeg_mux_free(&ffm);
 	resize_buf_free(&rb);
 	resize_buf_free(&rb_filename);
+#ifdef FFM_SHM_SUPPORTED
+	ffm_shm_free(&global_shm);
+#endif
 
 #ifdef _WIN32
 	for (int i = 0; i < argc; i++)
@@ -23,6 +23,8 @@ enum ffm_packet_type {
 	FFM_PACKET_VIDEO,
 	FFM_PACKET_AUDIO,
 	FFM_PACKET_CHANGE_FILE,
+	FFM_PACKET_SHM_OFFER,
+	FFM_PACKET_SHM_SWITCH,
 };
 
 #define FFM_SUCCESS 0
@@ -24,6 +24,8 @@
 
 #include <libavformat/avformat.h>
 
+#include <inttypes.h>
+
 #define do_log(level, format, ...) \
 	blog(level, "[ffmpeg muxer: '%s'] " format, obs_output_get_name(stream->output), ##__VA_ARGS__)
 
@@ -52,6 +54,9 @@ static inline void replay_buffer_clear(struct ffmpeg_muxer *stream)
 		obs_encoder_packet_release(&pkt);
 	}
 
+	if (stream->ring)
+		replay_ring_clear(stream->ring);
+
 	deque_free(&stream->packets);
 	stream->cur_size = 0;
 	stream->cur_time = 0;
@@ -72,8 +77,9 @@ static void ffmpeg_mux_destroy(void *data)
 		obs_encoder_packet_release(&stream->mux_packets.array[i]);
 	da_free(stream->mux_packets);
 	deque_free(&stream->packets);
+	replay_ring_destroy(stream->ring);
 
-	os_process_pipe_destroy(stream->pipe);
+	close_pipe(stream);
 	dstr_free(&stream->path);
 	dstr_free(&stream->printable_path);
 	dstr_free(&stream->stream_key);
@@ -303,14 +309,58 @@ static void build_command_line(struct ffmpeg_muxer *stream, os_process_args_t **
 	add_muxer_params(*args, stream);
 }
 
+#ifdef FFM_SHM_SUPPORTED
+static void create_shm(struct ffmpeg_muxer *stream)
+{
+	obs_data_t *settings = obs_output_get_settings(stream->output);
+	bool disabled = obs_data_get_bool(settings, "disable_shm_transport");
+	obs_data_release(settings);
+
+	if (stream->shm.header)
+		ffm_shm_free(&stream->shm);
+	stream->shm_offered = false;
+	stream->shm_active = false;
+
+	if (!disabled && !ffm_shm_create(&stream->shm, FFM_SHM_DEFAULT_SIZE))
+		warn("Failed to create shared memory ring, using pipe");
+}
+#endif
+
 void start_pipe(struct ffmpeg_muxer *stream, const char *path)
 {
 	os_process_args_t *args = NULL;
 	build_command_line(stream, &args, path);
+
+#ifdef FFM_SHM_SUPPORTED
+	/* the ring stays close-on-exec, only the helper inherits it */
+	create_shm(stream);
+	if (stream->shm.header)
+		os_process_args_inherit_fd(args, stream->shm.fd);
+#endif
+
 	stream->pipe = os_process_pipe_create2(args, "w");
 	os_process_args_destroy(args);
 }
 
+int close_pipe(struct ffmpeg_muxer *stream)
+{
+#ifdef FFM_SHM_SUPPORTED
+	if (stream->shm_active)
+		ffm_shm_close(&stream->shm);
+#endif
+
+	int ret = os_process_pipe_destroy(stream->pipe);
+	stream->pipe = NULL;
+
+#ifdef FFM_SHM_SUPPORTED
+	if (stream->shm.header)
+		ffm_shm_free(&stream->shm);
+	stream->shm_offered = false;
+	stream->shm_active = false;
+#endif
+	return ret;
+}
+
 static void set_file_not_readable_error(struct ffmpeg_muxer *stream, obs_data_t *settings, const char *path)
 {
 	struct dstr error_message;
@@ -467,8 +517,7 @@ int deactivate(struct ffmpeg_muxer *stream, int code)
 	}
 
 	if (active(stream)) {
-		ret = os_process_pipe_destroy(stream->pipe);
-		stream->pipe = NULL;
+		ret = close_pipe(stream);
 
 		os_atomic_set_bool(&stream->active, false);
 		os_atomic_set_bool(&stream->sent_headers, false);
@@ -601,10 +650,75 @@ static void generate_filename(struct ffmpeg_muxer *stream, struct dstr *dst, boo
 	obs_data_release(settings);
 }
 
+static bool write_helper(struct ffmpeg_muxer *stream, const void *data, size_t size)
+{
+#ifdef FFM_SHM_SUPPORTED
+	if (stream->shm_active)
+		return ffm_shm_write(&stream->shm, data, size);
+#endif
+	return os_process_pipe_write(stream->pipe, data, size) == size;
+}
+
+static bool send_message(struct ffmpeg_muxer *stream, const struct ffm_packet_info *info, const void *data)
+{
+	if (!write_helper(stream, info, sizeof(*info))) {
+		warn("Writing info structure to ffmpeg-mux failed");
+		signal_failure(stream);
+		return false;
+	}
+
+	if (info->size && !write_helper(stream, data, info->size)) {
+		warn("Writing packet data to ffmpeg-mux failed");
+		signal_failure(stream);
+		return false;
+	}
+
+	return true;
+}
+
+#ifdef FFM_SHM_SUPPORTED
+static bool offer_shm(struct ffmpeg_muxer *stream)
+{
+	struct ffm_shm_offer offer;
+	struct ffm_packet_info info = {.type = FFM_PACKET_SHM_OFFER, .size = sizeof(offer)};
+
+	ffm_shm_get_offer(&stream->shm, &offer);
+	stream->shm_offered = true;
+	return send_message(stream, &info, &offer);
+}
+
+/* switches to the ring once the helper has accepted it, without waiting for
+ * it, so packets keep going through the pipe until then */
+static bool update_transport(struct ffmpeg_muxer *stream)
+{
+	if (!stream->shm_offered || stream->shm_active)
+		return true;
+
+	enum ffm_shm_state state = ffm_shm_get_state(&stream->shm);
+	if (state == FFM_SHM_OFFERED)
+		return true;
+
+	if (state == FFM_SHM_ACCEPTED && ffm_shm_watch_consumer(&stream->shm)) {
+		struct ffm_packet_info info = {.type = FFM_PACKET_SHM_SWITCH};
+
+		if (!send_message(stream, &info, NULL))
+			return false;
+
+		stream->shm_active = true;
+		info("Using shared memory transport to ffmpeg-mux");
+		return true;
+	}
+
+	warn("Shared memory transport declined, using pipe");
+	ffm_shm_free(&stream->shm);
+	stream->shm_offered = false;
+	return true;
+}
+#endif
+
 bool write_packet(struct ffmpeg_muxer *stream, struct encoder_packet *packet)
 {
 	bool is_video = packet->type == OBS_ENCODER_VIDEO;
-	size_t ret;
 
 	struct ffm_packet_info info = {.pts = packet->pts,
 				       .dts = packet->dts,
@@ -623,19 +737,13 @@ bool write_packet(struct ffmpeg_muxer *stream, struct encoder_packet *packet)
 		}
 	}
 
-	ret = os_process_pipe_write(stream->pipe, (const uint8_t *)&info, sizeof(info));
-	if (ret != sizeof(info)) {
-		warn("os_process_pipe_write for info structure failed");
-		signal_failure(stream);
+#ifdef FFM_SHM_SUPPORTED
+	if (!update_transport(stream))
 		return false;
-	}
+#endif
 
-	ret = os_process_pipe_write(stream->pipe, packet->data, packet->size);
-	if (ret != packet->size) {
-		warn("os_process_pipe_write for packet data failed");
-		signal_failure(stream);
+	if (!send_message(stream, &info, packet->data))
 		return false;
-	}
 
 	stream->total_bytes += packet->size;
 
@@ -683,6 +791,12 @@ bool send_headers(struct ffmpeg_muxer *stream)
 		}
 	} while (aencoder);
 
+#ifdef FFM_SHM_SUPPORTED
+	/* offered after the first headers, which the helper reads before
+	 * anything else */
+	if (stream->shm.header && !stream->shm_offered)
+		return offer_shm(stream);
+#endif
 	return true;
 }
 
@@ -712,25 +826,10 @@ static inline bool should_split(struct ffmpeg_muxer *stream, struct encoder_pack
 
 static bool send_new_filename(struct ffmpeg_muxer *stream, const char *filename)
 {
-	size_t ret;
 	uint32_t size = (uint32_t)strlen(filename);
 	struct ffm_packet_info info = {.type = FFM_PACKET_CHANGE_FILE, .size = size};
 
-	ret = os_process_pipe_write(stream->pipe, (const uint8_t *)&info, sizeof(info));
-	if (ret != sizeof(info)) {
-		warn("os_process_pipe_write for info structure failed");
-		signal_failure(stream);
-		return false;
-	}
-
-	ret = os_process_pipe_write(stream->pipe, (const uint8_t *)filename, size);
-	if (ret != size) {
-		warn("os_process_pipe_write for packet data failed");
-		signal_failure(stream);
-		return false;
-	}
-
-	return true;
+	return send_message(stream, &info, filename);
 }
 
 static bool prepare_split_file(struct ffmpeg_muxer *stream, struct encoder_packet *packet)
@@ -944,8 +1043,10 @@ static void save_replay_proc(void *data, calldata_t *cd)
 static void get_last_replay(void *data, calldata_t *cd)
 {
 	struct ffmpeg_muxer *stream = data;
+	pthread_mutex_lock(&stream->saves_mutex);
 	if (!os_atomic_load_bool(&stream->muxing))
 		calldata_set_string(cd, "path", stream->path.array);
+	pthread_mutex_unlock(&stream->saves_mutex);
 }
 
 static void *replay_buffer_create(obs_data_t *settings, obs_output_t *output)
@@ -953,6 +1054,7 @@ static void *replay_buffer_create(obs_data_t *settings, obs_output_t *output)
 	UNUSED_PARAMETER(settings);
 	struct ffmpeg_muxer *stream = bzalloc(sizeof(*stream));
 	stream->output = output;
+	pthread_mutex_init(&stream->saves_mutex, NULL);
 
 	stream->hotkey = obs_hotkey_register_output(output, "ReplayBuffer.Save", obs_module_text("ReplayBuffer.Save"),
 						    replay_buffer_hotkey, stream);
@@ -967,14 +1069,114 @@ static void *replay_buffer_create(obs_data_t *settings, obs_output_t *output)
 	return stream;
 }
 
+/* ------------------------------------------------------------------------ */
+/* In-process saves through the mp4 muxer of obs-outputs.  Each save runs on
+ * its own thread with its own references to the packets, so saves don't
+ * have to wait for each other.  Saves from the disk buffer still run one at
+ * a time, as the ring only supports a single reader. */
+
+struct ring_reader;
+
+struct replay_save {
+	struct ffmpeg_muxer *stream;
+	struct dstr path;
+	int64_t request_ts;
+	pthread_t thread;
+	volatile bool done;
+
+	mux_packets_t packets;
+	size_t next;
+
+	struct ring_reader *ring_reader;
+	struct encoder_packet ring_packet;
+};
+
+static void join_saves(struct ffmpeg_muxer *stream, bool all)
+{
+	for (size_t i = stream->saves.num; i > 0; i--) {
+		struct replay_save *save = stream->saves.array[i - 1];
+
+		if (!all && !os_atomic_load_bool(&save->done))
+			continue;
+
+		pthread_join(save->thread, NULL);
+		dstr_free(&save->path);
+		bfree(save);
+		da_erase(stream->saves, i - 1);
+	}
+}
+
+static bool use_native_mux(struct ffmpeg_muxer *stream, obs_data_t *settings)
+{
+	const char *ext = obs_data_get_string(settings, "extension");
+	calldata_t cd = {0};
+	bool available;
+
+	if (!obs_data_get_bool(settings, "use_native_mux"))
+		return false;
+
+	if (astrcmpi(ext, "mp4") != 0 && astrcmpi(ext, "mov") != 0) {
+		warn("The native muxer only supports mp4 and mov, using ffmpeg for '%s'", ext);
+		return false;
+	}
+
+	/* with no packet source the proc only reports whether it exists */
+	available = proc_handler_call(obs_get_proc_handler(), "mp4_write_packets", &cd);
+	calldata_free(&cd);
+
+	if (!available)
+		warn("The native muxer is not available, using ffmpeg");
+	return available;
+}
+
 static void replay_buffer_destroy(void *data)
 {
 	struct ffmpeg_muxer *stream = data;
 	if (stream->hotkey)
 		obs_hotkey_unregister(stream->hotkey);
+	join_saves(stream, true);
+	da_free(stream->saves);
+	pthread_mutex_destroy(&stream->saves_mutex);
 	ffmpeg_mux_destroy(data);
 }
 
+#define DEFAULT_DISK_BUFFER_MB 2048
+
+static void create_replay_ring(struct ffmpeg_muxer *stream, obs_data_t *settings)
+{
+	bool use_disk = obs_data_get_bool(settings, "use_disk_buffer");
+	uint64_t capacity = (uint64_t)obs_data_get_int(settings, "disk_buffer_size_mb") * (1024 * 1024);
+	const char *dir = obs_data_get_string(settings, "disk_buffer_dir");
+	char *default_dir = NULL;
+
+	/* the previous replay may still be saving from the old ring */
+	if (stream->mux_thread_joinable) {
+		pthread_join(stream->mux_thread, NULL);
+		stream->mux_thread_joinable = false;
+	}
+	join_saves(stream, true);
+
+	replay_ring_destroy(stream->ring);
+	stream->ring = NULL;
+
+	if (!use_disk)
+		return;
+
+	/* leave room for the keyframe group that's kept past the limit */
+	if (!capacity)
+		capacity = stream->max_size ? (uint64_t)stream->max_size / 4 * 5
+					    : (uint64_t)DEFAULT_DISK_BUFFER_MB * (1024 * 1024);
+
+	if (!dir || !*dir)
+		dir = default_dir = os_get_cache_path_ptr("obs-studio/replay-buffer");
+
+	stream->ring = replay_ring_create(dir, capacity);
+	if (!stream->ring)
+		warn("Failed to create disk buffer, keeping the replay in memory");
+
+	bfree(default_dir);
+}
+
 static bool replay_buffer_start(void *data)
 {
 	struct ffmpeg_muxer *stream = data;
@@ -987,6 +1189,8 @@ static bool replay_buffer_start(void *data)
 	obs_data_t *s = obs_output_get_settings(stream->output);
 	stream->max_time = obs_data_get_int(s, "max_time_sec") * 1000000LL;
 	stream->max_size = obs_data_get_int(s, "max_size_mb") * (1024 * 1024);
+	create_replay_ring(stream, s);
+	stream->native_mux = use_native_mux(stream, s);
 	obs_data_release(s);
 
 	os_atomic_set_bool(&stream->active, true);
@@ -1060,6 +1264,24 @@ static inline void replay_buffer_purge(struct ffmpeg_muxer *stream, struct encod
 		purge(stream);
 }
 
+static inline void replay_ring_purge_old(struct ffmpeg_muxer *stream, struct encoder_packet *pkt)
+{
+	struct replay_ring *ring = stream->ring;
+
+	if (stream->max_size) {
+		while (replay_ring_keyframes(ring) > 2 &&
+		       (int64_t)(replay_ring_size(ring) + pkt->size) > stream->max_size) {
+			if (!replay_ring_purge(ring))
+				break;
+		}
+	}
+
+	while (replay_ring_keyframes(ring) > 2 && (pkt->dts_usec - replay_ring_start_time(ring)) > stream->max_time) {
+		if (!replay_ring_purge(ring))
+			break;
+	}
+}
+
 static void insert_packet(mux_packets_t *packets, struct encoder_packet *packet, int64_t video_offset,
 			  int64_t *audio_offsets, int64_t video_pts_offset, int64_t *audio_dts_offsets)
 {
@@ -1087,6 +1309,283 @@ static void insert_packet(mux_packets_t *packets, struct encoder_packet *packet,
 	da_insert(*packets, idx, &pkt);
 }
 
+#define RING_REORDER_PACKETS 64
+
+struct ring_packet {
+	struct encoder_packet packet;
+	uint64_t pos;
+};
+
+/* Reads the packets of a save straight from the ring.  Like insert_packet,
+ * packets are sorted by their adjusted timestamps, but only within a small
+ * window so that memory usage doesn't depend on the length of the replay. */
+struct ring_reader {
+	struct ffmpeg_muxer *stream;
+	struct replay_ring_iter iter;
+	DARRAY(struct ring_packet) window;
+	int64_t video_offset;
+	int64_t video_pts_offset;
+	int64_t audio_offsets[MAX_AUDIO_MIXES];
+	int64_t audio_dts_offsets[MAX_AUDIO_MIXES];
+	bool more;
+	bool front_used;
+};
+
+static bool find_ring_offsets(struct ring_reader *reader)
+{
+	struct ffmpeg_muxer *stream = reader->stream;
+	struct replay_ring_iter iter = reader->iter;
+	struct encoder_packet pkt;
+	bool found_video = false;
+	bool found_audio[MAX_AUDIO_MIXES] = {0};
+	size_t audio_tracks = 0;
+	size_t found_tracks = 0;
+
+	for (size_t i = 0; i < MAX_AUDIO_MIXES; i++) {
+		if (obs_output_get_audio_encoder(stream->output, i))
+			audio_tracks++;
+	}
+
+	/* only the packet headers are read, and only until the first packet
+	 * of every track has been found */
+	while (replay_ring_read_next(stream->ring, &iter, &pkt)) {
+		if (pkt.type == OBS_ENCODER_VIDEO) {
+			if (!found_video) {
+				reader->video_pts_offset = pkt.pts;
+				reader->video_offset = reader->video_pts_offset * 1000000 / pkt.timebase_den;
+				found_video = true;
+			}
+		} else if (!found_audio[pkt.track_idx]) {
+			found_audio[pkt.track_idx] = true;
+			reader->audio_offsets[pkt.track_idx] = pkt.dts_usec;
+			reader->audio_dts_offsets[pkt.track_idx] = pkt.dts;
+			found_tracks++;
+		}
+
+		if (found_video && found_tracks >= audio_tracks)
+			break;
+	}
+
+	return found_video || found_tracks;
+}
+
+static void ring_reader_init(struct ring_reader *reader, struct ffmpeg_muxer *stream)
+{
+	memset(reader, 0, sizeof(*reader));
+	reader->stream = stream;
+	reader->iter = stream->ring_iter;
+	reader->more = find_ring_offsets(reader);
+	da_reserve(reader->window, RING_REORDER_PACKETS + 1);
+}
+
+static void ring_reader_free(struct ring_reader *reader)
+{
+	da_free(reader->window);
+}
+
+static void ring_reader_add(struct ring_reader *reader, struct ring_packet *rp)
+{
+	struct encoder_packet *pkt = &rp->packet;
+	obs_output_t *output = reader->stream->output;
+	size_t idx;
+
+	if (pkt->type == OBS_ENCODER_VIDEO) {
+		pkt->dts_usec -= reader->video_offset;
+		pkt->dts -= reader->video_pts_offset;
+		pkt->pts -= reader->video_pts_offset;
+		pkt->encoder = obs_output_get_video_encoder2(output, pkt->track_idx);
+	} else {
+		pkt->dts_usec -= reader->audio_offsets[pkt->track_idx];
+		pkt->dts -= reader->audio_dts_offsets[pkt->track_idx];
+		pkt->pts -= reader->audio_dts_offsets[pkt->track_idx];
+		pkt->encoder = obs_output_get_audio_encoder(output, pkt->track_idx);
+	}
+
+	for (idx = reader->window.num; idx > 0; idx--) {
+		if (reader->window.array[idx - 1].packet.dts_usec < pkt->dts_usec)
+			break;
+	}
+
+	da_insert(reader->window, idx, rp);
+}
+
+/* The packet stays valid until the next call */
+static bool ring_reader_next(struct ring_reader *reader, struct encoder_packet *packet)
+{
+	struct replay_ring *ring = reader->stream->ring;
+
+	if (reader->front_used) {
+		da_erase(reader->window, 0);
+		reader->front_used = false;
+	}
+
+	while (reader->more && reader->window.num <= RING_REORDER_PACKETS) {
+		struct ring_packet rp;
+
+		reader->more = replay_ring_read_next(ring, &reader->iter, &rp.packet);
+		if (reader->more) {
+			rp.pos = reader->iter.last;
+			ring_reader_add(reader, &rp);
+		}
+	}
+
+	/* let the ring reuse everything that isn't needed anymore */
+	uint64_t pos = reader->iter.pos;
+	for (size_t i = 0; i < reader->window.num; i++) {
+		if (reader->window.array[i].pos < pos)
+			pos = reader->window.array[i].pos;
+	}
+	replay_ring_read_release(ring, pos);
+
+	if (!reader->window.num)
+		return false;
+
+	*packet = reader->window.array[0].packet;
+	reader->front_used = true;
+	return true;
+}
+
+static bool write_ring_packets(struct ffmpeg_muxer *stream)
+{
+	struct ring_reader reader;
+	struct encoder_packet pkt;
+	bool success = true;
+
+	ring_reader_init(&reader, stream);
+
+	while (ring_reader_next(&reader, &pkt)) {
+		if (!write_packet(stream, &pkt)) {
+			success = false;
+			break;
+		}
+	}
+
+	ring_reader_free(&reader);
+	return success;
+}
+
+static bool replay_save_next_packet(void *param, struct encoder_packet *packet)
+{
+	struct replay_save *save = param;
+
+	if (save->ring_reader) {
+		struct encoder_packet pkt;
+
+		/* the muxer takes references to the packets, so packets from the
+		 * ring have to be copied */
+		obs_encoder_packet_release(&save->ring_packet);
+		save->ring_packet.data = NULL;
+
+		if (!ring_reader_next(save->ring_reader, &pkt))
+			return false;
+
+		save->ring_packet = pkt;
+		obs_encoder_packet_alloc(&save->ring_packet, pkt.size);
+		memcpy(save->ring_packet.data, pkt.data, pkt.size);
+		*packet = save->ring_packet;
+		return true;
+	}
+
+	if (save->next == save->packets.num)
+		return false;
+
+	*packet = save->packets.array[save->next++];
+	return true;
+}
+
+static void *replay_save_thread(void *data)
+{
+	struct replay_save *save = data;
+	struct ffmpeg_muxer *stream = save->stream;
+	struct ring_reader reader;
+	calldata_t cd = {0};
+	bool success;
+
+	if (stream->ring) {
+		ring_reader_init(&reader, stream);
+		save->ring_reader = &reader;
+	}
+
+	calldata_set_ptr(&cd, "output", stream->output);
+	calldata_set_string(&cd, "path", save->path.array);
+	calldata_set_ptr(&cd, "next_packet", (void *)replay_save_next_packet);
+	calldata_set_ptr(&cd, "param", save);
+
+	success = proc_handler_call(obs_get_proc_handler(), "mp4_write_packets", &cd) &&
+		  calldata_bool(&cd, "success");
+
+	if (stream->ring) {
+		obs_encoder_packet_release(&save->ring_packet);
+		ring_reader_free(&reader);
+		replay_ring_read_end(stream->ring);
+		os_atomic_set_bool(&stream->ring_reading, false);
+	}
+
+	for (size_t i = 0; i < save->packets.num; i++)
+		obs_encoder_packet_release(&save->packets.array[i]);
+	da_free(save->packets);
+
+	if (success) {
+		int64_t latency = (int64_t)(os_gettime_ns() / 1000) - save->request_ts;
+
+		info("Wrote replay buffer to '%s' in-process, %" PRId64 " KB in %" PRId64 " ms", save->path.array,
+		     os_get_file_size(save->path.array) / 1024, latency / 1000);
+
+		pthread_mutex_lock(&stream->saves_mutex);
+		dstr_copy_dstr(&stream->path, &save->path);
+		pthread_mutex_unlock(&stream->saves_mutex);
+
+		calldata_t saved_cd = {0};
+		signal_handler_t *sh = obs_output_get_signal_handler(stream->output);
+		signal_handler_signal(sh, "saved", &saved_cd);
+	} else {
+		warn("Could not write replay buffer to '%s'", save->path.array);
+		os_unlink(save->path.array);
+	}
+
+	calldata_free(&cd);
+	os_atomic_set_bool(&save->done, true);
+	return NULL;
+}
+
+static void start_native_save(struct ffmpeg_muxer *stream)
+{
+	struct replay_save *save = bzalloc(sizeof(*save));
+
+	save->stream = stream;
+	save->request_ts = stream->save_request_ts;
+	da_move(save->packets, stream->mux_packets);
+
+	/* Saves of the same second would get the same name, so the file is
+	 * created right away, before the save thread opens it.  That way the
+	 * next save picks another name even if this one is still running. */
+	generate_filename(stream, &save->path, false);
+	FILE *f = os_fopen(save->path.array, "wb");
+	if (f)
+		fclose(f);
+
+	if (stream->ring)
+		os_atomic_set_bool(&stream->ring_reading, true);
+
+	if (pthread_create(&save->thread, NULL, replay_save_thread, save) != 0) {
+		warn("Failed to create replay save thread");
+
+		for (size_t i = 0; i < save->packets.num; i++)
+			obs_encoder_packet_release(&save->packets.array[i]);
+		da_free(save->packets);
+		if (stream->ring) {
+			replay_ring_read_end(stream->ring);
+			os_atomic_set_bool(&stream->ring_reading, false);
+		}
+		os_unlink(save->path.array);
+		dstr_free(&save->path);
+		bfree(save);
+		return;
+	}
+
+	da_push_back(stream->saves, &save);
+}
+
 static void *replay_buffer_mux_thread(void *data)
 {
 	struct ffmpeg_muxer *stream = data;
@@ -1106,6 +1605,12 @@ static void *replay_buffer_mux_thread(void *data)
 		goto error;
 	}
 
+	if (stream->ring && !write_ring_packets(stream)) {
+		warn("Could not write packet for file '%s'", stream->path.array);
+		error = true;
+		goto error;
+	}
+
 	for (size_t i = 0; i < stream->mux_packets.num; i++) {
 		struct encoder_packet *pkt = &stream->mux_packets.array[i];
 		if (!write_packet(stream, pkt)) {
@@ -1116,16 +1621,18 @@ static void *replay_buffer_mux_thread(void *data)
 		obs_encoder_packet_release(pkt);
 	}
 
-	info("Wrote replay buffer to '%s'", stream->path.array);
+	info("Wrote replay buffer to '%s' in %" PRId64 " ms", stream->path.array,
+	     ((int64_t)(os_gettime_ns() / 1000) - stream->save_request_ts) / 1000);
 
 error:
-	os_process_pipe_destroy(stream->pipe);
-	stream->pipe = NULL;
+	close_pipe(stream);
 	if (error) {
 		for (size_t i = 0; i < stream->mux_packets.num; i++)
 			obs_encoder_packet_release(&stream->mux_packets.array[i]);
 	}
 	da_free(stream->mux_packets);
+	if (stream->ring)
+		replay_ring_read_end(stream->ring);
 	os_atomic_set_bool(&stream->muxing, false);
 
 	if (!error) {
@@ -1142,6 +1649,10 @@ static void replay_buffer_save(struct ffmpeg_muxer *stream)
 	const size_t size = sizeof(struct encoder_packet);
 	size_t num_packets = stream->packets.size / size;
 
+	/* the mux thread reads the packets straight from the ring */
+	if (stream->ring)
+		replay_ring_read_begin(stream->ring, &stream->ring_iter);
+
 	da_reserve(stream->mux_packets, num_packets);
 
 	/* ---------------------------- */
@@ -1176,7 +1687,14 @@ static void replay_buffer_save(struct ffmpeg_muxer *stream)
 			      audio_dts_offsets);
 	}
 
+	if (stream->native_mux) {
+		start_native_save(stream);
+		return;
+	}
+
+	pthread_mutex_lock(&stream->saves_mutex);
 	generate_filename(stream, &stream->path, true);
+	pthread_mutex_unlock(&stream->saves_mutex);
 
 	os_atomic_set_bool(&stream->muxing, true);
 	stream->mux_thread_joinable = pthread_create(&stream->mux_thread, NULL, replay_buffer_mux_thread, stream) == 0;
@@ -1221,27 +1739,35 @@ static void replay_buffer_data(void *data, struct encoder_packet *packet)
 		}
 	}
 
-	obs_encoder_packet_ref(&pkt, packet);
-	replay_buffer_purge(stream, &pkt);
+	if (stream->ring) {
+		replay_ring_purge_old(stream, packet);
+		replay_ring_push(stream->ring, packet);
+	} else {
+		obs_encoder_packet_ref(&pkt, packet);
+		replay_buffer_purge(stream, &pkt);
 
-	if (!stream->packets.size)
-		stream->cur_time = pkt.dts_usec;
-	stream->cur_size += pkt.size;
+		if (!stream->packets.size)
+			stream->cur_time = pkt.dts_usec;
+		stream->cur_size += pkt.size;
 
-	deque_push_back(&stream->packets, packet, sizeof(*packet));
+		deque_push_back(&stream->packets, packet, sizeof(*packet));
 
-	if (packet->type == OBS_ENCODER_VIDEO && packet->keyframe)
-		stream->keyframes++;
+		if (packet->type == OBS_ENCODER_VIDEO && packet->keyframe)
+			stream->keyframes++;
+	}
 
 	if (stream->save_ts && packet->sys_dts_usec >= stream->save_ts) {
-		if (os_atomic_load_bool(&stream->muxing))
+		if (os_atomic_load_bool(&stream->muxing) || os_atomic_load_bool(&stream->ring_reading))
 			return;
 
+		join_saves(stream, false);
+
 		if (stream->mux_thread_joinable) {
 			pthread_join(stream->mux_thread, NULL);
 			stream->mux_thread_joinable = false;
 		}
 
+		stream->save_request_ts = stream->save_ts;
 		stream->save_ts = 0;
 		replay_buffer_save(stream);
 	}
@@ -1254,6 +1780,8 @@ static void replay_buffer_defaults(obs_data_t *s)
 	obs_data_set_default_string(s, "format", "%CCYY-%MM-%DD %hh-%mm-%ss");
 	obs_data_set_default_string(s, "extension", "mp4");
 	obs_data_set_default_bool(s, "allow_spaces", true);
+	obs_data_set_default_bool(s, "use_disk_buffer", false);
+	obs_data_set_default_bool(s, "use_native_mux", false);
 }
 
 struct obs_output_info replay_buffer = {
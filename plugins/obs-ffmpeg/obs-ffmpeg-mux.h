@@ -9,6 +9,9 @@
 #include <util/platform.h>
 #include <util/threading.h>
 
+#include "replay-ring.h"
+#include "ffmpeg-mux/ffmpeg-mux-shm.h"
+
 typedef DARRAY(struct encoder_packet) mux_packets_t;
 
 struct ffmpeg_muxer {
@@ -37,6 +40,13 @@ struct ffmpeg_muxer {
 	obs_hotkey_id hotkey;
 	volatile bool muxing;
 	mux_packets_t mux_packets;
+	struct replay_ring *ring;
+	struct replay_ring_iter ring_iter;
+	int64_t save_request_ts;
+	bool native_mux;
+	pthread_mutex_t saves_mutex;
+	DARRAY(struct replay_save *) saves;
+	volatile bool ring_reading;
 
 	/* split file */
 	bool found_video;
@@ -64,11 +74,19 @@ struct ffmpeg_muxer {
 	bool is_network;
 	bool split_file;
 	bool allow_overwrite;
+
+#ifdef FFM_SHM_SUPPORTED
+	/* shared memory transport to the helper, see ffmpeg-mux-shm.h */
+	struct ffm_shm shm;
+	bool shm_offered;
+	bool shm_active;
+#endif
 };
 
 bool stopping(struct ffmpeg_muxer *stream);
 bool active(struct ffmpeg_muxer *stream);
 void start_pipe(struct ffmpeg_muxer *stream, const char *path);
+int close_pipe(struct ffmpeg_muxer *stream);
 bool write_packet(struct ffmpeg_muxer *stream, struct encoder_packet *packet);
 bool send_headers(struct ffmpeg_muxer *stream);
 int deactivate(struct ffmpeg_muxer *stream, int code);
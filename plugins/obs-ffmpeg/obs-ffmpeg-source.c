@@ -40,12 +40,15 @@ struct ffmpeg_source {
 	char *input;
 	char *input_format;
 	char *ffmpeg_options;
+	char *cache_dir;
 	int buffering_mb;
+	int cache_limit_mb;
 	int speed_percent;
 	bool is_looping;
 	bool is_local_file;
 	bool is_hw_decoding;
 	bool full_decode;
+	bool cache_failed;
 	bool is_clear_on_media_end;
 	bool restart_on_activate;
 	bool close_when_inactive;
@@ -230,11 +233,13 @@ static void dump_source_info(struct ffmpeg_source *s, const char *input, const c
 		"\trestart_on_activate:     %s\n"
 		"\tclose_when_inactive:     %s\n"
 		"\tfull_decode:             %s\n"
+		"\tcache_limit_mb:          %d\n"
 		"\tffmpeg_options:          %s",
 		input ? input : "(null)", input_format ? input_format : "(null)", s->speed_percent,
 		s->is_looping ? "yes" : "no", s->is_linear_alpha ? "yes" : "no", s->is_hw_decoding ? "yes" : "no",
 		s->is_clear_on_media_end ? "yes" : "no", s->restart_on_activate ? "yes" : "no",
-		s->close_when_inactive ? "yes" : "no", s->full_decode ? "yes" : "no", s->ffmpeg_options);
+		s->close_when_inactive ? "yes" : "no", s->full_decode ? "yes" : "no", s->cache_limit_mb,
+		s->ffmpeg_options);
 }
 
 static void get_frame(void *opaque, struct obs_source_frame *f)
@@ -243,6 +248,12 @@ static void get_frame(void *opaque, struct obs_source_frame *f)
 	obs_source_output_video(s->source, f);
 }
 
+static void get_owned_frame(void *opaque, struct obs_source_frame *f, void (*release)(void *param), void *param)
+{
+	struct ffmpeg_source *s = opaque;
+	obs_source_output_video_owned(s->source, f, release, param);
+}
+
 static void preload_frame(void *opaque, struct obs_source_frame *f)
 {
 	struct ffmpeg_source *s = opaque;
@@ -293,6 +304,7 @@ static void ffmpeg_source_open(struct ffmpeg_source *s)
 		struct mp_media_info info = {
 			.opaque = s,
 			.v_cb = get_frame,
+			.v_owned_cb = get_owned_frame,
 			.v_preload_cb = preload_frame,
 			.v_seek_cb = seek_frame,
 			.a_cb = get_audio,
@@ -308,7 +320,9 @@ static void ffmpeg_source_open(struct ffmpeg_source *s)
 			.is_local_file = s->is_local_file || s->seekable,
 			.reconnecting = s->reconnecting,
 			.request_preload = s->is_stinger,
-			.full_decode = s->full_decode,
+			.full_decode = s->full_decode && !s->cache_failed,
+			.cache_limit = (size_t)s->cache_limit_mb * 1024 * 1024,
+			.cache_dir = s->cache_dir,
 		};
 
 		s->media = media_playback_create(&info);
@@ -355,6 +369,23 @@ static void ffmpeg_source_tick(void *data, float seconds)
 	UNUSED_PARAMETER(seconds);
 
 	struct ffmpeg_source *s = data;
+
+	if (media_playback_cache_failed(s->media)) {
+		/* the cache has already logged why, carry on from the
+		 * same position without it */
+		int64_t time = media_playback_get_current_time(s->media);
+
+		media_playback_destroy(s->media);
+		s->media = NULL;
+		s->cache_failed = true;
+
+		ffmpeg_source_open(s);
+		if (s->media) {
+			media_playback_play(s->media, s->is_looping, s->reconnecting);
+			media_playback_seek(s->media, time);
+		}
+	}
+
 	if (s->destroy_media) {
 		if (s->media) {
 			media_playback_destroy(s->media);
@@ -464,6 +495,7 @@ static void ffmpeg_source_update(void *data, obs_data_t *settings)
 	is_linear_alpha = obs_data_get_bool(settings, "linear_alpha");
 	s->is_linear_alpha = is_linear_alpha;
 	s->buffering_mb = (int)obs_data_get_int(settings, "buffering_mb");
+	s->cache_limit_mb = (int)obs_data_get_int(settings, "cache_limit_mb");
 	s->speed_percent = speed_percent;
 	s->is_local_file = is_local_file;
 	s->seekable = obs_data_get_bool(settings, "seekable");
@@ -479,6 +511,8 @@ static void ffmpeg_source_update(void *data, obs_data_t *settings)
 		media_playback_destroy(s->media);
 		s->media = NULL;
 	}
+	if (should_restart_media)
+		s->cache_failed = false;
 
 	/* directly set options if media is playing */
 	if (s->media) {
@@ -611,6 +645,9 @@ static void *ffmpeg_source_create(obs_data_t *settings, obs_source_t *source)
 		return NULL;
 	}
 
+	/* frames of fully decoded media that don't fit in memory go here */
+	s->cache_dir = os_get_cache_path_ptr("obs-studio/media-cache");
+
 	s->hotkey = obs_hotkey_register_source(source, "MediaSource.Restart", obs_module_text("RestartMedia"),
 					       restart_hotkey, s);
 
@@ -648,6 +685,7 @@ static void ffmpeg_source_destroy(void *data)
 	bfree(s->input);
 	bfree(s->input_format);
 	bfree(s->ffmpeg_options);
+	bfree(s->cache_dir);
 	bfree(s);
 }
 
@@ -0,0 +1,458 @@
+#include "replay-ring.h"
+
+#include <util/deque.h>
+#include <util/dstr.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#include <inttypes.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#define do_log(level, format, ...) blog(level, "[replay ring] " format, ##__VA_ARGS__)
+
+#define warn(format, ...) do_log(LOG_WARNING, format, ##__VA_ARGS__)
+#define info(format, ...) do_log(LOG_INFO, format, ##__VA_ARGS__)
+
+#define RECORD_ALIGN 16
+#define ALLOC_CHUNK (64 * 1024 * 1024)
+#define RECORD_WRAP UINT32_MAX
+#define NOT_PINNED UINT64_MAX
+
+struct ring_record {
+	int64_t pts;
+	int64_t dts;
+	int64_t dts_usec;
+	int64_t sys_dts_usec;
+	int32_t timebase_num;
+	int32_t timebase_den;
+	uint32_t size;
+	int16_t priority;
+	int16_t drop_priority;
+	uint8_t type;
+	uint8_t keyframe;
+	uint8_t track_idx;
+};
+
+struct ring_keyframe {
+	uint64_t pos;
+	int64_t dts_usec;
+};
+
+struct replay_ring {
+	uint8_t *data;
+	uint64_t capacity;
+
+	/* disk space is reserved as the ring fills up for the first time,
+	 * the writer wraps at the limit if that fails */
+	uint64_t allocated;
+	uint64_t limit;
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#else
+	int fd;
+#endif
+
+	/* byte positions that only ever increase, the offset into the
+	 * mapping is the position modulo the capacity */
+	uint64_t head;
+	uint64_t tail;
+	int64_t start_time;
+	struct deque keyframes; /* struct ring_keyframe */
+	bool wait_keyframe;
+	uint64_t dropped;
+
+	/* the oldest position a save still needs */
+	pthread_mutex_t pin_mutex;
+	uint64_t pin;
+};
+
+static inline uint64_t record_size(uint32_t size)
+{
+	return (sizeof(struct ring_record) + (uint64_t)size + RECORD_ALIGN - 1) & ~(uint64_t)(RECORD_ALIGN - 1);
+}
+
+#ifdef _WIN32
+static bool map_file(struct replay_ring *ring, const char *path)
+{
+	wchar_t *wpath = NULL;
+
+	ring->file = INVALID_HANDLE_VALUE;
+
+	if (!os_utf8_to_wcs_ptr(path, 0, &wpath))
+		return false;
+
+	ring->file = CreateFileW(wpath, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+				 FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+	bfree(wpath);
+
+	if (ring->file == INVALID_HANDLE_VALUE)
+		return false;
+
+	/* creating the mapping extends the file to the full capacity */
+	ring->mapping = CreateFileMappingW(ring->file, NULL, PAGE_READWRITE, (DWORD)(ring->capacity >> 32),
+					   (DWORD)ring->capacity, NULL);
+	if (!ring->mapping)
+		return false;
+
+	ring->data = MapViewOfFile(ring->mapping, FILE_MAP_ALL_ACCESS, 0, 0, (SIZE_T)ring->capacity);
+	return !!ring->data;
+}
+
+static void unmap_file(struct replay_ring *ring)
+{
+	if (ring->data)
+		UnmapViewOfFile(ring->data);
+	if (ring->mapping)
+		CloseHandle(ring->mapping);
+	if (ring->file != INVALID_HANDLE_VALUE)
+		CloseHandle(ring->file);
+}
+#else
+static bool map_file(struct replay_ring *ring, const char *path)
+{
+	ring->fd = open(path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+	if (ring->fd == -1)
+		return false;
+
+	/* the file only needs a name until it's mapped */
+	unlink(path);
+
+	if (ftruncate(ring->fd, (off_t)ring->capacity) != 0)
+		return false;
+
+	void *data = mmap(NULL, (size_t)ring->capacity, PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd, 0);
+	if (data == MAP_FAILED)
+		return false;
+
+	ring->data = data;
+	return true;
+}
+
+static void unmap_file(struct replay_ring *ring)
+{
+	if (ring->data)
+		munmap(ring->data, (size_t)ring->capacity);
+	if (ring->fd != -1)
+		close(ring->fd);
+}
+#endif
+
+/* Writing to a page of the sparse file that the disk has no room for would
+ * raise SIGBUS, so space is reserved a chunk at a time before the writer
+ * first gets there, instead of all at once when the output starts. */
+static bool allocate(struct replay_ring *ring, uint64_t end)
+{
+#ifdef __linux__
+	while (ring->allocated < end) {
+		uint64_t len = ring->capacity - ring->allocated;
+		if (len > ALLOC_CHUNK)
+			len = ALLOC_CHUNK;
+
+		if (posix_fallocate(ring->fd, (off_t)ring->allocated, (off_t)len) != 0) {
+			warn("Failed to reserve disk space, limiting the ring to %" PRIu64 " MB",
+			     ring->allocated / (1024 * 1024));
+			ring->limit = ring->allocated;
+			return false;
+		}
+
+		ring->allocated += len;
+	}
+#else
+	UNUSED_PARAMETER(ring);
+	UNUSED_PARAMETER(end);
+#endif
+	return true;
+}
+
+struct replay_ring *replay_ring_create(const char *dir, uint64_t capacity)
+{
+	struct replay_ring *ring = bzalloc(sizeof(*ring));
+	struct dstr path = {0};
+
+	ring->capacity = capacity & ~(uint64_t)(RECORD_ALIGN - 1);
+	ring->limit = ring->capacity;
+#ifndef __linux__
+	ring->allocated = ring->capacity;
+#endif
+	ring->pin = NOT_PINNED;
+#ifndef _WIN32
+	ring->fd = -1;
+#endif
+
+	if (pthread_mutex_init(&ring->pin_mutex, NULL) != 0) {
+		bfree(ring);
+		return NULL;
+	}
+
+	os_mkdirs(dir);
+	dstr_printf(&path, "%s/replay-%" PRIu64 ".ring", dir, os_gettime_ns());
+
+	if (!map_file(ring, path.array)) {
+		warn("Failed to map %" PRIu64 " MB ring file '%s'", capacity / (1024 * 1024), path.array);
+		dstr_free(&path);
+		replay_ring_destroy(ring);
+		return NULL;
+	}
+
+	info("Mapped %" PRIu64 " MB ring file in '%s'", capacity / (1024 * 1024), dir);
+	dstr_free(&path);
+	return ring;
+}
+
+void replay_ring_destroy(struct replay_ring *ring)
+{
+	if (!ring)
+		return;
+
+	if (ring->dropped)
+		info("Dropped %" PRIu64 " packets that didn't fit the ring", ring->dropped);
+
+	unmap_file(ring);
+	deque_free(&ring->keyframes);
+	pthread_mutex_destroy(&ring->pin_mutex);
+	bfree(ring);
+}
+
+void replay_ring_clear(struct replay_ring *ring)
+{
+	/* restart at the beginning of the mapping so that any packet that
+	 * fits the ring fits without wrapping */
+	ring->tail = (ring->tail + ring->capacity - 1) / ring->capacity * ring->capacity;
+	ring->head = ring->tail;
+	ring->start_time = 0;
+	ring->wait_keyframe = false;
+	deque_free(&ring->keyframes);
+}
+
+static inline uint64_t get_pin(struct replay_ring *ring)
+{
+	uint64_t pin;
+
+	pthread_mutex_lock(&ring->pin_mutex);
+	pin = ring->pin;
+	pthread_mutex_unlock(&ring->pin_mutex);
+
+	return pin;
+}
+
+bool replay_ring_purge(struct replay_ring *ring)
+{
+	struct ring_keyframe kf;
+
+	if (!ring->keyframes.size)
+		return false;
+
+	deque_peek_front(&ring->keyframes, &kf, sizeof(kf));
+
+	/* packets received before the first keyframe go first */
+	if (ring->head < kf.pos) {
+		if (kf.pos > get_pin(ring))
+			return false;
+
+		ring->head = kf.pos;
+		ring->start_time = kf.dts_usec;
+		return true;
+	}
+
+	if (ring->keyframes.size < 2 * sizeof(kf))
+		return false;
+
+	kf = *(struct ring_keyframe *)deque_data(&ring->keyframes, sizeof(kf));
+	if (kf.pos > get_pin(ring))
+		return false;
+
+	deque_pop_front(&ring->keyframes, NULL, sizeof(kf));
+	ring->head = kf.pos;
+	ring->start_time = kf.dts_usec;
+	return true;
+}
+
+/* the reader wraps at the limit if the writer couldn't mark the wrap */
+static inline bool wrap_record_fits(uint64_t limit, uint64_t offset)
+{
+	return limit - offset >= sizeof(struct ring_record);
+}
+
+static bool reserve(struct replay_ring *ring, uint64_t size, uint64_t *skip)
+{
+	for (;;) {
+		uint64_t offset = ring->tail % ring->capacity;
+		uint64_t oldest = ring->head;
+		uint64_t pin = get_pin(ring);
+
+		if (size > ring->limit)
+			return false;
+
+		/* whatever is skipped past the limit counts as used, so the
+		 * ring never holds more than the limit */
+		*skip = ring->limit - offset < size ? ring->capacity - offset : 0;
+
+		if (pin < oldest)
+			oldest = pin;
+		if (ring->tail + *skip + size - oldest <= ring->capacity) {
+			uint64_t end = *skip ? size : offset + size;
+
+			/* the wrap record goes where the skip starts */
+			if (*skip && wrap_record_fits(ring->limit, offset) && end < offset + sizeof(struct ring_record))
+				end = offset + sizeof(struct ring_record);
+
+			/* allocating may lower the limit, try again if it does */
+			if (allocate(ring, end))
+				return true;
+			continue;
+		}
+
+		if (replay_ring_purge(ring))
+			continue;
+
+		/* a single keyframe group doesn't fit, start over unless a
+		 * save still needs the data */
+		if (pin != NOT_PINNED)
+			return false;
+
+		replay_ring_clear(ring);
+		ring->wait_keyframe = true;
+	}
+}
+
+bool replay_ring_push(struct replay_ring *ring, const struct encoder_packet *packet)
+{
+	bool keyframe = packet->type == OBS_ENCODER_VIDEO && packet->keyframe;
+	uint64_t size = record_size((uint32_t)packet->size);
+	uint64_t skip;
+
+	if (ring->wait_keyframe && !keyframe) {
+		ring->dropped++;
+		return false;
+	}
+
+	if (!reserve(ring, size, &skip)) {
+		ring->wait_keyframe = true;
+		ring->dropped++;
+		return false;
+	}
+
+	if (ring->wait_keyframe && !keyframe) {
+		ring->dropped++;
+		return false;
+	}
+
+	if (skip && wrap_record_fits(ring->limit, ring->tail % ring->capacity)) {
+		struct ring_record *wrap = (struct ring_record *)(ring->data + ring->tail % ring->capacity);
+		wrap->size = RECORD_WRAP;
+	}
+
+	/* reserve may have cleared the ring */
+	if (ring->head == ring->tail) {
+		ring->head += skip;
+		ring->start_time = packet->dts_usec;
+	}
+	ring->tail += skip;
+
+	if (keyframe) {
+		struct ring_keyframe kf = {ring->tail, packet->dts_usec};
+		deque_push_back(&ring->keyframes, &kf, sizeof(kf));
+		ring->wait_keyframe = false;
+	}
+
+	struct ring_record *record = (struct ring_record *)(ring->data + ring->tail % ring->capacity);
+	record->pts = packet->pts;
+	record->dts = packet->dts;
+	record->dts_usec = packet->dts_usec;
+	record->sys_dts_usec = packet->sys_dts_usec;
+	record->timebase_num = packet->timebase_num;
+	record->timebase_den = packet->timebase_den;
+	record->size = (uint32_t)packet->size;
+	record->priority = (int16_t)packet->priority;
+	record->drop_priority = (int16_t)packet->drop_priority;
+	record->type = (uint8_t)packet->type;
+	record->keyframe = packet->keyframe;
+	record->track_idx = (uint8_t)packet->track_idx;
+	memcpy(record + 1, packet->data, packet->size);
+
+	ring->tail += size;
+	return true;
+}
+
+uint64_t replay_ring_size(const struct replay_ring *ring)
+{
+	return ring->tail - ring->head;
+}
+
+int64_t replay_ring_start_time(const struct replay_ring *ring)
+{
+	return ring->start_time;
+}
+
+size_t replay_ring_keyframes(const struct replay_ring *ring)
+{
+	return ring->keyframes.size / sizeof(struct ring_keyframe);
+}
+
+void replay_ring_read_begin(struct replay_ring *ring, struct replay_ring_iter *iter)
+{
+	iter->pos = ring->head;
+	iter->end = ring->tail;
+	iter->limit = ring->limit;
+
+	pthread_mutex_lock(&ring->pin_mutex);
+	ring->pin = ring->head;
+	pthread_mutex_unlock(&ring->pin_mutex);
+}
+
+bool replay_ring_read_next(struct replay_ring *ring, struct replay_ring_iter *iter, struct encoder_packet *packet)
+{
+	while (iter->pos < iter->end) {
+		uint64_t offset = iter->pos % ring->capacity;
+		const struct ring_record *record = (const struct ring_record *)(ring->data + offset);
+
+		if (!wrap_record_fits(iter->limit, offset) || record->size == RECORD_WRAP) {
+			iter->pos += ring->capacity - offset;
+			continue;
+		}
+
+		memset(packet, 0, sizeof(*packet));
+		packet->data = (uint8_t *)(record + 1);
+		packet->size = record->size;
+		packet->pts = record->pts;
+		packet->dts = record->dts;
+		packet->dts_usec = record->dts_usec;
+		packet->sys_dts_usec = record->sys_dts_usec;
+		packet->timebase_num = record->timebase_num;
+		packet->timebase_den = record->timebase_den;
+		packet->priority = record->priority;
+		packet->drop_priority = record->drop_priority;
+		packet->type = (enum obs_encoder_type)record->type;
+		packet->keyframe = !!record->keyframe;
+		packet->track_idx = record->track_idx;
+
+		iter->last = iter->pos;
+		iter->pos += record_size(record->size);
+		return true;
+	}
+
+	return false;
+}
+
+void replay_ring_read_release(struct replay_ring *ring, uint64_t pos)
+{
+	pthread_mutex_lock(&ring->pin_mutex);
+	ring->pin = pos;
+	pthread_mutex_unlock(&ring->pin_mutex);
+}
+
+void replay_ring_read_end(struct replay_ring *ring)
+{
+	pthread_mutex_lock(&ring->pin_mutex);
+	ring->pin = NOT_PINNED;
+	pthread_mutex_unlock(&ring->pin_mutex);
+}
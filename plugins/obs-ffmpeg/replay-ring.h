@@ -0,0 +1,53 @@
+#pragma once
+
+#include <obs-module.h>
+
+/*
+ * Disk-backed packet storage for the replay buffer.  Packets are appended to
+ * a memory-mapped ring file, and only the positions of video
+ * keyframes are kept in memory, so memory usage doesn't grow with the length
+ * of the replay.  Purging drops the oldest keyframe group by moving the head
+ * of the ring.
+ *
+ * The ring is written by the output's packet thread.  A save may read it
+ * from another thread at the same time, which keeps the writer from
+ * overwriting anything the reader hasn't reached yet.
+ */
+
+struct replay_ring;
+
+struct replay_ring_iter {
+	uint64_t pos;
+	uint64_t end;
+	/* position of the last packet read */
+	uint64_t last;
+	uint64_t limit;
+};
+
+struct replay_ring *replay_ring_create(const char *dir, uint64_t capacity);
+void replay_ring_destroy(struct replay_ring *ring);
+
+/* drops all packets, a save that's in progress is unaffected */
+void replay_ring_clear(struct replay_ring *ring);
+
+/* Appends a packet, purging the oldest keyframe groups if the ring is full.
+ * Returns false if the packet had to be dropped, in which case packets are
+ * dropped until the next video keyframe. */
+bool replay_ring_push(struct replay_ring *ring, const struct encoder_packet *packet);
+
+/* drops the oldest keyframe group */
+bool replay_ring_purge(struct replay_ring *ring);
+
+uint64_t replay_ring_size(const struct replay_ring *ring);
+int64_t replay_ring_start_time(const struct replay_ring *ring);
+size_t replay_ring_keyframes(const struct replay_ring *ring);
+
+/* Reads the packets that are in the ring when the read begins, which has
+ * to be called on the thread that pushes packets.  Packet data points into
+ * the mapping and stays valid until it's released with
+ * replay_ring_read_release, which lets the writer reuse everything before
+ * pos, or until replay_ring_read_end. */
+void replay_ring_read_begin(struct replay_ring *ring, struct replay_ring_iter *iter);
+bool replay_ring_read_next(struct replay_ring *ring, struct replay_ring_iter *iter, struct encoder_packet *packet);
+void replay_ring_read_release(struct replay_ring *ring, uint64_t pos);
+void replay_ring_read_end(struct replay_ring *ring);
@@ -0,0 +1,390 @@
+#pragma once
+
+#include <float.h>
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <util/c99defs.h>
+#include <util/sse-intrin.h>
+
+/*
+ * Block kernels shared by the compressor, expander, limiter and noise gate
+ * filters.  The dB conversions use polynomial log2/exp2 approximations in
+ * place of log10f/powf:
+ *
+ *   - dsp_log2_ps:  absolute error below 4e-6 for inputs >= FLT_MIN, and
+ *                   below 2e-6 (about 1e-5 dB) between -120 and +20 dB
+ *   - dsp_exp2_ps:  relative error below 3e-7 for inputs in [-126, 126]
+ *
+ * Inputs below FLT_MIN (including 0) are treated as FLT_MIN, around
+ * -758 dB, instead of -inf.  Every filter clamps its gain well above that,
+ * so the result matches the exact conversions.
+ */
+
+#define DSP_DB_PER_LOG2 6.0205999f     /* 20 * log10(2) */
+#define DSP_LOG2_PER_DB 0.16609640f    /* log2(10) / 20 */
+
+static inline __m128 dsp_log2_ps(__m128 x)
+{
+	const __m128 one = _mm_set1_ps(1.0f);
+
+	x = _mm_max_ps(x, _mm_set1_ps(FLT_MIN));
+
+	__m128i bits = _mm_castps_si128(x);
+	__m128i exp = _mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127));
+	__m128 m = _mm_castsi128_ps(
+		_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007fffff)), _mm_set1_epi32(0x3f800000)));
+
+	/* keep the mantissa in [sqrt(2)/2, sqrt(2)) so the series below
+	 * converges quickly */
+	__m128 big = _mm_cmpgt_ps(m, _mm_set1_ps(1.41421356f));
+	m = _mm_sub_ps(m, _mm_and_ps(big, _mm_mul_ps(m, _mm_set1_ps(0.5f))));
+	__m128 e = _mm_add_ps(_mm_cvtepi32_ps(exp), _mm_and_ps(big, one));
+
+	/* log2(m) = 2/ln(2) * atanh(t), t = (m - 1) / (m + 1) */
+	__m128 t = _mm_div_ps(_mm_sub_ps(m, one), _mm_add_ps(m, one));
+	__m128 t2 = _mm_mul_ps(t, t);
+	__m128 p = _mm_set1_ps(0.41219858f);
+	p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(0.57707802f));
+	p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(0.96179669f));
+	p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(2.88539008f));
+
+	return _mm_add_ps(e, _mm_mul_ps(p, t));
+}
+
+static inline __m128 dsp_exp2_ps(__m128 x)
+{
+	x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-126.0f)), _mm_set1_ps(126.0f));
+
+	/* split into a rounded integer and a fraction in [-0.5, 0.5] */
+	__m128i ipart = _mm_cvtps_epi32(x);
+	__m128 f = _mm_sub_ps(x, _mm_cvtepi32_ps(ipart));
+
+	/* 2^f = e^(f * ln(2)), Taylor series */
+	__m128 p = _mm_set1_ps(1.5403530e-4f);
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.3333558e-3f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(9.6181291e-3f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(5.5504109e-2f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(2.4022651e-1f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(6.9314718e-1f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.0f));
+
+	__m128i scale = _mm_slli_epi32(_mm_add_epi32(ipart, _mm_set1_epi32(127)), 23);
+	return _mm_mul_ps(p, _mm_castsi128_ps(scale));
+}
+
+static inline __m128 dsp_mul_to_db_ps(__m128 mul)
+{
+	return _mm_mul_ps(dsp_log2_ps(mul), _mm_set1_ps(DSP_DB_PER_LOG2));
+}
+
+static inline __m128 dsp_db_to_mul_ps(__m128 db)
+{
+	return dsp_exp2_ps(_mm_mul_ps(db, _mm_set1_ps(DSP_LOG2_PER_DB)));
+}
+
+/* loads the last count (< 4) floats of a block, padding with pad */
+static inline __m128 dsp_load_tail(const float *src, size_t count, float pad)
+{
+	float tail[4] = {pad, pad, pad, pad};
+	for (size_t i = 0; i < count; i++)
+		tail[i] = src[i];
+	return _mm_loadu_ps(tail);
+}
+
+static inline void dsp_store_tail(float *dst, __m128 val, size_t count)
+{
+	float tail[4];
+	_mm_storeu_ps(tail, val);
+	for (size_t i = 0; i < count; i++)
+		dst[i] = tail[i];
+}
+
+/* converts count linear levels to dB, dst may equal src */
+static inline void dsp_mul_to_db(float *dst, const float *src, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_ps(dst + i, dsp_mul_to_db_ps(_mm_loadu_ps(src + i)));
+
+	if (i < count)
+		dsp_store_tail(dst + i, dsp_mul_to_db_ps(dsp_load_tail(src + i, count - i, 1.0f)), count - i);
+}
+
+/* converts count dB values clamped to max_db into linear gains multiplied
+ * by output_gain, in place */
+static inline void dsp_db_to_mul(float *buf, size_t count, float max_db, float output_gain)
+{
+	const __m128 max = _mm_set1_ps(max_db);
+	const __m128 out = _mm_set1_ps(output_gain);
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 db = _mm_min_ps(_mm_loadu_ps(buf + i), max);
+		_mm_storeu_ps(buf + i, _mm_mul_ps(dsp_db_to_mul_ps(db), out));
+	}
+
+	if (i < count) {
+		__m128 db = _mm_min_ps(dsp_load_tail(buf + i, count - i, 0.0f), max);
+		dsp_store_tail(buf + i, _mm_mul_ps(dsp_db_to_mul_ps(db), out), count - i);
+	}
+}
+
+/* linear gain of a downward compressor:
+ * 10^(min(0, slope * (threshold - env_db)) / 20) * output_gain */
+static inline __m128 dsp_compressor_gain_ps(__m128 env, __m128 threshold, __m128 slope, __m128 output_gain)
+{
+	__m128 gain_db = _mm_mul_ps(slope, _mm_sub_ps(threshold, dsp_mul_to_db_ps(env)));
+	gain_db = _mm_min_ps(gain_db, _mm_setzero_ps());
+	return _mm_mul_ps(dsp_db_to_mul_ps(gain_db), output_gain);
+}
+
+/* turns count envelope values into compressor gains, in place */
+static inline void dsp_compressor_gain(float *buf, size_t count, float threshold, float slope, float output_gain)
+{
+	const __m128 thresh = _mm_set1_ps(threshold);
+	const __m128 slp = _mm_set1_ps(slope);
+	const __m128 out = _mm_set1_ps(output_gain);
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_ps(buf + i, dsp_compressor_gain_ps(_mm_loadu_ps(buf + i), thresh, slp, out));
+
+	if (i < count) {
+		__m128 env = dsp_load_tail(buf + i, count - i, 0.0f);
+		dsp_store_tail(buf + i, dsp_compressor_gain_ps(env, thresh, slp, out), count - i);
+	}
+}
+
+/* Peak envelope follower.  Folds the envelope of samples, starting at env,
+ * into env_buf by taking the maximum, and returns the last envelope value.
+ * The coefficient is selected without branching, which keeps the loop free
+ * of data-dependent mispredictions. */
+static inline float dsp_envelope_follow(float *env_buf, const float *samples, size_t count, float env,
+					float attack_gain, float release_gain)
+{
+	for (size_t i = 0; i < count; i++) {
+		const float env_in = fabsf(samples[i]);
+		const float coef = env < env_in ? attack_gain : release_gain;
+
+		env = env_in + coef * (env - env_in);
+		env_buf[i] = fmaxf(env_buf[i], env);
+	}
+
+	return env;
+}
+
+/* writes the highest absolute sample of all non-null channels to dst */
+static inline void dsp_abs_max(float *dst, float **samples, size_t channels, size_t count)
+{
+	const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 level = _mm_setzero_ps();
+
+		for (size_t c = 0; c < channels; c++) {
+			if (samples[c])
+				level = _mm_max_ps(level, _mm_and_ps(_mm_loadu_ps(samples[c] + i), abs_mask));
+		}
+
+		_mm_storeu_ps(dst + i, level);
+	}
+
+	for (; i < count; i++) {
+		float level = 0.0f;
+
+		for (size_t c = 0; c < channels; c++) {
+			if (samples[c])
+				level = fmaxf(level, fabsf(samples[c][i]));
+		}
+
+		dst[i] = level;
+	}
+}
+
+/* multiplies count samples of a channel by the per-sample gain */
+static inline void dsp_apply_gain(float *samples, const float *gain, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_ps(samples + i, _mm_mul_ps(_mm_loadu_ps(samples + i), _mm_loadu_ps(gain + i)));
+
+	for (; i < count; i++)
+		samples[i] *= gain[i];
+}
+
+/* multiplies every non-null channel by the per-sample gain */
+static inline void dsp_apply_gain_channels(float **samples, size_t channels, const float *gain, size_t count)
+{
+	for (size_t c = 0; c < channels; c++) {
+		if (samples[c])
+			dsp_apply_gain(samples[c], gain, count);
+	}
+}
+
+/* Detection stage of the compressor and limiter.  Writes the highest
+ * envelope of all non-null channels to env_buf, starting each channel at
+ * env, and returns the envelope to start the next block with. */
+static inline float dsp_envelope_analyze(float *env_buf, float **samples, size_t channels, size_t count, float env,
+					 float attack_gain, float release_gain)
+{
+	memset(env_buf, 0, count * sizeof(env_buf[0]));
+
+	for (size_t c = 0; c < channels; c++) {
+		if (samples[c])
+			dsp_envelope_follow(env_buf, samples[c], count, env, attack_gain, release_gain);
+	}
+
+	return env_buf[count - 1];
+}
+
+/* Gain stage of the compressor and limiter.  Turns the envelope in env_buf
+ * into gains in place and applies them to every non-null channel. */
+static inline void dsp_compress(float **samples, size_t channels, float *env_buf, size_t count, float threshold,
+				float slope, float output_gain)
+{
+	dsp_compressor_gain(env_buf, count, threshold, slope, output_gain);
+	dsp_apply_gain_channels(samples, channels, env_buf, count);
+}
+
+struct dsp_expander_params {
+	float threshold;
+	float slope;
+	float knee;
+	float attack_gain;
+	float release_gain;
+	bool is_upwcomp;
+};
+
+/* gain stage and ballistics of the expander and upward compressor, in dB */
+static inline float dsp_expander_gain_db(const struct dsp_expander_params *p, float env_db, float prev_gain)
+{
+	const float threshold = p->threshold;
+	const float knee = p->knee;
+	float diff = threshold - env_db;
+
+	if (p->is_upwcomp && env_db <= (threshold - 60.0f) / 2)
+		diff = env_db + 60.0f > 0 ? env_db + 60.0f : 0.0f;
+
+	float gain = 0.0f;
+	// Note that the gain is always >= 0 for the upward compressor
+	// but is always <=0 for the expander.
+	if (p->is_upwcomp) {
+		prev_gain = fmaxf(prev_gain, 0);
+		// gain above knee (included for clarity):
+		if (env_db >= threshold + knee / 2)
+			gain = 0.0f;
+		// gain below knee:
+		if (threshold - knee / 2 >= env_db)
+			gain = p->slope * diff;
+		// gain in knee:
+		if (env_db > threshold - knee / 2 && threshold + knee / 2 > env_db) {
+			const float knee_diff = diff + knee / 2;
+			gain = p->slope * (knee_diff * knee_diff) / (2.0f * knee);
+		}
+	} else {
+		gain = diff > 0.0f ? fmaxf(p->slope * diff, -60.0f) : 0.0f;
+	}
+
+	/* ballistics (attack/release) */
+	const bool attack = gain > prev_gain;
+	const float coef = attack ? p->attack_gain : p->release_gain;
+
+	return coef * prev_gain + (1.0f - coef) * gain;
+}
+
+/* Runs one channel of the expander or upward compressor.  gain_db is
+ * scratch space for count values, prev_gain_db is the last gain of the
+ * previous block, which is also what is returned for the next one.  The
+ * gains are applied to samples unless it is null. */
+static inline float dsp_expand(float *samples, float *gain_db, const float *env, size_t count, float prev_gain_db,
+			       float output_gain, const struct dsp_expander_params *p)
+{
+	/* the dB conversions are done a block at a time, only the
+	 * ballistics have to run sample by sample */
+	dsp_mul_to_db(gain_db, env, count);
+
+	for (size_t i = 0; i < count; i++) {
+		prev_gain_db = dsp_expander_gain_db(p, gain_db[i], prev_gain_db);
+		gain_db[i] = prev_gain_db;
+	}
+
+	dsp_db_to_mul(gain_db, count, p->is_upwcomp ? INFINITY : 0.0f, output_gain);
+	if (samples)
+		dsp_apply_gain(samples, gain_db, count);
+
+	return prev_gain_db;
+}
+
+struct dsp_noise_gate {
+	float open_threshold;
+	float close_threshold;
+	float decay_rate;
+	float attack_rate;
+	float release_rate;
+	float hold_time;
+	float sample_rate_i;
+
+	bool is_open;
+	float attenuation;
+	float level;
+	float held_time;
+};
+
+/* Runs the noise gate over count frames.  level_buf is scratch space for
+ * count values: it holds the peak level of each frame, and is overwritten
+ * with the attenuation that is then applied to every channel. */
+static inline void dsp_noise_gate(struct dsp_noise_gate *ng, float *level_buf, float **samples, size_t channels,
+				  size_t count)
+{
+	const float close_threshold = ng->close_threshold;
+	const float open_threshold = ng->open_threshold;
+	const float sample_rate_i = ng->sample_rate_i;
+	const float release_rate = ng->release_rate;
+	const float attack_rate = ng->attack_rate;
+	const float decay_rate = ng->decay_rate;
+	const float hold_time = ng->hold_time;
+
+	bool is_open = ng->is_open;
+	float attenuation = ng->attenuation;
+	float level = ng->level;
+	float held_time = ng->held_time;
+
+	dsp_abs_max(level_buf, samples, channels, count);
+
+	for (size_t i = 0; i < count; i++) {
+		const float cur_level = level_buf[i];
+
+		if (cur_level > open_threshold && !is_open) {
+			is_open = true;
+		}
+		if (level < close_threshold && is_open) {
+			held_time = 0.0f;
+			is_open = false;
+		}
+
+		level = fmaxf(level, cur_level) - decay_rate;
+
+		if (is_open) {
+			attenuation = fminf(1.0f, attenuation + attack_rate);
+		} else {
+			held_time += sample_rate_i;
+			if (held_time > hold_time) {
+				attenuation = fmaxf(0.0f, attenuation - release_rate);
+			}
+		}
+
+		level_buf[i] = attenuation;
+	}
+
+	ng->is_open = is_open;
+	ng->attenuation = attenuation;
+	ng->level = level;
+	ng->held_time = held_time;
+
+	dsp_apply_gain_channels(samples, channels, level_buf, count);
+}
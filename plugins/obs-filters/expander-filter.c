@@ -8,6 +8,8 @@
 #include <util/deque.h>
 #include <util/threading.h>
 
+#include "dynamics-dsp.h"
+
 /* -------------------------------------------------------- */
 
 #define do_log(level, format, ...) \
@@ -299,15 +301,15 @@ static void analyze_envelope(struct expander_data *cd, float **samples, const ui
 		float *env_in = cd->env_in;
 
 		if (cd->detector == RMS_DETECT) {
-			runave[0] = rmscoef * cd->runave[chan] + (1 - rmscoef) * powf(samples[chan][0], 2.0f);
+			runave[0] = rmscoef * cd->runave[chan] + (1 - rmscoef) * (samples[chan][0] * samples[chan][0]);
 			env_in[0] = sqrtf(fmaxf(runave[0], 0));
 			for (uint32_t i = 1; i < num_samples; ++i) {
-				runave[i] = rmscoef * runave[i - 1] + (1 - rmscoef) * powf(samples[chan][i], 2.0f);
+				runave[i] = rmscoef * runave[i - 1] + (1 - rmscoef) * (samples[chan][i] * samples[chan][i]);
 				env_in[i] = sqrtf(runave[i]);
 			}
 		} else if (cd->detector == PEAK_DETECT) {
 			for (uint32_t i = 0; i < num_samples; ++i) {
-				runave[i] = powf(samples[chan][i], 2);
+				runave[i] = samples[chan][i] * samples[chan][i];
 				env_in[i] = fabsf(samples[chan][i]);
 			}
 		}
@@ -319,90 +321,24 @@ static void analyze_envelope(struct expander_data *cd, float **samples, const ui
 	}
 }
 
-static inline void process_sample(size_t idx, float *samples, float *env_buf, float *gain_db, bool is_upwcomp,
-				  float channel_gain, float threshold, float slope, float attack_gain,
-				  float inv_attack_gain, float release_gain, float inv_release_gain, float output_gain,
-				  float knee)
-{
-	/* --------------------------------- */
-	/* gain stage of expansion           */
-
-	float env_db = mul_to_db(env_buf[idx]);
-	float diff = threshold - env_db;
-
-	if (is_upwcomp && env_db <= (threshold - 60.0f) / 2)
-		diff = env_db + 60.0f > 0 ? env_db + 60.0f : 0.0f;
-
-	float gain = 0.0f;
-	float prev_gain = 0.0f;
-	// Note that the gain is always >= 0 for the upward compressor
-	// but is always <=0 for the expander.
-	if (is_upwcomp) {
-		prev_gain = idx > 0 ? fmaxf(gain_db[idx - 1], 0) : fmaxf(channel_gain, 0);
-		// gain above knee (included for clarity):
-		if (env_db >= threshold + knee / 2)
-			gain = 0.0f;
-		// gain below knee:
-		if (threshold - knee / 2 >= env_db)
-			gain = slope * diff;
-		// gain in knee:
-		if (env_db > threshold - knee / 2 && threshold + knee / 2 > env_db)
-			gain = slope * powf(diff + knee / 2, 2) / (2.0f * knee);
-	} else {
-		prev_gain = idx > 0 ? gain_db[idx - 1] : channel_gain;
-		gain = diff > 0.0f ? fmaxf(slope * diff, -60.0f) : 0.0f;
-	}
-
-	/* --------------------------------- */
-	/* ballistics (attack/release)       */
-
-	if (gain > prev_gain)
-		gain_db[idx] = attack_gain * prev_gain + inv_attack_gain * gain;
-	else
-		gain_db[idx] = release_gain * prev_gain + inv_release_gain * gain;
-
-	/* --------------------------------- */
-	/* output                            */
-
-	if (!is_upwcomp) {
-		gain = db_to_mul(fminf(0, gain_db[idx]));
-	} else {
-		gain = db_to_mul(gain_db[idx]);
-	}
-
-	samples[idx] *= gain * output_gain;
-}
-
 // gain stage and ballistics in dB domain
 static inline void process_expansion(struct expander_data *cd, float **samples, uint32_t num_samples)
 {
-	const float attack_gain = cd->attack_gain;
-	const float release_gain = cd->release_gain;
-	const float inv_attack_gain = 1.0f - attack_gain;
-	const float inv_release_gain = 1.0f - release_gain;
-	const float threshold = cd->threshold;
-	const float slope = cd->slope;
-	const float output_gain = cd->output_gain;
-	const bool is_upwcomp = cd->is_upwcomp;
-	const float knee = cd->knee;
+	const struct dsp_expander_params params = {
+		.threshold = cd->threshold,
+		.slope = cd->slope,
+		.knee = cd->knee,
+		.attack_gain = cd->attack_gain,
+		.release_gain = cd->release_gain,
+		.is_upwcomp = cd->is_upwcomp,
+	};
 
 	if (cd->gain_db_len < num_samples)
 		resize_gain_db_buffer(cd, num_samples);
 
-	for (size_t i = 0; i < cd->num_channels; i++)
-		memset(cd->gain_db[i], 0, num_samples * sizeof(cd->gain_db[i][0]));
-
 	for (size_t chan = 0; chan < cd->num_channels; chan++) {
-		float *channel_samples = samples[chan];
-		float *env_buf = cd->envelope_buf[chan];
-		float *gain_db = cd->gain_db[chan];
-		float channel_gain = cd->gain_db_buf[chan];
-
-		for (size_t i = 0; i < num_samples; ++i) {
-			process_sample(i, channel_samples, env_buf, gain_db, is_upwcomp, channel_gain, threshold, slope,
-				       attack_gain, inv_attack_gain, release_gain, inv_release_gain, output_gain, knee);
-		}
-		cd->gain_db_buf[chan] = gain_db[num_samples - 1];
+		cd->gain_db_buf[chan] = dsp_expand(samples[chan], cd->gain_db[chan], cd->envelope_buf[chan],
+						   num_samples, cd->gain_db_buf[chan], cd->output_gain, &params);
 	}
 }
 
@@ -63,6 +63,10 @@ extern void write_file_info(FILE *file, int64_t duration_ms, int64_t size);
 extern void flv_meta_data(obs_output_t *context, uint8_t **output, size_t *size, bool write_header);
 extern void flv_packet_mux(struct encoder_packet *packet, int32_t dts_offset, uint8_t **output, size_t *size,
 			   bool is_header);
+// Same as the above, but only writes the FLV tag header and the body bytes
+// that precede the packet data.  The packet data and the previous tag size
+// are left for the caller to send from the packet itself.
+extern void flv_packet_mux_header(struct encoder_packet *packet, int32_t dts_offset, uint8_t **output, size_t *size);
 // Y2023 spec
 extern void flv_packet_start(struct encoder_packet *packet, enum video_id_t codec, uint8_t **output, size_t *size,
 			     size_t idx);
@@ -77,3 +81,7 @@ extern void flv_packet_audio_start(struct encoder_packet *packet, enum audio_id_
 				   size_t idx);
 extern void flv_packet_audio_frames(struct encoder_packet *packet, enum audio_id_t codec, int32_t dts_offset,
 				    uint8_t **output, size_t *size, size_t idx);
+extern void flv_packet_frames_header(struct encoder_packet *packet, enum video_id_t codec, int32_t dts_offset,
+				     uint8_t **output, size_t *size, size_t idx);
+extern void flv_packet_audio_frames_header(struct encoder_packet *packet, enum audio_id_t codec, int32_t dts_offset,
+					   uint8_t **output, size_t *size, size_t idx);
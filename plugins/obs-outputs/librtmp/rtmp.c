@@ -35,6 +35,10 @@
 #include "happy-eyeballs.h"
 #include <util/platform.h>
 
+#ifndef _WIN32
+#include <sys/uio.h>
+#endif
+
 #if !defined(MSG_NOSIGNAL)
 #define MSG_NOSIGNAL 0
 #endif
@@ -1576,11 +1580,38 @@ ReadN(RTMP *r, char *buffer, int n)
     return nOriginalSize - n;
 }
 
+/* Returns TRUE if the failed send should be retried, otherwise records the
+ * error and tears down the connection. */
+static int
+HandleSendError(RTMP *r, int n)
+{
+    struct linger l;
+    int sockerr = GetSockError();
+    RTMP_Log(RTMP_LOGERROR, "%s, RTMP send error %d (%d bytes)", __FUNCTION__,
+             sockerr, n);
+
+    if (sockerr == EINTR && !RTMP_ctrlC)
+        return TRUE;
+
+    r->last_error_code = sockerr;
+
+    // Force-close the socket. Sometimes a send() error isn't fatal, so
+    // we could end up writing an unpublish message which some services
+    // treat as a clean shutdown. We need to disable lingering too so
+    // the remote side sees an abortive shutdown (RST).
+    l.l_onoff = 1;
+    l.l_linger = 0;
+    setsockopt(r->m_sb.sb_socket, SOL_SOCKET, SO_LINGER, (char *)&l, sizeof(l));
+    RTMPSockBuf_Close(&r->m_sb);
+
+    RTMP_Close(r);
+    return FALSE;
+}
+
 static int
 WriteN(RTMP *r, const char *buffer, int n)
 {
     const char *ptr = buffer;
-    struct linger l;
 
     while (n > 0)
     {
@@ -1596,25 +1627,8 @@ WriteN(RTMP *r, const char *buffer, int n)
 
         if (nBytes < 0)
         {
-            int sockerr = GetSockError();
-            RTMP_Log(RTMP_LOGERROR, "%s, RTMP send error %d (%d bytes)", __FUNCTION__,
-                     sockerr, n);
-
-            if (sockerr == EINTR && !RTMP_ctrlC)
+            if (HandleSendError(r, n))
                 continue;
-
-            r->last_error_code = sockerr;
-
-            // Force-close the socket. Sometimes a send() error isn't fatal, so
-            // we could end up writing an unpublish message which some services
-            // treat as a clean shutdown. We need to disable lingering too so
-            // the remote side sees an abortive shutdown (RST).
-            l.l_onoff = 1;
-            l.l_linger = 0;
-            setsockopt(r->m_sb.sb_socket, SOL_SOCKET, SO_LINGER, (char *)&l, sizeof(l));
-            RTMPSockBuf_Close(&r->m_sb);
-
-            RTMP_Close(r);
             n = 1;
             break;
         }
@@ -1629,6 +1643,124 @@ WriteN(RTMP *r, const char *buffer, int n)
     return n == 0;
 }
 
+typedef struct RTMPWriteBuf
+{
+    const char *buf;
+    int len;
+} RTMPWriteBuf;
+
+#define RTMP_MAX_WRITE_BUFS 64
+
+/* Writes the buffers in order.  Plain sockets hand them to the kernel in a
+ * single gather write; everything else has to see contiguous data, so the
+ * buffers are either written one at a time or coalesced first.  payloadSize
+ * is the part of the buffers that isn't chunk headers, it's what gets counted
+ * in m_nBytesCopied if the buffers have to be copied. */
+static int
+WriteBufs(RTMP *r, RTMPWriteBuf *bufs, int count, int payloadSize)
+{
+    int total = 0;
+    int i;
+
+    for (i = 0; i < count; i++)
+        total += bufs[i].len;
+
+    if ((r->Link.protocol & RTMP_FEATURE_HTTP)
+#if defined(CRYPTO) && !defined(NO_SSL)
+            || r->m_sb.sb_ssl
+#endif
+#if defined(RTMP_NETSTACK_DUMP)
+            || 1
+#endif
+       )
+    {
+        char *tbuf = malloc(total), *toff = tbuf;
+        int ret;
+
+        if (!tbuf)
+            return FALSE;
+        for (i = 0; i < count; i++)
+        {
+            memcpy(toff, bufs[i].buf, bufs[i].len);
+            toff += bufs[i].len;
+        }
+        r->m_nBytesCopied += payloadSize;
+        ret = WriteN(r, tbuf, total);
+        free(tbuf);
+        return ret;
+    }
+
+    if (r->m_bCustomSend && r->m_customSendFunc)
+    {
+        /* the custom send function queues (copies) the data itself */
+        r->m_nBytesCopied += payloadSize;
+        for (i = 0; i < count; i++)
+        {
+            if (!WriteN(r, bufs[i].buf, bufs[i].len))
+                return FALSE;
+        }
+        return TRUE;
+    }
+
+    while (count)
+    {
+        int nBytes;
+
+#ifdef _WIN32
+        WSABUF wsabufs[RTMP_MAX_WRITE_BUFS];
+        DWORD sent = 0;
+
+        for (i = 0; i < count; i++)
+        {
+            wsabufs[i].buf = (char *)bufs[i].buf;
+            wsabufs[i].len = bufs[i].len;
+        }
+        if (WSASend(r->m_sb.sb_socket, wsabufs, count, &sent, 0, NULL, NULL) != 0)
+            nBytes = -1;
+        else
+            nBytes = (int)sent;
+#else
+        struct iovec iov[RTMP_MAX_WRITE_BUFS];
+        struct msghdr msg = {0};
+
+        for (i = 0; i < count; i++)
+        {
+            iov[i].iov_base = (void *)bufs[i].buf;
+            iov[i].iov_len = bufs[i].len;
+        }
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+        nBytes = (int)sendmsg(r->m_sb.sb_socket, &msg, MSG_NOSIGNAL);
+#endif
+
+        if (nBytes < 0)
+        {
+            if (HandleSendError(r, total))
+                continue;
+            return FALSE;
+        }
+
+        if (nBytes == 0)
+            return FALSE;
+
+        /* skip what was sent and resume from the partially written buffer */
+        total -= nBytes;
+        while (count && nBytes >= bufs->len)
+        {
+            nBytes -= bufs->len;
+            bufs++;
+            count--;
+        }
+        if (count)
+        {
+            bufs->buf += nBytes;
+            bufs->len -= nBytes;
+        }
+    }
+
+    return TRUE;
+}
+
 #define SAVC(x)	static const AVal av_##x = AVC(#x)
 
 SAVC(app);
@@ -4085,18 +4217,18 @@ RTMP_SendChunk(RTMP *r, RTMPChunk *chunk)
     return wrote;
 }
 
-int
-RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
+/* Makes room for the packet's channel and encodes its chunk header so that it
+ * ends at hend, compressing it against the previous packet on the channel. */
+static int
+EncodePacketHeader(RTMP *r, RTMPPacket *packet, char *hend, char **header_out, int *hSize_out,
+                   int *cSize_out, uint32_t *t_out, char *c_out)
 {
     const RTMPPacket *prevPacket;
     uint32_t last = 0;
     int nSize;
     int hSize, cSize;
-    char *header, *hptr, *hend, hbuf[RTMP_MAX_HEADER_SIZE], c;
+    char *header, *hptr, c;
     uint32_t t;
-    char *buffer, *tbuf = NULL, *toff = NULL;
-    int nChunkSize;
-    int tlen;
 
     if (packet->m_nChannel >= r->m_channelsAllocatedOut)
     {
@@ -4151,16 +4283,7 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
     t = packet->m_nTimeStamp - last;
     packet->m_nLastWireTimeStamp = t;
 
-    if (packet->m_body)
-    {
-        header = packet->m_body - nSize;
-        hend = packet->m_body;
-    }
-    else
-    {
-        header = hbuf + 6;
-        hend = hbuf + sizeof(hbuf);
-    }
+    header = hend - nSize;
 
     if (packet->m_nChannel > 319)
         cSize = 2;
@@ -4217,6 +4340,41 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
     if (nSize > 1 && t >= 0xffffff)
         hptr = AMF_EncodeInt32(hptr, hend, t);
 
+    *header_out = header;
+    *hSize_out = hSize;
+    *cSize_out = cSize;
+    *t_out = t;
+    *c_out = c;
+    return TRUE;
+}
+
+static void
+StoreLastPacket(RTMP *r, const RTMPPacket *packet)
+{
+    if (!r->m_vecChannelsOut[packet->m_nChannel])
+        r->m_vecChannelsOut[packet->m_nChannel] = malloc(sizeof(RTMPPacket));
+    memcpy(r->m_vecChannelsOut[packet->m_nChannel], packet, sizeof(RTMPPacket));
+}
+
+int
+RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
+{
+    int nSize;
+    int hSize, cSize;
+    char *header, *hend, hbuf[RTMP_MAX_HEADER_SIZE], c;
+    uint32_t t;
+    char *buffer, *tbuf = NULL, *toff = NULL;
+    int nChunkSize;
+    int tlen;
+
+    if (packet->m_body)
+        hend = packet->m_body;
+    else
+        hend = hbuf + sizeof(hbuf);
+
+    if (!EncodePacketHeader(r, packet, hend, &header, &hSize, &cSize, &t, &c))
+        return FALSE;
+
     nSize = packet->m_nBodySize;
     buffer = packet->m_body;
     nChunkSize = r->m_outChunkSize;
@@ -4314,9 +4472,7 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
         }
     }
 
-    if (!r->m_vecChannelsOut[packet->m_nChannel])
-        r->m_vecChannelsOut[packet->m_nChannel] = malloc(sizeof(RTMPPacket));
-    memcpy(r->m_vecChannelsOut[packet->m_nChannel], packet, sizeof(RTMPPacket));
+    StoreLastPacket(r, packet);
     return TRUE;
 }
 
@@ -5375,6 +5531,7 @@ RTMP_Write(RTMP *r, const char *buf, int size, int streamIdx)
         if (num > s2)
             num = s2;
         memcpy(enc, buf, num);
+        r->m_nBytesCopied += num;
         pkt->m_nBytesRead += num;
         s2 -= num;
         buf += num;
@@ -5393,3 +5550,122 @@ RTMP_Write(RTMP *r, const char *buf, int size, int streamIdx)
     }
     return size+s2;
 }
+
+/* Sends a single FLV tag whose body is split between the tail of the tag
+ * buffer (anything after the 11 byte tag header) and a separate payload.  Only
+ * the RTMP chunk headers are built here; the payload is written in place. */
+int
+RTMP_WriteTag(RTMP *r, const char *tag, int tagSize, const char *payload, int payloadSize,
+              int streamIdx)
+{
+    RTMPPacket packet = {0};
+    RTMPWriteBuf bufs[RTMP_MAX_WRITE_BUFS];
+    char hbuf[RTMP_MAX_HEADER_SIZE];
+    char cbufs[RTMP_MAX_WRITE_BUFS / 2][RTMP_MAX_HEADER_SIZE];
+    char *header, c;
+    const char *prefix = tag + 11;
+    int prefixSize = tagSize - 11;
+    int hSize, cSize, nSize, nChunkSize, numBufs = 0, numHeaders = 0, bufsPayload = 0;
+    uint32_t t;
+
+    if (tagSize < 11)
+        return FALSE;
+
+    packet.m_nChannel = 0x04;	/* source channel */
+    packet.m_nInfoField2 = r->Link.streams[streamIdx].id;
+    packet.m_packetType = tag[0];
+    packet.m_nBodySize = AMF_DecodeInt24(tag + 1);
+    packet.m_nTimeStamp = AMF_DecodeInt24(tag + 4);
+    packet.m_nTimeStamp |= (uint8_t)tag[7] << 24;
+    packet.m_hasAbsTimestamp = 0;
+
+    if (packet.m_nBodySize != (uint32_t)(prefixSize + payloadSize))
+    {
+        RTMP_Log(RTMP_LOGERROR, "%s, tag size mismatch", __FUNCTION__);
+        return FALSE;
+    }
+
+    if (((packet.m_packetType == RTMP_PACKET_TYPE_AUDIO
+            || packet.m_packetType == RTMP_PACKET_TYPE_VIDEO) &&
+            !packet.m_nTimeStamp) || packet.m_packetType == RTMP_PACKET_TYPE_INFO)
+    {
+        packet.m_headerType = RTMP_PACKET_SIZE_LARGE;
+    }
+    else
+    {
+        packet.m_headerType = RTMP_PACKET_SIZE_MEDIUM;
+    }
+
+    if (!EncodePacketHeader(r, &packet, hbuf + sizeof(hbuf), &header, &hSize, &cSize, &t, &c))
+        return FALSE;
+
+    nSize = packet.m_nBodySize;
+
+    while (hSize || nSize)
+    {
+        nChunkSize = r->m_outChunkSize;
+        if (nSize < nChunkSize)
+            nChunkSize = nSize;
+
+        /* each chunk needs at most a header and two body slices */
+        if (numBufs + 3 > RTMP_MAX_WRITE_BUFS)
+        {
+            if (!WriteBufs(r, bufs, numBufs, bufsPayload))
+                return FALSE;
+            numBufs = 0;
+            bufsPayload = 0;
+
+            /* keep the pending continuation header, but let the rest of
+             * the header storage be reused */
+            memmove(cbufs[0], header, hSize);
+            header = cbufs[0];
+            numHeaders = 1;
+        }
+
+        bufs[numBufs].buf = header;
+        bufs[numBufs++].len = hSize;
+        nSize -= nChunkSize;
+
+        while (nChunkSize)
+        {
+            const char **src = prefixSize ? &prefix : &payload;
+            int *srcSize = prefixSize ? &prefixSize : &payloadSize;
+            int len = nChunkSize < *srcSize ? nChunkSize : *srcSize;
+
+            bufs[numBufs].buf = *src;
+            bufs[numBufs++].len = len;
+            bufsPayload += len;
+            *src += len;
+            *srcSize -= len;
+            nChunkSize -= len;
+        }
+
+        hSize = 0;
+
+        // prepare to send off remaining data in Type 3 chunks
+        if (nSize > 0)
+        {
+            header = cbufs[numHeaders++];
+            header[0] = (0xc0 | c);
+            hSize = 1;
+            if (cSize)
+            {
+                int tmp = packet.m_nChannel - 64;
+                header[hSize++] = tmp & 0xff;
+                if (cSize == 2)
+                    header[hSize++] = tmp >> 8;
+            }
+            if (t >= 0xffffff)
+            {
+                AMF_EncodeInt32(header + hSize, header + hSize + 4, t);
+                hSize += 4;
+            }
+        }
+    }
+
+    if (numBufs && !WriteBufs(r, bufs, numBufs, bufsPayload))
+        return FALSE;
+
+    StoreLastPacket(r, &packet);
+    return TRUE;
+}
@@ -454,6 +454,7 @@ extern "C"
         RTMP_LNK Link;
         int connect_time_ms;
         int last_error_code;
+        uint64_t m_nBytesCopied;	/* payload bytes copied on the send path */
 
 #ifdef CRYPTO
         TLS_CTX RTMP_TLS_ctx;
@@ -543,6 +544,8 @@ extern "C"
     void RTMP_DropRequest(RTMP *r, int i, int freeit);
     int RTMP_Read(RTMP *r, char *buf, int size);
     int RTMP_Write(RTMP *r, const char *buf, int size, int streamIdx);
+    int RTMP_WriteTag(RTMP *r, const char *tag, int tagSize,
+                      const char *payload, int payloadSize, int streamIdx);
 
 #ifdef USE_HASHSWF
     /* hashswf.c */
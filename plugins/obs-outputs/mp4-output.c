@@ -594,6 +594,66 @@ uint64_t mp4_output_total_bytes(void *data)
 	return out->total_bytes;
 }
 
+/* ------------------------------------------------------------------------ */
+/* Writes a complete set of packets to a file in-process, so that other
+ * outputs (i.e. the replay buffer) can save through this muxer without
+ * having to spawn a muxer process.  Registered on the global proc handler
+ * as:
+ *
+ *   void mp4_write_packets(ptr output, string path, ptr next_packet,
+ *                          ptr param, out bool success)
+ *
+ * next_packet is a bool (*)(void *param, struct encoder_packet *packet)
+ * that returns the packets in order, each of which has to stay valid until
+ * the next call.  The muxer takes its own references. */
+
+typedef bool (*mp4_next_packet_t)(void *param, struct encoder_packet *packet);
+
+void mp4_write_packets_proc(void *data, calldata_t *cd)
+{
+	obs_output_t *output = calldata_ptr(cd, "output");
+	const char *path = calldata_string(cd, "path");
+	mp4_next_packet_t next_packet = (mp4_next_packet_t)calldata_ptr(cd, "next_packet");
+	void *param = calldata_ptr(cd, "param");
+	struct encoder_packet pkt;
+	struct serializer s;
+	bool success = true;
+
+	UNUSED_PARAMETER(data);
+
+	if (!output || !path || !*path || !next_packet) {
+		calldata_set_bool(cd, "success", false);
+		return;
+	}
+
+	if (!buffered_file_serializer_init_defaults(&s, path)) {
+		blog(LOG_WARNING, "[mp4 output: '%s'] Unable to open file '%s'", obs_output_get_name(output), path);
+		calldata_set_bool(cd, "success", false);
+		return;
+	}
+
+	const char *ext = strrchr(path, '.');
+	enum mp4_flavor flavor = ext && astrcmpi(ext, ".mov") == 0 ? FLAVOR_MOV : FLAVOR_MP4;
+	struct mp4_mux *muxer = mp4_mux_create(output, &s, MP4_USE_NEGATIVE_CTS, flavor);
+
+	while (next_packet(param, &pkt)) {
+		mp4_mux_submit_packet(muxer, &pkt);
+
+		if (serializer_get_pos(&s) == -1) {
+			success = false;
+			break;
+		}
+	}
+
+	if (success)
+		success = mp4_mux_finalise(muxer);
+
+	buffered_file_serializer_free(&s);
+	mp4_mux_destroy(muxer);
+
+	calldata_set_bool(cd, "success", success);
+}
+
 struct obs_output_info mp4_output_info = {
 	.id = "mp4_output",
 	.flags = OBS_OUTPUT_AV | OBS_OUTPUT_ENCODED | OBS_OUTPUT_MULTI_TRACK_AV | OBS_OUTPUT_CAN_PAUSE,
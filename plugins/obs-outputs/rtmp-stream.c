@@ -396,6 +396,28 @@ static int handle_socket_read(struct rtmp_stream *stream)
 	return 0;
 }
 
+/* Sends an encoded packet as a single FLV tag, with only the tag header built
+ * here.  The packet data itself goes out on the socket without being copied. */
+static int write_packet_tag(struct rtmp_stream *stream, struct encoder_packet *packet, uint8_t *header,
+			    size_t header_size)
+{
+	/* the muxer skips empty packets */
+	if (!header_size)
+		return 0;
+
+#ifdef TEST_FRAMEDROPS
+	droptest_cap_data_rate(stream, header_size + packet->size + 4);
+#endif
+
+	if (!RTMP_WriteTag(&stream->rtmp, (char *)header, (int)header_size, (char *)packet->data, (int)packet->size,
+			   0))
+		return -1;
+
+	/* count the previous tag size too, to match the copying path */
+	stream->total_bytes_sent += header_size + packet->size + 4;
+	return 0;
+}
+
 static int send_packet(struct rtmp_stream *stream, struct encoder_packet *packet, bool is_header)
 {
 	uint8_t *data;
@@ -405,7 +427,15 @@ static int send_packet(struct rtmp_stream *stream, struct encoder_packet *packet
 	if (handle_socket_read(stream))
 		return -1;
 
-	flv_packet_mux(packet, is_header ? 0 : stream->start_dts_offset, &data, &size, is_header);
+	if (!is_header) {
+		flv_packet_mux_header(packet, stream->start_dts_offset, &data, &size);
+		ret = write_packet_tag(stream, packet, data, size);
+		bfree(data);
+		obs_encoder_packet_release(packet);
+		return ret;
+	}
+
+	flv_packet_mux(packet, 0, &data, &size, is_header);
 
 #ifdef TEST_FRAMEDROPS
 	droptest_cap_data_rate(stream, size);
@@ -413,11 +443,7 @@ static int send_packet(struct rtmp_stream *stream, struct encoder_packet *packet
 
 	ret = RTMP_Write(&stream->rtmp, (char *)data, (int)size, 0);
 	bfree(data);
-
-	if (is_header)
-		bfree(packet->data);
-	else
-		obs_encoder_packet_release(packet);
+	bfree(packet->data);
 
 	stream->total_bytes_sent += size;
 	return ret;
@@ -438,7 +464,12 @@ static int send_packet_ex(struct rtmp_stream *stream, struct encoder_packet *pac
 	} else if (is_footer) {
 		flv_packet_end(packet, stream->video_codec[idx], &data, &size, idx);
 	} else {
-		flv_packet_frames(packet, stream->video_codec[idx], stream->start_dts_offset, &data, &size, idx);
+		flv_packet_frames_header(packet, stream->video_codec[idx], stream->start_dts_offset, &data, &size,
+					 idx);
+		ret = write_packet_tag(stream, packet, data, size);
+		bfree(data);
+		obs_encoder_packet_release(packet);
+		return ret;
 	}
 
 #ifdef TEST_FRAMEDROPS
@@ -447,11 +478,7 @@ static int send_packet_ex(struct rtmp_stream *stream, struct encoder_packet *pac
 
 	ret = RTMP_Write(&stream->rtmp, (char *)data, (int)size, 0);
 	bfree(data);
-
-	if (is_header || is_footer) // manually created packets
-		bfree(packet->data);
-	else
-		obs_encoder_packet_release(packet);
+	bfree(packet->data); // manually created packets
 
 	stream->total_bytes_sent += size;
 	return ret;
@@ -466,19 +493,20 @@ static int send_audio_packet_ex(struct rtmp_stream *stream, struct encoder_packe
 	if (handle_socket_read(stream))
 		return -1;
 
-	if (is_header) {
-		flv_packet_audio_start(packet, stream->audio_codec[idx], &data, &size, idx);
-	} else {
-		flv_packet_audio_frames(packet, stream->audio_codec[idx], stream->start_dts_offset, &data, &size, idx);
+	if (!is_header) {
+		flv_packet_audio_frames_header(packet, stream->audio_codec[idx], stream->start_dts_offset, &data, &size,
+					       idx);
+		ret = write_packet_tag(stream, packet, data, size);
+		bfree(data);
+		obs_encoder_packet_release(packet);
+		return ret;
 	}
 
+	flv_packet_audio_start(packet, stream->audio_codec[idx], &data, &size, idx);
+
 	ret = RTMP_Write(&stream->rtmp, (char *)data, (int)size, 0);
 	bfree(data);
-
-	if (is_header)
-		bfree(packet->data);
-	else
-		obs_encoder_packet_release(packet);
+	bfree(packet->data);
 
 	return ret;
 }
@@ -626,9 +654,22 @@ static void log_sndbuf_size(struct rtmp_stream *stream)
 }
 #endif
 
+static void log_bytes_copied(struct rtmp_stream *stream, uint64_t start_time)
+{
+	uint64_t duration_ms = (os_gettime_ns() - start_time) / 1000000;
+	uint64_t copied = stream->rtmp.m_nBytesCopied;
+
+	if (!duration_ms)
+		return;
+
+	info("Copied %" PRIu64 " of %" PRIu64 " bytes on the send path (%" PRIu64 " bytes/sec)", copied,
+	     stream->total_bytes_sent, copied * 1000 / duration_ms);
+}
+
 static void *send_thread(void *data)
 {
 	struct rtmp_stream *stream = data;
+	uint64_t start_time = os_gettime_ns();
 
 	os_set_thread_name("rtmp-stream: send_thread");
 
@@ -703,6 +744,8 @@ static void *send_thread(void *data)
 		send_footers(stream); // Y2023 spec
 	}
 
+	log_bytes_copied(stream, start_time);
+
 #ifdef _WIN32
 	log_sndbuf_size(stream);
 #endif
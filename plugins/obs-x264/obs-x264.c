@@ -49,8 +49,6 @@ struct obs_x264 {
 	x264_param_t params;
 	x264_t *context;
 
-	DARRAY(uint8_t) packet_data;
-
 	uint8_t *extra_data;
 	uint8_t *sei;
 
@@ -92,7 +90,6 @@ static void obs_x264_destroy(void *data)
 	if (obsx264) {
 		os_end_high_performance(obsx264->performance_token);
 		clear_data(obsx264);
-		da_free(obsx264->packet_data);
 		bfree(obsx264);
 	}
 }
@@ -677,18 +674,26 @@ static void *obs_x264_create(obs_data_t *settings, obs_encoder_t *encoder)
 static void parse_packet(struct obs_x264 *obsx264, struct encoder_packet *packet, x264_nal_t *nals, int nal_count,
 			 x264_picture_t *pic_out)
 {
+	size_t size = 0;
+	uint8_t *data;
+
 	if (!nal_count)
 		return;
 
-	da_resize(obsx264->packet_data, 0);
+	for (int i = 0; i < nal_count; i++)
+		size += nals[i].i_payload;
+
+	/* write straight into a refcounted packet buffer, which libobs then
+	 * hands to every output without copying it again */
+	obs_encoder_packet_alloc(packet, size);
+	data = packet->data;
 
 	for (int i = 0; i < nal_count; i++) {
 		x264_nal_t *nal = nals + i;
-		da_push_back_array(obsx264->packet_data, nal->p_payload, nal->i_payload);
+		memcpy(data, nal->p_payload, nal->i_payload);
+		data += nal->i_payload;
 	}
 
-	packet->data = obsx264->packet_data.array;
-	packet->size = obsx264->packet_data.num;
 	packet->type = OBS_ENCODER_VIDEO;
 	packet->pts = pic_out->i_pts;
 	packet->dts = pic_out->i_dts;
@@ -861,5 +866,5 @@ struct obs_encoder_info obs_x264_encoder = {
 	.get_extra_data = obs_x264_extra_data,
 	.get_sei_data = obs_x264_sei,
 	.get_video_info = obs_x264_video_info,
-	.caps = OBS_ENCODER_CAP_DYN_BITRATE | OBS_ENCODER_CAP_ROI,
+	.caps = OBS_ENCODER_CAP_DYN_BITRATE | OBS_ENCODER_CAP_ROI | OBS_ENCODER_CAP_REFCOUNTED_PACKETS,
 };
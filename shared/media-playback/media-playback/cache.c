@@ -15,7 +15,10 @@
  */
 
 #include <media-io/audio-io.h>
+#include <media-io/video-frame.h>
 #include <util/platform.h>
+#include <util/dstr.h>
+#include <inttypes.h>
 
 #include "media-playback.h"
 #include "cache.h"
@@ -32,6 +35,178 @@ static bool mp_cache_reset(mp_cache_t *c);
 
 static int64_t base_sys_ts = 0;
 
+/* default memory limit of a single cache */
+#define DEFAULT_CACHE_LIMIT (1024ULL * 1024ULL * 1024ULL)
+
+/* memory used by all caches, limited to half of the system's memory */
+static pthread_mutex_t cache_mem_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t cache_mem_limit = 0;
+static uint64_t cache_mem_used = 0;
+
+static bool cache_mem_reserve(mp_cache_t *c, size_t size, bool force)
+{
+	bool success = force;
+
+	if (!force && c->mem_used + size > c->mem_limit)
+		return false;
+
+	pthread_mutex_lock(&cache_mem_mutex);
+	if (!cache_mem_limit)
+		cache_mem_limit = os_get_sys_total_size() / 2;
+	if (cache_mem_used + size <= cache_mem_limit)
+		success = true;
+	if (success)
+		cache_mem_used += size;
+	pthread_mutex_unlock(&cache_mem_mutex);
+
+	if (success)
+		c->mem_used += size;
+	return success;
+}
+
+static void cache_mem_release(mp_cache_t *c)
+{
+	pthread_mutex_lock(&cache_mem_mutex);
+	cache_mem_used -= c->mem_used;
+	pthread_mutex_unlock(&cache_mem_mutex);
+
+	c->mem_used = 0;
+}
+
+/* makes spill_frame a frame of the same format and size as frame */
+static void prepare_spill_frame(mp_cache_t *c, const struct obs_source_frame *frame)
+{
+	struct obs_source_frame *sf = &c->spill_frame;
+
+	if (sf->data[0] && sf->format == frame->format && sf->width == frame->width && sf->height == frame->height)
+		return;
+
+	obs_source_frame_free(sf);
+	obs_source_frame_init(sf, frame->format, frame->width, frame->height);
+}
+
+/* size of the single allocation holding the planes of a frame created with
+ * obs_source_frame_init */
+static size_t get_frame_size(const struct obs_source_frame *frame)
+{
+	uint32_t heights[MAX_AV_PLANES] = {0};
+	size_t size = 0;
+
+	video_frame_get_plane_heights(heights, frame->format, frame->height);
+
+	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+		if (!frame->data[i])
+			continue;
+
+		size_t end = (size_t)(frame->data[i] - frame->data[0]) + (size_t)frame->linesize[i] * heights[i];
+		if (end > size)
+			size = end;
+	}
+
+	return size;
+}
+
+static bool open_spill_file(mp_cache_t *c)
+{
+	struct dstr path = {0};
+
+	if (c->spill_file)
+		return true;
+	if (c->spill_failed || !c->cache_dir)
+		return false;
+
+	os_mkdirs(c->cache_dir);
+	dstr_printf(&path, "%s/%p-%" PRIu64 ".frames", c->cache_dir, (void *)c, os_gettime_ns());
+
+#ifdef _WIN32
+	/* deleted when closed */
+	c->spill_file = os_fopen(path.array, "w+bD");
+#else
+	/* only the open handle refers to the file from here on, so it's gone
+	 * once closed, even after a crash */
+	c->spill_file = os_fopen(path.array, "w+b");
+	if (c->spill_file)
+		os_unlink(path.array);
+#endif
+
+	if (!c->spill_file) {
+		blog(LOG_WARNING, "MP: Failed to create frame cache file '%s', keeping all frames in memory",
+		     path.array);
+		c->spill_failed = true;
+	}
+
+	dstr_free(&path);
+	return c->spill_file != NULL;
+}
+
+/* writes the frame to the spill file and returns its offset, or -1 */
+static int64_t spill_frame(mp_cache_t *c, const struct obs_source_frame *frame)
+{
+	struct obs_source_frame *sf = &c->spill_frame;
+	int64_t offset = c->spill_size;
+
+	if (!open_spill_file(c))
+		return -1;
+
+	obs_source_frame_copy(sf, frame);
+	size_t size = get_frame_size(sf);
+
+	if (os_fseeki64(c->spill_file, offset, SEEK_SET) != 0 || fwrite(sf->data[0], 1, size, c->spill_file) != size) {
+		blog(LOG_WARNING, "MP: Failed to write to frame cache file, keeping remaining frames in memory");
+		fclose(c->spill_file);
+		c->spill_file = NULL;
+		c->spill_failed = true;
+		return -1;
+	}
+
+	c->spill_size += (int64_t)size;
+	return offset;
+}
+
+/* returns the cached frame at idx, reading it from the spill file into
+ * spill_frame if it isn't in memory, or NULL if it can't be read */
+static struct obs_source_frame *get_cached_frame(mp_cache_t *c, size_t idx)
+{
+	struct obs_source_frame *frame = &c->video_frames.array[idx];
+	struct obs_source_frame *sf = &c->spill_frame;
+	int64_t offset = c->spill_offsets.array[idx];
+
+	if (offset < 0) {
+		c->hits++;
+		return frame;
+	}
+
+	/* the owner recreates the media without the cache once it notices,
+	 * until then spilled frames are skipped rather than read again */
+	if (os_atomic_load_bool(&c->spill_read_failed))
+		return NULL;
+
+	uint64_t start = os_gettime_ns();
+
+	prepare_spill_frame(c, frame);
+	size_t size = get_frame_size(sf);
+
+	if (os_fseeki64(c->spill_file, offset, SEEK_SET) != 0 || fread(sf->data[0], 1, size, c->spill_file) != size) {
+		blog(LOG_WARNING, "MP: Failed to read frame %zu from frame cache file, falling back to decoding '%s'",
+		     idx, c->path ? c->path : "");
+		os_atomic_set_bool(&c->spill_read_failed, true);
+		return NULL;
+	}
+
+	uint8_t *data[MAX_AV_PLANES];
+	uint32_t linesize[MAX_AV_PLANES];
+	memcpy(data, sf->data, sizeof(data));
+	memcpy(linesize, sf->linesize, sizeof(linesize));
+
+	*sf = *frame;
+	memcpy(sf->data, data, sizeof(data));
+	memcpy(sf->linesize, linesize, sizeof(linesize));
+
+	c->misses++;
+	c->spill_read_ns += os_gettime_ns() - start;
+	return sf;
+}
+
 #define v_eof(c) (c->cur_v_idx == c->video_frames.num)
 #define a_eof(c) (c->cur_a_idx == c->audio_segments.num)
 
@@ -114,6 +289,7 @@ bool mp_cache_decode(mp_cache_t *c)
 {
 	mp_media_t *m = &c->m;
 	bool success = false;
+	uint64_t start = os_gettime_ns();
 
 	m->full_decode = true;
 
@@ -135,6 +311,11 @@ bool mp_cache_decode(mp_cache_t *c)
 	if (c->start_time == AV_NOPTS_VALUE)
 		c->start_time = 0;
 
+	c->decode_time_ns = os_gettime_ns() - start;
+	blog(LOG_INFO, "MP: Cached %zu frames of '%s' in %.1f ms, %.1f MB in memory, %.1f MB in cache file",
+	     c->video_frames.num, c->path ? c->path : "", (double)c->decode_time_ns / 1000000.0,
+	     (double)c->mem_used / (1024.0 * 1024.0), (double)c->spill_size / (1024.0 * 1024.0));
+
 fail:
 	mp_media_free(m);
 	return success;
@@ -240,7 +421,10 @@ static void mp_cache_next_video(mp_cache_t *c, bool preload)
 		return;
 	}
 
-	struct obs_source_frame *frame = &c->video_frames.array[c->next_v_idx];
+	struct obs_source_frame *frame = get_cached_frame(c, c->next_v_idx);
+	if (!frame)
+		return;
+
 	struct obs_source_frame dup = *frame;
 
 	dup.timestamp = c->base_ts + dup.timestamp - c->start_ts + c->play_sys_ts - base_sys_ts;
@@ -433,7 +617,7 @@ static inline bool mp_cache_thread(mp_cache_t *c)
 			continue;
 
 		if (preload_frame)
-			c->v_preload_cb(c->opaque, &c->video_frames.array[0]);
+			c->v_preload_cb(c->opaque, get_cached_frame(c, 0));
 
 		/* frames are ready */
 		if (is_active && !timeout) {
@@ -469,15 +653,33 @@ static void fill_video(void *data, struct obs_source_frame *frame)
 {
 	mp_cache_t *c = data;
 	struct obs_source_frame dup;
+	int64_t spill_offset = -1;
+
+	prepare_spill_frame(c, frame);
+	size_t size = get_frame_size(&c->spill_frame);
+
+	/* the first frame always stays in memory for preloading */
+	if (!cache_mem_reserve(c, size, c->video_frames.num == 0)) {
+		spill_offset = spill_frame(c, frame);
+		if (spill_offset < 0)
+			cache_mem_reserve(c, size, true);
+	}
 
-	obs_source_frame_init(&dup, frame->format, frame->width, frame->height);
-	obs_source_frame_copy(&dup, frame);
+	if (spill_offset < 0) {
+		obs_source_frame_init(&dup, frame->format, frame->width, frame->height);
+		obs_source_frame_copy(&dup, frame);
+	} else {
+		dup = *frame;
+		memset(dup.data, 0, sizeof(dup.data));
+		memset(dup.linesize, 0, sizeof(dup.linesize));
+	}
 
 	dup.timestamp = frame->timestamp;
 
 	c->final_v_duration = c->m.v.last_duration;
 
 	da_push_back(c->video_frames, &dup);
+	da_push_back(c->spill_offsets, &spill_offset);
 }
 
 static void fill_audio(void *data, struct obs_source_audio *audio)
@@ -487,6 +689,7 @@ static void fill_audio(void *data, struct obs_source_audio *audio)
 
 	size_t size = get_total_audio_size(dup.format, dup.speakers, dup.frames);
 	dup.data[0] = bmalloc(size);
+	cache_mem_reserve(c, size, true);
 
 	size_t planes = get_audio_planes(dup.format, dup.speakers);
 	if (planes > 1) {
@@ -522,6 +725,8 @@ static inline bool mp_cache_init_internal(mp_cache_t *c, const struct mp_media_i
 
 	c->path = info->path ? bstrdup(info->path) : NULL;
 	c->format_name = info->format ? bstrdup(info->format) : NULL;
+	c->cache_dir = info->cache_dir ? bstrdup(info->cache_dir) : NULL;
+	c->mem_limit = info->cache_limit ? info->cache_limit : DEFAULT_CACHE_LIMIT;
 
 	if (pthread_create(&c->thread, NULL, mp_cache_thread_start, c) != 0) {
 		blog(LOG_WARNING, "MP: Could not create media thread");
@@ -538,6 +743,7 @@ bool mp_cache_init(mp_cache_t *c, const struct mp_media_info *info)
 
 	info2.opaque = c;
 	info2.v_cb = fill_video;
+	info2.v_owned_cb = NULL;
 	info2.a_cb = fill_audio;
 	info2.v_preload_cb = NULL;
 	info2.v_seek_cb = NULL;
@@ -605,6 +811,14 @@ void mp_cache_free(mp_cache_t *c)
 	if (c->m.fmt)
 		mp_media_free(&c->m);
 
+	if (c->hits || c->misses) {
+		double avg_read_ms = c->misses ? (double)c->spill_read_ns / (double)c->misses / 1000000.0 : 0.0;
+		blog(LOG_INFO,
+		     "MP: Frame cache of '%s': %" PRIu64 " frames from memory, %" PRIu64
+		     " from cache file (%.2f ms per frame)",
+		     c->path ? c->path : "", c->hits, c->misses, avg_read_ms);
+	}
+
 	for (size_t i = 0; i < c->video_frames.num; i++) {
 		struct obs_source_frame *f = &c->video_frames.array[i];
 		obs_source_frame_free(f);
@@ -615,7 +829,14 @@ void mp_cache_free(mp_cache_t *c)
 	}
 	da_free(c->video_frames);
 	da_free(c->audio_segments);
+	da_free(c->spill_offsets);
+	obs_source_frame_free(&c->spill_frame);
+	cache_mem_release(c);
 
+	if (c->spill_file)
+		fclose(c->spill_file);
+
+	bfree(c->cache_dir);
 	bfree(c->path);
 	bfree(c->format_name);
 	pthread_mutex_destroy(&c->mutex);
@@ -695,6 +916,13 @@ int64_t mp_cache_get_frames(mp_cache_t *c)
 	return c->video_frames.num;
 }
 
+/* true once frames can no longer be read from the cache file, after which
+ * the media has to be decoded without the cache */
+bool mp_cache_failed(mp_cache_t *c)
+{
+	return os_atomic_load_bool(&c->spill_read_failed);
+}
+
 int64_t mp_cache_get_duration(mp_cache_t *c)
 {
 	return c->media_duration;
@@ -54,6 +54,23 @@ struct mp_cache {
 	DARRAY(struct obs_source_frame) video_frames;
 	DARRAY(struct obs_source_audio) audio_segments;
 
+	/* frames that don't fit in the memory limit are stored in a spill
+	 * file, and have no data in video_frames */
+	DARRAY(int64_t) spill_offsets;
+	struct obs_source_frame spill_frame;
+	char *cache_dir;
+	FILE *spill_file;
+	int64_t spill_size;
+	bool spill_failed;
+	volatile bool spill_read_failed;
+	size_t mem_limit;
+	size_t mem_used;
+
+	uint64_t decode_time_ns;
+	uint64_t spill_read_ns;
+	uint64_t hits;
+	uint64_t misses;
+
 	size_t cur_v_idx;
 	size_t cur_a_idx;
 	size_t next_v_idx;
@@ -95,3 +112,4 @@ extern int64_t mp_cache_get_current_time(mp_cache_t *c);
 extern void mp_cache_seek(mp_cache_t *c, int64_t pos);
 extern int64_t mp_cache_get_frames(mp_cache_t *c);
 extern int64_t mp_cache_get_duration(mp_cache_t *c);
+extern bool mp_cache_failed(mp_cache_t *c);
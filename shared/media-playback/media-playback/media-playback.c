@@ -174,3 +174,11 @@ bool media_playback_has_audio(media_playback_t *mp)
 	else
 		return mp->media.has_audio;
 }
+
+bool media_playback_cache_failed(media_playback_t *mp)
+{
+	if (!mp)
+		return false;
+
+	return mp->is_cached && mp_cache_failed(&mp->cache);
+}
@@ -22,6 +22,8 @@ struct media_playback;
 typedef struct media_playback media_playback_t;
 
 typedef void (*mp_video_cb)(void *opaque, struct obs_source_frame *frame);
+typedef void (*mp_video_owned_cb)(void *opaque, struct obs_source_frame *frame, void (*release)(void *param),
+				  void *param);
 typedef void (*mp_audio_cb)(void *opaque, struct obs_source_audio *audio);
 typedef void (*mp_stop_cb)(void *opaque);
 
@@ -29,6 +31,9 @@ struct mp_media_info {
 	void *opaque;
 
 	mp_video_cb v_cb;
+	/* optional, receives frames that reference the decoder's buffers
+	 * directly, which must be released by calling release(param) */
+	mp_video_owned_cb v_owned_cb;
 	mp_video_cb v_preload_cb;
 	mp_video_cb v_seek_cb;
 	mp_audio_cb a_cb;
@@ -46,6 +51,11 @@ struct mp_media_info {
 	bool reconnecting;
 	bool request_preload;
 	bool full_decode;
+
+	/* memory the full decode cache may use for this media, 0 for the
+	 * default; frames beyond it are spilled to a file in cache_dir */
+	size_t cache_limit;
+	const char *cache_dir;
 };
 
 extern media_playback_t *media_playback_create(const struct mp_media_info *info);
@@ -63,3 +73,7 @@ extern int64_t media_playback_get_frames(media_playback_t *mp);
 extern int64_t media_playback_get_duration(media_playback_t *mp);
 extern bool media_playback_has_video(media_playback_t *mp);
 extern bool media_playback_has_audio(media_playback_t *mp);
+
+/* true if the full decode cache can't serve frames anymore, in which case
+ * the media should be recreated with full_decode disabled */
+extern bool media_playback_cache_failed(media_playback_t *mp);
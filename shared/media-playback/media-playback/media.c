@@ -372,6 +372,12 @@ void mp_media_next_audio(mp_media_t *m)
 	m->a_cb(m->opaque, &audio);
 }
 
+static void mp_media_release_frame(void *param)
+{
+	AVFrame *f = param;
+	av_frame_free(&f);
+}
+
 void mp_media_next_video(mp_media_t *m, bool preload)
 {
 	struct mp_decode *d = &m->v;
@@ -490,6 +496,15 @@ void mp_media_next_video(mp_media_t *m, bool preload)
 		} else if (!m->request_preload) {
 			m->v_preload_cb(m->opaque, frame);
 		}
+	} else if (m->v_owned_cb && !m->swscale && f->buf[0]) {
+		/* hand out a new reference to the decoded buffers rather than
+		 * having them copied, the decoder allocates new ones for the
+		 * next frame */
+		AVFrame *ref = av_frame_clone(f);
+		if (ref)
+			m->v_owned_cb(m->opaque, frame, mp_media_release_frame, ref);
+		else
+			m->v_cb(m->opaque, frame);
 	} else {
 		m->v_cb(m->opaque, frame);
 	}
@@ -878,6 +893,7 @@ bool mp_media_init(mp_media_t *media, const struct mp_media_info *info)
 	pthread_mutex_init_value(&media->mutex);
 	media->opaque = info->opaque;
 	media->v_cb = info->v_cb;
+	media->v_owned_cb = info->v_owned_cb;
 	media->a_cb = info->a_cb;
 	media->stop_cb = info->stop_cb;
 	media->ffmpeg_options = info->ffmpeg_options;
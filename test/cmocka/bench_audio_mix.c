@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <media-io/audio-math.h>
+#include <media-io/audio-io.h>
+#include <util/platform.h>
+
+/* Not a test, compares the old mix loop (all mixes, scalar) with the new
+ * one (routed mixes, vectorized) for a source with 8 channels routed to 2
+ * of 6 tracks.  Run it by hand, optionally with the number of iterations. */
+
+#define CHANNELS 8
+#define MIXES 6
+#define DEFAULT_ITERATIONS 2000
+
+static void mix_scalar(float *dst, const float *src, size_t count)
+{
+	const float *end = src + count;
+
+	while (src < end)
+		*(dst++) += *(src++);
+}
+
+static void fill_random(float *buf, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		buf[i] = (float)rand() / (float)RAND_MAX * 2.0f - 1.0f;
+}
+
+static uint64_t bench_mix(void (*mix)(float *, const float *, size_t), float *dst, const float *src,
+			  uint32_t mixers, int iterations)
+{
+	uint64_t start = os_gettime_ns();
+
+	for (int i = 0; i < iterations; i++) {
+		for (size_t m = 0; m < MIXES; m++) {
+			if ((mixers & (1 << m)) == 0)
+				continue;
+
+			for (size_t ch = 0; ch < CHANNELS; ch++) {
+				size_t offset = (m * CHANNELS + ch) * AUDIO_OUTPUT_FRAMES;
+				mix(dst + offset, src + offset, AUDIO_OUTPUT_FRAMES);
+			}
+		}
+	}
+
+	return os_gettime_ns() - start;
+}
+
+int main(int argc, char *argv[])
+{
+	const size_t total = MIXES * CHANNELS * AUDIO_OUTPUT_FRAMES;
+	int iterations = argc > 1 ? atoi(argv[1]) : DEFAULT_ITERATIONS;
+	float *src = malloc(total * sizeof(float));
+	float *dst = calloc(total, sizeof(float));
+
+	if (iterations <= 0)
+		iterations = DEFAULT_ITERATIONS;
+
+	fill_random(src, total);
+
+	uint64_t scalar_all = bench_mix(mix_scalar, dst, src, 0x3F, iterations);
+	uint64_t simd_all = bench_mix(audio_mix_floats, dst, src, 0x3F, iterations);
+	uint64_t simd_sparse = bench_mix(audio_mix_floats, dst, src, 0x03, iterations);
+
+	printf("%d iterations of %d channels, %d frames\n", iterations, CHANNELS, AUDIO_OUTPUT_FRAMES);
+	printf("scalar, all mixes:    %8.3f ms\n", (double)scalar_all / 1000000.0);
+	printf("vector, all mixes:    %8.3f ms\n", (double)simd_all / 1000000.0);
+	printf("vector, routed mixes: %8.3f ms\n", (double)simd_sparse / 1000000.0);
+
+	free(src);
+	free(dst);
+	return 0;
+}
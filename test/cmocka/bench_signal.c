@@ -0,0 +1,83 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <callback/signal.h>
+#include <util/platform.h>
+#include <util/dstr.h>
+
+/* Not a test, fires millions of signals at a handler with as many
+ * declarations as a typical source, with both a per-signal and a global
+ * callback connected.  Run it by hand, optionally with the number of
+ * signals. */
+
+#define NUM_SIGNALS 64
+#define DEFAULT_SIGNALS 2000000
+
+struct signal_counts {
+	long long calls;
+	long long global_calls;
+};
+
+static void count_signal(void *data, calldata_t *cd)
+{
+	struct signal_counts *counts = data;
+	counts->calls += calldata_int(cd, "value");
+}
+
+static void count_global(void *data, const char *signal, calldata_t *cd)
+{
+	struct signal_counts *counts = data;
+	counts->global_calls++;
+
+	UNUSED_PARAMETER(signal);
+	UNUSED_PARAMETER(cd);
+}
+
+int main(int argc, char *argv[])
+{
+	signal_handler_t *handler = signal_handler_create();
+	struct signal_counts counts = {0};
+	struct dstr names[NUM_SIGNALS] = {0};
+	struct dstr decl = {0};
+	long long signals = argc > 1 ? atoll(argv[1]) : DEFAULT_SIGNALS;
+	uint8_t stack[128];
+	calldata_t cd;
+
+	if (signals <= 0)
+		signals = DEFAULT_SIGNALS;
+
+	for (int i = 0; i < NUM_SIGNALS; i++) {
+		dstr_printf(&names[i], "signal_%d", i);
+		dstr_printf(&decl, "void %s(int value)", names[i].array);
+		signal_handler_add(handler, decl.array);
+		signal_handler_connect(handler, names[i].array, count_signal, &counts);
+	}
+	signal_handler_connect_global(handler, count_global, &counts);
+
+	uint64_t start = os_gettime_ns();
+
+	for (long long i = 0; i < signals; i++) {
+		calldata_init_fixed(&cd, stack, sizeof(stack));
+		calldata_set_int(&cd, "value", 1);
+		signal_handler_signal(handler, names[i % NUM_SIGNALS].array, &cd);
+	}
+
+	uint64_t elapsed = os_gettime_ns() - start;
+
+	printf("%lld signals over %d declarations: %.1f ms, %.1f ns per signal\n", signals, NUM_SIGNALS,
+	       (double)elapsed / 1000000.0, (double)elapsed / (double)signals);
+
+	signal_handler_disconnect_global(handler, count_global, &counts);
+
+	for (int i = 0; i < NUM_SIGNALS; i++)
+		dstr_free(&names[i]);
+	dstr_free(&decl);
+	signal_handler_destroy(handler);
+
+	if (counts.calls != signals || counts.global_calls != signals) {
+		printf("lost signals: %lld of %lld delivered, %lld globally\n", counts.calls, signals,
+		       counts.global_calls);
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,56 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <stdlib.h>
+#include <media-io/audio-math.h>
+#include <media-io/audio-io.h>
+
+static void mix_scalar(float *dst, const float *src, size_t count)
+{
+	const float *end = src + count;
+
+	while (src < end)
+		*(dst++) += *(src++);
+}
+
+static void fill_random(float *buf, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		buf[i] = (float)rand() / (float)RAND_MAX * 2.0f - 1.0f;
+}
+
+static void audio_mix_matches_scalar_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	float src[AUDIO_OUTPUT_FRAMES];
+	float expected[AUDIO_OUTPUT_FRAMES];
+	float actual[AUDIO_OUTPUT_FRAMES];
+
+	fill_random(src, AUDIO_OUTPUT_FRAMES);
+
+	/* every start offset the audio thread can produce, which also covers
+	 * every remainder and alignment of the vector loops */
+	for (size_t start = 0; start < AUDIO_OUTPUT_FRAMES; start++) {
+		size_t count = AUDIO_OUTPUT_FRAMES - start;
+
+		fill_random(expected, AUDIO_OUTPUT_FRAMES);
+		memcpy(actual, expected, sizeof(actual));
+
+		mix_scalar(expected + start, src, count);
+		audio_mix_floats(actual + start, src, count);
+
+		assert_memory_equal(expected, actual, sizeof(actual));
+	}
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(audio_mix_matches_scalar_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
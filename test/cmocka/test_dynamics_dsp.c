@@ -0,0 +1,485 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include <media-io/audio-math.h>
+#include <util/bmem.h>
+
+#include "dynamics-dsp.h"
+
+/* Golden tests for the dynamics filter kernels: each filter's block
+ * processing is run both through the scalar code the filters used before
+ * the kernels existed, and through the kernels in dynamics-dsp.h that the
+ * filters call now. */
+
+#define CHANNELS 6
+#define SAMPLE_RATE 48000
+#define BLOCKS 40
+
+static const size_t block_sizes[] = {480, 1023, 1, 4};
+
+struct signal {
+	float *data[CHANNELS];
+	float *ref[CHANNELS];
+	size_t frames;
+};
+
+static uint32_t rand_state;
+
+static float rand_float(void)
+{
+	rand_state = rand_state * 1664525u + 1013904223u;
+	return (float)(rand_state >> 8) / (float)(1 << 24) * 2.0f - 1.0f;
+}
+
+/* noise with a level that jumps around in 10 ms steps, including silence,
+ * so that every filter crosses its thresholds in both directions */
+static void make_signal(struct signal *sig, size_t frames, uint32_t seed)
+{
+	static const float levels[] = {0.0f, 1e-4f, 0.003f, 0.02f, 0.1f, 0.5f, 0.9f};
+
+	rand_state = seed;
+	sig->frames = frames;
+
+	for (size_t c = 0; c < CHANNELS; c++) {
+		sig->data[c] = bmalloc(frames * sizeof(float));
+		sig->ref[c] = bmalloc(frames * sizeof(float));
+	}
+
+	float level = 0.0f;
+	for (size_t i = 0; i < frames; i++) {
+		if (i % (SAMPLE_RATE / 100) == 0)
+			level = levels[(rand_state >> 16) % (sizeof(levels) / sizeof(levels[0]))];
+
+		for (size_t c = 0; c < CHANNELS; c++)
+			sig->data[c][i] = sig->ref[c][i] = rand_float() * level / (float)(c + 1);
+	}
+}
+
+static void free_signal(struct signal *sig)
+{
+	for (size_t c = 0; c < CHANNELS; c++) {
+		bfree(sig->data[c]);
+		bfree(sig->ref[c]);
+	}
+}
+
+static void assert_close(const struct signal *sig, float rel)
+{
+	for (size_t c = 0; c < CHANNELS; c++) {
+		for (size_t i = 0; i < sig->frames; i++) {
+			float ref = sig->ref[c][i];
+			float diff = fabsf(sig->data[c][i] - ref);
+
+			if (diff > fabsf(ref) * rel + 1e-9f)
+				fail_msg("channel %zu sample %zu: %g, expected %g", c, i, sig->data[c][i], ref);
+		}
+	}
+}
+
+static void assert_equal(const struct signal *sig)
+{
+	for (size_t c = 0; c < CHANNELS; c++)
+		assert_memory_equal(sig->data[c], sig->ref[c], sig->frames * sizeof(float));
+}
+
+/* points ptrs and ref_ptrs at the block starting at pos, returns its size */
+static size_t get_block(const struct signal *sig, size_t pos, size_t block_size, float **ptrs, float **ref_ptrs)
+{
+	for (size_t c = 0; c < CHANNELS; c++) {
+		ptrs[c] = sig->data[c] + pos;
+		ref_ptrs[c] = sig->ref[c] + pos;
+	}
+
+	return sig->frames - pos < block_size ? sig->frames - pos : block_size;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void approximation_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	for (float mul = 1e-6f; mul < 10.0f; mul *= 1.001f) {
+		float db;
+		_mm_store_ss(&db, dsp_mul_to_db_ps(_mm_set1_ps(mul)));
+		assert_true(fabsf(db - mul_to_db(mul)) < 2e-5f);
+	}
+
+	for (float db = -120.0f; db < 30.0f; db += 0.01f) {
+		float mul;
+		_mm_store_ss(&mul, dsp_db_to_mul_ps(_mm_set1_ps(db)));
+		assert_true(fabsf(mul / db_to_mul(db) - 1.0f) < 2e-6f);
+	}
+
+	/* silence must not turn into a NaN or an infinity */
+	float db;
+	_mm_store_ss(&db, dsp_mul_to_db_ps(_mm_setzero_ps()));
+	assert_true(isfinite(db) && db < -700.0f);
+}
+
+/* ------------------------------------------------------------------------- */
+
+struct compressor {
+	float envelope;
+	float *envelope_buf;
+	float attack_gain, release_gain;
+	float threshold, slope, output_gain;
+};
+
+static void compressor_init(struct compressor *cd, size_t frames, float ratio, float threshold, float attack_ms,
+			    float release_ms, float output_gain_db)
+{
+	memset(cd, 0, sizeof(*cd));
+	cd->envelope_buf = bmalloc(frames * sizeof(float));
+	cd->attack_gain = expf(-1.0f / (SAMPLE_RATE * attack_ms / 1000.0f));
+	cd->release_gain = expf(-1.0f / (SAMPLE_RATE * release_ms / 1000.0f));
+	cd->threshold = threshold;
+	cd->slope = 1.0f - 1.0f / ratio;
+	cd->output_gain = db_to_mul(output_gain_db);
+}
+
+static void compressor_ref(struct compressor *cd, float **samples, size_t num_samples)
+{
+	memset(cd->envelope_buf, 0, num_samples * sizeof(float));
+	for (size_t chan = 0; chan < CHANNELS; ++chan) {
+		float *envelope_buf = cd->envelope_buf;
+		float env = cd->envelope;
+		for (size_t i = 0; i < num_samples; ++i) {
+			const float env_in = fabsf(samples[chan][i]);
+			if (env < env_in) {
+				env = env_in + cd->attack_gain * (env - env_in);
+			} else {
+				env = env_in + cd->release_gain * (env - env_in);
+			}
+			envelope_buf[i] = fmaxf(envelope_buf[i], env);
+		}
+	}
+	cd->envelope = cd->envelope_buf[num_samples - 1];
+
+	for (size_t i = 0; i < num_samples; ++i) {
+		const float env_db = mul_to_db(cd->envelope_buf[i]);
+		float gain = cd->slope * (cd->threshold - env_db);
+		gain = db_to_mul(fminf(0, gain));
+
+		for (size_t c = 0; c < CHANNELS; ++c)
+			samples[c][i] *= gain * cd->output_gain;
+	}
+}
+
+static void compressor_dsp(struct compressor *cd, float **samples, size_t num_samples)
+{
+	cd->envelope = dsp_envelope_analyze(cd->envelope_buf, samples, CHANNELS, num_samples, cd->envelope,
+					    cd->attack_gain, cd->release_gain);
+	dsp_compress(samples, CHANNELS, cd->envelope_buf, num_samples, cd->threshold, cd->slope, cd->output_gain);
+}
+
+static void run_compressor(float ratio, float threshold, float attack_ms, float release_ms, float output_gain_db)
+{
+	for (size_t b = 0; b < sizeof(block_sizes) / sizeof(block_sizes[0]); b++) {
+		size_t block_size = block_sizes[b];
+		struct compressor ref, dsp;
+		struct signal sig;
+		float *ptrs[CHANNELS], *ref_ptrs[CHANNELS];
+
+		make_signal(&sig, block_size * BLOCKS, (uint32_t)b + 1);
+		compressor_init(&ref, block_size, ratio, threshold, attack_ms, release_ms, output_gain_db);
+		compressor_init(&dsp, block_size, ratio, threshold, attack_ms, release_ms, output_gain_db);
+
+		for (size_t pos = 0, frames; pos < sig.frames; pos += frames) {
+			frames = get_block(&sig, pos, block_size, ptrs, ref_ptrs);
+			compressor_ref(&ref, ref_ptrs, frames);
+			compressor_dsp(&dsp, ptrs, frames);
+			assert_true(dsp.envelope == ref.envelope);
+		}
+
+		assert_close(&sig, 2e-5f);
+
+		bfree(ref.envelope_buf);
+		bfree(dsp.envelope_buf);
+		free_signal(&sig);
+	}
+}
+
+static void compressor_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	run_compressor(10.0f, -18.0f, 6.0f, 60.0f, 0.0f);
+	run_compressor(1.0f, -40.0f, 1.0f, 1000.0f, 12.0f);
+	run_compressor(32.0f, -60.0f, 500.0f, 1.0f, -32.0f);
+}
+
+static void limiter_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	/* the limiter is a compressor with a fixed attack and a slope of 1 */
+	run_compressor(INFINITY, -6.0f, 0.001f, 60.0f, 0.0f);
+	run_compressor(INFINITY, -30.0f, 0.001f, 1000.0f, 0.0f);
+}
+
+/* ------------------------------------------------------------------------- */
+
+struct expander {
+	float *envelope_buf[CHANNELS];
+	float *gain_db[CHANNELS];
+	float gain_db_buf[CHANNELS];
+	float attack_gain, release_gain;
+	float threshold, slope, output_gain, knee;
+	bool is_upwcomp;
+};
+
+static void expander_init(struct expander *cd, size_t frames, bool is_upwcomp, float ratio, float threshold,
+			  float knee)
+{
+	memset(cd, 0, sizeof(*cd));
+	for (size_t c = 0; c < CHANNELS; c++) {
+		cd->envelope_buf[c] = bmalloc(frames * sizeof(float));
+		cd->gain_db[c] = bmalloc(frames * sizeof(float));
+	}
+	cd->attack_gain = expf(-1.0f / (SAMPLE_RATE * 0.01f));
+	cd->release_gain = expf(-1.0f / (SAMPLE_RATE * 0.05f));
+	cd->threshold = threshold;
+	cd->slope = 1.0f - ratio;
+	cd->output_gain = db_to_mul(3.0f);
+	cd->knee = knee;
+	cd->is_upwcomp = is_upwcomp;
+}
+
+static void expander_free(struct expander *cd)
+{
+	for (size_t c = 0; c < CHANNELS; c++) {
+		bfree(cd->envelope_buf[c]);
+		bfree(cd->gain_db[c]);
+	}
+}
+
+/* peak detection, which is what the filters share besides the gain stage */
+static void expander_detect(struct expander *cd, float **samples, size_t num_samples)
+{
+	for (size_t c = 0; c < CHANNELS; c++) {
+		for (size_t i = 0; i < num_samples; i++)
+			cd->envelope_buf[c][i] = fabsf(samples[c][i]);
+	}
+}
+
+static float expander_gain_ref(const struct expander *cd, float env_db, float prev_gain_db, bool first,
+			   float channel_gain)
+{
+	const float threshold = cd->threshold;
+	const float knee = cd->knee;
+	float diff = threshold - env_db;
+
+	if (cd->is_upwcomp && env_db <= (threshold - 60.0f) / 2)
+		diff = env_db + 60.0f > 0 ? env_db + 60.0f : 0.0f;
+
+	float gain = 0.0f;
+	float prev_gain = 0.0f;
+	if (cd->is_upwcomp) {
+		prev_gain = !first ? fmaxf(prev_gain_db, 0) : fmaxf(channel_gain, 0);
+		if (env_db >= threshold + knee / 2)
+			gain = 0.0f;
+		if (threshold - knee / 2 >= env_db)
+			gain = cd->slope * diff;
+		if (env_db > threshold - knee / 2 && threshold + knee / 2 > env_db)
+			gain = cd->slope * powf(diff + knee / 2, 2) / (2.0f * knee);
+	} else {
+		prev_gain = !first ? prev_gain_db : channel_gain;
+		gain = diff > 0.0f ? fmaxf(cd->slope * diff, -60.0f) : 0.0f;
+	}
+
+	if (gain > prev_gain)
+		return cd->attack_gain * prev_gain + (1.0f - cd->attack_gain) * gain;
+	else
+		return cd->release_gain * prev_gain + (1.0f - cd->release_gain) * gain;
+}
+
+static void expander_ref(struct expander *cd, float **samples, size_t num_samples)
+{
+	expander_detect(cd, samples, num_samples);
+
+	for (size_t chan = 0; chan < CHANNELS; chan++) {
+		float *gain_db = cd->gain_db[chan];
+
+		for (size_t i = 0; i < num_samples; ++i) {
+			float env_db = mul_to_db(cd->envelope_buf[chan][i]);
+			gain_db[i] = expander_gain_ref(cd, env_db, i > 0 ? gain_db[i - 1] : 0.0f, i == 0,
+						   cd->gain_db_buf[chan]);
+
+			float gain = cd->is_upwcomp ? db_to_mul(gain_db[i]) : db_to_mul(fminf(0, gain_db[i]));
+			samples[chan][i] *= gain * cd->output_gain;
+		}
+
+		cd->gain_db_buf[chan] = gain_db[num_samples - 1];
+	}
+}
+
+static void expander_dsp(struct expander *cd, float **samples, size_t num_samples)
+{
+	const struct dsp_expander_params params = {
+		.threshold = cd->threshold,
+		.slope = cd->slope,
+		.knee = cd->knee,
+		.attack_gain = cd->attack_gain,
+		.release_gain = cd->release_gain,
+		.is_upwcomp = cd->is_upwcomp,
+	};
+
+	expander_detect(cd, samples, num_samples);
+
+	for (size_t chan = 0; chan < CHANNELS; chan++)
+		cd->gain_db_buf[chan] = dsp_expand(samples[chan], cd->gain_db[chan], cd->envelope_buf[chan],
+						   num_samples, cd->gain_db_buf[chan], cd->output_gain, &params);
+}
+
+static void run_expander(bool is_upwcomp, float ratio, float threshold, float knee)
+{
+	for (size_t b = 0; b < sizeof(block_sizes) / sizeof(block_sizes[0]); b++) {
+		size_t block_size = block_sizes[b];
+		struct expander ref, dsp;
+		struct signal sig;
+		float *ptrs[CHANNELS], *ref_ptrs[CHANNELS];
+
+		make_signal(&sig, block_size * BLOCKS, (uint32_t)b + 100);
+		expander_init(&ref, block_size, is_upwcomp, ratio, threshold, knee);
+		expander_init(&dsp, block_size, is_upwcomp, ratio, threshold, knee);
+
+		for (size_t pos = 0, frames; pos < sig.frames; pos += frames) {
+			frames = get_block(&sig, pos, block_size, ptrs, ref_ptrs);
+			expander_ref(&ref, ref_ptrs, frames);
+			expander_dsp(&dsp, ptrs, frames);
+		}
+
+		/* the dB error is carried through the gain ballistics */
+		assert_close(&sig, 1e-4f);
+
+		expander_free(&ref);
+		expander_free(&dsp);
+		free_signal(&sig);
+	}
+}
+
+static void expander_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	run_expander(false, 2.0f, -40.0f, 0.0f);
+	run_expander(false, 10.0f, -20.0f, 0.0f);
+}
+
+static void upward_compressor_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	run_expander(true, 0.5f, -20.0f, 10.0f);
+	run_expander(true, 0.2f, -30.0f, 0.0f);
+}
+
+/* ------------------------------------------------------------------------- */
+
+struct noise_gate {
+	float open_threshold, close_threshold;
+	float attack_rate, release_rate, decay_rate;
+	float hold_time, sample_rate_i;
+	bool is_open;
+	float attenuation, level, held_time;
+};
+
+static void noise_gate_init(struct noise_gate *ng, struct dsp_noise_gate *gate)
+{
+	const float sample_rate = (float)SAMPLE_RATE;
+
+	memset(ng, 0, sizeof(*ng));
+	ng->sample_rate_i = 1.0f / sample_rate;
+	ng->open_threshold = db_to_mul(-26.0f);
+	ng->close_threshold = db_to_mul(-32.0f);
+	ng->attack_rate = 1.0f / (0.025f * sample_rate);
+	ng->release_rate = 1.0f / (0.150f * sample_rate);
+	ng->decay_rate = (ng->open_threshold - ng->close_threshold) / ((1.0f / 75.0f) * sample_rate);
+	ng->hold_time = 0.2f;
+
+	memset(gate, 0, sizeof(*gate));
+	gate->sample_rate_i = ng->sample_rate_i;
+	gate->open_threshold = ng->open_threshold;
+	gate->close_threshold = ng->close_threshold;
+	gate->attack_rate = ng->attack_rate;
+	gate->release_rate = ng->release_rate;
+	gate->decay_rate = ng->decay_rate;
+	gate->hold_time = ng->hold_time;
+}
+
+static void noise_gate_ref(struct noise_gate *ng, float **adata, size_t frames)
+{
+	for (size_t i = 0; i < frames; i++) {
+		float cur_level = fabsf(adata[0][i]);
+		for (size_t j = 0; j < CHANNELS; j++)
+			cur_level = fmaxf(cur_level, fabsf(adata[j][i]));
+
+		if (cur_level > ng->open_threshold && !ng->is_open)
+			ng->is_open = true;
+		if (ng->level < ng->close_threshold && ng->is_open) {
+			ng->held_time = 0.0f;
+			ng->is_open = false;
+		}
+
+		ng->level = fmaxf(ng->level, cur_level) - ng->decay_rate;
+
+		if (ng->is_open) {
+			ng->attenuation = fminf(1.0f, ng->attenuation + ng->attack_rate);
+		} else {
+			ng->held_time += ng->sample_rate_i;
+			if (ng->held_time > ng->hold_time)
+				ng->attenuation = fmaxf(0.0f, ng->attenuation - ng->release_rate);
+		}
+
+		for (size_t c = 0; c < CHANNELS; c++)
+			adata[c][i] *= ng->attenuation;
+	}
+}
+
+static void noise_gate_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	for (size_t b = 0; b < sizeof(block_sizes) / sizeof(block_sizes[0]); b++) {
+		size_t block_size = block_sizes[b];
+		struct noise_gate ref;
+		struct dsp_noise_gate gate;
+		struct signal sig;
+		float *ptrs[CHANNELS], *ref_ptrs[CHANNELS];
+		float *level_buf = bmalloc(block_size * sizeof(float));
+
+		make_signal(&sig, block_size * BLOCKS, (uint32_t)b + 200);
+		noise_gate_init(&ref, &gate);
+
+		for (size_t pos = 0, frames; pos < sig.frames; pos += frames) {
+			frames = get_block(&sig, pos, block_size, ptrs, ref_ptrs);
+			noise_gate_ref(&ref, ref_ptrs, frames);
+			dsp_noise_gate(&gate, level_buf, ptrs, CHANNELS, frames);
+		}
+
+		/* the gate involves no approximations */
+		assert_equal(&sig);
+
+		bfree(level_buf);
+		free_signal(&sig);
+	}
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(approximation_test),
+		cmocka_unit_test(compressor_test),
+		cmocka_unit_test(limiter_test),
+		cmocka_unit_test(expander_test),
+		cmocka_unit_test(upward_compressor_test),
+		cmocka_unit_test(noise_gate_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
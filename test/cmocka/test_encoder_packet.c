@@ -0,0 +1,94 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <obs.h>
+
+static void packet_pool_reuse_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct obs_encoder_packet_stats before;
+	struct obs_encoder_packet_stats after;
+	struct encoder_packet pkt = {0};
+	struct encoder_packet ref = {0};
+	uint8_t *data;
+
+	obs_encoder_packet_get_stats(&before);
+
+	obs_encoder_packet_alloc(&pkt, 10000);
+	assert_non_null(pkt.data);
+	assert_int_equal(pkt.size, 10000);
+	memset(pkt.data, 0xAB, pkt.size);
+	data = pkt.data;
+
+	/* a second reference keeps the buffer out of the pool */
+	obs_encoder_packet_ref(&ref, &pkt);
+	obs_encoder_packet_release(&pkt);
+	assert_null(pkt.data);
+	assert_int_equal(ref.data[ref.size - 1], 0xAB);
+	obs_encoder_packet_release(&ref);
+
+	/* a buffer of the same size class comes back from the pool */
+	obs_encoder_packet_alloc(&pkt, 9000);
+	assert_ptr_equal(pkt.data, data);
+	obs_encoder_packet_release(&pkt);
+
+	obs_encoder_packet_get_stats(&after);
+	assert_int_equal(after.allocs - before.allocs, 1);
+	assert_int_equal(after.reuses - before.reuses, 1);
+}
+
+static void packet_pool_large_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct encoder_packet pkt = {0};
+	struct encoder_packet ref = {0};
+	size_t size = 20 * 1024 * 1024;
+
+	/* larger than the biggest size class, allocated directly */
+	obs_encoder_packet_alloc(&pkt, size);
+	assert_non_null(pkt.data);
+	pkt.data[0] = 1;
+	pkt.data[size - 1] = 2;
+
+	obs_encoder_packet_ref(&ref, &pkt);
+	obs_encoder_packet_release(&pkt);
+	assert_int_equal(ref.data[size - 1], 2);
+	obs_encoder_packet_release(&ref);
+}
+
+static void packet_plain_buffer_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct encoder_packet pkt = {0};
+	struct encoder_packet ref = {0};
+	long allocs = bnum_allocs();
+
+	/* packets built by hand with a leading reference count, as the
+	 * AVC/HEVC parsers do, must still be released correctly */
+	long *p_refs = bmalloc(sizeof(long) + 16);
+	*p_refs = 1;
+	pkt.data = (uint8_t *)(p_refs + 1);
+	pkt.size = 16;
+
+	obs_encoder_packet_ref(&ref, &pkt);
+	obs_encoder_packet_release(&pkt);
+	assert_int_equal(bnum_allocs(), allocs + 1);
+	obs_encoder_packet_release(&ref);
+	assert_int_equal(bnum_allocs(), allocs);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(packet_pool_reuse_test),
+		cmocka_unit_test(packet_pool_large_test),
+		cmocka_unit_test(packet_plain_buffer_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,175 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <stdlib.h>
+#include <obs-interleave.h>
+#include <util/darray.h>
+
+#define VIDEO_TRACKS 3
+#define AUDIO_TRACKS 6
+#define STRESS_OPERATIONS 200000
+
+/* the darray-based interleaver this replaced, kept as the reference */
+struct reference {
+	DARRAY(struct encoder_packet) packets;
+};
+
+static void reference_insert(struct reference *ref, struct encoder_packet *out)
+{
+	size_t idx;
+	for (idx = 0; idx < ref->packets.num; idx++) {
+		struct encoder_packet *cur_packet;
+		cur_packet = ref->packets.array + idx;
+
+		if (out->dts_usec == cur_packet->dts_usec && out->type == OBS_ENCODER_VIDEO &&
+		    cur_packet->type == OBS_ENCODER_VIDEO && out->track_idx > cur_packet->track_idx)
+			continue;
+
+		if (out->dts_usec == cur_packet->dts_usec && out->type == OBS_ENCODER_VIDEO) {
+			break;
+		} else if (out->dts_usec < cur_packet->dts_usec) {
+			break;
+		}
+	}
+
+	da_insert(ref->packets, idx, out);
+}
+
+static void reference_resort(struct reference *ref)
+{
+	DARRAY(struct encoder_packet) old_array;
+
+	old_array.da = ref->packets.da;
+	memset(&ref->packets, 0, sizeof(ref->packets));
+
+	for (size_t i = 0; i < old_array.num; i++)
+		reference_insert(ref, &old_array.array[i]);
+
+	da_free(old_array);
+}
+
+static void interleaver_resort(struct interleaver *il)
+{
+	struct interleaver old = *il;
+
+	interleaver_init(il);
+
+	for (size_t i = 0; i < old.num; i++)
+		interleaver_insert(il, interleaver_get(&old, i));
+
+	interleaver_free(&old);
+}
+
+static void assert_same_order(struct reference *ref, struct interleaver *il)
+{
+	assert_int_equal(ref->packets.num, il->num);
+
+	for (size_t i = 0; i < il->num; i++) {
+		struct encoder_packet *expected = ref->packets.array + i;
+		struct encoder_packet *actual = interleaver_get(il, i);
+
+		/* pts is unique per packet in these tests */
+		assert_int_equal(expected->pts, actual->pts);
+	}
+}
+
+struct track_state {
+	enum obs_encoder_type type;
+	size_t track_idx;
+	int64_t next_dts_usec;
+	int64_t interval_usec;
+};
+
+static void init_tracks(struct track_state *tracks)
+{
+	for (size_t i = 0; i < VIDEO_TRACKS; i++) {
+		tracks[i].type = OBS_ENCODER_VIDEO;
+		tracks[i].track_idx = i;
+		tracks[i].next_dts_usec = 0;
+		tracks[i].interval_usec = 33333;
+	}
+
+	for (size_t i = 0; i < AUDIO_TRACKS; i++) {
+		struct track_state *track = &tracks[VIDEO_TRACKS + i];
+		track->type = OBS_ENCODER_AUDIO;
+		track->track_idx = i;
+		track->next_dts_usec = 0;
+		track->interval_usec = 21333;
+	}
+}
+
+static void next_packet(struct track_state *tracks, struct encoder_packet *pkt, int64_t id)
+{
+	struct track_state *track = &tracks[rand() % (VIDEO_TRACKS + AUDIO_TRACKS)];
+
+	memset(pkt, 0, sizeof(*pkt));
+	pkt->type = track->type;
+	pkt->track_idx = track->track_idx;
+	pkt->pts = id;
+
+	/* mostly in order per track, but with a coarse timebase so that DTS
+	 * collisions between tracks are common, and the occasional packet that
+	 * arrives late */
+	pkt->dts_usec = track->next_dts_usec / 1000 * 1000;
+	if (rand() % 16 == 0)
+		pkt->dts_usec -= (rand() % 4) * track->interval_usec;
+
+	track->next_dts_usec += track->interval_usec;
+}
+
+static void interleaver_matches_reference_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct track_state tracks[VIDEO_TRACKS + AUDIO_TRACKS];
+	struct reference ref = {0};
+	struct interleaver il;
+
+	srand(1);
+	init_tracks(tracks);
+	interleaver_init(&il);
+
+	for (int64_t id = 0; id < STRESS_OPERATIONS; id++) {
+		struct encoder_packet pkt;
+		int op = rand() % 100;
+
+		next_packet(tracks, &pkt, id);
+		reference_insert(&ref, &pkt);
+		interleaver_insert(&il, &pkt);
+
+		if (op < 45 && il.num) {
+			struct encoder_packet front;
+			interleaver_pop_front(&il, &front);
+			assert_int_equal(front.pts, ref.packets.array[0].pts);
+			da_erase(ref.packets, 0);
+
+		} else if (op < 47 && il.num) {
+			size_t count = rand() % il.num + 1;
+			interleaver_erase_front(&il, count);
+			da_erase_range(ref.packets, 0, count);
+
+		} else if (op < 48) {
+			reference_resort(&ref);
+			interleaver_resort(&il);
+		}
+
+		if (id % 64 == 0)
+			assert_same_order(&ref, &il);
+	}
+
+	assert_same_order(&ref, &il);
+
+	da_free(ref.packets);
+	interleaver_free(&il);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(interleaver_matches_reference_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
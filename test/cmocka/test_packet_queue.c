@@ -0,0 +1,225 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <obs-packet-queue.h>
+#include <util/darray.h>
+
+struct receiver {
+	DARRAY(int64_t) dts;
+	os_event_t *entered;
+	os_event_t *release;
+	bool block;
+};
+
+static void receiver_init(struct receiver *r, bool block)
+{
+	memset(r, 0, sizeof(*r));
+	os_event_init(&r->entered, OS_EVENT_TYPE_AUTO);
+	os_event_init(&r->release, OS_EVENT_TYPE_MANUAL);
+	r->block = block;
+}
+
+static void receiver_free(struct receiver *r)
+{
+	da_free(r->dts);
+	os_event_destroy(r->entered);
+	os_event_destroy(r->release);
+}
+
+static void receive(void *param, struct encoder_packet *packet, struct encoder_packet_time *packet_time)
+{
+	struct receiver *r = param;
+	UNUSED_PARAMETER(packet_time);
+
+	da_push_back(r->dts, &packet->dts);
+	os_event_signal(r->entered);
+
+	if (r->block)
+		os_event_wait(r->release);
+}
+
+static size_t push(struct packet_queue *pq, enum obs_encoder_type type, int64_t dts, bool keyframe, size_t size)
+{
+	struct encoder_packet pkt = {0};
+	size_t flushed;
+
+	obs_encoder_packet_alloc(&pkt, size);
+	pkt.type = type;
+	pkt.dts = dts;
+	pkt.keyframe = keyframe;
+
+	flushed = packet_queue_push(pq, &pkt, NULL, 0);
+	obs_encoder_packet_release(&pkt);
+	return flushed;
+}
+
+static void start_stop_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct packet_queue pq;
+	struct receiver r;
+
+	receiver_init(&r, false);
+	assert_true(packet_queue_init(&pq));
+
+	assert_true(packet_queue_start(&pq, receive, &r));
+	for (int64_t i = 0; i < 500; i++)
+		push(&pq, (i % 3) ? OBS_ENCODER_AUDIO : OBS_ENCODER_VIDEO, i, i == 0, 64);
+	packet_queue_stop(&pq);
+
+	/* stopping passes on everything that was queued, in order */
+	assert_int_equal(r.dts.num, 500);
+	for (size_t i = 0; i < r.dts.num; i++)
+		assert_int_equal(r.dts.array[i], (int64_t)i);
+	assert_int_equal(packet_queue_depth(&pq), 0);
+	assert_int_equal(packet_queue_dropped_frames(&pq), 0);
+	assert_false(pq.thread_active);
+
+	/* outputs are restarted with the same queue */
+	assert_true(packet_queue_start(&pq, receive, &r));
+	push(&pq, OBS_ENCODER_VIDEO, 500, true, 64);
+	packet_queue_stop(&pq);
+	assert_int_equal(r.dts.num, 501);
+
+	/* stopping twice is harmless */
+	packet_queue_stop(&pq);
+
+	packet_queue_free(&pq);
+	receiver_free(&r);
+}
+
+static void drop_policy_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct packet_queue pq;
+	struct receiver r;
+
+	receiver_init(&r, true);
+	assert_true(packet_queue_init(&pq));
+	packet_queue_set_policy(&pq, OBS_OUTPUT_QUEUE_DROP, 4);
+	assert_true(packet_queue_start(&pq, receive, &r));
+
+	/* the output is stuck on the first packet */
+	push(&pq, OBS_ENCODER_VIDEO, 0, true, 64);
+	os_event_wait(r.entered);
+
+	assert_int_equal(push(&pq, OBS_ENCODER_VIDEO, 1, false, 64), 0);
+	assert_int_equal(push(&pq, OBS_ENCODER_AUDIO, 2, false, 64), 0);
+	assert_int_equal(push(&pq, OBS_ENCODER_VIDEO, 3, false, 64), 0);
+	assert_int_equal(push(&pq, OBS_ENCODER_AUDIO, 4, false, 64), 0);
+	assert_int_equal(packet_queue_depth(&pq), 4);
+
+	/* full, so the queue is flushed and the delta frame is dropped */
+	assert_int_equal(push(&pq, OBS_ENCODER_VIDEO, 5, false, 64), 4);
+	assert_int_equal(packet_queue_depth(&pq), 0);
+	assert_int_equal(packet_queue_dropped_frames(&pq), 3);
+
+	/* audio goes through, video waits for the next keyframe */
+	push(&pq, OBS_ENCODER_AUDIO, 6, false, 64);
+	push(&pq, OBS_ENCODER_VIDEO, 7, false, 64);
+	push(&pq, OBS_ENCODER_VIDEO, 8, true, 64);
+	push(&pq, OBS_ENCODER_VIDEO, 9, false, 64);
+	assert_int_equal(packet_queue_depth(&pq), 3);
+	assert_int_equal(packet_queue_dropped_frames(&pq), 4);
+
+	os_event_signal(r.release);
+	packet_queue_stop(&pq);
+
+	int64_t expected[] = {0, 6, 8, 9};
+	assert_int_equal(r.dts.num, 4);
+	for (size_t i = 0; i < r.dts.num; i++)
+		assert_int_equal(r.dts.array[i], expected[i]);
+
+	/* the counters start over with the next start */
+	assert_true(packet_queue_start(&pq, receive, &r));
+	assert_int_equal(packet_queue_dropped_frames(&pq), 0);
+	packet_queue_stop(&pq);
+
+	packet_queue_free(&pq);
+	receiver_free(&r);
+}
+
+static void byte_limit_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct packet_queue pq;
+	struct receiver r;
+
+	receiver_init(&r, true);
+	assert_true(packet_queue_init(&pq));
+	pq.max_bytes = 1000;
+	assert_true(packet_queue_start(&pq, receive, &r));
+
+	push(&pq, OBS_ENCODER_VIDEO, 0, true, 300);
+	os_event_wait(r.entered);
+
+	/* OBS_OUTPUT_QUEUE_GROW ignores the packet count ... */
+	for (int64_t i = 1; i <= 3; i++)
+		assert_int_equal(push(&pq, OBS_ENCODER_AUDIO, i, false, 300), 0);
+	assert_int_equal(packet_queue_depth(&pq), 3);
+
+	/* ... but not the amount of data */
+	assert_int_equal(push(&pq, OBS_ENCODER_AUDIO, 4, false, 300), 3);
+	assert_int_equal(packet_queue_depth(&pq), 1);
+	assert_int_equal(packet_queue_dropped_frames(&pq), 0);
+
+	/* a single packet larger than the limit is still queued */
+	assert_int_equal(push(&pq, OBS_ENCODER_VIDEO, 5, true, 2000), 1);
+	assert_int_equal(packet_queue_depth(&pq), 1);
+
+	os_event_signal(r.release);
+	packet_queue_stop(&pq);
+
+	assert_int_equal(r.dts.num, 2);
+	assert_int_equal(r.dts.array[1], 5);
+	assert_int_equal(pq.bytes, 0);
+
+	packet_queue_free(&pq);
+	receiver_free(&r);
+}
+
+static void free_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct packet_queue pq;
+	struct encoder_packet pkt = {0};
+	long allocs = bnum_allocs();
+
+	assert_true(packet_queue_init(&pq));
+
+	long *p_refs = bmalloc(sizeof(long) + 16);
+	*p_refs = 1;
+	pkt.data = (uint8_t *)(p_refs + 1);
+	pkt.size = 16;
+	pkt.type = OBS_ENCODER_AUDIO;
+
+	for (int i = 0; i < 10; i++)
+		packet_queue_push(&pq, &pkt, NULL, 0);
+	assert_int_equal(packet_queue_depth(&pq), 10);
+	assert_int_equal(*p_refs, 11);
+
+	/* packets still queued when the output is destroyed are released */
+	packet_queue_free(&pq);
+	assert_int_equal(*p_refs, 1);
+
+	obs_encoder_packet_release(&pkt);
+	assert_int_equal(bnum_allocs(), allocs);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(start_stop_test),
+		cmocka_unit_test(drop_policy_test),
+		cmocka_unit_test(byte_limit_test),
+		cmocka_unit_test(free_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
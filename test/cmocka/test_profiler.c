@@ -0,0 +1,255 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <util/profiler.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#define NUM_THREADS 8
+/* stays below the size of the per-thread ring, so nothing is dropped even if
+ * the aggregator never gets to run before the snapshot */
+#define CALLS_PER_THREAD 1000
+
+static const char *root_name = "test_root";
+static const char *child_name = "test_child";
+
+static void *profile_thread(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+
+	for (int i = 0; i < CALLS_PER_THREAD; i++) {
+		profile_start(root_name);
+		profile_start(child_name);
+		profile_end(child_name);
+		profile_end(root_name);
+	}
+
+	return NULL;
+}
+
+struct counts {
+	uint64_t root;
+	uint64_t child;
+};
+
+static bool count_child(void *data, profiler_snapshot_entry_t *entry)
+{
+	struct counts *counts = data;
+	if (profiler_snapshot_entry_name(entry) == child_name)
+		counts->child += profiler_snapshot_entry_overall_count(entry);
+	return true;
+}
+
+static bool count_root(void *data, profiler_snapshot_entry_t *entry)
+{
+	struct counts *counts = data;
+	if (profiler_snapshot_entry_name(entry) == root_name) {
+		counts->root += profiler_snapshot_entry_overall_count(entry);
+		profiler_snapshot_enumerate_children(entry, count_child, data);
+	}
+	return true;
+}
+
+static void profiler_threads_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	pthread_t threads[NUM_THREADS];
+	struct counts counts = {0};
+
+	profiler_start();
+
+	/* the first batch of threads exits before the snapshot, which
+	 * exercises handing off calls from threads that are gone */
+	for (int i = 0; i < NUM_THREADS; i++)
+		assert_int_equal(pthread_create(&threads[i], NULL, profile_thread, NULL), 0);
+	for (int i = 0; i < NUM_THREADS; i++)
+		pthread_join(threads[i], NULL);
+
+	profile_thread(NULL);
+
+	profiler_snapshot_t *snap = profile_snapshot_create();
+	profiler_snapshot_enumerate_roots(snap, count_root, &counts);
+	profile_snapshot_free(snap);
+
+	assert_int_equal(counts.root, (NUM_THREADS + 1) * CALLS_PER_THREAD);
+	assert_int_equal(counts.child, (NUM_THREADS + 1) * CALLS_PER_THREAD);
+
+	profiler_stop();
+	profiler_free();
+}
+
+static struct counts snapshot_counts(void)
+{
+	struct counts counts = {0};
+
+	profiler_snapshot_t *snap = profile_snapshot_create();
+	profiler_snapshot_enumerate_roots(snap, count_root, &counts);
+	profile_snapshot_free(snap);
+	return counts;
+}
+
+struct restart_thread {
+	os_sem_t *profiled;
+	os_sem_t *restarted;
+};
+
+/* profiles before and after the profiler is freed and started again */
+static void *restart_thread(void *param)
+{
+	struct restart_thread *rt = param;
+
+	profile_thread(NULL);
+	os_sem_post(rt->profiled);
+	os_sem_wait(rt->restarted);
+	profile_thread(NULL);
+	return NULL;
+}
+
+static void profiler_restart_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct restart_thread rt;
+	struct counts counts;
+	pthread_t thread;
+
+	assert_int_equal(os_sem_init(&rt.profiled, 0), 0);
+	assert_int_equal(os_sem_init(&rt.restarted, 0), 0);
+
+	profiler_start();
+
+	assert_int_equal(pthread_create(&thread, NULL, restart_thread, &rt), 0);
+	os_sem_wait(rt.profiled);
+	profile_thread(NULL);
+
+	counts = snapshot_counts();
+	assert_int_equal(counts.root, 2 * CALLS_PER_THREAD);
+
+	profiler_stop();
+	profiler_free();
+
+	/* both threads outlive the buffers they used, and have to get new ones
+	 * after the restart */
+	profiler_start();
+
+	os_sem_post(rt.restarted);
+	pthread_join(thread, NULL);
+	profile_thread(NULL);
+
+	counts = snapshot_counts();
+	assert_int_equal(counts.root, 2 * CALLS_PER_THREAD);
+	assert_int_equal(counts.child, 2 * CALLS_PER_THREAD);
+
+	profiler_stop();
+	profiler_free();
+
+	os_sem_destroy(rt.profiled);
+	os_sem_destroy(rt.restarted);
+}
+
+static volatile bool racing = false;
+
+static void *race_thread(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+
+	while (os_atomic_load_bool(&racing)) {
+		profile_start(root_name);
+		profile_end(root_name);
+		profile_reenable_thread();
+	}
+
+	return NULL;
+}
+
+/* threads that are in the middle of handing off a call must not have their
+ * buffers freed from under them */
+static void profiler_free_race_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	pthread_t threads[NUM_THREADS];
+
+	os_atomic_set_bool(&racing, true);
+	for (int i = 0; i < NUM_THREADS; i++)
+		assert_int_equal(pthread_create(&threads[i], NULL, race_thread, NULL), 0);
+
+	for (int i = 0; i < 200; i++) {
+		profiler_start();
+		os_sleep_ms(1);
+		profiler_free();
+	}
+
+	os_atomic_set_bool(&racing, false);
+	for (int i = 0; i < NUM_THREADS; i++)
+		pthread_join(threads[i], NULL);
+
+	profiler_free();
+}
+
+static size_t count_occurrences(const char *str, const char *find)
+{
+	size_t count = 0;
+	while ((str = strstr(str, find))) {
+		count++;
+		str += strlen(find);
+	}
+	return count;
+}
+
+static void profiler_trace_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	const char *path = "test_profiler_trace.json";
+	pthread_t thread;
+
+	profiler_start();
+
+	/* nothing is recorded before the trace starts */
+	profile_thread(NULL);
+
+	profiler_trace_start(16, NULL);
+	assert_true(profiler_trace_active());
+
+	assert_int_equal(pthread_create(&thread, NULL, profile_thread, NULL), 0);
+	pthread_join(thread, NULL);
+	profile_thread(NULL);
+
+	assert_true(profiler_trace_dump_json(path));
+	profiler_trace_stop();
+	assert_false(profiler_trace_active());
+
+	char *json = os_quick_read_utf8_file(path);
+	assert_non_null(json);
+
+	/* two threads, each keeping the last 16 of its events, and each named
+	 * after its root in the thread name metadata */
+	assert_int_equal(count_occurrences(json, "\"thread_name\""), 2);
+	assert_int_equal(count_occurrences(json, "\"ph\":\"X\""), 32);
+	assert_int_equal(count_occurrences(json, "\"args\":{\"name\":\"test_root\"}"), 2);
+	assert_int_equal(count_occurrences(json, "\"name\":\"test_root\"}"), 16 + 2);
+	assert_int_equal(count_occurrences(json, "\"name\":\"test_child\"}"), 16);
+	assert_non_null(strstr(json, "\"traceEvents\":["));
+
+	bfree(json);
+	os_unlink(path);
+
+	profiler_stop();
+	profiler_free();
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(profiler_threads_test),
+		cmocka_unit_test(profiler_restart_test),
+		cmocka_unit_test(profiler_free_race_test),
+		cmocka_unit_test(profiler_trace_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
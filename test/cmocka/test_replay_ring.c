@@ -0,0 +1,169 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <replay-ring.h>
+#include <util/platform.h>
+
+#define RING_DIR "replay-ring-test"
+#define RING_SIZE 4096
+#define GROUP_SIZE 5
+
+static uint8_t buf[RING_SIZE];
+
+static bool push(struct replay_ring *ring, int64_t dts, size_t size)
+{
+	struct encoder_packet pkt = {0};
+
+	for (size_t i = 0; i < size; i++)
+		buf[i] = (uint8_t)(dts + i);
+
+	pkt.data = buf;
+	pkt.size = size;
+	pkt.type = OBS_ENCODER_VIDEO;
+	pkt.dts = dts;
+	pkt.pts = dts;
+	pkt.dts_usec = dts * 1000;
+	pkt.keyframe = dts % GROUP_SIZE == 0;
+	pkt.timebase_num = 1;
+	pkt.timebase_den = 1000;
+
+	return replay_ring_push(ring, &pkt);
+}
+
+static void check_packet(const struct encoder_packet *pkt, int64_t dts)
+{
+	assert_int_equal(pkt->dts, dts);
+	assert_int_equal(pkt->pts, dts);
+	assert_int_equal(pkt->dts_usec, dts * 1000);
+	assert_int_equal(pkt->keyframe, dts % GROUP_SIZE == 0);
+	assert_int_equal(pkt->type, OBS_ENCODER_VIDEO);
+
+	for (size_t i = 0; i < pkt->size; i++)
+		assert_int_equal(pkt->data[i], (uint8_t)(dts + i));
+}
+
+/* reads everything in the ring, returns the number of packets */
+static size_t check_ring(struct replay_ring *ring, int64_t last)
+{
+	struct replay_ring_iter iter;
+	struct encoder_packet pkt;
+	int64_t dts = -1;
+	size_t count = 0;
+
+	replay_ring_read_begin(ring, &iter);
+	while (replay_ring_read_next(ring, &iter, &pkt)) {
+		/* the ring always starts with a keyframe */
+		if (dts == -1)
+			assert_true(pkt.keyframe);
+		else
+			assert_int_equal(pkt.dts, dts + 1);
+
+		dts = pkt.dts;
+		check_packet(&pkt, dts);
+		count++;
+	}
+	replay_ring_read_end(ring);
+
+	assert_int_equal(dts, last);
+	return count;
+}
+
+static void wrap_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct replay_ring *ring = replay_ring_create(RING_DIR, RING_SIZE);
+	assert_non_null(ring);
+
+	/* sizes that don't divide the ring, so records get split at every
+	 * possible offset from the end of the mapping */
+	for (int64_t dts = 0; dts < 2000; dts++) {
+		assert_true(push(ring, dts, 37 + (size_t)(dts * 13) % 180));
+		assert_true(replay_ring_size(ring) <= RING_SIZE);
+
+		if (dts % 7 == 0)
+			assert_true(check_ring(ring, dts) >= (dts < GROUP_SIZE ? (size_t)dts + 1 : GROUP_SIZE));
+	}
+
+	/* purging always keeps a keyframe group */
+	while (replay_ring_purge(ring))
+		;
+	assert_int_equal(replay_ring_keyframes(ring), 1);
+	assert_int_equal(replay_ring_start_time(ring), 1995 * 1000);
+	assert_int_equal(check_ring(ring, 1999), GROUP_SIZE);
+
+	/* a packet larger than the ring is dropped along with the rest of
+	 * its keyframe group */
+	assert_false(push(ring, 2000, RING_SIZE));
+	assert_false(push(ring, 2001, 100));
+	assert_true(push(ring, 2005, 100));
+
+	replay_ring_clear(ring);
+	assert_int_equal(replay_ring_size(ring), 0);
+	assert_int_equal(replay_ring_keyframes(ring), 0);
+
+	replay_ring_destroy(ring);
+}
+
+static void pin_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct replay_ring *ring = replay_ring_create(RING_DIR, RING_SIZE);
+	struct replay_ring_iter iter;
+	struct encoder_packet pkt;
+	int64_t dts = 0;
+
+	assert_non_null(ring);
+
+	/* wrap at least once before reading */
+	while (dts < 100)
+		assert_true(push(ring, dts++, 200));
+
+	/* a save reads from the ring while the writer keeps going */
+	replay_ring_read_begin(ring, &iter);
+	assert_true(replay_ring_read_next(ring, &iter, &pkt));
+	int64_t next = pkt.dts + 1;
+	assert_true(pkt.keyframe);
+
+	/* the writer runs out of room once it only has pinned data left */
+	while (push(ring, dts, 200))
+		dts++;
+	assert_true(dts > 100);
+	assert_false(push(ring, dts + 1, 200));
+
+	/* nothing the save hasn't read was overwritten */
+	while (replay_ring_read_next(ring, &iter, &pkt)) {
+		check_packet(&pkt, next);
+		if (next == 99)
+			break;
+		next++;
+	}
+	assert_int_equal(next, 99);
+
+	/* releasing what was read lets the writer reuse it */
+	replay_ring_read_release(ring, iter.pos);
+	dts = (dts / GROUP_SIZE + 1) * GROUP_SIZE;
+	assert_true(push(ring, dts, 200));
+
+	replay_ring_read_end(ring);
+	for (int i = 0; i < 100; i++)
+		assert_true(push(ring, ++dts, 200));
+	check_ring(ring, dts);
+
+	replay_ring_destroy(ring);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(wrap_test),
+		cmocka_unit_test(pin_test),
+	};
+
+	int ret = cmocka_run_group_tests(tests, NULL, NULL);
+	os_rmdir(RING_DIR);
+	return ret;
+}
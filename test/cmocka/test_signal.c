@@ -0,0 +1,191 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <callback/signal.h>
+#include <callback/proc.h>
+#include <util/dstr.h>
+
+#define NUM_SIGNALS 64
+#define GLOBAL_TEST_SIGNALS (NUM_SIGNALS * 4)
+
+struct signal_counts {
+	long long calls;
+	long long global_calls;
+	long long value_sum;
+};
+
+static void count_signal(void *data, calldata_t *cd)
+{
+	struct signal_counts *counts = data;
+	counts->calls++;
+	counts->value_sum += calldata_int(cd, "value");
+}
+
+static void count_global(void *data, const char *signal, calldata_t *cd)
+{
+	struct signal_counts *counts = data;
+	counts->global_calls++;
+
+	UNUSED_PARAMETER(signal);
+	UNUSED_PARAMETER(cd);
+}
+
+static void add_signals(signal_handler_t *handler, struct dstr *names)
+{
+	struct dstr decl = {0};
+
+	for (int i = 0; i < NUM_SIGNALS; i++) {
+		dstr_printf(&names[i], "signal_%d", i);
+		dstr_printf(&decl, "void %s(int value)", names[i].array);
+		assert_true(signal_handler_add(handler, decl.array));
+	}
+
+	dstr_free(&decl);
+}
+
+static void signal_lookup_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	signal_handler_t *handler = signal_handler_create();
+	struct signal_counts counts[NUM_SIGNALS] = {0};
+	struct dstr names[NUM_SIGNALS] = {0};
+	uint8_t stack[128];
+	calldata_t cd;
+
+	add_signals(handler, names);
+	assert_false(signal_handler_add(handler, "void signal_0(int value)"));
+
+	for (int i = 0; i < NUM_SIGNALS; i++)
+		signal_handler_connect(handler, names[i].array, count_signal, &counts[i]);
+
+	calldata_init_fixed(&cd, stack, sizeof(stack));
+	for (int i = 0; i < NUM_SIGNALS; i++) {
+		calldata_set_int(&cd, "value", i);
+		signal_handler_signal(handler, names[i].array, &cd);
+	}
+
+	/* unknown signals are ignored */
+	signal_handler_signal(handler, "signal_", &cd);
+	signal_handler_signal(handler, "signal_00", &cd);
+
+	for (int i = 0; i < NUM_SIGNALS; i++) {
+		assert_int_equal(counts[i].calls, 1);
+		assert_int_equal(counts[i].value_sum, i);
+	}
+
+	signal_handler_disconnect(handler, names[1].array, count_signal, &counts[1]);
+	signal_handler_signal(handler, names[1].array, &cd);
+	assert_int_equal(counts[1].calls, 1);
+
+	for (int i = 0; i < NUM_SIGNALS; i++)
+		dstr_free(&names[i]);
+	signal_handler_destroy(handler);
+}
+
+static void call_proc(void *data, calldata_t *cd)
+{
+	long long *value = data;
+	*value = calldata_int(cd, "value");
+	calldata_set_int(cd, "result", *value * 2);
+}
+
+static void proc_lookup_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	proc_handler_t *handler = proc_handler_create();
+	long long values[2] = {0};
+	calldata_t cd;
+
+	proc_handler_add(handler, "int double_a(int value)", call_proc, &values[0]);
+	proc_handler_add(handler, "int double_b(int value)", call_proc, &values[1]);
+	proc_handler_add(handler, "int double_a(int value)", call_proc, NULL);
+
+	calldata_init(&cd);
+	calldata_set_int(&cd, "value", 21);
+	assert_true(proc_handler_call(handler, "double_b", &cd));
+	assert_int_equal(values[1], 21);
+	assert_int_equal(calldata_int(&cd, "result"), 42);
+
+	assert_true(proc_handler_call(handler, "double_a", &cd));
+	assert_int_equal(values[0], 21);
+	assert_false(proc_handler_call(handler, "double_c", &cd));
+	calldata_free(&cd);
+
+	proc_handler_destroy(handler);
+}
+
+static void calldata_names_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	uint8_t stack[256];
+	calldata_t cd;
+
+	/* names sharing prefixes or lengths must not be confused */
+	calldata_init_fixed(&cd, stack, sizeof(stack));
+	calldata_set_int(&cd, "vol", 1);
+	calldata_set_int(&cd, "volume", 2);
+	calldata_set_int(&cd, "volumf", 3);
+	calldata_set_string(&cd, "v", "str");
+
+	assert_int_equal(calldata_int(&cd, "vol"), 1);
+	assert_int_equal(calldata_int(&cd, "volume"), 2);
+	assert_int_equal(calldata_int(&cd, "volumf"), 3);
+	assert_string_equal(calldata_string(&cd, "v"), "str");
+	assert_null(calldata_string(&cd, "vo"));
+
+	calldata_set_int(&cd, "volume", 4);
+	assert_int_equal(calldata_int(&cd, "volume"), 4);
+	assert_int_equal(calldata_int(&cd, "volumf"), 3);
+}
+
+/* every signal reaches both its own and the global callbacks */
+static void signal_global_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	signal_handler_t *handler = signal_handler_create();
+	struct signal_counts counts = {0};
+	struct signal_counts global_counts = {0};
+	struct dstr names[NUM_SIGNALS] = {0};
+	uint8_t stack[128];
+	calldata_t cd;
+
+	add_signals(handler, names);
+
+	for (int i = 0; i < NUM_SIGNALS; i++)
+		signal_handler_connect(handler, names[i].array, count_signal, &counts);
+	signal_handler_connect_global(handler, count_global, &global_counts);
+
+	for (int i = 0; i < GLOBAL_TEST_SIGNALS; i++) {
+		calldata_init_fixed(&cd, stack, sizeof(stack));
+		calldata_set_int(&cd, "value", 1);
+		signal_handler_signal(handler, names[i % NUM_SIGNALS].array, &cd);
+	}
+
+	assert_int_equal(counts.calls, GLOBAL_TEST_SIGNALS);
+	assert_int_equal(counts.value_sum, GLOBAL_TEST_SIGNALS);
+	assert_int_equal(global_counts.global_calls, GLOBAL_TEST_SIGNALS);
+
+	signal_handler_disconnect_global(handler, count_global, &global_counts);
+
+	for (int i = 0; i < NUM_SIGNALS; i++)
+		dstr_free(&names[i]);
+	signal_handler_destroy(handler);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(signal_lookup_test),
+		cmocka_unit_test(proc_lookup_test),
+		cmocka_unit_test(calldata_names_test),
+		cmocka_unit_test(signal_global_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,396 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <media-io/video-io.h>
+#include <media-io/video-frame.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#define WIDTH 64
+#define HEIGHT 64
+#define MAX_RECEIVED 16
+#define TIMEOUT_MS 5000
+
+/* planes owned by the test that video-io references instead of copying */
+struct ref_frame {
+	uint8_t data[WIDTH * HEIGHT];
+	volatile long released;
+};
+
+struct received_frame {
+	uint8_t *data;
+	uint8_t value;
+	uint64_t timestamp;
+};
+
+/* raw video input, called back on the video thread or on its own thread, so
+ * it only records what it got and the test checks that afterwards */
+struct receiver {
+	struct received_frame frames[MAX_RECEIVED];
+	volatile long count;
+	os_event_t *entered;
+	os_event_t *resume;
+	bool block;
+
+	/* disconnects the input from within its first callback */
+	video_t *disconnect;
+};
+
+static void release_frame(void *param)
+{
+	struct ref_frame *frame = param;
+	os_atomic_inc_long(&frame->released);
+}
+
+static void receive(void *param, struct video_data *frame)
+{
+	struct receiver *r = param;
+	long idx = os_atomic_load_long(&r->count);
+
+	if (idx < MAX_RECEIVED) {
+		r->frames[idx].data = frame->data[0];
+		r->frames[idx].value = frame->data[0][0];
+		r->frames[idx].timestamp = frame->timestamp;
+	}
+	os_atomic_inc_long(&r->count);
+
+	if (r->disconnect) {
+		video_output_disconnect(r->disconnect, receive, r);
+		r->disconnect = NULL;
+	}
+
+	os_event_signal(r->entered);
+
+	if (r->block)
+		os_event_wait(r->resume);
+}
+
+static void receiver_init(struct receiver *r, bool block)
+{
+	memset(r, 0, sizeof(*r));
+	os_event_init(&r->entered, OS_EVENT_TYPE_AUTO);
+	os_event_init(&r->resume, OS_EVENT_TYPE_MANUAL);
+	r->block = block;
+}
+
+static void receiver_free(struct receiver *r)
+{
+	os_event_destroy(r->entered);
+	os_event_destroy(r->resume);
+}
+
+static bool wait_for(volatile long *val, long expected)
+{
+	for (int i = 0; i < TIMEOUT_MS; i++) {
+		if (os_atomic_load_long(val) >= expected)
+			return true;
+		os_sleep_ms(1);
+	}
+
+	return false;
+}
+
+/* waits until the video thread is done with the given number of frames */
+static bool wait_for_output(video_t *video, uint32_t frames)
+{
+	for (int i = 0; i < TIMEOUT_MS; i++) {
+		if (video_output_get_total_frames(video) >= frames)
+			return true;
+		os_sleep_ms(1);
+	}
+
+	return false;
+}
+
+static video_t *open_video(size_t cache_size)
+{
+	struct video_output_info info = {
+		.name = "test",
+		.format = VIDEO_FORMAT_Y800,
+		.fps_num = 30,
+		.fps_den = 1,
+		.width = WIDTH,
+		.height = HEIGHT,
+		.cache_size = cache_size,
+		.colorspace = VIDEO_CS_709,
+		.range = VIDEO_RANGE_PARTIAL,
+	};
+	video_t *video = NULL;
+
+	assert_int_equal(video_output_open(&video, &info), VIDEO_OUTPUT_SUCCESS);
+	return video;
+}
+
+static bool reference(video_t *video, struct ref_frame *frame, uint8_t value, uint64_t timestamp)
+{
+	struct video_frame planes = {0};
+
+	memset(frame->data, value, sizeof(frame->data));
+	frame->released = 0;
+	planes.data[0] = frame->data;
+	planes.linesize[0] = WIDTH;
+
+	return video_output_reference_frame(video, &planes, 1, timestamp, release_frame, frame);
+}
+
+/* outputs a copied frame, returns its buffer */
+static uint8_t *output_copy(video_t *video, uint8_t value, uint64_t timestamp)
+{
+	struct video_frame frame;
+
+	assert_true(video_output_lock_frame(video, &frame, 1, timestamp));
+	memset(frame.data[0], value, (size_t)frame.linesize[0] * HEIGHT);
+	video_output_unlock_frame(video);
+	return frame.data[0];
+}
+
+static void zero_copy_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	long allocs = bnum_allocs();
+	struct ref_frame a;
+	struct receiver r;
+	video_t *video = open_video(2);
+	uint64_t frame_time = video_output_get_frame_time(video);
+
+	receiver_init(&r, false);
+	video_output_set_zero_copy(video, true);
+	assert_true(video_output_get_zero_copy(video));
+	assert_true(video_output_connect(video, NULL, receive, &r));
+
+	/* the input gets the referenced planes, which are released as soon
+	 * as the video thread is done with the frame */
+	assert_true(reference(video, &a, 0xA1, 0));
+	assert_true(wait_for_output(video, 1));
+	assert_int_equal(r.count, 1);
+	assert_ptr_equal(r.frames[0].data, a.data);
+	assert_int_equal(r.frames[0].value, 0xA1);
+	assert_int_equal(a.released, 1);
+
+	/* the cache entries got their own buffers back */
+	for (int i = 1; i <= 2; i++)
+		assert_ptr_not_equal(output_copy(video, (uint8_t)i, frame_time * i), a.data);
+	assert_true(wait_for_output(video, 3));
+	assert_int_equal(r.count, 3);
+	assert_int_equal(r.frames[1].value, 1);
+	assert_int_equal(r.frames[2].value, 2);
+
+	video_output_disconnect(video, receive, &r);
+	video_output_close(video);
+	assert_int_equal(a.released, 1);
+	receiver_free(&r);
+	assert_int_equal(bnum_allocs(), allocs);
+}
+
+static void zero_copy_threaded_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	long allocs = bnum_allocs();
+	struct ref_frame a, b;
+	struct receiver r;
+	uint8_t *copy;
+	video_t *video = open_video(1);
+	uint64_t frame_time = video_output_get_frame_time(video);
+
+	receiver_init(&r, true);
+	video_output_set_zero_copy(video, true);
+	video_output_set_parallel_inputs(video, true);
+	assert_true(video_output_connect(video, NULL, receive, &r));
+
+	assert_true(reference(video, &a, 0xA1, 0));
+	os_event_wait(r.entered);
+	assert_true(wait_for_output(video, 1));
+
+	/* the only cache entry is reused while the input still has the
+	 * frame, so the planes are not released yet and the entry doesn't
+	 * hand them out again */
+	assert_int_equal(a.released, 0);
+	copy = output_copy(video, 0x22, frame_time);
+	assert_ptr_not_equal(copy, a.data);
+	assert_true(wait_for_output(video, 2));
+
+	assert_true(reference(video, &b, 0xB1, frame_time * 2));
+	assert_true(wait_for_output(video, 3));
+	assert_int_equal(a.released, 0);
+	assert_int_equal(b.released, 0);
+
+	/* every referenced frame is released once the input is done */
+	os_event_signal(r.resume);
+	assert_true(wait_for(&b.released, 1));
+	assert_int_equal(a.released, 1);
+	assert_int_equal(r.count, 3);
+	assert_ptr_equal(r.frames[0].data, a.data);
+	assert_int_equal(r.frames[0].value, 0xA1);
+	assert_ptr_equal(r.frames[1].data, copy);
+	assert_int_equal(r.frames[1].value, 0x22);
+	assert_ptr_equal(r.frames[2].data, b.data);
+	assert_int_equal(r.frames[2].value, 0xB1);
+
+	video_output_close(video);
+	assert_int_equal(a.released, 1);
+	assert_int_equal(b.released, 1);
+	receiver_free(&r);
+	assert_int_equal(bnum_allocs(), allocs);
+}
+
+static void zero_copy_close_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	long allocs = bnum_allocs();
+	struct ref_frame a, b, c;
+	struct receiver r;
+	video_t *video = open_video(2);
+	uint64_t frame_time = video_output_get_frame_time(video);
+
+	receiver_init(&r, true);
+	video_output_set_zero_copy(video, true);
+	video_output_set_parallel_inputs(video, true);
+	assert_true(video_output_connect(video, NULL, receive, &r));
+
+	/* one frame in the input's callback, one in its queue */
+	assert_true(reference(video, &a, 0xA1, 0));
+	os_event_wait(r.entered);
+	assert_true(reference(video, &b, 0xB1, frame_time));
+	assert_true(wait_for_output(video, 2));
+
+	/* and one the video thread never gets to */
+	video_output_stop(video);
+	assert_true(reference(video, &c, 0xC1, frame_time * 2));
+
+	os_event_signal(r.resume);
+	video_output_close(video);
+	assert_int_equal(a.released, 1);
+	assert_int_equal(b.released, 1);
+	assert_int_equal(c.released, 1);
+	receiver_free(&r);
+	assert_int_equal(bnum_allocs(), allocs);
+}
+
+static void check_stats(video_t *video, struct receiver *r, uint32_t total, uint32_t lagged, uint32_t skipped)
+{
+	struct video_input_stats stats;
+
+	assert_true(video_output_get_input_stats(video, receive, r, &stats));
+	assert_true(stats.threaded);
+	assert_int_equal(stats.total_frames, total);
+	assert_int_equal(stats.lagged_frames, lagged);
+	assert_int_equal(stats.skipped_frames, skipped);
+}
+
+static void parallel_inputs_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct receiver slow, fast;
+	video_t *video;
+	uint64_t frame_time;
+	uint8_t *held;
+
+	receiver_init(&slow, true);
+	receiver_init(&fast, false);
+
+	long allocs = bnum_allocs();
+
+	video = open_video(2);
+	frame_time = video_output_get_frame_time(video);
+	video_output_set_parallel_inputs(video, true);
+	assert_true(video_output_connect(video, NULL, receive, &slow));
+	assert_true(video_output_connect(video, NULL, receive, &fast));
+
+	/* the slow input is stuck on the first frame */
+	output_copy(video, 1, 0);
+	os_event_wait(slow.entered);
+	assert_true(wait_for(&fast.count, 1));
+	held = slow.frames[0].data;
+
+	/* the other input keeps getting frames, and no buffer the slow input
+	 * still has is handed out again */
+	for (uint32_t i = 1; i < 5; i++) {
+		assert_true(output_copy(video, (uint8_t)(i + 1), frame_time * i) != held);
+		assert_true(wait_for_output(video, i + 1));
+		assert_true(wait_for(&fast.count, i + 1));
+	}
+	assert_int_equal(held[0], 1);
+
+	/* two frames fit in the slow input's queue, the rest are skipped */
+	check_stats(video, &slow, 5, 1, 2);
+	check_stats(video, &fast, 5, 0, 0);
+
+	os_event_signal(slow.resume);
+	assert_true(wait_for(&slow.count, 3));
+
+	/* the next frame is repeated in place of the skipped ones, with the
+	 * timestamps they would have had */
+	output_copy(video, 6, frame_time * 5);
+	assert_true(wait_for(&slow.count, 6));
+	assert_true(wait_for(&fast.count, 6));
+	check_stats(video, &slow, 6, 1, 2);
+	check_stats(video, &fast, 6, 0, 0);
+
+	const uint8_t slow_values[] = {1, 2, 3, 6, 6, 6};
+	for (int i = 0; i < 6; i++) {
+		assert_int_equal(slow.frames[i].value, slow_values[i]);
+		assert_int_equal(slow.frames[i].timestamp, frame_time * i);
+		assert_int_equal(fast.frames[i].value, i + 1);
+		assert_int_equal(fast.frames[i].timestamp, frame_time * i);
+	}
+
+	/* closing with the inputs still connected stops their threads and
+	 * frees every buffer they referenced */
+	video_output_close(video);
+	assert_int_equal(slow.count, 6);
+	assert_int_equal(fast.count, 6);
+	assert_int_equal(bnum_allocs(), allocs);
+
+	receiver_free(&slow);
+	receiver_free(&fast);
+}
+
+static void self_disconnect_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct receiver r;
+	struct video_input_stats stats;
+	video_t *video;
+
+	receiver_init(&r, false);
+
+	long allocs = bnum_allocs();
+
+	video = open_video(2);
+	video_output_set_parallel_inputs(video, true);
+	r.disconnect = video;
+	assert_true(video_output_connect(video, NULL, receive, &r));
+
+	output_copy(video, 1, 0);
+	os_event_wait(r.entered);
+	assert_false(video_output_get_input_stats(video, receive, &r, &stats));
+	assert_false(video_output_active(video));
+
+	/* the input's thread is still joined and freed on close */
+	video_output_close(video);
+	assert_int_equal(r.count, 1);
+	assert_int_equal(bnum_allocs(), allocs);
+
+	receiver_free(&r);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(zero_copy_test),
+		cmocka_unit_test(zero_copy_threaded_test),
+		cmocka_unit_test(zero_copy_close_test),
+		cmocka_unit_test(parallel_inputs_test),
+		cmocka_unit_test(self_disconnect_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}